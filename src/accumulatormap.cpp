@@ -41,13 +41,14 @@ void AccumulatorMap::Reset(libzerocoin::ZerocoinParams* params2)
 }
 
 //Load a checkpoint containing 8 32bit checksums of accumulator values.
+//Values of recent checkpoints are kept in memory, so the database is only hit for older ones.
 bool AccumulatorMap::Load(uint256 nCheckpoint)
 {
     for (auto& denom : zerocoinDenomList) {
         uint32_t nChecksum = ParseChecksum(nCheckpoint, denom);
 
         CBigNum bnValue;
-        if (!zerocoinDB->ReadAccumulatorValue(nChecksum, bnValue))
+        if (!GetAccumulatorValueFromChecksum(nChecksum, true, bnValue) && !zerocoinDB->ReadAccumulatorValue(nChecksum, bnValue))
             return error("%s : cannot find checksum %d", __func__, nChecksum);
 
         mapAccumulators.at(denom)->setValue(bnValue);
@@ -266,13 +266,9 @@ bool CalculateAccumulatorCheckpoint(int nHeight, uint256& nCheckpoint, Accumulat
             continue;
         }
 
-        //grab mints from this block
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex))
-            return error("%s: failed to read block from disk", __func__);
-
+        //grab mints from this block, using the pubcoin index instead of deserializing the block
         std::list<PublicCoin> listPubcoins;
-        if (!BlockToPubcoinList(block, listPubcoins, fFilterInvalid))
+        if (!BlockIndexToPubcoinList(pindex, listPubcoins, fFilterInvalid))
             return error("%s: failed to get zerocoin mintlist from block %d", __func__, pindex->nHeight);
 
         nTotalMintsFound += listPubcoins.size();
@@ -349,7 +345,7 @@ int ComputeAccumulatedCoins(int nHeightEnd, libzerocoin::CoinDenomination denom)
     CBlockIndex* pindex = chainActive[GetZerocoinStartHeight()];
     int n = 0;
     while (pindex->nHeight < nHeightEnd) {
-        n += count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), denom);
+        n += pindex->vMintsInBlock.at(denom);
         pindex = chainActive.Next(pindex);
     }
 
@@ -363,12 +359,8 @@ int AddBlockMintsToAccumulator(const libzerocoin::PublicCoin& coin, const int nH
     int nMintsAdded = 0;
     if (pindex->MintedDenomination(coin.getDenomination())) {
         //grab mints from this block
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex))
-            return error("%s: failed to read block from disk while adding pubcoins to witness", __func__);
-
         list<PublicCoin> listPubcoins;
-        if(!BlockToPubcoinList(block, listPubcoins, true))
+        if(!BlockIndexToPubcoinList(pindex, listPubcoins, true))
             return error("%s: failed to get zerocoin mintlist from block %n\n", __func__, pindex->nHeight);
 
         //add the mints to the witness
@@ -413,22 +405,34 @@ bool GetAccumulatorValue(int& nHeight, const libzerocoin::CoinDenomination denom
     return true;
 }
 
-bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError, CBlockIndex* pindexCheckpoint)
+void CoinWitnessData::SetNull()
+{
+    fInitialized = false;
+    bnPubcoin = 0;
+    denom = libzerocoin::ZQ_ERROR;
+    nHeightMintAdded = 0;
+    nHeightAccStart = 0;
+    nHeightWalkStart = 0;
+    bnAccStart = 0;
+    nMintsAccumulatedBefore = -1;
+    ResetWalk();
+}
+
+void CoinWitnessData::ResetWalk()
+{
+    bnWitness = bnAccStart;
+    nHeight = nHeightWalkStart;
+    nHeightLast = 0;
+    hashBlockLast = 0;
+    nHeightMaxWalked = 0;
+    nMintsAdded = 0;
+    nCheckpointsAdded = 0;
+    fDoubleCounted = false;
+}
+
+//Find where the coin was minted and the accumulator value that its witness starts from
+bool InitializeWitnessData(const PublicCoin& coin, const Accumulator& accumulatorDefault, CoinWitnessData& data)
 {
-    LogPrint("zero", "%s: generating\n", __func__);
-    int nLockAttempts = 0;
-    while (nLockAttempts < 100) {
-        TRY_LOCK(cs_main, lockMain);
-        if(!lockMain) {
-            MilliSleep(50);
-            nLockAttempts++;
-            continue;
-        }
-        break;
-    }
-    if (nLockAttempts == 100)
-        return error("%s: could not get lock on cs_main", __func__);
-    LogPrint("zero", "%s: after lock\n", __func__);
     uint256 txid;
     if (!zerocoinDB->ReadCoinMint(coin.getValue(), txid))
         return error("%s failed to read mint from db", __func__);
@@ -442,82 +446,175 @@ bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator
     if (!IsTransactionInChain(txid, nHeightTest))
         return error("%s: mint tx %s is not in chain", __func__, txid.GetHex());
 
-    int nHeightMintAdded = mapBlockIndex[hashBlock]->nHeight;
+    data.SetNull();
+    data.bnPubcoin = coin.getValue();
+    data.denom = coin.getDenomination();
+    data.nHeightMintAdded = mapBlockIndex[hashBlock]->nHeight;
 
     //get the checkpoint added at the next multiple of 10
-    int nHeightCheckpoint = nHeightMintAdded + (10 - (nHeightMintAdded % 10));
+    int nHeightCheckpoint = data.nHeightMintAdded + (10 - (data.nHeightMintAdded % 10));
 
     //the height to start accumulating coins to add to witness
-    int nAccStartHeight = nHeightMintAdded - (nHeightMintAdded % 10);
+    data.nHeightAccStart = data.nHeightMintAdded - (data.nHeightMintAdded % 10);
 
     //Get the accumulator that is right before the cluster of blocks containing our mint was added to the accumulator
     CBigNum bnAccValue = 0;
-    if (GetAccumulatorValue(nHeightCheckpoint, coin.getDenomination(), bnAccValue)) {
-            accumulator.setValue(bnAccValue);
-            witness.resetValue(accumulator, coin);
-    }
+    data.bnAccStart = accumulatorDefault.getValue();
+    if (GetAccumulatorValue(nHeightCheckpoint, coin.getDenomination(), bnAccValue))
+        data.bnAccStart = bnAccValue;
 
     //add the pubcoins from the blockchain up to the next checksum starting from the block
-    CBlockIndex* pindex = chainActive[nHeightCheckpoint - 10];
-    int nChainHeight = chainActive.Height();
-    int nHeightStop = nChainHeight % 10;
-    nHeightStop = nChainHeight - nHeightStop - 20; // at least two checkpoints deep
-
-    //If looking for a specific checkpoint
-    if (pindexCheckpoint)
-        nHeightStop = pindexCheckpoint->nHeight - 10;
+    data.nHeightWalkStart = nHeightCheckpoint - 10;
+    data.ResetWalk();
+    data.fInitialized = true;
+    return true;
+}
 
-    //Iterate through the chain and calculate the witness
-    int nCheckpointsAdded = 0;
-    nMintsAdded = 0;
-    RandomizeSecurityLevel(nSecurityLevel); //make security level not always the same and predictable
-    libzerocoin::Accumulator witnessAccumulator = accumulator;
+//Add the mints of each block to the witness, continuing from where the last walk stopped, until a block is reached
+//that is at nHeightStop or that satisfies the security level. Returns the block the walk stopped at.
+CBlockIndex* WalkWitnessChain(CoinWitnessData& data, Accumulator& witnessAccumulator, int nHeightStop, int nSecurityLevel)
+{
+    PublicCoin coin(Params().Zerocoin_Params(false), data.bnPubcoin, data.denom);
+    witnessAccumulator.setValue(data.bnWitness);
 
-    bool fDoubleCounted = false;
+    CBlockIndex* pindex = data.nHeight <= chainActive.Height() ? chainActive[data.nHeight] : nullptr;
     while (pindex) {
-        if (pindex->nHeight != nAccStartHeight && pindex->pprev->nAccumulatorCheckpoint != pindex->nAccumulatorCheckpoint)
+        int nCheckpointsAdded = data.nCheckpointsAdded;
+        if (pindex->nHeight != data.nHeightAccStart && pindex->pprev->nAccumulatorCheckpoint != pindex->nAccumulatorCheckpoint)
             ++nCheckpointsAdded;
 
-        //If the security level is satisfied, or the stop height is reached, then initialize the accumulator from here
+        //If the security level is satisfied, or the stop height is reached, then the witness is complete.
+        //If this height is within the invalid range (when fraudulent coins were being minted), then continue past this range
         bool fSecurityLevelSatisfied = (nSecurityLevel != 100 && nCheckpointsAdded >= nSecurityLevel);
-        if (pindex->nHeight >= nHeightStop || fSecurityLevelSatisfied) {
-            //If this height is within the invalid range (when fraudulent coins were being minted), then continue past this range
-            if(InvalidCheckpointRange(pindex->nHeight))
-                continue;
-
-            bnAccValue = 0;
-            uint256 nCheckpointSpend = chainActive[pindex->nHeight + 10]->nAccumulatorCheckpoint;
-            if (!GetAccumulatorValueFromDB(nCheckpointSpend, coin.getDenomination(), bnAccValue) || bnAccValue == 0)
-                return error("%s : failed to find checksum in database for accumulator", __func__);
-
-            accumulator.setValue(bnAccValue);
+        if ((pindex->nHeight >= nHeightStop || fSecurityLevelSatisfied) && !InvalidCheckpointRange(pindex->nHeight))
             break;
-        }
 
-        nMintsAdded += AddBlockMintsToAccumulator(coin, nHeightMintAdded, pindex, &witnessAccumulator, true);
+        data.nCheckpointsAdded = nCheckpointsAdded;
+        data.nMintsAdded += AddBlockMintsToAccumulator(coin, data.nHeightMintAdded, pindex, &witnessAccumulator, true);
+        data.nHeightLast = pindex->nHeight;
+        data.hashBlockLast = pindex->GetBlockHash();
+        data.nHeightMaxWalked = std::max(data.nHeightMaxWalked, pindex->nHeight);
 
         // 10 blocks were accumulated twice when zVITAE v2 was activated
-        if (pindex->nHeight == 1050010 && !fDoubleCounted) {
+        if (pindex->nHeight == 1050010 && !data.fDoubleCounted) {
             pindex = chainActive[1050000];
-            fDoubleCounted = true;
+            data.fDoubleCounted = true;
             continue;
         }
 
         pindex = chainActive.Next(pindex);
     }
 
+    data.nHeight = pindex ? pindex->nHeight : chainActive.Height() + 1;
+    data.bnWitness = witnessAccumulator.getValue();
+    return pindex;
+}
+
+//Whether the part of the chain already added to a cached witness is still valid for a walk with these stop conditions
+bool CanResumeWitness(const CoinWitnessData& data, int nHeightStop, int nSecurityLevel)
+{
+    if (!data.fInitialized)
+        return false;
+
+    //Nothing walked yet
+    if (data.hashBlockLast == 0)
+        return true;
+
+    //A reorg replaced blocks that were added to the witness
+    if (data.nHeightLast > chainActive.Height() || chainActive[data.nHeightLast]->GetBlockHash() != data.hashBlockLast)
+        return false;
+
+    //The walk would have stopped at a block that is already added
+    if (data.nHeightMaxWalked >= nHeightStop)
+        return false;
+
+    return nSecurityLevel == 100 || data.nCheckpointsAdded < nSecurityLevel;
+}
+
+bool AdvanceAccumulatorWitness(CoinWitnessData& data, int nHeightTarget)
+{
+    AssertLockHeld(cs_main);
+    if (!CanResumeWitness(data, nHeightTarget, 100)) {
+        if (!data.fInitialized)
+            return false;
+        data.ResetWalk();
+    }
+
+    if (data.nHeight >= nHeightTarget)
+        return true;
+
+    Accumulator witnessAccumulator(Params().Zerocoin_Params(false), data.denom);
+    WalkWitnessChain(data, witnessAccumulator, nHeightTarget, 100);
+    return true;
+}
+
+bool GenerateAccumulatorWitness(const PublicCoin &coin, Accumulator& accumulator, AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, string& strError, CBlockIndex* pindexCheckpoint, CoinWitnessData* pWitnessData)
+{
+    LogPrint("zero", "%s: generating\n", __func__);
+    int nLockAttempts = 0;
+    while (nLockAttempts < 100) {
+        TRY_LOCK(cs_main, lockMain);
+        if(!lockMain) {
+            MilliSleep(50);
+            nLockAttempts++;
+            continue;
+        }
+        break;
+    }
+    if (nLockAttempts == 100)
+        return error("%s: could not get lock on cs_main", __func__);
+    LogPrint("zero", "%s: after lock\n", __func__);
+
+    //Use the cached progress of this coin if there is any
+    CoinWitnessData dataNew;
+    CoinWitnessData& data = pWitnessData ? *pWitnessData : dataNew;
+    if (data.fInitialized && data.bnPubcoin != coin.getValue())
+        data.SetNull();
+    if (!data.fInitialized && !InitializeWitnessData(coin, accumulator, data))
+        return false;
+
+    int nChainHeight = chainActive.Height();
+    int nHeightStop = nChainHeight % 10;
+    nHeightStop = nChainHeight - nHeightStop - 20; // at least two checkpoints deep
+
+    //If looking for a specific checkpoint
+    if (pindexCheckpoint)
+        nHeightStop = pindexCheckpoint->nHeight - 10;
+
+    //Iterate through the chain and calculate the witness
+    RandomizeSecurityLevel(nSecurityLevel); //make security level not always the same and predictable
+    if (!CanResumeWitness(data, nHeightStop, nSecurityLevel))
+        data.ResetWalk();
+    else if (data.hashBlockLast != 0)
+        LogPrint("zero", "%s : resuming witness from height %d\n", __func__, data.nHeight);
+
+    accumulator.setValue(data.bnAccStart);
+    libzerocoin::Accumulator witnessAccumulator = accumulator;
+    CBlockIndex* pindex = WalkWitnessChain(data, witnessAccumulator, nHeightStop, nSecurityLevel);
+    if (pindex) {
+        CBigNum bnAccValue = 0;
+        uint256 nCheckpointSpend = chainActive[pindex->nHeight + 10]->nAccumulatorCheckpoint;
+        if (!GetAccumulatorValueFromDB(nCheckpointSpend, coin.getDenomination(), bnAccValue) || bnAccValue == 0)
+            return error("%s : failed to find checksum in database for accumulator", __func__);
+
+        accumulator.setValue(bnAccValue);
+    }
+
     witness.resetValue(witnessAccumulator, coin);
     if (!witness.VerifyWitness(accumulator, coin))
         return error("%s: failed to verify witness", __func__);
 
     // A certain amount of accumulated coins are required
+    nMintsAdded = data.nMintsAdded;
     if (nMintsAdded < Params().Zerocoin_RequiredAccumulation()) {
         strError = _(strprintf("Less than %d mints added, unable to create spend", Params().Zerocoin_RequiredAccumulation()).c_str());
         return error("%s : %s", __func__, strError);
     }
 
     // calculate how many mints of this denomination existed in the accumulator we initialized
-    nMintsAdded += ComputeAccumulatedCoins(nAccStartHeight, coin.getDenomination());
+    if (data.nMintsAccumulatedBefore < 0)
+        data.nMintsAccumulatedBefore = ComputeAccumulatedCoins(data.nHeightAccStart, coin.getDenomination());
+    nMintsAdded += data.nMintsAccumulatedBefore;
     LogPrint("zero", "%s : %d mints added to witness\n", __func__, nMintsAdded);
 
     return true;
@@ -540,8 +637,7 @@ map<CoinDenomination, int> GetMintMaturityHeight()
         for (auto denom : libzerocoin::zerocoinDenomList) {
             //If the denom has not already had a mint added to it, then see if it has a mint added on this block
             if (mapDenomMaturity.at(denom).first < Params().Zerocoin_RequiredAccumulation()) {
-                mapDenomMaturity.at(denom).first += count(pindex->vMintDenominationsInBlock.begin(),
-                                                          pindex->vMintDenominationsInBlock.end(), denom);
+                mapDenomMaturity.at(denom).first += pindex->vMintsInBlock.at(denom);
 
                 //if mint was found then record this block as the first block that maturity occurs.
                 if (mapDenomMaturity.at(denom).first >= Params().Zerocoin_RequiredAccumulation())
@@ -15,8 +15,38 @@
 
 class CBlockIndex;
 
+//Progress of a witness calculation for a single coin, so that later spends and stakes of the coin can resume it
+//instead of walking the chain again from the height the coin was minted at
+class CoinWitnessData
+{
+public:
+    bool fInitialized;
+    CBigNum bnPubcoin;
+    libzerocoin::CoinDenomination denom;
+    int nHeightMintAdded;
+    int nHeightAccStart;
+    int nHeightWalkStart;
+    CBigNum bnAccStart; //accumulator value at the checkpoint the walk starts from
+    int nMintsAccumulatedBefore; //mints of this denomination before nHeightAccStart, -1 if not yet counted
+
+    //the part of the walk that is already done
+    CBigNum bnWitness;
+    int nHeight; //next block to add to the witness
+    int nHeightLast;
+    uint256 hashBlockLast;
+    int nHeightMaxWalked;
+    int nMintsAdded;
+    int nCheckpointsAdded;
+    bool fDoubleCounted;
+
+    CoinWitnessData() { SetNull(); }
+    void SetNull();
+    void ResetWalk();
+};
+
 std::map<libzerocoin::CoinDenomination, int> GetMintMaturityHeight();
-bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError, CBlockIndex* pindexCheckpoint = nullptr);
+bool AdvanceAccumulatorWitness(CoinWitnessData& data, int nHeightTarget);
+bool GenerateAccumulatorWitness(const libzerocoin::PublicCoin &coin, libzerocoin::Accumulator& accumulator, libzerocoin::AccumulatorWitness& witness, int nSecurityLevel, int& nMintsAdded, std::string& strError, CBlockIndex* pindexCheckpoint = nullptr, CoinWitnessData* pWitnessData = nullptr);
 bool GetAccumulatorValueFromDB(uint256 nCheckpoint, libzerocoin::CoinDenomination denom, CBigNum& bnAccValue);
 bool GetAccumulatorValueFromChecksum(uint32_t nChecksum, bool fMemoryOnly, CBigNum& bnAccValue);
 void AddAccumulatorChecksum(const uint32_t nChecksum, const CBigNum &bnValue, bool fMemoryOnly);
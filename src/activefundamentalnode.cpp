@@ -36,7 +36,7 @@ void CActiveFundamentalnode::ManageStatus()
         CFundamentalnode* pmn;
         pmn = mnodeman.Find(pubKeyFundamentalnode);
         if (pmn != NULL) {
-            pmn->Check();
+            mnodeman.CheckEntry(*pmn);
             if (pmn->IsEnabled() && pmn->protocolVersion == PROTOCOL_VERSION) EnableHotColdFundamentalNode(pmn->vin, pmn->addr);
         }
     }
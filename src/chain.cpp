@@ -15,6 +15,8 @@ void CChain::SetTip(CBlockIndex* pindex)
 {
     if (pindex == NULL) {
         vChain.clear();
+        vModifierHeights.clear();
+        vModifierMaxTime.clear();
         return;
     }
     vChain.resize(pindex->nHeight + 1);
@@ -22,6 +24,21 @@ void CChain::SetTip(CBlockIndex* pindex)
         vChain[pindex->nHeight] = pindex;
         pindex = pindex->pprev;
     }
+
+    // Forget the stake modifiers above the fork and index the new blocks
+    const int nForkHeight = pindex ? pindex->nHeight : -1;
+    const size_t nKeep = std::upper_bound(vModifierHeights.begin(), vModifierHeights.end(), nForkHeight) - vModifierHeights.begin();
+    vModifierHeights.resize(nKeep);
+    vModifierMaxTime.resize(nKeep);
+    for (int nHeight = nForkHeight + 1; nHeight < (int)vChain.size(); nHeight++) {
+        if (!vChain[nHeight]->GeneratedStakeModifier())
+            continue;
+        int64_t nMaxTime = vChain[nHeight]->GetBlockTime();
+        if (!vModifierMaxTime.empty())
+            nMaxTime = std::max(nMaxTime, vModifierMaxTime.back());
+        vModifierHeights.push_back(nHeight);
+        vModifierMaxTime.push_back(nMaxTime);
+    }
 }
 
 CBlockLocator CChain::GetLocator(const CBlockIndex* pindex) const
@@ -62,6 +79,38 @@ const CBlockIndex* CChain::FindFork(const CBlockIndex* pindex) const
     return pindex;
 }
 
+const CBlockIndex* CChain::FindLastStakeModifier(const CBlockIndex* pindex) const
+{
+    // Walk back to this chain, the index answers from there
+    while (pindex && !Contains(pindex)) {
+        if (pindex->GeneratedStakeModifier())
+            return pindex;
+        pindex = pindex->pprev;
+    }
+    if (!pindex)
+        return NULL;
+
+    std::vector<int>::const_iterator it = std::upper_bound(vModifierHeights.begin(), vModifierHeights.end(), pindex->nHeight);
+    if (it == vModifierHeights.begin())
+        return NULL;
+    return vChain[*(it - 1)];
+}
+
+const CBlockIndex* CChain::FindNextStakeModifier(int nHeight, int64_t nTime) const
+{
+    const size_t nFirst = std::upper_bound(vModifierHeights.begin(), vModifierHeights.end(), nHeight) - vModifierHeights.begin();
+    size_t i = nFirst;
+    if (nFirst == 0 || vModifierMaxTime[nFirst - 1] < nTime) {
+        // No earlier modifier reaches nTime, so the first running maximum that does is the answer
+        i = std::lower_bound(vModifierMaxTime.begin() + nFirst, vModifierMaxTime.end(), nTime) - vModifierMaxTime.begin();
+    } else {
+        // An earlier block has a later timestamp, fall back to scanning
+        while (i < vModifierHeights.size() && vChain[vModifierHeights[i]]->GetBlockTime() < nTime)
+            i++;
+    }
+    return i < vModifierHeights.size() ? vChain[vModifierHeights[i]] : NULL;
+}
+
 uint256 CBlockIndex::GetBlockTrust() const
 {
     uint256 bnTarget;
@@ -19,6 +19,10 @@
 #include "util.h"
 #include "libzerocoin/Denominations.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -107,6 +111,75 @@ enum BlockStatus {
     BLOCK_FAILED_MASK = BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 };
 
+/** A value for each zerocoin denomination, stored in zerocoinDenomList order. */
+template <typename T>
+class CDenominationArray
+{
+private:
+    T values[8];
+
+    static int Index(libzerocoin::CoinDenomination denom)
+    {
+        switch (denom) {
+        case libzerocoin::ZQ_ONE: return 0;
+        case libzerocoin::ZQ_FIVE: return 1;
+        case libzerocoin::ZQ_TEN: return 2;
+        case libzerocoin::ZQ_FIFTY: return 3;
+        case libzerocoin::ZQ_ONE_HUNDRED: return 4;
+        case libzerocoin::ZQ_FIVE_HUNDRED: return 5;
+        case libzerocoin::ZQ_ONE_THOUSAND: return 6;
+        case libzerocoin::ZQ_FIVE_THOUSAND: return 7;
+        default: throw std::out_of_range("CDenominationArray : invalid denomination");
+        }
+    }
+
+public:
+    CDenominationArray() { SetNull(); }
+
+    void SetNull() { std::fill(values, values + 8, T(0)); }
+
+    T& at(libzerocoin::CoinDenomination denom) { return values[Index(denom)]; }
+    const T& at(libzerocoin::CoinDenomination denom) const { return values[Index(denom)]; }
+};
+
+/** Proof-of-stake fields of a block index entry, only allocated for proof-of-stake blocks. */
+struct CBlockIndexStake
+{
+    COutPoint prevoutStake;
+    unsigned int nStakeTime;
+    uint256 hashProofOfStake;
+
+    CBlockIndexStake() : nStakeTime(0) {}
+};
+
+/** Owns the CBlockIndexStake of an entry, copying it along with the entry. */
+class CBlockIndexStakePtr
+{
+private:
+    std::unique_ptr<CBlockIndexStake> p;
+
+public:
+    CBlockIndexStakePtr() {}
+    CBlockIndexStakePtr(const CBlockIndexStakePtr& other) : p(other.p ? new CBlockIndexStake(*other.p) : NULL) {}
+
+    CBlockIndexStakePtr& operator=(const CBlockIndexStakePtr& other)
+    {
+        p.reset(other.p ? new CBlockIndexStake(*other.p) : NULL);
+        return *this;
+    }
+
+    const CBlockIndexStake* get() const { return p.get(); }
+
+    CBlockIndexStake& GetOrCreate()
+    {
+        if (!p)
+            p.reset(new CBlockIndexStake());
+        return *p;
+    }
+
+    void reset() { p.reset(); }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -127,9 +200,6 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
-    //ppcoin: trust score of block chain
-    uint256 bnChainTrust;
-
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -157,6 +227,9 @@ public:
     //! Verification status of this block. See enum BlockStatus
     unsigned int nStatus;
 
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId;
+
     unsigned int nFlags; // ppcoin: block index flags
     enum {
         BLOCK_PROOF_OF_STAKE = (1 << 0), // is proof-of-stake block
@@ -169,9 +242,7 @@ public:
     uint256 GetBlockTrust() const;
     uint64_t nStakeModifier;             // hash modifier for proof-of-stake
     unsigned int nStakeModifierChecksum; // checksum of index; in-memeory only
-    COutPoint prevoutStake;
-    unsigned int nStakeTime;
-    uint256 hashProofOfStake;
+    CBlockIndexStakePtr pstake;          // kept out of line, see GetStakeData()
     int64_t nMint;
     int64_t nMoneySupply;
     uint256 nStakeModifierV2;
@@ -184,12 +255,10 @@ public:
     unsigned int nNonce;
     uint256 nAccumulatorCheckpoint;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId;
-
     //! zerocoin specific fields
-    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
-    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
+    CDenominationArray<int64_t> vZerocoinSupply;
+    //! Number of mints of each denomination in this block. A block holds far fewer than 65536 mints.
+    CDenominationArray<uint16_t> vMintsInBlock;
 
     void SetNull()
     {
@@ -212,8 +281,7 @@ public:
         nStakeModifier = 0;
         nStakeModifierV2 = uint256();
         nStakeModifierChecksum = 0;
-        prevoutStake.SetNull();
-        nStakeTime = 0;
+        pstake.reset();
 
         nVersion = 0;
         hashMerkleRoot = uint256();
@@ -222,10 +290,8 @@ public:
         nNonce = 0;
         nAccumulatorCheckpoint = 0;
         // Start supply of each denomination with 0s
-        for (auto& denom : libzerocoin::zerocoinDenomList) {
-            mapZerocoinSupply.insert(make_pair(denom, 0));
-        }
-        vMintDenominationsInBlock.clear();
+        vZerocoinSupply.SetNull();
+        vMintsInBlock.SetNull();
     }
 
     CBlockIndex()
@@ -247,11 +313,23 @@ public:
 
         if (block.IsProofOfStake()) {
             SetProofOfStake();
-            prevoutStake = block.vtx[1].vin[0].prevout;
-            nStakeTime = block.nTime;
+            GetStakeDataForUpdate().prevoutStake = block.vtx[1].vin[0].prevout;
+            GetStakeDataForUpdate().nStakeTime = block.nTime;
         }
     }
 
+    //! The proof-of-stake fields, all null for proof-of-work blocks.
+    const CBlockIndexStake& GetStakeData() const
+    {
+        static const CBlockIndexStake stakeNull;
+        return pstake.get() ? *pstake.get() : stakeNull;
+    }
+
+    CBlockIndexStake& GetStakeDataForUpdate()
+    {
+        return pstake.GetOrCreate();
+    }
+
 
     CDiskBlockPos GetBlockPos() const
     {
@@ -291,14 +369,14 @@ public:
     {
         int64_t nTotal = 0;
         for (auto& denom : libzerocoin::zerocoinDenomList) {
-            nTotal += libzerocoin::ZerocoinDenominationToAmount(denom) * mapZerocoinSupply.at(denom);
+            nTotal += libzerocoin::ZerocoinDenominationToAmount(denom) * vZerocoinSupply.at(denom);
         }
         return nTotal;
     }
 
     bool MintedDenomination(libzerocoin::CoinDenomination denom) const
     {
-        return std::find(vMintDenominationsInBlock.begin(), vMintDenominationsInBlock.end(), denom) != vMintDenominationsInBlock.end();
+        return vMintsInBlock.at(denom) > 0;
     }
 
     uint256 GetBlockHash() const
@@ -470,12 +548,11 @@ public:
         }
 
         if (IsProofOfStake()) {
-            READWRITE(prevoutStake);
-            READWRITE(nStakeTime);
+            CBlockIndexStake& stake = const_cast<CDiskBlockIndex*>(this)->GetStakeDataForUpdate();
+            READWRITE(stake.prevoutStake);
+            READWRITE(stake.nStakeTime);
         } else {
-            const_cast<CDiskBlockIndex*>(this)->prevoutStake.SetNull();
-            const_cast<CDiskBlockIndex*>(this)->nStakeTime = 0;
-            const_cast<CDiskBlockIndex*>(this)->hashProofOfStake = uint256();
+            const_cast<CDiskBlockIndex*>(this)->pstake.reset();
         }
 
         // block header
@@ -488,8 +565,29 @@ public:
         READWRITE(nNonce);
         if(this->nVersion > 3) {
             READWRITE(nAccumulatorCheckpoint);
+
+            // Stored as the map and vector the entries used to hold
+            std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
+            std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
+            if (!ser_action.ForRead()) {
+                for (auto& denom : libzerocoin::zerocoinDenomList) {
+                    mapZerocoinSupply.insert(std::make_pair(denom, vZerocoinSupply.at(denom)));
+                    vMintDenominationsInBlock.insert(vMintDenominationsInBlock.end(), vMintsInBlock.at(denom), denom);
+                }
+            }
             READWRITE(mapZerocoinSupply);
             READWRITE(vMintDenominationsInBlock);
+            if (ser_action.ForRead()) {
+                CDiskBlockIndex* pthis = const_cast<CDiskBlockIndex*>(this);
+                for (auto& item : mapZerocoinSupply) {
+                    if (item.first != libzerocoin::ZQ_ERROR)
+                        pthis->vZerocoinSupply.at(item.first) = item.second;
+                }
+                for (auto& denom : vMintDenominationsInBlock) {
+                    if (denom != libzerocoin::ZQ_ERROR)
+                        pthis->vMintsInBlock.at(denom)++;
+                }
+            }
         }
 
     }
@@ -524,6 +622,10 @@ class CChain
 {
 private:
     std::vector<CBlockIndex*> vChain;
+    /** Heights of the blocks in this chain that generated a stake modifier, ascending. */
+    std::vector<int> vModifierHeights;
+    /** Latest block time among the first i + 1 entries of vModifierHeights. */
+    std::vector<int64_t> vModifierMaxTime;
 
 public:
     /** Returns the index entry for the genesis block of this chain, or NULL if none. */
@@ -591,6 +693,12 @@ public:
 
     /** Find the last common block between this chain and a block index entry. */
     const CBlockIndex* FindFork(const CBlockIndex* pindex) const;
+
+    /** Find the last block up to pindex that generated a stake modifier, or NULL if none did. pindex needs not be in this chain. */
+    const CBlockIndex* FindLastStakeModifier(const CBlockIndex* pindex) const;
+
+    /** Find the first block above nHeight in this chain that generated a stake modifier with a block time of at least nTime, or NULL if none did yet. */
+    const CBlockIndex* FindNextStakeModifier(int nHeight, int64_t nTime) const;
 };
 
 #endif // BITCOIN_CHAIN_H
@@ -304,6 +304,19 @@ public:
     }
 };
 
+/** Salted hasher for indexes keyed by transaction output. */
+class COutPointHasher
+{
+private:
+    CCoinsKeyHasher hasher;
+
+public:
+    size_t operator()(const COutPoint& out) const
+    {
+        return hasher(out.hash) ^ out.n;
+    }
+};
+
 struct CCoinsCacheEntry {
     CCoins coins; // The actual cached data.
     unsigned char flags;
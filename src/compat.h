@@ -90,6 +90,11 @@ typedef u_int SOCKET;
 
 size_t strnlen_int(const char* start, size_t max_len);
 
+// The socket handler can wait for socket events with epoll instead of select
+#if defined(__linux__)
+#define USE_EPOLL
+#endif
+
 bool static inline IsSelectableSocket(SOCKET s)
 {
 #ifdef WIN32
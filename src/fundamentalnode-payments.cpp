@@ -28,6 +28,19 @@ CCriticalSection cs_vecPayments;
 CCriticalSection cs_mapFundamentalnodeBlocks;
 CCriticalSection cs_mapFundamentalnodePayeeVotes;
 
+/** Heights below the tip to keep the votes of */
+static int GetPaymentHistoryDepth()
+{
+    //keep up to five cycles for historical sake
+    return std::max(int(mnodeman.size() * 1.25), 1000);
+}
+
+/** Heights the vote store has to cover: the history plus the votes ahead of the tip */
+static int GetPaymentVoteDepth()
+{
+    return GetPaymentHistoryDepth() + 21;
+}
+
 //
 // CFundamentalnodePaymentDB
 //
@@ -35,20 +48,20 @@ CCriticalSection cs_mapFundamentalnodePayeeVotes;
 CFundamentalnodePaymentDB::CFundamentalnodePaymentDB()
 {
     pathDB = GetDataDir() / "fnpayments.dat";
-    strMagicMessage = "FundamentalnodePayments";
+    strMagicMessage = "FundamentalnodePaymentVotes";
 }
 
-bool CFundamentalnodePaymentDB::Write(const CFundamentalnodePayments& objToSave)
+static void WriteVoteBatch(CAutoFile& fileout, const std::vector<CFundamentalnodePaymentWinner>& vVotes)
 {
-    int64_t nStart = GetTimeMillis();
+    CHashWriter ssHash(SER_DISK, CLIENT_VERSION);
+    ssHash << vVotes;
+    fileout << vVotes;
+    fileout << ssHash.GetHash();
+}
 
-    // serialize, checksum data up to that point, then append checksum
-    CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-    ssObj << strMagicMessage;                   // fundamentalnode cache file specific magic message
-    ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
-    ssObj << objToSave;
-    uint256 hash = Hash(ssObj.begin(), ssObj.end());
-    ssObj << hash;
+bool CFundamentalnodePaymentDB::Write(const std::vector<CFundamentalnodePaymentWinner>& vVotes)
+{
+    int64_t nStart = GetTimeMillis();
 
     // open output file, and associate with CAutoFile
     FILE* file = fopen(pathDB.string().c_str(), "wb");
@@ -58,18 +71,43 @@ bool CFundamentalnodePaymentDB::Write(const CFundamentalnodePayments& objToSave)
 
     // Write and commit header, data
     try {
-        fileout << ssObj;
+        fileout << strMagicMessage;                   // fundamentalnode cache file specific magic message
+        fileout << FLATDATA(Params().MessageStart()); // network specific magic number
+        WriteVoteBatch(fileout, vVotes);
+    } catch (const std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    LogPrint("fundamentalnode","Written %d votes to fnpayments.dat  %dms\n", vVotes.size(), GetTimeMillis() - nStart);
+
+    return true;
+}
+
+bool CFundamentalnodePaymentDB::Append(const std::vector<CFundamentalnodePaymentWinner>& vVotes)
+{
+    int64_t nStart = GetTimeMillis();
+
+    FILE* file = fopen(pathDB.string().c_str(), "ab");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathDB.string());
+
+    try {
+        WriteVoteBatch(fileout, vVotes);
     } catch (const std::exception& e) {
         return error("%s : Serialize or I/O error - %s", __func__, e.what());
     }
+    FileCommit(fileout.Get());
     fileout.fclose();
 
-    LogPrint("fundamentalnode","Written info to mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
+    LogPrint("fundamentalnode","Appended %d votes to fnpayments.dat  %dms\n", vVotes.size(), GetTimeMillis() - nStart);
 
     return true;
 }
 
-CFundamentalnodePaymentDB::ReadResult CFundamentalnodePaymentDB::Read(CFundamentalnodePayments& objToLoad, bool fDryRun)
+CFundamentalnodePaymentDB::ReadResult CFundamentalnodePaymentDB::Read(CFundamentalnodePayments& objToLoad)
 {
     int64_t nStart = GetTimeMillis();
     // open input file, and associate with CAutoFile
@@ -82,18 +120,12 @@ CFundamentalnodePaymentDB::ReadResult CFundamentalnodePaymentDB::Read(CFundament
 
     // use file size to size memory buffer
     int fileSize = boost::filesystem::file_size(pathDB);
-    int dataSize = fileSize - sizeof(uint256);
-    // Don't try to resize to a negative number if file is small
-    if (dataSize < 0)
-        dataSize = 0;
     vector<unsigned char> vchData;
-    vchData.resize(dataSize);
-    uint256 hashIn;
+    vchData.resize(fileSize);
 
-    // read data and checksum from file
     try {
-        filein.read((char*)&vchData[0], dataSize);
-        filein >> hashIn;
+        if (fileSize > 0)
+            filein.read((char*)&vchData[0], fileSize);
     } catch (const std::exception& e) {
         error("%s : Deserialize or I/O error - %s", __func__, e.what());
         return HashReadError;
@@ -102,13 +134,6 @@ CFundamentalnodePaymentDB::ReadResult CFundamentalnodePaymentDB::Read(CFundament
 
     CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
 
-    // verify stored checksum matches input data
-    uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
-    if (hashIn != hashTmp) {
-        error("%s : Checksum mismatch, data corrupted", __func__);
-        return IncorrectHash;
-    }
-
     unsigned char pchMsgTmp[4];
     std::string strMagicMessageTmp;
     try {
@@ -121,7 +146,6 @@ CFundamentalnodePaymentDB::ReadResult CFundamentalnodePaymentDB::Read(CFundament
             return IncorrectMagicMessage;
         }
 
-
         // de-serialize file header (network specific magic number) and ..
         ssObj >> FLATDATA(pchMsgTmp);
 
@@ -130,52 +154,70 @@ CFundamentalnodePaymentDB::ReadResult CFundamentalnodePaymentDB::Read(CFundament
             error("%s : Invalid network magic number", __func__);
             return IncorrectMagicNumber;
         }
-
-        // de-serialize data into CFundamentalnodePayments object
-        ssObj >> objToLoad;
     } catch (const std::exception& e) {
-        objToLoad.Clear();
         error("%s : Deserialize or I/O error - %s", __func__, e.what());
         return IncorrectFormat;
     }
 
-    LogPrint("fundamentalnode","Loaded info from mnpayments.dat  %dms\n", GetTimeMillis() - nStart);
-    LogPrint("fundamentalnode","  %s\n", objToLoad.ToString());
-    if (!fDryRun) {
-        LogPrint("fundamentalnode","Fundamentalnode payments manager - cleaning....\n");
-        objToLoad.CleanPaymentList();
-        LogPrint("fundamentalnode","Fundamentalnode payments manager - result:\n");
-        LogPrint("fundamentalnode","  %s\n", objToLoad.ToString());
+    objToLoad.Clear();
+
+    // de-serialize the batches of votes, stopping at the first damaged one
+    int nVotes = 0;
+    bool fComplete = true;
+    {
+        LOCK2(cs_mapFundamentalnodePayeeVotes, cs_mapFundamentalnodeBlocks);
+        objToLoad.votes.Reserve(GetPaymentVoteDepth());
+
+        while (!ssObj.empty()) {
+            std::vector<CFundamentalnodePaymentWinner> vVotes;
+            uint256 hashIn;
+            try {
+                ssObj >> vVotes;
+                ssObj >> hashIn;
+            } catch (const std::exception& e) {
+                fComplete = false;
+                break;
+            }
+
+            CHashWriter ssHash(SER_DISK, CLIENT_VERSION);
+            ssHash << vVotes;
+            if (hashIn != ssHash.GetHash()) {
+                fComplete = false;
+                break;
+            }
+
+            BOOST_FOREACH (const CFundamentalnodePaymentWinner& winner, vVotes)
+                objToLoad.votes.Add(winner);
+            nVotes += vVotes.size();
+        }
+
+        // a damaged batch is dropped by writing the file anew
+        objToLoad.nSavedVotes = fComplete ? nVotes : -1;
     }
 
+    if (!fComplete)
+        LogPrint("fundamentalnode","Dropped damaged votes at the end of fnpayments.dat\n");
+
+    LogPrint("fundamentalnode","Loaded info from fnpayments.dat  %dms\n", GetTimeMillis() - nStart);
+    LogPrint("fundamentalnode","  %s\n", objToLoad.ToString());
+    LogPrint("fundamentalnode","Fundamentalnode payments manager - cleaning....\n");
+    objToLoad.CleanPaymentList();
+    LogPrint("fundamentalnode","Fundamentalnode payments manager - result:\n");
+    LogPrint("fundamentalnode","  %s\n", objToLoad.ToString());
+
     return Ok;
 }
 
 void DumpFundamentalnodePayments()
 {
+    static CCriticalSection cs_dump;
+    LOCK(cs_dump);
+
     int64_t nStart = GetTimeMillis();
 
     CFundamentalnodePaymentDB paymentdb;
-    CFundamentalnodePayments tempPayments;
-
-    LogPrint("fundamentalnode","Verifying mnpayments.dat format...\n");
-    CFundamentalnodePaymentDB::ReadResult readResult = paymentdb.Read(tempPayments, true);
-    // there was an error and it was not an error on file opening => do not proceed
-    if (readResult == CFundamentalnodePaymentDB::FileError)
-        LogPrint("fundamentalnode","Missing budgets file - mnpayments.dat, will try to recreate\n");
-    else if (readResult != CFundamentalnodePaymentDB::Ok) {
-        LogPrint("fundamentalnode","Error reading mnpayments.dat: ");
-        if (readResult == CFundamentalnodePaymentDB::IncorrectFormat)
-            LogPrint("fundamentalnode","magic is ok but data has invalid format, will try to recreate\n");
-        else {
-            LogPrint("fundamentalnode","file format is unknown or invalid, please fix it manually\n");
-            return;
-        }
-    }
-    LogPrint("fundamentalnode","Writting info to mnpayments.dat...\n");
-    paymentdb.Write(fundamentalnodePayments);
-
-    LogPrint("fundamentalnode","Budget dump finished  %dms\n", GetTimeMillis() - nStart);
+    if (fundamentalnodePayments.Flush(paymentdb))
+        LogPrint("fundamentalnode","Fundamentalnode payments dump finished  %dms\n", GetTimeMillis() - nStart);
 }
 
 bool IsBlockValueValid(const CBlock& block, CAmount nExpectedValue, CAmount nMinted)
@@ -385,7 +427,7 @@ void CFundamentalnodePayments::FillBlockPayee(CMutableTransaction& txNew, int64_
     //spork
     if (!fundamentalnodePayments.GetBlockPayee(pindexPrev->nHeight + 1, payee)) {
         //no fundamentalnode detected
-        CFundamentalnode* winningNode = mnodeman.GetCurrentFundamentalNode(1);
+        CFundamentalnode* winningNode = mnodeman.GetCurrentFundamentalNode();
         if (winningNode) {
             payee = GetScriptForDestination(winningNode->pubKeyCollateralAddress.GetID());
         } else {
@@ -408,7 +450,7 @@ void CFundamentalnodePayments::FillBlockPayee(CMutableTransaction& txNew, int64_
 
     if(!masternodePayments.GetBlockPayee(pindexPrev->nHeight+1, mn_payee)){
         //no masternode detected
-        CMasternode* winningNode = m_nodeman.GetCurrentMasterNode(1);
+        CMasternode* winningNode = m_nodeman.GetCurrentMasterNode();
         if(winningNode){
             mn_payee = GetScriptForDestination(winningNode->pubkey.GetID());
         } else {
@@ -590,7 +632,7 @@ void CFundamentalnodePayments::ProcessMessageFundamentalnodePayments(CNode* pfro
             nHeight = chainActive.Tip()->nHeight;
         }
 
-        if (fundamentalnodePayments.mapFundamentalnodePayeeVotes.count(winner.GetHash())) {
+        if (fundamentalnodePayments.HasVote(winner.GetHash())) {
             LogPrint("mnpayments", "fnw - Already seen - %s bestHeight %d\n", winner.GetHash().ToString().c_str(), nHeight);
             fundamentalnodeSync.AddedFundamentalnodeWinner(winner.GetHash());
             return;
@@ -656,10 +698,39 @@ bool CFundamentalnodePaymentWinner::Sign(CKey& keyFundamentalnode, CPubKey& pubK
     return true;
 }
 
+bool CFundamentalnodePayments::HasVote(const uint256& hash)
+{
+    LOCK(cs_mapFundamentalnodePayeeVotes);
+    return votes.Has(hash);
+}
+
+bool CFundamentalnodePayments::GetVote(const uint256& hash, CFundamentalnodePaymentWinner& winner)
+{
+    LOCK(cs_mapFundamentalnodePayeeVotes);
+
+    const CFundamentalnodePaymentWinner* pwinner = votes.Get(hash);
+    if (pwinner == NULL)
+        return false;
+
+    winner = *pwinner;
+    return true;
+}
+
+bool CFundamentalnodePayments::HasPayeeWithVotes(int nBlockHeight, const CScript& payee, int nVotesReq)
+{
+    LOCK(cs_mapFundamentalnodeBlocks);
+
+    CFundamentalnodeBlockPayees* pblockPayees = votes.GetPayees(nBlockHeight);
+    return pblockPayees != NULL && pblockPayees->HasPayeeWithVotes(payee, nVotesReq);
+}
+
 bool CFundamentalnodePayments::GetBlockPayee(int nBlockHeight, CScript& payee)
 {
-    if (mapFundamentalnodeBlocks.count(nBlockHeight)) {
-        return mapFundamentalnodeBlocks[nBlockHeight].GetPayee(payee);
+    LOCK(cs_mapFundamentalnodeBlocks);
+
+    CFundamentalnodeBlockPayees* pblockPayees = votes.GetPayees(nBlockHeight);
+    if (pblockPayees != NULL) {
+        return pblockPayees->GetPayee(payee);
     }
 
     return false;
@@ -684,8 +755,9 @@ bool CFundamentalnodePayments::IsScheduled(CFundamentalnode& mn, int nNotBlockHe
     CScript payee;
     for (int64_t h = nHeight; h <= nHeight + 8; h++) {
         if (h == nNotBlockHeight) continue;
-        if (mapFundamentalnodeBlocks.count(h)) {
-            if (mapFundamentalnodeBlocks[h].GetPayee(payee)) {
+        CFundamentalnodeBlockPayees* pblockPayees = votes.GetPayees(h);
+        if (pblockPayees != NULL) {
+            if (pblockPayees->GetPayee(payee)) {
                 if (mnpayee == payee) {
                     return true;
                 }
@@ -703,22 +775,14 @@ bool CFundamentalnodePayments::AddWinningFundamentalnode(CFundamentalnodePayment
         return false;
     }
 
-    {
-        LOCK2(cs_mapFundamentalnodePayeeVotes, cs_mapFundamentalnodeBlocks);
-
-        if (mapFundamentalnodePayeeVotes.count(winnerIn.GetHash())) {
-            return false;
-        }
-
-        mapFundamentalnodePayeeVotes[winnerIn.GetHash()] = winnerIn;
+    LOCK2(cs_mapFundamentalnodePayeeVotes, cs_mapFundamentalnodeBlocks);
 
-        if (!mapFundamentalnodeBlocks.count(winnerIn.nBlockHeight)) {
-            CFundamentalnodeBlockPayees blockPayees(winnerIn.nBlockHeight);
-            mapFundamentalnodeBlocks[winnerIn.nBlockHeight] = blockPayees;
-        }
+    // already known, or for a height that is no longer kept
+    if (!votes.Add(winnerIn)) {
+        return false;
     }
 
-    mapFundamentalnodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+    vUnsavedVotes.push_back(winnerIn.GetHash());
 
     return true;
 }
@@ -810,8 +874,9 @@ std::string CFundamentalnodePayments::GetRequiredPaymentsString(int nBlockHeight
 {
     LOCK(cs_mapFundamentalnodeBlocks);
 
-    if (mapFundamentalnodeBlocks.count(nBlockHeight)) {
-        return mapFundamentalnodeBlocks[nBlockHeight].GetRequiredPaymentsString();
+    CFundamentalnodeBlockPayees* pblockPayees = votes.GetPayees(nBlockHeight);
+    if (pblockPayees != NULL) {
+        return pblockPayees->GetRequiredPaymentsString();
     }
 
     return "Unknown";
@@ -821,8 +886,9 @@ bool CFundamentalnodePayments::IsTransactionValid(const CTransaction& txNew, int
 {
     LOCK(cs_mapFundamentalnodeBlocks);
 
-    if (mapFundamentalnodeBlocks.count(nBlockHeight)) {
-        return mapFundamentalnodeBlocks[nBlockHeight].IsTransactionValid(txNew);
+    CFundamentalnodeBlockPayees* pblockPayees = votes.GetPayees(nBlockHeight);
+    if (pblockPayees != NULL) {
+        return pblockPayees->IsTransactionValid(txNew);
     }
 
     return true;
@@ -839,22 +905,61 @@ void CFundamentalnodePayments::CleanPaymentList()
         nHeight = chainActive.Tip()->nHeight;
     }
 
-    //keep up to five cycles for historical sake
-    int nLimit = std::max(int(mnodeman.size() * 1.25), 1000);
+    int nMinHeight = nHeight - GetPaymentHistoryDepth();
 
-    std::map<uint256, CFundamentalnodePaymentWinner>::iterator it = mapFundamentalnodePayeeVotes.begin();
-    while (it != mapFundamentalnodePayeeVotes.end()) {
-        CFundamentalnodePaymentWinner winner = (*it).second;
+    votes.Reserve(GetPaymentVoteDepth());
 
-        if (nHeight - winner.nBlockHeight > nLimit) {
-            LogPrint("mnpayments", "CFundamentalnodePayments::CleanPaymentList - Removing old Fundamentalnode payment - block %d\n", winner.nBlockHeight);
-            fundamentalnodeSync.mapSeenSyncMNW.erase((*it).first);
-            mapFundamentalnodePayeeVotes.erase(it++);
-            mapFundamentalnodeBlocks.erase(winner.nBlockHeight);
-        } else {
+    std::vector<uint256> vErased;
+    votes.Prune(nMinHeight, &vErased);
+    BOOST_FOREACH (const uint256& hash, vErased)
+        fundamentalnodeSync.mapSeenSyncMNW.erase(hash);
+
+    if (!vErased.empty())
+        LogPrint("mnpayments", "CFundamentalnodePayments::CleanPaymentList - Removed %d old Fundamentalnode payments below block %d\n", vErased.size(), nMinHeight);
+
+    boost::unordered_map<COutPoint, int, COutPointHasher>::iterator it = mapFundamentalnodesLastVote.begin();
+    while (it != mapFundamentalnodesLastVote.end()) {
+        if (it->second < nMinHeight)
+            it = mapFundamentalnodesLastVote.erase(it);
+        else
             ++it;
+    }
+}
+
+bool CFundamentalnodePayments::Flush(CFundamentalnodePaymentDB& paymentdb)
+{
+    std::vector<CFundamentalnodePaymentWinner> vVotes;
+    bool fRewrite;
+    {
+        LOCK(cs_mapFundamentalnodePayeeVotes);
+
+        // write the file anew once it mostly holds votes that have expired
+        fRewrite = nSavedVotes < 0 || nSavedVotes > 2 * (int)votes.size() + 1000;
+        if (fRewrite) {
+            vVotes.reserve(votes.size());
+            votes.ForEach([&vVotes](const CFundamentalnodePaymentWinner& winner) { vVotes.push_back(winner); });
+        } else {
+            BOOST_FOREACH (const uint256& hash, vUnsavedVotes) {
+                const CFundamentalnodePaymentWinner* pwinner = votes.Get(hash);
+                if (pwinner != NULL)
+                    vVotes.push_back(*pwinner);
+            }
         }
+        vUnsavedVotes.clear();
     }
+
+    if (!fRewrite && vVotes.empty())
+        return true;
+
+    bool fSaved = fRewrite ? paymentdb.Write(vVotes) : paymentdb.Append(vVotes);
+
+    LOCK(cs_mapFundamentalnodePayeeVotes);
+    if (!fSaved)
+        nSavedVotes = -1;
+    else
+        nSavedVotes = (fRewrite ? 0 : nSavedVotes) + vVotes.size();
+
+    return fSaved;
 }
 
 bool CFundamentalnodePaymentWinner::IsValid(CNode* pnode, std::string& strError)
@@ -1003,14 +1108,13 @@ void CFundamentalnodePayments::Sync(CNode* node, int nCountNeeded)
     if (nCountNeeded > nCount) nCountNeeded = nCount;
 
     int nInvCount = 0;
-    std::map<uint256, CFundamentalnodePaymentWinner>::iterator it = mapFundamentalnodePayeeVotes.begin();
-    while (it != mapFundamentalnodePayeeVotes.end()) {
-        CFundamentalnodePaymentWinner winner = (*it).second;
-        if (winner.nBlockHeight >= nHeight - nCountNeeded && winner.nBlockHeight <= nHeight + 20) {
-            node->PushInventory(CInv(MSG_FUNDAMENTALNODE_WINNER, winner.GetHash()));
+    for (int h = nHeight - nCountNeeded; h <= nHeight + 20; h++) {
+        const std::vector<uint256>* pvHashes = votes.GetHashes(h);
+        if (pvHashes == NULL) continue;
+        BOOST_FOREACH (const uint256& hash, *pvHashes) {
+            node->PushInventory(CInv(MSG_FUNDAMENTALNODE_WINNER, hash));
             nInvCount++;
         }
-        ++it;
     }
     node->PushMessage("ssc", FUNDAMENTALNODE_SYNC_MNW, nInvCount);
 }
@@ -1019,7 +1123,7 @@ std::string CFundamentalnodePayments::ToString() const
 {
     std::ostringstream info;
 
-    info << "Votes: " << (int)mapFundamentalnodePayeeVotes.size() << ", Blocks: " << (int)mapFundamentalnodeBlocks.size();
+    info << "Votes: " << (int)votes.size() << ", Blocks: " << votes.CountBlocks();
 
     return info.str();
 }
@@ -1029,32 +1133,150 @@ int CFundamentalnodePayments::GetOldestBlock()
 {
     LOCK(cs_mapFundamentalnodeBlocks);
 
-    int nOldestBlock = std::numeric_limits<int>::max();
+    return votes.GetOldestBlock();
+}
 
-    std::map<int, CFundamentalnodeBlockPayees>::iterator it = mapFundamentalnodeBlocks.begin();
-    while (it != mapFundamentalnodeBlocks.end()) {
-        if ((*it).first < nOldestBlock) {
-            nOldestBlock = (*it).first;
-        }
-        it++;
+
+int CFundamentalnodePayments::GetNewestBlock()
+{
+    LOCK(cs_mapFundamentalnodeBlocks);
+
+    return votes.GetNewestBlock();
+}
+
+//
+// CFundamentalnodePaymentVotes
+//
+
+void CFundamentalnodePaymentVotes::EraseHeight(CHeightVotes& bucket, std::vector<uint256>* pvErased)
+{
+    if (bucket.payees.nBlockHeight < 0)
+        return;
+
+    BOOST_FOREACH (const uint256& hash, bucket.vHashes) {
+        mapVotes.erase(hash);
+        if (pvErased != NULL)
+            pvErased->push_back(hash);
     }
+    bucket = CHeightVotes();
+    nBlocks--;
+}
 
-    return nOldestBlock;
+void CFundamentalnodePaymentVotes::Reserve(unsigned int nDepth)
+{
+    if (nDepth <= vRing.size())
+        return;
+
+    unsigned int nSize = std::max(vRing.size(), (size_t)1);
+    while (nSize < nDepth)
+        nSize *= 2;
+
+    // place the votes again, each height keeping the order its votes came in
+    std::vector<CFundamentalnodePaymentWinner> vVotes;
+    vVotes.reserve(mapVotes.size());
+    ForEach([&vVotes](const CFundamentalnodePaymentWinner& winner) { vVotes.push_back(winner); });
+
+    int nMinHeightOld = nMinHeight;
+    mapVotes.clear();
+    vRing.assign(nSize, CHeightVotes());
+    nBlocks = 0;
+    nMinHeight = nMinHeightOld;
+    BOOST_FOREACH (const CFundamentalnodePaymentWinner& winner, vVotes)
+        Add(winner);
+}
+
+bool CFundamentalnodePaymentVotes::Add(const CFundamentalnodePaymentWinner& winner)
+{
+    CFundamentalnodePaymentWinner vote(winner);
+    uint256 hash = vote.GetHash();
+
+    if (vote.nBlockHeight < nMinHeight || vote.nBlockHeight < 0 || mapVotes.count(hash))
+        return false;
+
+    CHeightVotes& bucket = vRing[vote.nBlockHeight % vRing.size()];
+    if (bucket.payees.nBlockHeight != vote.nBlockHeight) {
+        // the slot is taken by a newer height, this one is too old to keep
+        if (bucket.payees.nBlockHeight > vote.nBlockHeight)
+            return false;
+        EraseHeight(bucket, NULL);
+        bucket.payees.nBlockHeight = vote.nBlockHeight;
+        nBlocks++;
+    }
+
+    bucket.payees.AddPayee(vote.payee, 1);
+    bucket.vHashes.push_back(hash);
+    mapVotes.insert(std::make_pair(hash, vote));
+
+    return true;
 }
 
+void CFundamentalnodePaymentVotes::Prune(int nMinHeightIn, std::vector<uint256>* pvErased)
+{
+    if (nMinHeightIn <= nMinHeight)
+        return;
 
-int CFundamentalnodePayments::GetNewestBlock()
+    // every height left below nMinHeightIn is in one of these slots
+    int nFrom = std::max(nMinHeight, nMinHeightIn - (int)vRing.size());
+    for (int h = nFrom; h < nMinHeightIn; h++) {
+        CHeightVotes& bucket = vRing[h % vRing.size()];
+        if (bucket.payees.nBlockHeight < nMinHeightIn)
+            EraseHeight(bucket, pvErased);
+    }
+
+    nMinHeight = nMinHeightIn;
+}
+
+void CFundamentalnodePaymentVotes::Clear()
 {
-    LOCK(cs_mapFundamentalnodeBlocks);
+    vRing.assign(vRing.size(), CHeightVotes());
+    mapVotes.clear();
+    nMinHeight = 0;
+    nBlocks = 0;
+}
+
+const CFundamentalnodePaymentWinner* CFundamentalnodePaymentVotes::Get(const uint256& hash) const
+{
+    boost::unordered_map<uint256, CFundamentalnodePaymentWinner, BlockHasher>::const_iterator it = mapVotes.find(hash);
+    return it == mapVotes.end() ? NULL : &it->second;
+}
+
+CFundamentalnodeBlockPayees* CFundamentalnodePaymentVotes::GetPayees(int nBlockHeight)
+{
+    if (nBlockHeight < 0)
+        return NULL;
+
+    CHeightVotes& bucket = vRing[nBlockHeight % vRing.size()];
+    return bucket.payees.nBlockHeight == nBlockHeight ? &bucket.payees : NULL;
+}
+
+const std::vector<uint256>* CFundamentalnodePaymentVotes::GetHashes(int nBlockHeight) const
+{
+    if (nBlockHeight < 0)
+        return NULL;
+
+    const CHeightVotes& bucket = vRing[nBlockHeight % vRing.size()];
+    return bucket.payees.nBlockHeight == nBlockHeight ? &bucket.vHashes : NULL;
+}
 
+int CFundamentalnodePaymentVotes::GetOldestBlock() const
+{
+    int nOldestBlock = std::numeric_limits<int>::max();
+
+    for (unsigned int i = 0; i < vRing.size(); i++) {
+        if (vRing[i].payees.nBlockHeight >= 0 && vRing[i].payees.nBlockHeight < nOldestBlock)
+            nOldestBlock = vRing[i].payees.nBlockHeight;
+    }
+
+    return nOldestBlock;
+}
+
+int CFundamentalnodePaymentVotes::GetNewestBlock() const
+{
     int nNewestBlock = 0;
 
-    std::map<int, CFundamentalnodeBlockPayees>::iterator it = mapFundamentalnodeBlocks.begin();
-    while (it != mapFundamentalnodeBlocks.end()) {
-        if ((*it).first > nNewestBlock) {
-            nNewestBlock = (*it).first;
-        }
-        it++;
+    for (unsigned int i = 0; i < vRing.size(); i++) {
+        if (vRing[i].payees.nBlockHeight > nNewestBlock)
+            nNewestBlock = vRing[i].payees.nBlockHeight;
     }
 
     return nNewestBlock;
@@ -9,7 +9,9 @@
 #include "key.h"
 #include "main.h"
 #include "fundamentalnode.h"
+
 #include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
 
 using namespace std;
 
@@ -34,30 +36,6 @@ void FillBlockPayee(CMutableTransaction& txNew, CAmount nFees, bool fProofOfStak
 
 void DumpFundamentalnodePayments();
 
-/** Save Fundamentalnode Payment Data (fnpayments.dat)
- */
-class CFundamentalnodePaymentDB
-{
-private:
-    boost::filesystem::path pathDB;
-    std::string strMagicMessage;
-
-public:
-    enum ReadResult {
-        Ok,
-        FileError,
-        HashReadError,
-        IncorrectHash,
-        IncorrectMagicMessage,
-        IncorrectMagicNumber,
-        IncorrectFormat
-    };
-
-    CFundamentalnodePaymentDB();
-    bool Write(const CFundamentalnodePayments& objToSave);
-    ReadResult Read(CFundamentalnodePayments& objToLoad, bool fDryRun = false);
-};
-
 class CFundamentalnodePayee
 {
 public:
@@ -225,6 +203,96 @@ public:
     }
 };
 
+/** Save Fundamentalnode Payment Data (fnpayments.dat)
+ *
+ * The file is a log: a header followed by batches of votes, each batch with
+ * its own checksum. Votes received since the last write are appended as a
+ * new batch; the file is only written anew once most of the votes in it have
+ * expired.
+ */
+class CFundamentalnodePaymentDB
+{
+private:
+    boost::filesystem::path pathDB;
+    std::string strMagicMessage;
+
+public:
+    enum ReadResult {
+        Ok,
+        FileError,
+        HashReadError,
+        IncorrectHash,
+        IncorrectMagicMessage,
+        IncorrectMagicNumber,
+        IncorrectFormat
+    };
+
+    CFundamentalnodePaymentDB();
+    /** Replace the file with one holding vVotes */
+    bool Write(const std::vector<CFundamentalnodePaymentWinner>& vVotes);
+    /** Append vVotes to the file as a new batch */
+    bool Append(const std::vector<CFundamentalnodePaymentWinner>& vVotes);
+    ReadResult Read(CFundamentalnodePayments& objToLoad);
+};
+
+/**
+ * Payment votes kept in a ring of per-height buckets, with the votes also
+ * indexed by hash. The payees of a height are found in O(1), and moving the
+ * window forward drops the buckets of old heights one at a time. A vote for
+ * a height below the window, or one whose slot in the ring is taken by a
+ * newer height, is not stored.
+ */
+class CFundamentalnodePaymentVotes
+{
+private:
+    struct CHeightVotes {
+        CFundamentalnodeBlockPayees payees;
+        std::vector<uint256> vHashes;
+
+        CHeightVotes() : payees(-1) {}
+    };
+
+    std::vector<CHeightVotes> vRing;
+    boost::unordered_map<uint256, CFundamentalnodePaymentWinner, BlockHasher> mapVotes;
+    // Heights below this have been pruned
+    int nMinHeight;
+    int nBlocks;
+
+    void EraseHeight(CHeightVotes& bucket, std::vector<uint256>* pvErased);
+
+public:
+    CFundamentalnodePaymentVotes(unsigned int nDepth = 1024) : vRing(nDepth), nMinHeight(0), nBlocks(0) {}
+
+    /** Make room for votes on at least nDepth consecutive heights */
+    void Reserve(unsigned int nDepth);
+    unsigned int Depth() const { return vRing.size(); }
+
+    bool Add(const CFundamentalnodePaymentWinner& winner);
+    /** Drop the votes for heights below nMinHeightIn, returning their hashes in pvErased */
+    void Prune(int nMinHeightIn, std::vector<uint256>* pvErased = NULL);
+    void Clear();
+
+    bool Has(const uint256& hash) const { return mapVotes.count(hash); }
+    const CFundamentalnodePaymentWinner* Get(const uint256& hash) const;
+    /** The payees voted for at nBlockHeight, or NULL if there are no votes for it */
+    CFundamentalnodeBlockPayees* GetPayees(int nBlockHeight);
+    /** Hashes of the votes for nBlockHeight, or NULL if there are none */
+    const std::vector<uint256>* GetHashes(int nBlockHeight) const;
+
+    size_t size() const { return mapVotes.size(); }
+    int CountBlocks() const { return nBlocks; }
+    int GetOldestBlock() const;
+    int GetNewestBlock() const;
+
+    template <typename Callable>
+    void ForEach(Callable func) const
+    {
+        for (unsigned int i = 0; i < vRing.size(); i++)
+            for (unsigned int j = 0; j < vRing[i].vHashes.size(); j++)
+                func(mapVotes.find(vRing[i].vHashes[j])->second);
+    }
+};
+
 //
 // fundamentalnode Payments Class
 // Keeps track of who should get paid for which blocks
@@ -236,22 +304,32 @@ private:
     int nSyncedFromPeer;
     int nLastBlockHeight;
 
-public:
-    std::map<uint256, CFundamentalnodePaymentWinner> mapFundamentalnodePayeeVotes;
-    std::map<int, CFundamentalnodeBlockPayees> mapFundamentalnodeBlocks;
-    std::map<uint256, int> mapFundamentalnodesLastVote; //prevout.hash + prevout.n, nBlockHeight
+    // Guarded by cs_mapFundamentalnodePayeeVotes and cs_mapFundamentalnodeBlocks,
+    // writers take both
+    CFundamentalnodePaymentVotes votes;
+    boost::unordered_map<COutPoint, int, COutPointHasher> mapFundamentalnodesLastVote;
+
+    // Votes added since fnpayments.dat was last written
+    std::vector<uint256> vUnsavedVotes;
+    // Votes written to fnpayments.dat, -1 if it has to be written anew
+    int nSavedVotes;
 
+    friend class CFundamentalnodePaymentDB;
+
+public:
     CFundamentalnodePayments()
     {
         nSyncedFromPeer = 0;
         nLastBlockHeight = 0;
+        nSavedVotes = -1;
     }
 
     void Clear()
     {
-        LOCK2(cs_mapFundamentalnodeBlocks, cs_mapFundamentalnodePayeeVotes);
-        mapFundamentalnodeBlocks.clear();
-        mapFundamentalnodePayeeVotes.clear();
+        LOCK2(cs_mapFundamentalnodePayeeVotes, cs_mapFundamentalnodeBlocks);
+        votes.Clear();
+        vUnsavedVotes.clear();
+        nSavedVotes = -1;
     }
 
     bool AddWinningFundamentalnode(CFundamentalnodePaymentWinner& winner);
@@ -261,6 +339,10 @@ public:
     void CleanPaymentList();
     int LastPayment(CFundamentalnode& mn);
 
+    bool HasVote(const uint256& hash);
+    bool GetVote(const uint256& hash, CFundamentalnodePaymentWinner& winner);
+    bool HasPayeeWithVotes(int nBlockHeight, const CScript& payee, int nVotesReq);
+
     bool GetBlockPayee(int nBlockHeight, CScript& payee);
     bool IsTransactionValid(const CTransaction& txNew, int nBlockHeight);
     bool IsScheduled(CFundamentalnode& mn, int nNotBlockHeight);
@@ -269,17 +351,19 @@ public:
     {
         LOCK(cs_mapFundamentalnodePayeeVotes);
 
-        if (mapFundamentalnodesLastVote.count(outFundamentalnode.hash + outFundamentalnode.n)) {
-            if (mapFundamentalnodesLastVote[outFundamentalnode.hash + outFundamentalnode.n] == nBlockHeight) {
-                return false;
-            }
+        int& nLastVote = mapFundamentalnodesLastVote[outFundamentalnode];
+        if (nLastVote == nBlockHeight) {
+            return false;
         }
 
         //record this fundamentalnode voted
-        mapFundamentalnodesLastVote[outFundamentalnode.hash + outFundamentalnode.n] = nBlockHeight;
+        nLastVote = nBlockHeight;
         return true;
     }
 
+    /** Write the votes not yet in fnpayments.dat */
+    bool Flush(CFundamentalnodePaymentDB& paymentdb);
+
     int GetMinFundamentalnodePaymentsProto();
     void ProcessMessageFundamentalnodePayments(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
     std::string GetRequiredPaymentsString(int nBlockHeight);
@@ -287,16 +371,6 @@ public:
     std::string ToString() const;
     int GetOldestBlock();
     int GetNewestBlock();
-
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
-    {
-        READWRITE(mapFundamentalnodePayeeVotes);
-        READWRITE(mapFundamentalnodeBlocks);
-    }
 };
 
-
 #endif
@@ -98,7 +98,7 @@ void CFundamentalnodeSync::AddedFundamentalnodeList(uint256 hash)
 
 void CFundamentalnodeSync::AddedFundamentalnodeWinner(uint256 hash)
 {
-    if (fundamentalnodePayments.mapFundamentalnodePayeeVotes.count(hash)) {
+    if (fundamentalnodePayments.HasVote(hash)) {
         if (mapSeenSyncMNW[hash] < FUNDAMENTALNODE_SYNC_THRESHOLD) {
             lastFundamentalnodeWinner = GetTime();
             mapSeenSyncMNW[hash]++;
@@ -280,14 +280,12 @@ int64_t CFundamentalnode::GetLastPaid()
         }
         n++;
 
-        if (fundamentalnodePayments.mapFundamentalnodeBlocks.count(BlockReading->nHeight)) {
-            /*
-                Search for this payee, with at least 2 votes. This will aid in consensus allowing the network
-                to converge on the same payees quickly, then keep the same schedule.
-            */
-            if (fundamentalnodePayments.mapFundamentalnodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2)) {
-                return BlockReading->nTime + nOffset;
-            }
+        /*
+            Search for this payee, with at least 2 votes. This will aid in consensus allowing the network
+            to converge on the same payees quickly, then keep the same schedule.
+        */
+        if (fundamentalnodePayments.HasPayeeWithVotes(BlockReading->nHeight, mnpayee, 2)) {
+            return BlockReading->nTime + nOffset;
         }
 
         if (BlockReading->pprev == NULL) {
@@ -477,7 +475,7 @@ bool CFundamentalnodeBroadcast::CheckDefaultPort(std::string strService, std::st
     return true;
 }
 
-bool CFundamentalnodeBroadcast::CheckAndUpdate(int& nDos)
+bool CFundamentalnodeBroadcast::CheckFields(int& nDos)
 {
     // make sure signature isn't in the future (past is OK)
     if (sigTime > GetAdjustedTime() + 60 * 60) {
@@ -486,8 +484,8 @@ bool CFundamentalnodeBroadcast::CheckAndUpdate(int& nDos)
         return false;
     }
 
-    // incorrect ping or its sigTime
-    if(lastPing == CFundamentalnodePing() || !lastPing.CheckAndUpdate(nDos, false, true))
+    // incorrect ping sigTime
+    if(lastPing == CFundamentalnodePing() || !lastPing.CheckSigTime(nDos))
         return false;
 
     if (protocolVersion < fundamentalnodePayments.GetMinFundamentalnodePaymentsProto()) {
@@ -518,6 +516,18 @@ bool CFundamentalnodeBroadcast::CheckAndUpdate(int& nDos)
         return false;
     }
 
+    return true;
+}
+
+bool CFundamentalnodeBroadcast::CheckAndUpdate(int& nDos)
+{
+    if (!CheckFields(nDos))
+        return false;
+
+    // incorrect ping signature
+    if (!lastPing.CheckAndUpdate(nDos, false, true))
+        return false;
+
     std::string errorMessage = "";
     if (!obfuScationSigner.VerifyMessage(pubKeyCollateralAddress, sig, GetNewStrMessage(), errorMessage)
     		&& !obfuScationSigner.VerifyMessage(pubKeyCollateralAddress, sig, GetOldStrMessage(), errorMessage)) {
@@ -554,8 +564,7 @@ bool CFundamentalnodeBroadcast::CheckAndUpdate(int& nDos)
         //take the newest entry
         LogPrint("fundamentalnode","mnb - Got updated entry for %s\n", vin.prevout.hash.ToString());
         if (pmn->UpdateFromNewBroadcast((*this))) {
-            pmn->Check();
-            if (pmn->IsEnabled()) Relay();
+            if (mnodeman.CheckEntry(*pmn)) Relay();
         }
         fundamentalnodeSync.AddedFundamentalnodeList(GetHash());
     }
@@ -753,7 +762,7 @@ bool CFundamentalnodePing::Sign(CKey& keyFundamentalnode, CPubKey& pubKeyFundame
     std::string strFundamentalNodeSignMessage;
 
     sigTime = GetAdjustedTime();
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    std::string strMessage = GetStrMessage();
 
     if (!obfuScationSigner.SignMessage(strMessage, errorMessage, vchSig, keyFundamentalnode)) {
         LogPrint("fundamentalnode","CFundamentalnodePing::Sign() - Error: %s\n", errorMessage);
@@ -768,8 +777,13 @@ bool CFundamentalnodePing::Sign(CKey& keyFundamentalnode, CPubKey& pubKeyFundame
     return true;
 }
 
+std::string CFundamentalnodePing::GetStrMessage() const
+{
+    return vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+}
+
 bool CFundamentalnodePing::VerifySignature(CPubKey& pubKeyFundamentalnode, int &nDos) {
-	std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+	std::string strMessage = GetStrMessage();
 	std::string errorMessage = "";
 
 	if(!obfuScationSigner.VerifyMessage(pubKeyFundamentalnode, vchSig, strMessage, errorMessage)){
@@ -779,20 +793,28 @@ bool CFundamentalnodePing::VerifySignature(CPubKey& pubKeyFundamentalnode, int &
 	return true;
 }
 
-bool CFundamentalnodePing::CheckAndUpdate(int& nDos, bool fRequireEnabled, bool fCheckSigTimeOnly)
+bool CFundamentalnodePing::CheckSigTime(int& nDos)
 {
     if (sigTime > GetAdjustedTime() + 60 * 60) {
-        LogPrint("fundamentalnode","CFundamentalnodePing::CheckAndUpdate - Signature rejected, too far into the future %s\n", vin.prevout.hash.ToString());
+        LogPrint("fundamentalnode","CFundamentalnodePing::CheckSigTime - Signature rejected, too far into the future %s\n", vin.prevout.hash.ToString());
         nDos = 1;
         return false;
     }
 
     if (sigTime <= GetAdjustedTime() - 60 * 60) {
-        LogPrint("fundamentalnode","CFundamentalnodePing::CheckAndUpdate - Signature rejected, too far into the past %s - %d %d \n", vin.prevout.hash.ToString(), sigTime, GetAdjustedTime());
+        LogPrint("fundamentalnode","CFundamentalnodePing::CheckSigTime - Signature rejected, too far into the past %s - %d %d \n", vin.prevout.hash.ToString(), sigTime, GetAdjustedTime());
         nDos = 1;
         return false;
     }
 
+    return true;
+}
+
+bool CFundamentalnodePing::CheckAndUpdate(int& nDos, bool fRequireEnabled, bool fCheckSigTimeOnly)
+{
+    if (!CheckSigTime(nDos))
+        return false;
+
     if(fCheckSigTimeOnly) {
     	CFundamentalnode* pmn = mnodeman.Find(vin);
     	if(pmn) return VerifySignature(pmn->pubKeyFundamentalnode, nDos);
@@ -839,8 +861,7 @@ bool CFundamentalnodePing::CheckAndUpdate(int& nDos, bool fRequireEnabled, bool
                 mnodeman.mapSeenFundamentalnodeBroadcast[hash].lastPing = *this;
             }
 
-            pmn->Check(true);
-            if (!pmn->IsEnabled()) return false;
+            if (!mnodeman.CheckEntry(*pmn, true)) return false;
 
             LogPrint("fundamentalnode", "CFundamentalnodePing::CheckAndUpdate - Fundamentalnode ping accepted, vin: %s\n", vin.prevout.hash.ToString());
 
@@ -63,8 +63,11 @@ public:
     }
 
     bool CheckAndUpdate(int& nDos, bool fRequireEnabled = true, bool fCheckSigTimeOnly = false);
+    //! Whether sigTime is within an hour of the adjusted time
+    bool CheckSigTime(int& nDos);
     bool Sign(CKey& keyFundamentalnode, CPubKey& pubKeyFundamentalnode);
     bool VerifySignature(CPubKey& pubKeyFundamentalnode, int &nDos);
+    std::string GetStrMessage() const;
     void Relay();
 
     uint256 GetHash()
@@ -294,6 +297,8 @@ public:
     CFundamentalnodeBroadcast(const CFundamentalnode& mn);
 
     bool CheckAndUpdate(int& nDoS);
+    //! The checks of CheckAndUpdate that need neither signature checks nor the fundamentalnode list
+    bool CheckFields(int& nDoS);
     bool CheckInputsAndAdd(int& nDos);
     bool Sign(CKey& keyCollateralAddress);
     bool VerifySignature();
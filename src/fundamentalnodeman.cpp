@@ -34,14 +34,6 @@ struct CompareScoreTxIn {
     }
 };
 
-struct CompareScoreMN {
-    bool operator()(const pair<int64_t, CFundamentalnode>& t1,
-        const pair<int64_t, CFundamentalnode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
-
 //
 // CFundamentalnodeDB
 //
@@ -205,10 +197,10 @@ bool CFundamentalnodeMan::Add(CFundamentalnode& mn)
     if (!mn.IsEnabled())
         return false;
 
-    CFundamentalnode* pmn = Find(mn.vin);
-    if (pmn == NULL) {
+    if (listFundamentalnodes.Find(mn.vin.prevout) == NULL) {
         LogPrint("fundamentalnode", "CFundamentalnodeMan: Adding new Fundamentalnode %s - %i now\n", mn.vin.prevout.hash.ToString(), size() + 1);
-        vFundamentalnodes.push_back(mn);
+        listFundamentalnodes.Add(mn);
+        rankCache.Clear();
         return true;
     }
 
@@ -235,8 +227,29 @@ void CFundamentalnodeMan::Check()
 {
     LOCK(cs);
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        mn.Check();
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes)
+        CheckEntry(mn);
+}
+
+bool CFundamentalnodeMan::CheckEntry(CFundamentalnode& mn, bool forceCheck)
+{
+    LOCK(cs);
+
+    mn.Check(forceCheck);
+
+    // the counters and rankings only count enabled Fundamentalnodes
+    if (listFundamentalnodes.Refresh(mn)) rankCache.Clear();
+
+    return mn.IsEnabled();
+}
+
+void CFundamentalnodeMan::ForEachFundamentalnode(boost::function<void(CFundamentalnode&)> fn)
+{
+    LOCK(cs);
+
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
+        CheckEntry(mn);
+        fn(mn);
     }
 }
 
@@ -247,8 +260,8 @@ void CFundamentalnodeMan::CheckAndRemove(bool forceExpiredRemoval)
     LOCK(cs);
 
     //remove inactive and outdated
-    vector<CFundamentalnode>::iterator it = vFundamentalnodes.begin();
-    while (it != vFundamentalnodes.end()) {
+    CNodeList<CFundamentalnode, &CFundamentalnode::pubKeyFundamentalnode>::iterator it = listFundamentalnodes.begin();
+    while (it != listFundamentalnodes.end()) {
         if ((*it).activeState == CFundamentalnode::FUNDAMENTALNODE_REMOVE ||
             (*it).activeState == CFundamentalnode::FUNDAMENTALNODE_VIN_SPENT ||
             (forceExpiredRemoval && (*it).activeState == CFundamentalnode::FUNDAMENTALNODE_EXPIRED) ||
@@ -278,7 +291,8 @@ void CFundamentalnodeMan::CheckAndRemove(bool forceExpiredRemoval)
                 }
             }
 
-            it = vFundamentalnodes.erase(it);
+            it = listFundamentalnodes.Erase(it);
+            rankCache.Clear();
         } else {
             ++it;
         }
@@ -339,7 +353,8 @@ void CFundamentalnodeMan::CheckAndRemove(bool forceExpiredRemoval)
 void CFundamentalnodeMan::Clear()
 {
     LOCK(cs);
-    vFundamentalnodes.clear();
+    listFundamentalnodes.Clear();
+    rankCache.Clear();
     mAskedUsForFundamentalnodeList.clear();
     mWeAskedForFundamentalnodeList.clear();
     mWeAskedForFundamentalnodeListEntry.clear();
@@ -355,7 +370,9 @@ int CFundamentalnodeMan::stable_size ()
     int64_t nFundamentalnode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nFundamentalnode_Age = 0;
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
+    LOCK(cs);
+
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
         if (mn.protocolVersion < nMinProtocol) {
             continue; // Skip obsolete versions
         }
@@ -365,8 +382,7 @@ int CFundamentalnodeMan::stable_size ()
                 continue; // Skip fundamentalnodes younger than (default) 8000 sec (MUST be > FUNDAMENTALNODE_REMOVAL_SECONDS)
             }
         }
-        mn.Check ();
-        if (!mn.IsEnabled ())
+        if (!CheckEntry(mn))
             continue; // Skip not-enabled fundamentalnodes
 
         nStable_size++;
@@ -377,24 +393,21 @@ int CFundamentalnodeMan::stable_size ()
 
 int CFundamentalnodeMan::CountEnabled(int protocolVersion)
 {
-    int i = 0;
-    protocolVersion = protocolVersion == -1 ? fundamentalnodePayments.GetMinFundamentalnodePaymentsProto() : protocolVersion;
+    LOCK(cs);
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        mn.Check();
-        if (mn.protocolVersion < protocolVersion || !mn.IsEnabled()) continue;
-        i++;
-    }
+    protocolVersion = protocolVersion == -1 ? fundamentalnodePayments.GetMinFundamentalnodePaymentsProto() : protocolVersion;
 
-    return i;
+    // as of the last check of each Fundamentalnode
+    return listFundamentalnodes.CountEnabled(protocolVersion);
 }
 
 void CFundamentalnodeMan::CountNetworks(int protocolVersion, int& ipv4, int& ipv6, int& onion)
 {
     protocolVersion = protocolVersion == -1 ? fundamentalnodePayments.GetMinFundamentalnodePaymentsProto() : protocolVersion;
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        mn.Check();
+    LOCK(cs);
+
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
         std::string strHost;
         int port;
         SplitHostPort(mn.addr.ToString(), port, strHost);
@@ -440,7 +453,7 @@ CFundamentalnode* CFundamentalnodeMan::Find(const CScript& payee)
     LOCK(cs);
     CScript payee2;
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
         payee2 = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
         if (payee2 == payee)
             return &mn;
@@ -452,11 +465,7 @@ CFundamentalnode* CFundamentalnodeMan::Find(const CTxIn& vin)
 {
     LOCK(cs);
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        if (mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    return listFundamentalnodes.Find(vin.prevout);
 }
 
 
@@ -464,11 +473,7 @@ CFundamentalnode* CFundamentalnodeMan::Find(const CPubKey& pubKeyFundamentalnode
 {
     LOCK(cs);
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        if (mn.pubKeyFundamentalnode == pubKeyFundamentalnode)
-            return &mn;
-    }
-    return NULL;
+    return listFundamentalnodes.Find(pubKeyFundamentalnode);
 }
 
 //
@@ -486,9 +491,8 @@ CFundamentalnode* CFundamentalnodeMan::GetNextFundamentalnodeInQueueForPayment(i
     */
 
     int nMnCount = CountEnabled();
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        mn.Check();
-        if (!mn.IsEnabled()) continue;
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
+        if (!CheckEntry(mn)) continue;
 
         // //check protocol version
         if (mn.protocolVersion < fundamentalnodePayments.GetMinFundamentalnodePaymentsProto()) continue;
@@ -547,18 +551,13 @@ CFundamentalnode* CFundamentalnodeMan::FindRandomNotInVec(std::vector<CTxIn>& ve
 
     int rand = GetRandInt(nCountEnabled - vecToExclude.size());
     LogPrint("fundamentalnode", "CFundamentalnodeMan::FindRandomNotInVec - rand %d\n", rand);
-    bool found;
+    std::set<COutPoint> setExcluded;
+    BOOST_FOREACH (CTxIn& usedVin, vecToExclude)
+        setExcluded.insert(usedVin.prevout);
 
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
         if (mn.protocolVersion < protocolVersion || !mn.IsEnabled()) continue;
-        found = false;
-        BOOST_FOREACH (CTxIn& usedVin, vecToExclude) {
-            if (mn.vin.prevout == usedVin.prevout) {
-                found = true;
-                break;
-            }
-        }
-        if (found) continue;
+        if (setExcluded.count(mn.vin.prevout)) continue;
         if (--rand < 1) {
             return &mn;
         }
@@ -567,143 +566,115 @@ CFundamentalnode* CFundamentalnodeMan::FindRandomNotInVec(std::vector<CTxIn>& ve
     return NULL;
 }
 
-CFundamentalnode* CFundamentalnodeMan::GetCurrentFundamentalNode(int mod, int64_t nBlockHeight, int minProtocol)
+const CNodeRanking* CFundamentalnodeMan::GetRanking(int64_t nBlockHeight, int minProtocol, int nFilter)
 {
-    int64_t score = 0;
-    CFundamentalnode* winner = NULL;
-
-    // scan for winner
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        mn.Check();
-        if (mn.protocolVersion < minProtocol || !mn.IsEnabled()) continue;
-
-        // calculate the score for each Fundamentalnode
-        uint256 n = mn.CalculateScore(mod, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        // determine the winner
-        if (n2 > score) {
-            score = n2;
-            winner = &mn;
-        }
-    }
-
-    return winner;
-}
-
-int CFundamentalnodeMan::GetFundamentalnodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
-{
-    std::vector<pair<int64_t, CTxIn> > vecFundamentalnodeScores;
-    int64_t nFundamentalnode_Min_Age = MN_WINNER_MINIMUM_AGE;
-    int64_t nFundamentalnode_Age = 0;
+    LOCK(cs);
 
     //make sure we know about this block
     uint256 hash = 0;
-    if (!GetBlockHash(hash, nBlockHeight)) return -1;
+    if (!GetBlockHash(hash, nBlockHeight)) return NULL;
+
+    int64_t nNow = GetAdjustedTime();
+    const CNodeRanking* pranking = rankCache.Get(nBlockHeight, minProtocol, nFilter, hash, nNow);
+    if (pranking) return pranking;
 
-    // scan for winner
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
+    // Fundamentalnodes are only checked again once the ranking expires
+    int64_t nExpireTime = nNow + FUNDAMENTALNODE_CHECK_SECONDS;
+    std::vector<pair<int64_t, CTxIn> > vecFundamentalnodeScores;
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
         if (mn.protocolVersion < minProtocol) {
             LogPrint("fundamentalnode","Skipping Fundamentalnode with obsolete version %d\n", mn.protocolVersion);
             continue;                                                       // Skip obsolete versions
         }
 
-        if (IsSporkActive(SPORK_8_FUNDAMENTALNODE_PAYMENT_ENFORCEMENT)) {
-            nFundamentalnode_Age = GetAdjustedTime() - mn.sigTime;
-            if ((nFundamentalnode_Age) < nFundamentalnode_Min_Age) {
-                if (fDebug) LogPrint("fundamentalnode","Skipping just activated Fundamentalnode. Age: %ld\n", nFundamentalnode_Age);
+        if (nFilter & RANK_MIN_AGE) {
+            if (nNow - mn.sigTime < MN_WINNER_MINIMUM_AGE) {
+                if (fDebug) LogPrint("fundamentalnode","Skipping just activated Fundamentalnode. Age: %ld\n", nNow - mn.sigTime);
+                // rank again once it has come of age
+                nExpireTime = std::min(nExpireTime, mn.sigTime + MN_WINNER_MINIMUM_AGE);
                 continue;                                                   // Skip fundamentalnodes younger than (default) 1 hour
             }
         }
-        if (fOnlyActive) {
-            mn.Check();
-            if (!mn.IsEnabled()) continue;
-        }
+        if ((nFilter & RANK_ONLY_ACTIVE) && !CheckEntry(mn)) continue;
         uint256 n = mn.CalculateScore(1, nBlockHeight);
         int64_t n2 = n.GetCompact(false);
 
         vecFundamentalnodeScores.push_back(make_pair(n2, mn.vin));
     }
 
-    sort(vecFundamentalnodeScores.rbegin(), vecFundamentalnodeScores.rend(), CompareScoreTxIn());
+    return &rankCache.Set(nBlockHeight, minProtocol, nFilter, CNodeRanking(hash, nExpireTime, vecFundamentalnodeScores));
+}
 
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CTxIn) & s, vecFundamentalnodeScores) {
-        rank++;
-        if (s.second.prevout == vin.prevout) {
-            return rank;
-        }
-    }
+CFundamentalnode* CFundamentalnodeMan::GetCurrentFundamentalNode(int64_t nBlockHeight, int minProtocol)
+{
+    LOCK(cs);
+
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, minProtocol, RANK_ONLY_ACTIVE);
+    if (!pranking) return NULL;
+
+    // the winner is the Fundamentalnode with the highest score
+    const pair<int64_t, CTxIn>* pwinner = pranking->GetByRank(1);
+    if (!pwinner || pwinner->first <= 0) return NULL;
 
-    return -1;
+    return Find(pwinner->second);
 }
 
-std::vector<pair<int, CFundamentalnode> > CFundamentalnodeMan::GetFundamentalnodeRanks(int64_t nBlockHeight, int minProtocol)
+int CFundamentalnodeMan::GetFundamentalnodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<pair<int64_t, CFundamentalnode> > vecFundamentalnodeScores;
-    std::vector<pair<int, CFundamentalnode> > vecFundamentalnodeRanks;
+    LOCK(cs);
 
-    //make sure we know about this block
-    uint256 hash = 0;
-    if (!GetBlockHash(hash, nBlockHeight)) return vecFundamentalnodeRanks;
+    int nFilter = fOnlyActive ? RANK_ONLY_ACTIVE : RANK_ALL;
+    if (IsSporkActive(SPORK_8_FUNDAMENTALNODE_PAYMENT_ENFORCEMENT))
+        nFilter |= RANK_MIN_AGE;
 
-    // scan for winner
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        mn.Check();
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, minProtocol, nFilter);
+    if (!pranking) return -1;
 
-        if (mn.protocolVersion < minProtocol) continue;
+    return pranking->GetRank(vin.prevout);
+}
 
-        if (!mn.IsEnabled()) {
-            vecFundamentalnodeScores.push_back(make_pair(9999, mn));
-            continue;
-        }
+void CFundamentalnodeMan::ForEachRankedFundamentalnode(int64_t nBlockHeight, boost::function<void(int, CFundamentalnode&)> fn)
+{
+    LOCK(cs);
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, 0, RANK_ONLY_ACTIVE);
+    if (!pranking) return;
 
-        vecFundamentalnodeScores.push_back(make_pair(n2, mn));
+    for (unsigned int rank = 1; rank <= pranking->size(); rank++) {
+        CFundamentalnode* pmn = Find(pranking->GetByRank(rank)->second);
+        if (pmn) fn(rank, *pmn);
     }
 
-    sort(vecFundamentalnodeScores.rbegin(), vecFundamentalnodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CFundamentalnode) & s, vecFundamentalnodeScores) {
-        rank++;
-        vecFundamentalnodeRanks.push_back(make_pair(rank, s.second));
+    // the ones that are not enabled follow, unranked
+    BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
+        if (pranking->GetRank(mn.vin.prevout) == -1) fn(0, mn);
     }
-
-    return vecFundamentalnodeRanks;
 }
 
 CFundamentalnode* CFundamentalnodeMan::GetFundamentalnodeByRank(int nRank, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<pair<int64_t, CTxIn> > vecFundamentalnodeScores;
+    LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-        if (mn.protocolVersion < minProtocol) continue;
-        if (fOnlyActive) {
-            mn.Check();
-            if (!mn.IsEnabled()) continue;
-        }
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, minProtocol, fOnlyActive ? RANK_ONLY_ACTIVE : RANK_ALL);
+    if (!pranking) return NULL;
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
+    const pair<int64_t, CTxIn>* pscore = pranking->GetByRank(nRank);
+    if (!pscore) return NULL;
 
-        vecFundamentalnodeScores.push_back(make_pair(n2, mn.vin));
-    }
+    return Find(pscore->second);
+}
 
-    sort(vecFundamentalnodeScores.rbegin(), vecFundamentalnodeScores.rend(), CompareScoreTxIn());
+void CFundamentalnodeMan::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    LOCK(cs);
 
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CTxIn) & s, vecFundamentalnodeScores) {
-        rank++;
-        if (rank == nRank) {
-            return Find(s.second);
-        }
-    }
+    rankCache.Prune(pindex->nHeight - NODE_RANK_CACHE_DEPTH);
 
-    return NULL;
+    // payment votes for the next blocks are checked against this ranking
+    int nFilter = RANK_ONLY_ACTIVE;
+    if (IsSporkActive(SPORK_8_FUNDAMENTALNODE_PAYMENT_ENFORCEMENT))
+        nFilter |= RANK_MIN_AGE;
+    GetRanking(pindex->nHeight + 10 - 100, ActiveProtocol(), nFilter);
 }
 
 void CFundamentalnodeMan::ProcessFundamentalnodeConnections()
@@ -730,6 +701,7 @@ void CFundamentalnodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand,
     LOCK(cs_process_message);
 
     if (strCommand == "fnb") { //Fundamentalnode Broadcast
+        CDataStream vRecvCopy(vRecv);
         CFundamentalnodeBroadcast fnb;
         vRecv >> fnb;
 
@@ -737,9 +709,23 @@ void CFundamentalnodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand,
             fundamentalnodeSync.AddedFundamentalnodeList(fnb.GetHash());
             return;
         }
-        mapSeenFundamentalnodeBroadcast.insert(make_pair(fnb.GetHash(), fnb));
 
+        // check the signatures on a worker thread, which then processes the broadcast,
+        // a broadcast failing the cheap checks is rejected right away below
         int nDoS = 0;
+        if (fnb.CheckFields(nDoS)) {
+            std::vector<CObfuScationSigCheck> vChecks;
+            CFundamentalnode* pmn = Find(fnb.vin);
+            if (pmn)
+                vChecks.push_back(CObfuScationSigCheck(pmn->pubKeyFundamentalnode, fnb.lastPing.vchSig, fnb.lastPing.GetStrMessage()));
+            vChecks.push_back(CObfuScationSigCheck(fnb.pubKeyCollateralAddress, fnb.sig, fnb.GetNewStrMessage()));
+            vChecks.back().vMessages.push_back(fnb.GetOldStrMessage());
+            if (obfuScationVerifyPool.Defer(pfrom, fnb.GetHash(), fnb.vin.prevout, vChecks, boost::bind(&CFundamentalnodeMan::ProcessMessage, this, pfrom, strCommand, vRecvCopy)))
+                return;
+        }
+        mapSeenFundamentalnodeBroadcast.insert(make_pair(fnb.GetHash(), fnb));
+
+        nDoS = 0;
         if (!fnb.CheckAndUpdate(nDoS)) {
             if (nDoS > 0)
                 Misbehaving(pfrom->GetId(), nDoS);
@@ -773,15 +759,28 @@ void CFundamentalnodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand,
     }
 
     else if (strCommand == "fnp") { //Fundamentalnode Ping
+        CDataStream vRecvCopy(vRecv);
         CFundamentalnodePing fnp;
         vRecv >> fnp;
 
         LogPrint("fundamentalnode", "fnp - Fundamentalnode ping, vin: %s\n", fnp.vin.prevout.hash.ToString());
 
         if (mapSeenFundamentalnodePing.count(fnp.GetHash())) return; //seen
-        mapSeenFundamentalnodePing.insert(make_pair(fnp.GetHash(), fnp));
 
+        // check the signature on a worker thread, which then processes the ping; without one to
+        // check it is still deferred while a broadcast for the node is queued, so it isn't lost
         int nDoS = 0;
+        if (fnp.CheckSigTime(nDoS)) {
+            std::vector<CObfuScationSigCheck> vChecks;
+            CFundamentalnode* pmnPing = Find(fnp.vin);
+            if (pmnPing && !pmnPing->IsPingedWithin(FUNDAMENTALNODE_MIN_MNP_SECONDS - 60, fnp.sigTime))
+                vChecks.push_back(CObfuScationSigCheck(pmnPing->pubKeyFundamentalnode, fnp.vchSig, fnp.GetStrMessage()));
+            if (obfuScationVerifyPool.Defer(pfrom, fnp.GetHash(), fnp.vin.prevout, vChecks, boost::bind(&CFundamentalnodeMan::ProcessMessage, this, pfrom, strCommand, vRecvCopy)))
+                return;
+        }
+        mapSeenFundamentalnodePing.insert(make_pair(fnp.GetHash(), fnp));
+
+        nDoS = 0;
         if (fnp.CheckAndUpdate(nDoS)) return;
 
         if (nDoS > 0) {
@@ -825,7 +824,7 @@ void CFundamentalnodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand,
 
         int nInvCount = 0;
 
-        BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
+        BOOST_FOREACH (CFundamentalnode& mn, listFundamentalnodes) {
             if (mn.addr.IsRFC1918()) continue; //local network
 
             if (mn.IsEnabled()) {
@@ -952,8 +951,7 @@ void CFundamentalnodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand,
                         pmn->lastPing = CFundamentalnodePing(vin);
                     }
                     pmn->nLastDsee = sigTime;
-                    pmn->Check();
-                    if (pmn->IsEnabled()) {
+                    if (CheckEntry(*pmn)) {
                         TRY_LOCK(cs_vNodes, lockNodes);
                         if (!lockNodes) return;
                         BOOST_FOREACH (CNode* pnode, vNodes)
@@ -1115,8 +1113,7 @@ void CFundamentalnodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand,
                 // fake ping for v11 fundamentalnodes, ignore for v12
                 if (pmn->protocolVersion < GETHEADERS_VERSION) pmn->lastPing = CFundamentalnodePing(vin);
                 pmn->nLastDseep = sigTime;
-                pmn->Check();
-                if (pmn->IsEnabled()) {
+                if (CheckEntry(*pmn)) {
                     TRY_LOCK(cs_vNodes, lockNodes);
                     if (!lockNodes) return;
                     LogPrint("fundamentalnode", "obseep - relaying %s \n", vin.prevout.hash.ToString());
@@ -1142,14 +1139,11 @@ void CFundamentalnodeMan::Remove(CTxIn vin)
 {
     LOCK(cs);
 
-    vector<CFundamentalnode>::iterator it = vFundamentalnodes.begin();
-    while (it != vFundamentalnodes.end()) {
-        if ((*it).vin == vin) {
-            LogPrint("fundamentalnode", "CFundamentalnodeMan: Removing Fundamentalnode %s - %i now\n", (*it).vin.prevout.hash.ToString(), size() - 1);
-            vFundamentalnodes.erase(it);
-            break;
-        }
-        ++it;
+    CFundamentalnode* pmn = listFundamentalnodes.Find(vin.prevout);
+    if (pmn && pmn->vin == vin) {
+        LogPrint("fundamentalnode", "CFundamentalnodeMan: Removing Fundamentalnode %s - %i now\n", vin.prevout.hash.ToString(), size() - 1);
+        listFundamentalnodes.Erase(vin.prevout);
+        rankCache.Clear();
     }
 }
 
@@ -1166,7 +1160,11 @@ void CFundamentalnodeMan::UpdateFundamentalnodeList(CFundamentalnodeBroadcast fn
         CFundamentalnode mn(fnb);
         Add(mn);
     } else {
-        pmn->UpdateFromNewBroadcast(fnb);
+        LOCK(cs);
+        if (pmn->UpdateFromNewBroadcast(fnb)) {
+            listFundamentalnodes.Refresh(*pmn);
+            rankCache.Clear();
+        }
     }
 }
 
@@ -1174,7 +1172,7 @@ std::string CFundamentalnodeMan::ToString() const
 {
     std::ostringstream info;
 
-    info << "Fundamentalnodes: " << (int)vFundamentalnodes.size() << ", peers who asked us for Fundamentalnode list: " << (int)mAskedUsForFundamentalnodeList.size() << ", peers we asked for Fundamentalnode list: " << (int)mWeAskedForFundamentalnodeList.size() << ", entries in Fundamentalnode list we asked for: " << (int)mWeAskedForFundamentalnodeListEntry.size() << ", nDsqCount: " << (int)nDsqCount;
+    info << "Fundamentalnodes: " << (int)listFundamentalnodes.size() << ", peers who asked us for Fundamentalnode list: " << (int)mAskedUsForFundamentalnodeList.size() << ", peers we asked for Fundamentalnode list: " << (int)mWeAskedForFundamentalnodeList.size() << ", entries in Fundamentalnode list we asked for: " << (int)mWeAskedForFundamentalnodeListEntry.size() << ", nDsqCount: " << (int)nDsqCount;
 
     return info.str();
 }
@@ -11,8 +11,13 @@
 #include "main.h"
 #include "fundamentalnode.h"
 #include "net.h"
+#include "nodelist.h"
+#include "noderank.h"
 #include "sync.h"
 #include "util.h"
+#include "validationinterface.h"
+
+#include <boost/function.hpp>
 
 #define FUNDAMENTALNODES_DUMP_SECONDS (15 * 60)
 #define FUNDAMENTALNODES_DSEG_SECONDS (3 * 60 * 60)
@@ -48,7 +53,7 @@ public:
     ReadResult Read(CFundamentalnodeMan& mnodemanToLoad, bool fDryRun = false);
 };
 
-class CFundamentalnodeMan
+class CFundamentalnodeMan : public CValidationInterface
 {
 private:
     // critical section to protect the inner data structures
@@ -57,14 +62,19 @@ private:
     // critical section to protect the inner data structures specifically on messaging
     mutable CCriticalSection cs_process_message;
 
-    // map to hold all MNs
-    std::vector<CFundamentalnode> vFundamentalnodes;
+    // all MNs, indexed by collateral and by pubKeyFundamentalnode
+    CNodeList<CFundamentalnode, &CFundamentalnode::pubKeyFundamentalnode> listFundamentalnodes;
     // who's asked for the Fundamentalnode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForFundamentalnodeList;
     // who we asked for the Fundamentalnode list and the last time
     std::map<CNetAddr, int64_t> mWeAskedForFundamentalnodeList;
     // which Fundamentalnodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForFundamentalnodeListEntry;
+    // rankings already computed for recent blocks
+    CNodeRankCache rankCache;
+
+    /// Rank the Fundamentalnodes for a block, reusing the ranking computed for it before if it is still valid
+    const CNodeRanking* GetRanking(int64_t nBlockHeight, int minProtocol, int nFilter);
 
 public:
     // Keep track of all broadcasts I've seen
@@ -81,7 +91,7 @@ public:
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
     {
         LOCK(cs);
-        READWRITE(vFundamentalnodes);
+        READWRITE(listFundamentalnodes);
         READWRITE(mAskedUsForFundamentalnodeList);
         READWRITE(mWeAskedForFundamentalnodeList);
         READWRITE(mWeAskedForFundamentalnodeListEntry);
@@ -103,6 +113,9 @@ public:
     /// Check all Fundamentalnodes
     void Check();
 
+    /// Check an entry and update the list indexes, counters and rankings if it changed
+    bool CheckEntry(CFundamentalnode& mn, bool forceCheck = false);
+
     /// Check all Fundamentalnodes and remove inactive
     void CheckAndRemove(bool forceExpiredRemoval = false);
 
@@ -127,15 +140,20 @@ public:
     CFundamentalnode* FindRandomNotInVec(std::vector<CTxIn>& vecToExclude, int protocolVersion = -1);
 
     /// Get the current winner for this block
-    CFundamentalnode* GetCurrentFundamentalNode(int mod = 1, int64_t nBlockHeight = 0, int minProtocol = 0);
+    CFundamentalnode* GetCurrentFundamentalNode(int64_t nBlockHeight = 0, int minProtocol = 0);
 
     std::vector<CFundamentalnode> GetFullFundamentalnodeVector()
     {
         Check();
-        return vFundamentalnodes;
+        LOCK(cs);
+        return std::vector<CFundamentalnode>(listFundamentalnodes.begin(), listFundamentalnodes.end());
     }
 
-    std::vector<pair<int, CFundamentalnode> > GetFundamentalnodeRanks(int64_t nBlockHeight, int minProtocol = 0);
+    /// Check all Fundamentalnodes and call fn on each of them under the list lock, without copying the list
+    void ForEachFundamentalnode(boost::function<void(CFundamentalnode&)> fn);
+
+    /// Call fn on each enabled Fundamentalnode with its rank for the block, best first, and then on the others with rank 0, under the list lock
+    void ForEachRankedFundamentalnode(int64_t nBlockHeight, boost::function<void(int, CFundamentalnode&)> fn);
     int GetFundamentalnodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
     CFundamentalnode* GetFundamentalnodeByRank(int nRank, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
 
@@ -144,7 +162,7 @@ public:
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
     /// Return the number of (unique) Fundamentalnodes
-    int size() { return vFundamentalnodes.size(); }
+    int size() { return listFundamentalnodes.size(); }
 
     /// Return the number of Fundamentalnodes older than (default) 8000 seconds
     int stable_size ();
@@ -157,6 +175,9 @@ public:
 
     /// Update fundamentalnode list and maps using provided CFundamentalnodeBroadcast
     void UpdateFundamentalnodeList(CFundamentalnodeBroadcast mnb);
+
+    /// Drop the rankings of old blocks and rank the Fundamentalnodes for the next payment vote
+    void UpdatedBlockTip(const CBlockIndex* pindex);
 };
 
 #endif
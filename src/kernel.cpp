@@ -5,9 +5,14 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <atomic>
+#include <mutex>
+
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 
+#include "crypto/common.h"
 #include "db.h"
 #include "kernel.h"
 #include "script/interpreter.h"
@@ -29,9 +34,8 @@ static bool GetLastStakeModifier(const CBlockIndex* pindex, uint64_t& nStakeModi
 {
     if (!pindex)
         return error("GetLastStakeModifier: null pindex");
-    while (pindex && pindex->pprev && !pindex->GeneratedStakeModifier())
-        pindex = pindex->pprev;
-    if (!pindex->GeneratedStakeModifier())
+    pindex = chainActive.FindLastStakeModifier(pindex);
+    if (!pindex)
         return error("GetLastStakeModifier: no generation at genesis block");
     nStakeModifier = pindex->nStakeModifier;
     nModifierTime = pindex->GetBlockTime();
@@ -46,11 +50,19 @@ static int64_t GetStakeModifierSelectionIntervalSection(int nSection)
     return a;
 }
 
+// Order the modifier candidates by timestamp, then by block hash
+static bool CompareCandidates(const pair<int64_t, const CBlockIndex*>& a, const pair<int64_t, const CBlockIndex*>& b)
+{
+    if (a.first != b.first)
+        return a.first < b.first;
+    return a.second->GetBlockHash() < b.second->GetBlockHash();
+}
+
 // select a block from the candidate blocks in vSortedByTimestamp, excluding
 // already selected blocks in vSelectedBlocks, and with timestamp up to
 // nSelectionIntervalStop.
 static bool SelectBlockFromCandidates(
-    vector<pair<int64_t, uint256> >& vSortedByTimestamp,
+    vector<pair<int64_t, const CBlockIndex*> >& vSortedByTimestamp,
     map<uint256, const CBlockIndex*>& mapSelectedBlocks,
     int64_t nSelectionIntervalStop,
     uint64_t nStakeModifierPrev,
@@ -61,11 +73,8 @@ static bool SelectBlockFromCandidates(
     bool fSelected = false;
     uint256 hashBest = 0;
     *pindexSelected = (const CBlockIndex*)0;
-    BOOST_FOREACH (const PAIRTYPE(int64_t, uint256) & item, vSortedByTimestamp) {
-        if (!mapBlockIndex.count(item.second))
-            return error("SelectBlockFromCandidates: failed to find block index for candidate block %s", item.second.ToString().c_str());
-
-        const CBlockIndex* pindex = mapBlockIndex[item.second];
+    BOOST_FOREACH (const PAIRTYPE(int64_t, const CBlockIndex*) & item, vSortedByTimestamp) {
+        const CBlockIndex* pindex = item.second;
         if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
             break;
 
@@ -183,19 +192,19 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeMod
         return true;
 
     // Sort candidate blocks by timestamp
-    std::vector<std::pair<int64_t, uint256> > vSortedByTimestamp;
+    std::vector<std::pair<int64_t, const CBlockIndex*> > vSortedByTimestamp;
     vSortedByTimestamp.reserve(64 * MODIFIER_INTERVAL  / Params().TargetSpacing());
     int64_t nSelectionIntervalStart = (pindexPrev->GetBlockTime() / MODIFIER_INTERVAL ) * MODIFIER_INTERVAL  - OLD_MODIFIER_INTERVAL;
     const CBlockIndex* pindex = pindexPrev;
 
     while (pindex && pindex->GetBlockTime() >= nSelectionIntervalStart) {
-        vSortedByTimestamp.push_back(make_pair(pindex->GetBlockTime(), pindex->GetBlockHash()));
+        vSortedByTimestamp.push_back(make_pair(pindex->GetBlockTime(), pindex));
         pindex = pindex->pprev;
     }
 
     int nHeightFirstCandidate = pindex ? (pindex->nHeight + 1) : 0;
     reverse(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
-    sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end());
+    sort(vSortedByTimestamp.begin(), vSortedByTimestamp.end(), CompareCandidates);
 
     // Select 64 blocks from candidate blocks to generate stake modifier
     uint64_t nStakeModifierNew = 0;
@@ -266,27 +275,32 @@ bool GetKernelStakeModifier(const uint256& hashBlockFrom, uint64_t& nStakeModifi
         nStakeModifier = pindexFrom->nStakeModifier;
         return true;
     }
-    const CBlockIndex* pindex = pindexFrom;
-    CBlockIndex* pindexNext = chainActive[pindex->nHeight + 1];
-
-    // loop to find the stake modifier later by a selection interval
-    do {
-        if (!pindexNext) {
-            // Should never happen
-            return error("%s : Null pindexNext, current block %s ", __func__, pindex->phashBlock->GetHex());
-        }
-        pindex = pindexNext;
-        if (pindex->GeneratedStakeModifier()) {
-            nStakeModifierHeight = pindex->nHeight;
-            nStakeModifierTime = pindex->GetBlockTime();
-        }
-        pindexNext = chainActive[pindex->nHeight + 1];
-    } while (nStakeModifierTime < pindexFrom->GetBlockTime() + OLD_MODIFIER_INTERVAL);
 
+    // find the stake modifier later by a selection interval
+    const CBlockIndex* pindex = chainActive.FindNextStakeModifier(pindexFrom->nHeight, pindexFrom->GetBlockTime() + OLD_MODIFIER_INTERVAL);
+    if (!pindex) {
+        // Should never happen
+        return error("%s : no stake modifier after block %s ", __func__, pindexFrom->phashBlock->GetHex());
+    }
+    nStakeModifierHeight = pindex->nHeight;
+    nStakeModifierTime = pindex->GetBlockTime();
     nStakeModifier = pindex->nStakeModifier;
     return true;
 }
 
+// Kernel target weighted by the value of the stake
+static uint256 GetStakeTarget(const unsigned int nBits, const CAmount& nValueIn)
+{
+    // Base target
+    uint256 bnTarget;
+    bnTarget.SetCompact(nBits);
+
+    // Weighted target
+    uint256 bnWeight = uint256(nValueIn) / 100;
+    bnTarget *= bnWeight;
+    return bnTarget;
+}
+
 bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, const unsigned int nBits, CStakeInput* stake, const unsigned int nTimeTx, uint256& hashProofOfStake, const bool fVerify)
 {
     // Calculate the proof of stake hash
@@ -296,14 +310,7 @@ bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, const unsigned int nBit
 
     const CAmount& nValueIn = stake->GetValue();
     const CDataStream& ssUniqueID = stake->GetUniqueness();
-
-    // Base target
-    uint256 bnTarget;
-    bnTarget.SetCompact(nBits);
-
-    // Weighted target
-    uint256 bnWeight = uint256(nValueIn) / 100;
-    bnTarget *= bnWeight;
+    const uint256 bnTarget = GetStakeTarget(nBits, nValueIn);
 
     // Check if proof-of-stake hash meets target protocol
     const bool res = (hashProofOfStake < bnTarget);
@@ -327,16 +334,9 @@ bool CheckStakeKernelHash(const CBlockIndex* pindexPrev, const unsigned int nBit
     return res;
 }
 
-bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, const unsigned int nTimeTx, const bool fVerify, uint256& hashProofOfStakeRet)
+// Serialize the stake modifier, which starts the kernel
+static bool GetKernelModifier(const CBlockIndex* pindexPrev, CStakeInput* stake, CDataStream& modifier_ss)
 {
-    // Grab the stake data
-    CBlockIndex* pindexfrom = stake->GetIndexFrom();
-    if (!pindexfrom) return error("%s : Failed to find the block index for stake origin", __func__);
-    const CDataStream& ssUniqueID = stake->GetUniqueness();
-    const unsigned int nTimeBlockFrom = pindexfrom->nTime;
-    CDataStream modifier_ss(SER_GETHASH, 0);
-
-    // Hash the modifier
     if (!Params().IsStakeModifierV2(pindexPrev->nHeight + 1, getStakeModifierV2SporkValue())) {
         // Modifier v1
         uint64_t nStakeModifier = 0;
@@ -347,11 +347,34 @@ bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, cons
         // Modifier v2
         modifier_ss << pindexPrev->nStakeModifierV2;
     }
+    return true;
+}
+
+// Hash the kernel: modifier, block from time and stake uniqueness, followed by the tx time
+static uint256 HashKernel(const CDataStream& ssPrefix, const unsigned int nTimeTx)
+{
+    CDataStream ss(ssPrefix);
+    ss << nTimeTx;
+    return Hash(ss.begin(), ss.end());
+}
+
+bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, const unsigned int nTimeTx, const bool fVerify, uint256& hashProofOfStakeRet)
+{
+    // Grab the stake data
+    CBlockIndex* pindexfrom = stake->GetIndexFrom();
+    if (!pindexfrom) return error("%s : Failed to find the block index for stake origin", __func__);
+    const CDataStream& ssUniqueID = stake->GetUniqueness();
+    const unsigned int nTimeBlockFrom = pindexfrom->nTime;
+    CDataStream modifier_ss(SER_GETHASH, 0);
+
+    // Hash the modifier
+    if (!GetKernelModifier(pindexPrev, stake, modifier_ss))
+        return false;
 
     CDataStream ss(modifier_ss);
     // Calculate hash
-    ss << nTimeBlockFrom << ssUniqueID << nTimeTx;
-    hashProofOfStakeRet = Hash(ss.begin(), ss.end());
+    ss << nTimeBlockFrom << ssUniqueID;
+    hashProofOfStakeRet = HashKernel(ss, nTimeTx);
 
     if (fVerify) {
         LogPrint("staking", "%s :{ nStakeModifier=%s\n"
@@ -362,78 +385,196 @@ bool GetHashProofOfStake(const CBlockIndex* pindexPrev, CStakeInput* stake, cons
     return true;
 }
 
-bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int nBits, int64_t& nTimeTx, uint256& hashProofOfStake)
+// Kernel hashes done by the stake search and the time spent on them
+static std::atomic<uint64_t> nStakeSearchHashes(0);
+static std::atomic<int64_t> nStakeSearchMicros(0);
+
+double GetStakeSearchHashRate()
 {
-    const int nHeight = pindexPrev->nHeight + 1;
+    const int64_t nMicros = nStakeSearchMicros;
+    return nMicros > 0 ? nStakeSearchHashes * 1000000.0 / nMicros : 0.0;
+}
 
-    // get stake input pindex
-    CBlockIndex* pindexFrom = stakeInput->GetIndexFrom();
-    if (!pindexFrom || pindexFrom->nHeight < 1) return error("%s : no pindexfrom", __func__);
+int GetStakeSearchThreads()
+{
+    // -stakethreads=0 means one per core, negative values leave that many cores free
+    int nThreads = GetArg("-stakethreads", DEFAULT_STAKE_THREADS);
+    if (nThreads <= 0)
+        nThreads += boost::thread::hardware_concurrency();
+    return std::max(1, std::min(nThreads, MAX_STAKE_THREADS));
+}
 
-    // Time protocol V2: one-try
-    if (Params().IsTimeProtocolV2(nHeight, getTimeProtocolV2SporkValue())) {
-        // store a time stamp of when we last hashed on this block
-        mapHashedBlocks.clear();
-        mapHashedBlocks[pindexPrev->nHeight] = GetTime();
+namespace {
+// Everything the workers need to hash one stake input, gathered up front so
+// that they never touch the chain or the wallet. The hasher has already taken
+// the kernel prefix, a time slot only adds its own four bytes to a copy.
+struct CStakeKernel {
+    CStakeInput* stake;
+    CHash256 hasherPrefix;
+    uint256 bnTarget;
 
-        // check required min depth for stake
-        const int nHeightBlockFrom = pindexFrom->nHeight;
-        if (nHeight < nHeightBlockFrom + Params().COINSTAKE_MIN_DEPTH())
-            return error("%s : min depth violation, nHeight=%d, nHeightBlockFrom=%d", __func__, nHeight, nHeightBlockFrom);
+    CStakeKernel(CStakeInput* stakeIn) : stake(stakeIn) {}
+};
 
-        nTimeTx = GetCurrentTimeSlot();
-        // double check that we are not on the same slot as prev block
-        if (nTimeTx <= pindexPrev->nTime && Params().NetworkID() != CBaseChainParams::REGTEST)
-            return false;
+// Same as HashKernel, from a hasher that holds the serialized prefix
+static uint256 HashKernelSlot(const CHash256& hasherPrefix, const unsigned int nTimeTx)
+{
+    unsigned char vchTime[4];
+    WriteLE32(vchTime, nTimeTx);
+    uint256 hash;
+    CHash256(hasherPrefix).Write(vchTime, sizeof(vchTime)).Finalize((unsigned char*)&hash);
+    return hash;
+}
 
-        // check stake kernel
-        return CheckStakeKernelHash(pindexPrev, nBits, stakeInput, nTimeTx, hashProofOfStake);
-    }
+// A range of tx times of one kernel, searched from nTimeFirst down to nTimeLast
+struct CStakeWork {
+    size_t nKernel;
+    unsigned int nTimeFirst;
+    unsigned int nTimeLast;
+};
 
-    // Time protocol V1: iterate the hashing (can be removed after hard-fork)
-    const uint32_t nTimeBlockFrom = pindexFrom->nTime;
-    return StakeV1(pindexPrev, stakeInput, nTimeBlockFrom, nBits, nTimeTx, hashProofOfStake);
+// Time slots searched per work item with time protocol v1
+static const unsigned int STAKE_WORK_SLOTS = 64;
 }
 
-bool StakeV1(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, const uint32_t nTimeBlockFrom, unsigned int nBits, int64_t& nTimeTx, uint256& hashProofOfStake)
+bool StakeSearch(const CBlockIndex* pindexPrev, std::list<std::unique_ptr<CStakeInput> >& listInputs, unsigned int nBits, CStakeInput*& stakeRet, int64_t& nTimeTx, uint256& hashProofOfStake)
 {
-    bool fSuccess = false;
-    // iterate from maxTime down to pindexPrev->nTime (or min time due to maturity, 60 min after blockFrom)
-    const unsigned int prevBlockTime = pindexPrev->nTime;
-    const unsigned int maxTime = pindexPrev->MaxFutureBlockTime();
-    unsigned int minTime = std::max(prevBlockTime, nTimeBlockFrom + 3600);
-    if (Params().NetworkID() == CBaseChainParams::REGTEST)
-        minTime = prevBlockTime;
-    unsigned int nTryTime = maxTime;
-
-    // check required maturity for stake
-    if (maxTime <= minTime)
-        return error("%s : stake age violation, nTimeBlockFrom = %d, prevBlockTime = %d -- maxTime = %d ", __func__, nTimeBlockFrom, prevBlockTime, maxTime);
-
-    while (nTryTime > minTime) {
-        // store a time stamp of when we last hashed on this block
-        mapHashedBlocks.clear();
-        mapHashedBlocks[pindexPrev->nHeight] = GetTime();
-
-        //new block came in, move on
-        if (chainActive.Height() != pindexPrev->nHeight) break;
-
-        --nTryTime;
-        // if stake hash does not meet the target then continue to next iteration
-        if (!CheckStakeKernelHash(pindexPrev, nBits, stakeInput, nTryTime, hashProofOfStake))
+    const int nHeight = pindexPrev->nHeight + 1;
+    const bool fTimeV2 = Params().IsTimeProtocolV2(nHeight, getTimeProtocolV2SporkValue());
+
+    // store a time stamp of when we last hashed on this block
+    mapHashedBlocks.clear();
+    mapHashedBlocks[pindexPrev->nHeight] = GetTime();
+
+    // Time protocol V2: one-try on the current slot
+    const unsigned int nTimeSlot = GetCurrentTimeSlot();
+    if (fTimeV2 && nTimeSlot <= pindexPrev->nTime && Params().NetworkID() != CBaseChainParams::REGTEST)
+        return false;
+
+    std::vector<CStakeKernel> vKernels;
+    std::vector<CStakeWork> vWork;
+    for (std::unique_ptr<CStakeInput>& stakeInput : listInputs) {
+        CBlockIndex* pindexFrom = stakeInput->GetIndexFrom();
+        if (!pindexFrom || pindexFrom->nHeight < 1) {
+            error("%s : no pindexfrom", __func__);
             continue;
+        }
+
+        unsigned int nTimeFirst = nTimeSlot;
+        unsigned int nTimeLast = nTimeSlot;
+        if (fTimeV2) {
+            // check required min depth for stake
+            if (nHeight < pindexFrom->nHeight + Params().COINSTAKE_MIN_DEPTH()) {
+                error("%s : min depth violation, nHeight=%d, nHeightBlockFrom=%d", __func__, nHeight, pindexFrom->nHeight);
+                continue;
+            }
+        } else {
+            // iterate from maxTime down to pindexPrev->nTime (or min time due to maturity, 60 min after blockFrom)
+            const unsigned int maxTime = pindexPrev->MaxFutureBlockTime();
+            unsigned int minTime = std::max(pindexPrev->nTime, pindexFrom->nTime + 3600);
+            if (Params().NetworkID() == CBaseChainParams::REGTEST)
+                minTime = pindexPrev->nTime;
+
+            // check required maturity for stake
+            if (maxTime <= minTime) {
+                error("%s : stake age violation, nTimeBlockFrom = %d, prevBlockTime = %d -- maxTime = %d ", __func__, pindexFrom->nTime, pindexPrev->nTime, maxTime);
+                continue;
+            }
+            nTimeFirst = maxTime - 1;
+            nTimeLast = minTime;
+        }
 
-        // if we made it this far, then we have successfully found a valid kernel hash
-        fSuccess = true;
-        break;
+        CStakeKernel kernel(stakeInput.get());
+        CDataStream ssPrefix(SER_GETHASH, 0);
+        if (!GetKernelModifier(pindexPrev, kernel.stake, ssPrefix))
+            continue;
+        ssPrefix << pindexFrom->nTime << kernel.stake->GetUniqueness();
+        kernel.hasherPrefix.Write((const unsigned char*)&ssPrefix[0], ssPrefix.size());
+        kernel.bnTarget = GetStakeTarget(nBits, kernel.stake->GetValue());
+        vKernels.push_back(kernel);
+
+        // Split the time range so that one input's slots are shared between the threads
+        for (unsigned int nTime = nTimeFirst;; nTime -= STAKE_WORK_SLOTS) {
+            CStakeWork work;
+            work.nKernel = vKernels.size() - 1;
+            work.nTimeFirst = nTime;
+            work.nTimeLast = nTime - nTimeLast >= STAKE_WORK_SLOTS ? nTime - STAKE_WORK_SLOTS + 1 : nTimeLast;
+            vWork.push_back(work);
+            if (work.nTimeLast == nTimeLast)
+                break;
+        }
     }
 
-    nTimeTx = nTryTime;
+    std::atomic<size_t> nNextWork(0);
+    std::atomic<bool> fStop(false);
+    std::atomic<uint64_t> nHashes(0);
+    std::mutex csFound;
+    bool fFound = false;
+    size_t nKernelFound = 0;
+    unsigned int nTimeFound = 0;
+
+    // Workers only see the data gathered above, the calling thread watches the chain for them
+    const int nHeightPrev = pindexPrev->nHeight;
+    auto searchWork = [&](bool fWatchChain) {
+        uint64_t nHashesThread = 0;
+        while (!fStop) {
+            const size_t i = nNextWork++;
+            if (i >= vWork.size())
+                break;
+
+            //new block came in, move on
+            if (fWatchChain) {
+                TRY_LOCK(cs_main, lockMain);
+                if (lockMain && chainActive.Height() != nHeightPrev) {
+                    fStop = true;
+                    break;
+                }
+            }
+
+            const CStakeWork& work = vWork[i];
+            const CStakeKernel& kernel = vKernels[work.nKernel];
+            for (unsigned int nTime = work.nTimeFirst; !fStop; nTime--) {
+                nHashesThread++;
+                if (HashKernelSlot(kernel.hasherPrefix, nTime) < kernel.bnTarget) {
+                    std::lock_guard<std::mutex> lock(csFound);
+                    if (!fFound) {
+                        fFound = true;
+                        nKernelFound = work.nKernel;
+                        nTimeFound = nTime;
+                    }
+                    fStop = true;
+                }
+                if (nTime == work.nTimeLast)
+                    break;
+            }
+        }
+        nHashes += nHashesThread;
+    };
+
+    const int64_t nStart = GetTimeMicros();
+    const int nThreads = std::min((size_t)GetStakeSearchThreads(), vWork.size());
+    if (nThreads > 1) {
+        boost::thread_group threadGroup;
+        for (int i = 1; i < nThreads; i++)
+            threadGroup.create_thread(boost::bind<void>(searchWork, false));
+        searchWork(true);
+        threadGroup.join_all();
+    } else {
+        searchWork(true);
+    }
+    nStakeSearchHashes += nHashes;
+    nStakeSearchMicros += GetTimeMicros() - nStart;
 
     mapHashedBlocks.clear();
     mapHashedBlocks[pindexPrev->nHeight] = GetTime(); //store a time stamp of when we last hashed on this block
 
-    return fSuccess;
+    if (!fFound)
+        return false;
+
+    // Recompute the winner through the same path block validation uses
+    stakeRet = vKernels[nKernelFound].stake;
+    nTimeTx = nTimeFound;
+    return CheckStakeKernelHash(pindexPrev, nBits, stakeRet, nTimeFound, hashProofOfStake);
 }
 
 bool initStakeInput(const CBlock& block, std::unique_ptr<CStakeInput>& stake, int nPreviousBlockHeight) {
@@ -518,7 +659,7 @@ unsigned int GetStakeModifierChecksum(const CBlockIndex* pindex)
     CDataStream ss(SER_GETHASH, 0);
     if (pindex->pprev)
         ss << pindex->pprev->nStakeModifierChecksum;
-    ss << pindex->nFlags << pindex->hashProofOfStake << pindex->nStakeModifier;
+    ss << pindex->nFlags << pindex->GetStakeData().hashProofOfStake << pindex->nStakeModifier;
     uint256 hashChecksum = Hash(ss.begin(), ss.end());
     hashChecksum >>= (256 - 32);
     return hashChecksum.Get64();
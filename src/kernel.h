@@ -10,6 +10,8 @@
 #include "main.h"
 #include "stakeinput.h"
 
+#include <list>
+
 
 // MODIFIER_INTERVAL: time to elapse before new modifier is computed
 static const unsigned int MODIFIER_INTERVAL = 60;
@@ -22,8 +24,17 @@ static const int MODIFIER_INTERVAL_RATIO = 3;
 bool GetKernelStakeModifier(const uint256& hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake);
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kernel);
-bool Stake(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, unsigned int nBits, int64_t& nTimeTx, uint256& hashProofOfStake);
-bool StakeV1(const CBlockIndex* pindexPrev, CStakeInput* stakeInput, const uint32_t nTimeBlockFrom, unsigned int nBits, int64_t& nTimeTx, uint256& hashProofOfStake);
+
+// Default and maximum number of threads of the stake search
+static const int DEFAULT_STAKE_THREADS = 1;
+static const int MAX_STAKE_THREADS = 64;
+
+// Search all stake inputs and their allowed tx times for a kernel, on -stakethreads threads.
+// Returns the input that met the target in stakeRet.
+bool StakeSearch(const CBlockIndex* pindexPrev, std::list<std::unique_ptr<CStakeInput> >& listInputs, unsigned int nBits, CStakeInput*& stakeRet, int64_t& nTimeTx, uint256& hashProofOfStake);
+int GetStakeSearchThreads();
+// Kernel hashes per second of the stake search so far
+double GetStakeSearchHashRate();
 
 // Initialize the stake input object
 bool initStakeInput(const CBlock & block, std::unique_ptr<CStakeInput>& stake, int nPreviousBlockHeight);
@@ -13,6 +13,7 @@
 // Copyright (c) 2017 The PIVX developers
 #include "AccumulatorProofOfKnowledge.h"
 #include "hash.h"
+#include "MultiExp.h"
 
 namespace libzerocoin {
 
@@ -104,7 +105,7 @@ AccumulatorProofOfKnowledge::AccumulatorProofOfKnowledge(const AccumulatorAndPro
 
 /** Verifies that a commitment c is accumulated in accumulator a
  */
-bool AccumulatorProofOfKnowledge:: Verify(const Accumulator& a, const CBigNum& valueOfCommitmentToCoin) const {
+bool AccumulatorProofOfKnowledge:: Verify(const Accumulator& a, const CBigNum& valueOfCommitmentToCoin, const FixedBaseTable* pAccumulatorTable) const {
 	CBigNum sg = params->accumulatorPoKCommitmentGroup.g;
 	CBigNum sh = params->accumulatorPoKCommitmentGroup.h;
 
@@ -117,14 +118,25 @@ bool AccumulatorProofOfKnowledge:: Verify(const Accumulator& a, const CBigNum& v
 
 	CBigNum c = CBigNum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-	CBigNum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin * sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) * sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-	CBigNum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * (sg * valueOfCommitmentToCoin).pow_mod(s_sigma, params->accumulatorPoKCommitmentGroup.modulus) * sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) % params->accumulatorPoKCommitmentGroup.modulus;
-
-	CBigNum t_1_prime = (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) * g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_2_prime = (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) * g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-	CBigNum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) * C_u.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
-	CBigNum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) * ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) * ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) % params->accumulatorModulus;
+	// sg, sh, g_n and h_n are fixed, their powers come from precomputed tables.
+	// Negative exponents of h_n^-1 and g_n^-1 map onto the same tables.
+	std::shared_ptr<const AccumulatorPoKTables> tables = params->GetPoKTables();
+	const CBigNum& p = params->accumulatorPoKCommitmentGroup.modulus;
+	const CBigNum& N = params->accumulatorModulus;
+
+	CBigNum st_1_prime = valueOfCommitmentToCoin.pow_mod(c, p).mul_mod(MultiExp(tables->sg, s_alpha, tables->sh, s_phi), p);
+	CBigNum st_2_prime = MultiExp(tables->sg, c, tables->sh, s_psi).mul_mod((valueOfCommitmentToCoin * sg.inverse(p)).pow_mod(s_gamma, p), p);
+	CBigNum st_3_prime = MultiExp(tables->sg, c, tables->sh, s_xi).mul_mod((sg * valueOfCommitmentToCoin).pow_mod(s_sigma, p), p);
+
+	CBigNum accumulatorToC;
+	if (pAccumulatorTable && pAccumulatorTable->getBase() == a.getValue() && pAccumulatorTable->getModulus() == N)
+		accumulatorToC = pAccumulatorTable->pow_mod(c);
+	else
+		accumulatorToC = a.getValue().pow_mod(c, N);
+	CBigNum t_1_prime = C_r.pow_mod(c, N).mul_mod(MultiExp(tables->h_n, s_zeta, tables->g_n, s_epsilon), N);
+	CBigNum t_2_prime = C_e.pow_mod(c, N).mul_mod(MultiExp(tables->h_n, s_eta, tables->g_n, s_alpha), N);
+	CBigNum t_3_prime = accumulatorToC.mul_mod(C_u.pow_mod(s_alpha, N), N).mul_mod(tables->h_n.pow_mod(-s_beta), N);
+	CBigNum t_4_prime = C_r.pow_mod(s_alpha, N).mul_mod(MultiExp(tables->h_n, -s_delta, tables->g_n, -s_beta), N);
 
 	bool result = false;
 
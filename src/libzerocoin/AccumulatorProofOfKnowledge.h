@@ -20,6 +20,8 @@
 
 namespace libzerocoin {
 
+class FixedBaseTable;
+
 /**A prove that a value insde the commitment commitmentToCoin is in an accumulator a.
  *
  */
@@ -35,8 +37,9 @@ public:
 	 */
 	AccumulatorProofOfKnowledge(const AccumulatorAndProofParams* p, const Commitment& commitmentToCoin, const AccumulatorWitness& witness, Accumulator& a);
 	/** Verifies that  a commitment c is accumulated in accumulated a
+	 * @param pAccumulatorTable optional fixed-base table for the value of a, shared between proofs
 	 */
-	bool Verify(const Accumulator& a,const CBigNum& valueOfCommitmentToCoin) const;
+	bool Verify(const Accumulator& a,const CBigNum& valueOfCommitmentToCoin, const FixedBaseTable* pAccumulatorTable = NULL) const;
 	
 	ADD_SERIALIZE_METHODS;
   template <typename Stream, typename Operation>  inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
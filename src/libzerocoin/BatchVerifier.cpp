@@ -0,0 +1,53 @@
+/**
+* @file       BatchVerifier.cpp
+*
+* @brief      BatchVerifier class for the Zerocoin library.
+*
+* @license    This project is released under the MIT license.
+**/
+// Copyright (c) 2018 The VITAE developers
+
+#include <map>
+#include <memory>
+#include "BatchVerifier.h"
+#include "MultiExp.h"
+
+namespace libzerocoin {
+
+// Bit length of the accumulator proof challenge, a SHA256 hash
+static const unsigned int CHALLENGE_BITS = 256;
+
+BatchVerifier::BatchVerifier(const ZerocoinParams* p): params(p) { }
+
+void BatchVerifier::Add(const CoinSpend& spend, const Accumulator& a) {
+	vSpends.push_back(std::make_pair(spend, a));
+}
+
+bool BatchVerifier::Verify() {
+	vResults.assign(vSpends.size(), false);
+
+	std::map<CBigNum, std::vector<size_t> > mapGroups;
+	for (size_t i = 0; i < vSpends.size(); i++)
+		mapGroups[vSpends[i].second.getValue()].push_back(i);
+
+	bool fAllValid = true;
+	for (std::map<CBigNum, std::vector<size_t> >::const_iterator it = mapGroups.begin(); it != mapGroups.end(); ++it) {
+		std::unique_ptr<FixedBaseTable> pTable;
+		if (it->second.size() >= ACC_TABLE_MIN_SPENDS)
+			pTable.reset(new FixedBaseTable(it->first, params->accumulatorParams.accumulatorModulus, 0, CHALLENGE_BITS));
+
+		for (size_t i : it->second) {
+			vResults[i] = vSpends[i].first.Verify(vSpends[i].second, pTable.get());
+			fAllValid &= vResults[i];
+		}
+	}
+
+	return fAllValid;
+}
+
+void BatchVerifier::clear() {
+	vSpends.clear();
+	vResults.clear();
+}
+
+} /* namespace libzerocoin */
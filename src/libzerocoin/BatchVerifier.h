@@ -0,0 +1,60 @@
+/**
+* @file       BatchVerifier.h
+*
+* @brief      BatchVerifier class for the Zerocoin library.
+*
+* @license    This project is released under the MIT license.
+**/
+// Copyright (c) 2018 The VITAE developers
+
+#ifndef BATCHVERIFIER_H_
+#define BATCHVERIFIER_H_
+
+#include <utility>
+#include <vector>
+#include "Accumulator.h"
+#include "CoinSpend.h"
+
+namespace libzerocoin {
+
+/**
+ * Verifies the coin spends of a block or a mempool batch together.
+ *
+ * Spends are grouped by the accumulator they prove membership in. Every
+ * proof already evaluates the powers of the parameter generators from
+ * shared fixed-base tables; groups of ACC_TABLE_MIN_SPENDS or more spends
+ * additionally share a table for the accumulator value itself. Results
+ * are bit-identical to calling CoinSpend::Verify on each spend.
+ */
+class BatchVerifier {
+public:
+	/** @param p parameters the accumulators of the batch were built with */
+	BatchVerifier(const ZerocoinParams* p);
+
+	/** Queues spend for verification against accumulator a */
+	void Add(const CoinSpend& spend, const Accumulator& a);
+
+	/**
+	 * Verifies every queued spend.
+	 * @return true if all of them are valid, see GetResults() otherwise
+	 */
+	bool Verify();
+
+	/** Per-spend results of the last Verify(), in the order of Add() */
+	const std::vector<bool>& GetResults() const { return vResults; }
+
+	size_t size() const { return vSpends.size(); }
+	void clear();
+
+private:
+	// Building an accumulator table costs about as much as four exponentiations
+	static const size_t ACC_TABLE_MIN_SPENDS = 4;
+
+	const ZerocoinParams* params;
+	std::vector<std::pair<CoinSpend, Accumulator> > vSpends;
+	std::vector<bool> vResults;
+};
+
+} /* namespace libzerocoin */
+
+#endif /* BATCHVERIFIER_H_ */
@@ -71,7 +71,7 @@ namespace libzerocoin
     }
 }
 
-bool CoinSpend::Verify(const Accumulator& a) const
+bool CoinSpend::Verify(const Accumulator& a, const FixedBaseTable* pAccumulatorTable) const
 {
     // Double check that the version is the same as marked in the serial
     if (ExtractVersionFromSerial(coinSerialNumber) != version) {
@@ -90,7 +90,7 @@ bool CoinSpend::Verify(const Accumulator& a) const
         return false;
     }
 
-    if (!accumulatorPoK.Verify(a, accCommitmentToCoinValue)) {
+    if (!accumulatorPoK.Verify(a, accCommitmentToCoinValue, pAccumulatorTable)) {
         //std::cout << "CoinsSpend::Verify: accumulatorPoK failed\n";
         return false;
     }
@@ -0,0 +1,122 @@
+/**
+* @file       MultiExp.cpp
+*
+* @brief      Fixed-base exponentiation tables for the Zerocoin library.
+*
+* @license    This project is released under the MIT license.
+**/
+// Copyright (c) 2018 The VITAE developers
+
+#include "MultiExp.h"
+#include "Params.h"
+
+#include <algorithm>
+
+namespace libzerocoin {
+
+FixedBaseTable::FixedBaseTable(const CBigNum& base, const CBigNum& modulus, const CBigNum& order,
+                               unsigned int nMaxBits, bool fSigned):
+	base(base), modulus(modulus), order(order) {
+
+	// Only rely on the order when it is actually the order of base, so the
+	// result never depends on the parameters being well formed
+	fReduce = order > 0 && base.pow_mod(order, modulus).isOne();
+
+	if (nMaxBits == 0)
+		nMaxBits = (fReduce ? order : modulus).bitSize();
+	nWindows = (nMaxBits + WINDOW_BITS - 1) / WINDOW_BITS;
+
+	BuildTable(vTable, base % modulus, modulus, nWindows);
+	if (fSigned && !fReduce)
+		BuildTable(vInvTable, base.inverse(modulus), modulus, nWindows);
+}
+
+void FixedBaseTable::BuildTable(std::vector<CBigNum>& vTableOut, const CBigNum& p, const CBigNum& modulus, unsigned int nWindows) {
+	vTableOut.resize(nWindows * WINDOW_ENTRIES);
+
+	// pow = p^(16^i)
+	CBigNum pow = p;
+	for (unsigned int i = 0; i < nWindows; i++) {
+		vTableOut[i * WINDOW_ENTRIES] = pow;
+		for (unsigned int d = 1; d < WINDOW_ENTRIES; d++)
+			vTableOut[i * WINDOW_ENTRIES + d] = vTableOut[i * WINDOW_ENTRIES + d - 1].mul_mod(pow, modulus);
+		pow = vTableOut[i * WINDOW_ENTRIES + WINDOW_ENTRIES - 1].mul_mod(pow, modulus);
+	}
+}
+
+void FixedBaseTable::MulTable(const std::vector<CBigNum>& vTableIn, CBigNum& acc, bool& fOne, const CBigNum& e, const CBigNum& modulus) {
+	// getvch() is little endian, two digits per byte
+	std::vector<unsigned char> vch = e.getvch();
+	for (unsigned int i = 0; i < vch.size() * 2; i++) {
+		unsigned int d = (vch[i / 2] >> ((i % 2) * WINDOW_BITS)) & WINDOW_ENTRIES;
+		if (d == 0)
+			continue;
+		const CBigNum& entry = vTableIn[i * WINDOW_ENTRIES + d - 1];
+		if (fOne) {
+			acc = entry;
+			fOne = false;
+		} else {
+			acc = acc.mul_mod(entry, modulus);
+		}
+	}
+}
+
+void FixedBaseTable::MulPow(CBigNum& acc, bool& fOne, const CBigNum& e) const {
+	CBigNum bnExp = e;
+	if (fReduce && (e < 0 || e >= order))
+		bnExp = e % order;
+
+	const bool fNegative = bnExp < 0;
+	if (fNegative)
+		bnExp = -bnExp;
+
+	if ((fNegative && vInvTable.empty()) || (unsigned int)bnExp.bitSize() > nWindows * WINDOW_BITS) {
+		// Outside the table, e.g. an oversized exponent
+		CBigNum r = base.pow_mod(e, modulus);
+		acc = fOne ? r : acc.mul_mod(r, modulus);
+		fOne = false;
+		return;
+	}
+
+	// base^-x = (base^-1)^x, as in CBigNum::pow_mod
+	MulTable(fNegative ? vInvTable : vTable, acc, fOne, bnExp, modulus);
+}
+
+CBigNum FixedBaseTable::pow_mod(const CBigNum& e) const {
+	CBigNum acc = 1;
+	bool fOne = true;
+	MulPow(acc, fOne, e);
+	return fOne ? CBigNum(1) % modulus : acc;
+}
+
+CBigNum MultiExp(const FixedBaseTable& t1, const CBigNum& e1, const FixedBaseTable& t2, const CBigNum& e2) {
+	if (t1.modulus != t2.modulus)
+		throw std::runtime_error("MultiExp: tables use different moduli");
+
+	CBigNum acc = 1;
+	bool fOne = true;
+	t1.MulPow(acc, fOne, e1);
+	t2.MulPow(acc, fOne, e2);
+	return fOne ? CBigNum(1) % t1.modulus : acc;
+}
+
+SerialNumberSoKTables::SerialNumberSoKTables(const ZerocoinParams* p):
+	a(p->coinCommitmentGroup.g, p->serialNumberSoKCommitmentGroup.groupOrder, p->coinCommitmentGroup.groupOrder),
+	b(p->coinCommitmentGroup.h, p->serialNumberSoKCommitmentGroup.groupOrder, p->coinCommitmentGroup.groupOrder),
+	g(p->serialNumberSoKCommitmentGroup.g, p->serialNumberSoKCommitmentGroup.modulus, p->serialNumberSoKCommitmentGroup.groupOrder),
+	h(p->serialNumberSoKCommitmentGroup.h, p->serialNumberSoKCommitmentGroup.modulus, p->serialNumberSoKCommitmentGroup.groupOrder) { }
+
+// Bound on the size of s_beta and s_delta, the largest responses of the proof
+static unsigned int MaxResponseBits(const AccumulatorAndProofParams* p) {
+	unsigned int nRandomBits = p->accumulatorPoKCommitmentGroup.modulus.bitSize() + p->k_prime + p->k_dprime;
+	unsigned int nChallengeBits = p->maxCoinValue.bitSize() + 256;
+	return p->accumulatorModulus.bitSize() + std::max(nRandomBits, nChallengeBits) + 1;
+}
+
+AccumulatorPoKTables::AccumulatorPoKTables(const AccumulatorAndProofParams* p):
+	sg(p->accumulatorPoKCommitmentGroup.g, p->accumulatorPoKCommitmentGroup.modulus, p->accumulatorPoKCommitmentGroup.groupOrder),
+	sh(p->accumulatorPoKCommitmentGroup.h, p->accumulatorPoKCommitmentGroup.modulus, p->accumulatorPoKCommitmentGroup.groupOrder),
+	g_n(p->accumulatorQRNCommitmentGroup.g, p->accumulatorModulus, 0, MaxResponseBits(p), true),
+	h_n(p->accumulatorQRNCommitmentGroup.h, p->accumulatorModulus, 0, MaxResponseBits(p), true) { }
+
+} /* namespace libzerocoin */
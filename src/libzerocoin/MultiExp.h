@@ -0,0 +1,103 @@
+/**
+* @file       MultiExp.h
+*
+* @brief      Fixed-base exponentiation tables for the Zerocoin library.
+*
+* @license    This project is released under the MIT license.
+**/
+// Copyright (c) 2018 The VITAE developers
+
+#ifndef MULTIEXP_H_
+#define MULTIEXP_H_
+
+#include <vector>
+#include "bignum.h"
+
+namespace libzerocoin {
+
+class ZerocoinParams;
+class AccumulatorAndProofParams;
+
+/**
+ * Precomputed powers of a fixed base, base^(d * 16^i) for every 4-bit
+ * digit d and window i, so that base^e costs one modular multiplication
+ * per non-zero digit of e and no squarings.
+ */
+class FixedBaseTable {
+public:
+	/**
+	 * @param base the fixed base
+	 * @param modulus the modulus all results are reduced by
+	 * @param order order of base modulo modulus, used to reduce exponents
+	 * @param nMaxBits largest exponent covered by the table, 0 for the size of order or modulus
+	 * @param fSigned also tabulate base^-1 for negative exponents when the order is unknown
+	 */
+	FixedBaseTable(const CBigNum& base, const CBigNum& modulus, const CBigNum& order,
+	               unsigned int nMaxBits = 0, bool fSigned = false);
+
+	/** base^e mod modulus, identical to base.pow_mod(e, modulus) */
+	CBigNum pow_mod(const CBigNum& e) const;
+
+	const CBigNum& getBase() const { return base; }
+	const CBigNum& getModulus() const { return modulus; }
+
+private:
+	static const unsigned int WINDOW_BITS = 4;
+	static const unsigned int WINDOW_ENTRIES = (1 << WINDOW_BITS) - 1;
+
+	CBigNum base;
+	CBigNum modulus;
+	CBigNum order;
+	// base^order == 1, so any exponent can be reduced modulo order
+	bool fReduce;
+	unsigned int nWindows;
+	// vTable[i * WINDOW_ENTRIES + d - 1] = base^(d * 2^(WINDOW_BITS * i))
+	std::vector<CBigNum> vTable;
+	// Same layout for base^-1, empty unless the table is signed
+	std::vector<CBigNum> vInvTable;
+
+	static void BuildTable(std::vector<CBigNum>& vTableOut, const CBigNum& p, const CBigNum& modulus, unsigned int nWindows);
+	static void MulTable(const std::vector<CBigNum>& vTableIn, CBigNum& acc, bool& fOne, const CBigNum& e, const CBigNum& modulus);
+
+	/** acc = acc * base^e mod modulus, where fOne tracks an accumulator still equal to 1 */
+	void MulPow(CBigNum& acc, bool& fOne, const CBigNum& e) const;
+
+	friend CBigNum MultiExp(const FixedBaseTable& t1, const CBigNum& e1, const FixedBaseTable& t2, const CBigNum& e2);
+};
+
+/**
+ * Simultaneous exponentiation t1.base^e1 * t2.base^e2 mod m for two
+ * tables over the same modulus, sharing one accumulator.
+ */
+CBigNum MultiExp(const FixedBaseTable& t1, const CBigNum& e1, const FixedBaseTable& t2, const CBigNum& e2);
+
+/** Fixed-base tables for the generators used by the serial number signature of knowledge */
+class SerialNumberSoKTables {
+public:
+	SerialNumberSoKTables(const ZerocoinParams* p);
+
+	// coinCommitmentGroup g and h, modulo the SoK group order
+	FixedBaseTable a;
+	FixedBaseTable b;
+	// serialNumberSoKCommitmentGroup g and h, modulo the SoK group modulus
+	FixedBaseTable g;
+	FixedBaseTable h;
+};
+
+/** Fixed-base tables for the generators used by the accumulator proof of knowledge */
+class AccumulatorPoKTables {
+public:
+	AccumulatorPoKTables(const AccumulatorAndProofParams* p);
+
+	// accumulatorPoKCommitmentGroup g and h
+	FixedBaseTable sg;
+	FixedBaseTable sh;
+	// accumulatorQRNCommitmentGroup g and h modulo the accumulator modulus,
+	// signed and sized for the largest honest proof responses
+	FixedBaseTable g_n;
+	FixedBaseTable h_n;
+};
+
+} /* namespace libzerocoin */
+
+#endif /* MULTIEXP_H_ */
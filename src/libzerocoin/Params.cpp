@@ -11,11 +11,16 @@
 **/
 // Copyright (c) 2017 The VITAE developers
 // Copyright (c) 2017 The PIVX developers
+#include <mutex>
 #include "Params.h"
 #include "ParamGeneration.h"
+#include "MultiExp.h"
 
 namespace libzerocoin {
 
+static std::mutex csSoKTables;
+static std::mutex csPoKTables;
+
 ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
 	this->zkp_hash_len = securityLevel;
 	this->zkp_iterations = securityLevel;
@@ -30,10 +35,24 @@ ZerocoinParams::ZerocoinParams(CBigNum N, uint32_t securityLevel) {
 	this->initialized = true;
 }
 
+std::shared_ptr<const SerialNumberSoKTables> ZerocoinParams::GetSoKTables() const {
+	std::lock_guard<std::mutex> lock(csSoKTables);
+	if (!pSoKTables)
+		pSoKTables = std::make_shared<const SerialNumberSoKTables>(this);
+	return pSoKTables;
+}
+
 AccumulatorAndProofParams::AccumulatorAndProofParams() {
 	this->initialized = false;
 }
 
+std::shared_ptr<const AccumulatorPoKTables> AccumulatorAndProofParams::GetPoKTables() const {
+	std::lock_guard<std::mutex> lock(csPoKTables);
+	if (!pPoKTables)
+		pPoKTables = std::make_shared<const AccumulatorPoKTables>(this);
+	return pPoKTables;
+}
+
 IntegerGroupParams::IntegerGroupParams() {
 	this->initialized = false;
 }
@@ -14,11 +14,15 @@
 #ifndef PARAMS_H_
 #define PARAMS_H_
 
+#include <memory>
 #include "bignum.h"
 #include "ZerocoinDefines.h"
 
 namespace libzerocoin {
 
+class SerialNumberSoKTables;
+class AccumulatorPoKTables;
+
 class IntegerGroupParams {
 public:
 	/** @brief Integer group class, default constructor
@@ -151,6 +155,16 @@ public:
 	    READWRITE(k_prime);
 	    READWRITE(k_dprime);
   }
+
+	/**
+	 * Fixed-base tables for the generators of the accumulator proof.
+	 * Built on first use and shared by all threads; the parameters
+	 * must not change afterwards.
+	 */
+	std::shared_ptr<const AccumulatorPoKTables> GetPoKTables() const;
+
+private:
+	mutable std::shared_ptr<const AccumulatorPoKTables> pPoKTables;
 };
 
 class ZerocoinParams {
@@ -213,6 +227,16 @@ public:
 	    READWRITE(zkp_iterations);
 	    READWRITE(zkp_hash_len);
 	}
+
+	/**
+	 * Fixed-base exponentiation tables for the serial number proof.
+	 * Built on first use and shared by all threads; the parameters
+	 * must not change afterwards.
+	 */
+	std::shared_ptr<const SerialNumberSoKTables> GetSoKTables() const;
+
+private:
+	mutable std::shared_ptr<const SerialNumberSoKTables> pSoKTables;
 };
 
 } /* namespace libzerocoin */
@@ -13,6 +13,7 @@
 // Copyright (c) 2017 The PIVX developers
 #include <streams.h>
 #include "SerialNumberSignatureOfKnowledge.h"
+#include "MultiExp.h"
 
 namespace libzerocoin {
 
@@ -48,10 +49,7 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
 		throw std::runtime_error("Groups are not structured correctly.");
 	}
 
-	CBigNum a = params->coinCommitmentGroup.g;
-	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+	std::shared_ptr<const SerialNumberSoKTables> tables = params->GetSoKTables();
 
 	CHashWriter hasher(0,0);
 	hasher << *params << commitmentToCoin.getCommitmentValue() << coin.getSerialNumber() << msghash;
@@ -78,9 +76,10 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
         }
 	}
 
+	const CBigNum aSerial = tables->a.pow_mod(coin.getSerialNumber());
 	for(uint32_t i=0; i < params->zkp_iterations; i++) {
 		// compute g^{ {a^x b^r} h^v} mod p2
-		c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v_expanded[i]);
+		c[i] = challengeCalculation(*tables, aSerial, r[i], v_expanded[i]);
 	}
 
 	// We can't hash data in parallel either
@@ -103,48 +102,43 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const
 		} else {
 			s_notprime[i]       = r[i] - coin.getRandomness();
 			sprime[i]           = v_expanded[i] - (commitmentToCoin.getRandomness() *
-			                              b.pow_mod(r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
+			                              tables->b.pow_mod(r[i] - coin.getRandomness()));
 		}
 	}
 }
 
-inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const CBigNum& a_exp,const CBigNum& b_exp,
-        const CBigNum& h_exp) const {
+inline CBigNum SerialNumberSignatureOfKnowledge::challengeCalculation(const SerialNumberSoKTables& tables,
+        const CBigNum& a_pow, const CBigNum& b_exp, const CBigNum& h_exp) const {
 
-	CBigNum a = params->coinCommitmentGroup.g;
-	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+	// (g^{(a^a_exp * b^b_exp) mod q} * h^h_exp) mod p, where a_pow = a^a_exp mod q is
+	// the same for every iteration and the rest come from fixed-base tables
+	CBigNum exponent = a_pow.mul_mod(tables.b.pow_mod(b_exp), tables.b.getModulus());
 
-	CBigNum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
-	                   * b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
-
-	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
+	return MultiExp(tables.g, exponent, tables.h, h_exp);
 }
 
 bool SerialNumberSignatureOfKnowledge::Verify(const CBigNum& coinSerialNumber, const CBigNum& valueOfCommitmentToCoin,
         const uint256 msghash) const {
-	CBigNum a = params->coinCommitmentGroup.g;
-	CBigNum b = params->coinCommitmentGroup.h;
-	CBigNum g = params->serialNumberSoKCommitmentGroup.g;
-	CBigNum h = params->serialNumberSoKCommitmentGroup.h;
+	std::shared_ptr<const SerialNumberSoKTables> tables = params->GetSoKTables();
 	CHashWriter hasher(0,0);
 	hasher << *params << valueOfCommitmentToCoin << coinSerialNumber << msghash;
 
 	vector<CBigNum> tprime(params->zkp_iterations);
 	unsigned char *hashbytes = (unsigned char*) &this->hash;
 
+	// a^serial is the same in every iteration
+	const CBigNum aSerial = tables->a.pow_mod(coinSerialNumber);
+
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
 		int bit = i % 8;
 		int byte = i / 8;
 		bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
 		if(challenge_bit) {
-			tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], SeedTo1024(sprime[i].getuint256()));
+			tprime[i] = challengeCalculation(*tables, aSerial, s_notprime[i], SeedTo1024(sprime[i].getuint256()));
 		} else {
-			CBigNum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
-			tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-			             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
-			            params->serialNumberSoKCommitmentGroup.modulus;
+			CBigNum exp = tables->b.pow_mod(s_notprime[i]);
+			tprime[i] = valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus).mul_mod(
+			            tables->h.pow_mod(sprime[i]), params->serialNumberSoKCommitmentGroup.modulus);
 		}
 	}
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
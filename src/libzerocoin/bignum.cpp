@@ -0,0 +1,61 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2012 The Bitcoin developers
+// Copyright (c) 2017 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bignum.h"
+
+// Backend independent parts of CBigNum. The arithmetic lives in
+// bignum_gmp.cpp and bignum_openssl.cpp.
+
+void CBigNum::SetHex(const std::string& str)
+{
+    SetHexBool(str);
+}
+
+bool CBigNum::SetHexBool(const std::string& str)
+{
+    // skip 0x
+    const char* psz = str.c_str();
+    while (isspace(*psz))
+        psz++;
+    bool fNegative = false;
+    if (*psz == '-')
+    {
+        fNegative = true;
+        psz++;
+    }
+    if (psz[0] == '0' && tolower(psz[1]) == 'x')
+        psz += 2;
+    while (isspace(*psz))
+        psz++;
+
+    // hex string to bignum
+    static const signed char phexdigit[256] = { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,1,2,3,4,5,6,7,8,9,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0xa,0xb,0xc,0xd,0xe,0xf,0,0,0,0,0,0,0,0,0 };
+    *this = 0;
+    while (isxdigit(*psz))
+    {
+        *this <<= 4;
+        int n = phexdigit[(unsigned char)*psz++];
+        *this += n;
+    }
+    if (fNegative)
+        *this = 0 - *this;
+
+    return true;
+}
+
+int CBigNum::getint() const
+{
+    unsigned long n = getulong();
+    if (*this >= 0)
+        return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::max() : n);
+    else
+        return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::min() : -(int)n);
+}
+
+unsigned int CBigNum::getuint() const
+{
+    return getulong();
+}
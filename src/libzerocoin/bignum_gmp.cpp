@@ -0,0 +1,576 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2012 The Bitcoin developers
+// Copyright (c) 2017 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bignum.h"
+
+#if defined(USE_NUM_GMP)
+
+#include "random.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <openssl/crypto.h> // for OPENSSL_cleanse()
+
+#include <boost/thread/tss.hpp>
+
+/** Miller-Rabin rounds used by isPrime() when no count is given: error rate below 2^-80 */
+static const int GMP_PRIME_CHECKS = 40;
+
+namespace
+{
+/** Limb blocks are cached in power of two size classes from 64 bytes up to 64 KiB */
+const size_t LIMB_CACHE_MIN_SHIFT = 6;
+const size_t LIMB_CACHE_CLASSES = 11;
+/** Free blocks kept per size class and thread */
+const size_t LIMB_CACHE_DEPTH = 32;
+
+/**
+ * Per-thread cache of freed limb blocks. Every CBigNum result owns its
+ * limbs, so without it each operation costs a malloc and each temporary
+ * a free; with it they recycle the blocks of the temporaries before them.
+ */
+class CLimbCache
+{
+    std::vector<void*> vFree[LIMB_CACHE_CLASSES];
+
+public:
+    ~CLimbCache()
+    {
+        for (size_t i = 0; i < LIMB_CACHE_CLASSES; i++)
+            for (size_t j = 0; j < vFree[i].size(); j++)
+                free(vFree[i][j]);
+    }
+
+    void* Alloc(size_t nClass)
+    {
+        if (vFree[nClass].empty())
+            return NULL;
+        void* p = vFree[nClass].back();
+        vFree[nClass].pop_back();
+        return p;
+    }
+
+    bool Free(size_t nClass, void* p)
+    {
+        if (vFree[nClass].size() >= LIMB_CACHE_DEPTH)
+            return false;
+        if (vFree[nClass].capacity() == 0)
+            vFree[nClass].reserve(LIMB_CACHE_DEPTH);
+        vFree[nClass].push_back(p);
+        return true;
+    }
+};
+
+CLimbCache& GetLimbCache()
+{
+    // Never destroyed: CBigNum statics may free limbs after static destructors ran
+    static boost::thread_specific_ptr<CLimbCache>* limbCache = new boost::thread_specific_ptr<CLimbCache>();
+    if (!limbCache->get())
+        limbCache->reset(new CLimbCache());
+    return *limbCache->get();
+}
+
+/** The size class of a block of n bytes, LIMB_CACHE_CLASSES if it is too large to cache */
+size_t GetLimbClass(size_t n)
+{
+    size_t nClass = 0;
+    while (nClass < LIMB_CACHE_CLASSES && ((size_t)1 << (nClass + LIMB_CACHE_MIN_SHIFT)) < n)
+        nClass++;
+    return nClass;
+}
+
+void* AllocLimbs(size_t n)
+{
+    size_t nClass = GetLimbClass(n);
+    void* p = NULL;
+    if (nClass < LIMB_CACHE_CLASSES) {
+        p = GetLimbCache().Alloc(nClass);
+        n = (size_t)1 << (nClass + LIMB_CACHE_MIN_SHIFT);
+    }
+    if (p == NULL)
+        p = malloc(n);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void FreeLimbs(void* p, size_t n)
+{
+    size_t nClass = GetLimbClass(n);
+    if (nClass < LIMB_CACHE_CLASSES && GetLimbCache().Free(nClass, p))
+        return;
+    free(p);
+}
+
+void* ReallocLimbs(void* p, size_t nOld, size_t nNew)
+{
+    size_t nClass = GetLimbClass(nNew);
+    if (nClass == GetLimbClass(nOld)) {
+        if (nClass < LIMB_CACHE_CLASSES)
+            return p;
+        void* pNew = realloc(p, nNew);
+        if (pNew == NULL)
+            throw std::bad_alloc();
+        return pNew;
+    }
+    void* pNew = AllocLimbs(nNew);
+    memcpy(pNew, p, std::min(nOld, nNew));
+    FreeLimbs(p, nOld);
+    return pNew;
+}
+
+/**
+ * Route GMP allocations through the limb cache. This has to happen before
+ * GMP allocates anything, as cached blocks are sized by class: every
+ * CBigNum constructor calls it before touching its mpz_t, and nothing
+ * else in the process uses GMP.
+ */
+void InitLimbCache()
+{
+    static bool fInit = (mp_set_memory_functions(AllocLimbs, ReallocLimbs, FreeLimbs), true);
+    (void)fInit;
+}
+}
+
+/** Set bn to nBits uniformly random bits */
+static void SetRandomBits(mpz_t bn, unsigned int nBits)
+{
+    if (nBits == 0) {
+        mpz_set_ui(bn, 0);
+        return;
+    }
+    std::vector<unsigned char> vch((nBits + 7) / 8);
+    GetRandBytes(&vch[0], vch.size());
+    mpz_import(bn, vch.size(), 1, 1, 1, 0, &vch[0]);
+    mpz_tdiv_r_2exp(bn, bn, nBits);
+    OPENSSL_cleanse(&vch[0], vch.size());
+}
+
+void CBigNum::init()
+{
+    // Since GMP 6.2 this does not allocate; limbs are allocated on first write
+    InitLimbCache();
+    mpz_init(bn);
+}
+
+CBigNum::CBigNum()
+{
+    init();
+}
+
+CBigNum::CBigNum(const CBigNum& b)
+{
+    InitLimbCache();
+    mpz_init_set(bn, b.bn);
+}
+
+CBigNum& CBigNum::operator=(const CBigNum& b)
+{
+    mpz_set(bn, b.bn);
+    return (*this);
+}
+
+CBigNum::~CBigNum()
+{
+    // Match BN_clear_free(): proof randomness must not linger on the heap
+    if (bn->_mp_alloc > 0)
+        OPENSSL_cleanse(bn->_mp_d, bn->_mp_alloc * sizeof(mp_limb_t));
+    mpz_clear(bn);
+}
+
+CBigNum CBigNum::randBignum(const CBigNum& range)
+{
+    if (mpz_sgn(range.bn) <= 0)
+        throw bignum_error("CBigNum:rand element : range must be positive");
+
+    // Rejection sampling: each try succeeds with probability > 1/2
+    CBigNum ret;
+    unsigned int nBits = range.bitSize();
+    do {
+        SetRandomBits(ret.bn, nBits);
+    } while (mpz_cmp(ret.bn, range.bn) >= 0);
+    return ret;
+}
+
+CBigNum CBigNum::RandKBitBigum(const uint32_t k)
+{
+    CBigNum ret;
+    SetRandomBits(ret.bn, k);
+    return ret;
+}
+
+int CBigNum::bitSize() const
+{
+    if (mpz_sgn(bn) == 0)
+        return 0;
+    return mpz_sizeinbase(bn, 2);
+}
+
+void CBigNum::setulong(unsigned long n)
+{
+    mpz_set_ui(bn, n);
+}
+
+unsigned long CBigNum::getulong() const
+{
+    // Like BN_get_word(): the magnitude, or all ones if it does not fit
+    if (bitSize() > std::numeric_limits<unsigned long>::digits)
+        return std::numeric_limits<unsigned long>::max();
+    return mpz_get_ui(bn);
+}
+
+void CBigNum::setint64(int64_t sn)
+{
+    bool fNegative;
+    uint64_t n;
+
+    if (sn < (int64_t)0)
+    {
+        // Since the minimum signed integer cannot be represented as positive so long as its type is signed,
+        // and it's not well-defined what happens if you make it unsigned before negating it,
+        // we instead increment the negative integer by 1, convert it, then increment the (now positive) unsigned integer by 1 to compensate
+        n = -(sn + 1);
+        ++n;
+        fNegative = true;
+    } else {
+        n = sn;
+        fNegative = false;
+    }
+
+    setuint64(n);
+    if (fNegative)
+        mpz_neg(bn, bn);
+}
+
+void CBigNum::setuint64(uint64_t n)
+{
+    mpz_import(bn, 1, -1, sizeof(n), 0, 0, &n);
+}
+
+void CBigNum::setuint256(uint256 n)
+{
+    mpz_import(bn, sizeof(n), -1, 1, 0, 0, (unsigned char*)&n);
+}
+
+uint256 CBigNum::getuint256() const
+{
+    uint256 n = 0;
+    if (mpz_sgn(bn) == 0)
+        return n;
+
+    // Low 256 bits of the magnitude, as the MPI based implementation did
+    std::vector<unsigned char> vch((bitSize() + 7) / 8);
+    size_t nCount = 0;
+    mpz_export(&vch[0], &nCount, -1, 1, 0, 0, bn);
+    memcpy((unsigned char*)&n, &vch[0], std::min(nCount, sizeof(n)));
+    return n;
+}
+
+void CBigNum::setvch(const std::vector<unsigned char>& vch)
+{
+    // vch is the little endian MPI payload: magnitude with the sign
+    // in the top bit of the most significant byte
+    if (vch.empty()) {
+        mpz_set_ui(bn, 0);
+        return;
+    }
+    std::vector<unsigned char> vch2(vch.rbegin(), vch.rend());
+    bool fNegative = (vch2[0] & 0x80) != 0;
+    vch2[0] &= 0x7f;
+    mpz_import(bn, vch2.size(), 1, 1, 1, 0, &vch2[0]);
+    if (fNegative)
+        mpz_neg(bn, bn);
+}
+
+std::vector<unsigned char> CBigNum::getvch() const
+{
+    if (mpz_sgn(bn) == 0)
+        return std::vector<unsigned char>();
+
+    // Leave room for a padding byte when the top bit of the magnitude is set
+    size_t nBytes = (bitSize() + 7) / 8;
+    std::vector<unsigned char> vch(nBytes + 1, 0);
+    size_t nCount = 0;
+    mpz_export(&vch[1], &nCount, 1, 1, 1, 0, bn);
+    if (!(vch[1] & 0x80))
+        vch.erase(vch.begin());
+    if (mpz_sgn(bn) < 0)
+        vch[0] |= 0x80;
+    reverse(vch.begin(), vch.end());
+    return vch;
+}
+
+CBigNum& CBigNum::SetCompact(unsigned int nCompact)
+{
+    unsigned int nSize = nCompact >> 24;
+    bool fNegative     =(nCompact & 0x00800000) != 0;
+    unsigned int nWord = nCompact & 0x007fffff;
+    if (nSize <= 3)
+    {
+        nWord >>= 8*(3-nSize);
+        mpz_set_ui(bn, nWord);
+    }
+    else
+    {
+        mpz_set_ui(bn, nWord);
+        mpz_mul_2exp(bn, bn, 8*(nSize-3));
+    }
+    if (fNegative)
+        mpz_neg(bn, bn);
+    return *this;
+}
+
+unsigned int CBigNum::GetCompact() const
+{
+    unsigned int nSize = (bitSize() + 7) / 8;
+    unsigned int nCompact = 0;
+    if (nSize <= 3)
+        nCompact = getulong() << 8*(3-nSize);
+    else
+    {
+        CBigNum cbn;
+        mpz_abs(cbn.bn, bn);
+        mpz_tdiv_q_2exp(cbn.bn, cbn.bn, 8*(nSize-3));
+        nCompact = cbn.getulong();
+    }
+    // The 0x00800000 bit denotes the sign.
+    // Thus, if it is already set, divide the mantissa by 256 and increase the exponent.
+    if (nCompact & 0x00800000)
+    {
+        nCompact >>= 8;
+        nSize++;
+    }
+    nCompact |= nSize << 24;
+    nCompact |= (mpz_sgn(bn) < 0 ? 0x00800000 : 0);
+    return nCompact;
+}
+
+void CBigNum::SetDec(const std::string& str)
+{
+    // Like BN_dec2bn(): optional '-', then parse up to the first non digit
+    size_t nStart = (!str.empty() && str[0] == '-') ? 1 : 0;
+    size_t nEnd = nStart;
+    while (nEnd < str.size() && isdigit(str[nEnd]))
+        nEnd++;
+    if (nEnd == nStart)
+        return;
+    mpz_set_str(bn, str.substr(nStart, nEnd - nStart).c_str(), 10);
+    if (nStart)
+        mpz_neg(bn, bn);
+}
+
+std::string CBigNum::ToString(int nBase) const
+{
+    std::vector<char> vch(mpz_sizeinbase(bn, nBase) + 2);
+    mpz_get_str(&vch[0], nBase, bn);
+    return std::string(&vch[0]);
+}
+
+CBigNum CBigNum::pow(const CBigNum& e) const
+{
+    if (mpz_sgn(e.bn) < 0)
+        throw bignum_error("CBigNum::pow : negative exponent");
+    CBigNum ret;
+    mpz_pow_ui(ret.bn, bn, e.getulong());
+    return ret;
+}
+
+CBigNum CBigNum::mul_mod(const CBigNum& b, const CBigNum& m) const
+{
+    if (mpz_sgn(m.bn) == 0)
+        throw bignum_error("CBigNum::mul_mod : zero modulus");
+    CBigNum ret;
+    mpz_mul(ret.bn, bn, b.bn);
+    mpz_mod(ret.bn, ret.bn, m.bn);
+    return ret;
+}
+
+CBigNum CBigNum::pow_mod(const CBigNum& e, const CBigNum& m) const
+{
+    if (mpz_sgn(m.bn) == 0)
+        throw bignum_error("CBigNum::pow_mod : zero modulus");
+    CBigNum ret;
+    if (mpz_sgn(e.bn) < 0) {
+        // g^-x = (g^-1)^x
+        CBigNum inv = this->inverse(m);
+        CBigNum posE = -e;
+        mpz_powm(ret.bn, inv.bn, posE.bn, m.bn);
+    } else
+        mpz_powm(ret.bn, bn, e.bn, m.bn);
+
+    return ret;
+}
+
+CBigNum CBigNum::inverse(const CBigNum& m) const
+{
+    CBigNum ret;
+    if (mpz_sgn(m.bn) == 0 || !mpz_invert(ret.bn, bn, m.bn))
+        throw bignum_error("CBigNum::inverse*= :mpz_invert");
+    return ret;
+}
+
+CBigNum CBigNum::generatePrime(const unsigned int numBits, bool safe)
+{
+    if (numBits < 3)
+        throw bignum_error("CBigNum::generatePrime*= :numBits too small");
+
+    // Like BN_generate_prime_ex(): the two top bits are set, so the
+    // product of two such primes has exactly twice as many bits
+    CBigNum ret;
+    for (;;) {
+        SetRandomBits(ret.bn, numBits);
+        mpz_setbit(ret.bn, numBits - 1);
+        mpz_setbit(ret.bn, numBits - 2);
+        mpz_setbit(ret.bn, 0);
+        if (!ret.isPrime())
+            continue;
+        if (safe) {
+            CBigNum half;
+            mpz_tdiv_q_2exp(half.bn, ret.bn, 1);
+            if (!half.isPrime())
+                continue;
+        }
+        return ret;
+    }
+}
+
+CBigNum CBigNum::gcd(const CBigNum& b) const
+{
+    CBigNum ret;
+    mpz_gcd(ret.bn, bn, b.bn);
+    return ret;
+}
+
+bool CBigNum::isPrime(const int checks) const
+{
+    return mpz_probab_prime_p(bn, checks > 0 ? checks : GMP_PRIME_CHECKS) != 0;
+}
+
+bool CBigNum::isOne() const
+{
+    return mpz_cmp_ui(bn, 1) == 0;
+}
+
+bool CBigNum::operator!() const
+{
+    return mpz_sgn(bn) == 0;
+}
+
+CBigNum& CBigNum::operator+=(const CBigNum& b)
+{
+    mpz_add(bn, bn, b.bn);
+    return *this;
+}
+
+CBigNum& CBigNum::operator-=(const CBigNum& b)
+{
+    mpz_sub(bn, bn, b.bn);
+    return *this;
+}
+
+CBigNum& CBigNum::operator*=(const CBigNum& b)
+{
+    mpz_mul(bn, bn, b.bn);
+    return *this;
+}
+
+CBigNum& CBigNum::operator<<=(unsigned int shift)
+{
+    mpz_mul_2exp(bn, bn, shift);
+    return *this;
+}
+
+CBigNum& CBigNum::operator>>=(unsigned int shift)
+{
+    // Anything smaller than 2^shift, including all negative numbers,
+    // becomes zero, as with the OpenSSL implementation
+    if (mpz_sgn(bn) < 0 || (unsigned int)bitSize() <= shift)
+    {
+        mpz_set_ui(bn, 0);
+        return *this;
+    }
+
+    mpz_tdiv_q_2exp(bn, bn, shift);
+    return *this;
+}
+
+CBigNum& CBigNum::operator++()
+{
+    // prefix operator
+    mpz_add_ui(bn, bn, 1);
+    return *this;
+}
+
+CBigNum& CBigNum::operator--()
+{
+    // prefix operator
+    mpz_sub_ui(bn, bn, 1);
+    return *this;
+}
+
+const CBigNum operator+(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    mpz_add(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    mpz_sub(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a)
+{
+    CBigNum r;
+    mpz_neg(r.bn, a.bn);
+    return r;
+}
+
+const CBigNum operator*(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    mpz_mul(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator/(const CBigNum& a, const CBigNum& b)
+{
+    if (mpz_sgn(b.bn) == 0)
+        throw bignum_error("CBigNum::operator/ : division by zero");
+    CBigNum r;
+    mpz_tdiv_q(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator%(const CBigNum& a, const CBigNum& b)
+{
+    if (mpz_sgn(b.bn) == 0)
+        throw bignum_error("CBigNum::operator% : division by zero");
+    CBigNum r;
+    mpz_mod(r.bn, a.bn, b.bn);
+    return r;
+}
+
+const CBigNum operator<<(const CBigNum& a, unsigned int shift)
+{
+    CBigNum r;
+    mpz_mul_2exp(r.bn, a.bn, shift);
+    return r;
+}
+
+bool operator==(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) == 0); }
+bool operator!=(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) != 0); }
+bool operator<=(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) <= 0); }
+bool operator>=(const CBigNum& a, const CBigNum& b) { return (mpz_cmp(a.bn, b.bn) >= 0); }
+bool operator<(const CBigNum& a, const CBigNum& b)  { return (mpz_cmp(a.bn, b.bn) < 0); }
+bool operator>(const CBigNum& a, const CBigNum& b)  { return (mpz_cmp(a.bn, b.bn) > 0); }
+
+#endif // USE_NUM_GMP
@@ -0,0 +1,585 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2012 The Bitcoin developers
+// Copyright (c) 2017 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bignum.h"
+
+#if defined(USE_NUM_OPENSSL)
+
+#include <boost/thread/tss.hpp>
+
+namespace
+{
+/** Size of the per-thread Montgomery context cache. libzerocoin only
+ *  exponentiates modulo a handful of fixed group moduli. */
+const size_t MONT_CACHE_SIZE = 8;
+
+/**
+ * Per-thread OpenSSL scratch state. Holds the BN_CTX that used to be
+ * created for every operation, and the Montgomery contexts of the moduli
+ * that were most recently exponentiated with.
+ */
+class CBigNumScratch
+{
+    struct MontEntry {
+        BIGNUM* modulus;
+        BN_MONT_CTX* mont;
+    };
+
+    std::vector<MontEntry> vMont;
+    size_t nNextMont;
+
+public:
+    BN_CTX* ctx;
+
+    CBigNumScratch() : nNextMont(0)
+    {
+        ctx = BN_CTX_new();
+        if (ctx == NULL)
+            throw bignum_error("CBigNumScratch : BN_CTX_new() returned NULL");
+    }
+
+    ~CBigNumScratch()
+    {
+        for (size_t i = 0; i < vMont.size(); i++) {
+            BN_free(vMont[i].modulus);
+            BN_MONT_CTX_free(vMont[i].mont);
+        }
+        BN_CTX_free(ctx);
+    }
+
+    /** Return the Montgomery context for an odd modulus, creating it on first use */
+    BN_MONT_CTX* GetMont(const BIGNUM* m)
+    {
+        for (size_t i = 0; i < vMont.size(); i++) {
+            if (BN_cmp(vMont[i].modulus, m) == 0)
+                return vMont[i].mont;
+        }
+
+        MontEntry entry;
+        entry.modulus = BN_dup(m);
+        entry.mont = BN_MONT_CTX_new();
+        if (entry.modulus == NULL || entry.mont == NULL || !BN_MONT_CTX_set(entry.mont, m, ctx)) {
+            BN_free(entry.modulus);
+            BN_MONT_CTX_free(entry.mont);
+            throw bignum_error("CBigNumScratch::GetMont : BN_MONT_CTX_set failed");
+        }
+
+        if (vMont.size() < MONT_CACHE_SIZE) {
+            vMont.push_back(entry);
+        } else {
+            // Evict round-robin
+            BN_free(vMont[nNextMont].modulus);
+            BN_MONT_CTX_free(vMont[nNextMont].mont);
+            vMont[nNextMont] = entry;
+            nNextMont = (nNextMont + 1) % MONT_CACHE_SIZE;
+        }
+        return entry.mont;
+    }
+};
+
+boost::thread_specific_ptr<CBigNumScratch> scratch;
+
+CBigNumScratch& GetScratch()
+{
+    if (!scratch.get())
+        scratch.reset(new CBigNumScratch());
+    return *scratch;
+}
+
+BN_CTX* GetCtx()
+{
+    return GetScratch().ctx;
+}
+
+/** Fill in the 4 byte size header in front of an MPI and load it into bn */
+void SetMPI(BIGNUM* bn, unsigned char* pch, unsigned char* pend)
+{
+    unsigned int nSize = pend - (pch + 4);
+    pch[0] = (nSize >> 24) & 0xff;
+    pch[1] = (nSize >> 16) & 0xff;
+    pch[2] = (nSize >> 8) & 0xff;
+    pch[3] = (nSize >> 0) & 0xff;
+    BN_mpi2bn(pch, pend - pch, bn);
+}
+}
+
+void CBigNum::init()
+{
+    bn = BN_new();
+    if (bn == NULL)
+        throw bignum_error("CBigNum::init : BN_new failed");
+}
+
+CBigNum::CBigNum()
+{
+    init();
+}
+
+CBigNum::CBigNum(const CBigNum& b)
+{
+    init();
+    if (!BN_copy(bn, b.bn))
+    {
+        BN_clear_free(bn);
+        throw bignum_error("CBigNum::CBigNum(const CBigNum&) : BN_copy failed");
+    }
+}
+
+CBigNum& CBigNum::operator=(const CBigNum& b)
+{
+    if (!BN_copy(bn, b.bn))
+        throw bignum_error("CBigNum::operator= : BN_copy failed");
+    return (*this);
+}
+
+CBigNum::~CBigNum()
+{
+    BN_clear_free(bn);
+}
+
+CBigNum CBigNum::randBignum(const CBigNum& range)
+{
+    CBigNum ret;
+    if(!BN_rand_range(ret.bn, range.bn)){
+        throw bignum_error("CBigNum:rand element : BN_rand_range failed");
+    }
+    return ret;
+}
+
+CBigNum CBigNum::RandKBitBigum(const uint32_t k)
+{
+    CBigNum ret;
+    if(!BN_rand(ret.bn, k, -1, 0)){
+        throw bignum_error("CBigNum:rand element : BN_rand failed");
+    }
+    return ret;
+}
+
+int CBigNum::bitSize() const
+{
+    return BN_num_bits(bn);
+}
+
+void CBigNum::setulong(unsigned long n)
+{
+    if (!BN_set_word(bn, n))
+        throw bignum_error("CBigNum conversion from unsigned long : BN_set_word failed");
+}
+
+unsigned long CBigNum::getulong() const
+{
+    return BN_get_word(bn);
+}
+
+void CBigNum::setint64(int64_t sn)
+{
+    unsigned char pch[sizeof(sn) + 6];
+    unsigned char* p = pch + 4;
+    bool fNegative;
+    uint64_t n;
+
+    if (sn < (int64_t)0)
+    {
+        // Since the minimum signed integer cannot be represented as positive so long as its type is signed,
+        // and it's not well-defined what happens if you make it unsigned before negating it,
+        // we instead increment the negative integer by 1, convert it, then increment the (now positive) unsigned integer by 1 to compensate
+        n = -(sn + 1);
+        ++n;
+        fNegative = true;
+    } else {
+        n = sn;
+        fNegative = false;
+    }
+
+    bool fLeadingZeroes = true;
+    for (int i = 0; i < 8; i++)
+    {
+        unsigned char c = (n >> 56) & 0xff;
+        n <<= 8;
+        if (fLeadingZeroes)
+        {
+            if (c == 0)
+                continue;
+            if (c & 0x80)
+                *p++ = (fNegative ? 0x80 : 0);
+            else if (fNegative)
+                c |= 0x80;
+            fLeadingZeroes = false;
+        }
+        *p++ = c;
+    }
+    SetMPI(bn, pch, p);
+}
+
+void CBigNum::setuint64(uint64_t n)
+{
+    unsigned char pch[sizeof(n) + 6];
+    unsigned char* p = pch + 4;
+    bool fLeadingZeroes = true;
+    for (int i = 0; i < 8; i++)
+    {
+        unsigned char c = (n >> 56) & 0xff;
+        n <<= 8;
+        if (fLeadingZeroes)
+        {
+            if (c == 0)
+                continue;
+            if (c & 0x80)
+                *p++ = 0;
+            fLeadingZeroes = false;
+        }
+        *p++ = c;
+    }
+    SetMPI(bn, pch, p);
+}
+
+void CBigNum::setuint256(uint256 n)
+{
+    unsigned char pch[sizeof(n) + 6];
+    unsigned char* p = pch + 4;
+    bool fLeadingZeroes = true;
+    unsigned char* pbegin = (unsigned char*)&n;
+    unsigned char* psrc = pbegin + sizeof(n);
+    while (psrc != pbegin)
+    {
+        unsigned char c = *(--psrc);
+        if (fLeadingZeroes)
+        {
+            if (c == 0)
+                continue;
+            if (c & 0x80)
+                *p++ = 0;
+            fLeadingZeroes = false;
+        }
+        *p++ = c;
+    }
+    SetMPI(bn, pch, p);
+}
+
+uint256 CBigNum::getuint256() const
+{
+    unsigned int nSize = BN_bn2mpi(bn, NULL);
+    if (nSize < 4)
+        return 0;
+    std::vector<unsigned char> vch(nSize);
+    BN_bn2mpi(bn, &vch[0]);
+    if (vch.size() > 4)
+        vch[4] &= 0x7f;
+    uint256 n = 0;
+    for (unsigned int i = 0, j = vch.size()-1; i < sizeof(n) && j >= 4; i++, j--)
+        ((unsigned char*)&n)[i] = vch[j];
+    return n;
+}
+
+void CBigNum::setvch(const std::vector<unsigned char>& vch)
+{
+    std::vector<unsigned char> vch2(vch.size() + 4);
+    unsigned int nSize = vch.size();
+    // BIGNUM's byte stream format expects 4 bytes of
+    // big endian size data info at the front
+    vch2[0] = (nSize >> 24) & 0xff;
+    vch2[1] = (nSize >> 16) & 0xff;
+    vch2[2] = (nSize >> 8) & 0xff;
+    vch2[3] = (nSize >> 0) & 0xff;
+    // swap data to big endian
+    reverse_copy(vch.begin(), vch.end(), vch2.begin() + 4);
+    BN_mpi2bn(&vch2[0], vch2.size(), bn);
+}
+
+std::vector<unsigned char> CBigNum::getvch() const
+{
+    unsigned int nSize = BN_bn2mpi(bn, NULL);
+    if (nSize <= 4)
+        return std::vector<unsigned char>();
+    std::vector<unsigned char> vch(nSize);
+    BN_bn2mpi(bn, &vch[0]);
+    vch.erase(vch.begin(), vch.begin() + 4);
+    reverse(vch.begin(), vch.end());
+    return vch;
+}
+
+CBigNum& CBigNum::SetCompact(unsigned int nCompact)
+{
+    unsigned int nSize = nCompact >> 24;
+    bool fNegative     =(nCompact & 0x00800000) != 0;
+    unsigned int nWord = nCompact & 0x007fffff;
+    if (nSize <= 3)
+    {
+        nWord >>= 8*(3-nSize);
+        BN_set_word(bn, nWord);
+    }
+    else
+    {
+        BN_set_word(bn, nWord);
+        BN_lshift(bn, bn, 8*(nSize-3));
+    }
+    BN_set_negative(bn, fNegative);
+    return *this;
+}
+
+unsigned int CBigNum::GetCompact() const
+{
+    unsigned int nSize = BN_num_bytes(bn);
+    unsigned int nCompact = 0;
+    if (nSize <= 3)
+        nCompact = BN_get_word(bn) << 8*(3-nSize);
+    else
+    {
+        CBigNum cbn;
+        BN_rshift(cbn.bn, bn, 8*(nSize-3));
+        nCompact = BN_get_word(cbn.bn);
+    }
+    // The 0x00800000 bit denotes the sign.
+    // Thus, if it is already set, divide the mantissa by 256 and increase the exponent.
+    if (nCompact & 0x00800000)
+    {
+        nCompact >>= 8;
+        nSize++;
+    }
+    nCompact |= nSize << 24;
+    nCompact |= (BN_is_negative(bn) ? 0x00800000 : 0);
+    return nCompact;
+}
+
+void CBigNum::SetDec(const std::string& str)
+{
+    BN_dec2bn(&bn, str.c_str());
+}
+
+std::string CBigNum::ToString(int nBase) const
+{
+    BN_CTX* pctx = GetCtx();
+    CBigNum bnBase = nBase;
+    CBigNum bn0 = 0;
+    CBigNum locBn = *this;
+    std::string str;
+    BN_set_negative(locBn.bn, false);
+    CBigNum dv;
+    CBigNum rem;
+    if (BN_cmp(locBn.bn, bn0.bn) == 0)
+        return "0";
+    while (BN_cmp(locBn.bn, bn0.bn) > 0)
+    {
+        if (!BN_div(dv.bn, rem.bn, locBn.bn, bnBase.bn, pctx))
+            throw bignum_error("CBigNum::ToString() : BN_div failed");
+        locBn = dv;
+        unsigned int c = rem.getulong();
+        str += "0123456789abcdef"[c];
+    }
+    if (BN_is_negative(bn))
+        str += "-";
+    reverse(str.begin(), str.end());
+    return str;
+}
+
+CBigNum CBigNum::pow(const CBigNum& e) const
+{
+    CBigNum ret;
+    if (!BN_exp(ret.bn, bn, e.bn, GetCtx()))
+        throw bignum_error("CBigNum::pow : BN_exp failed");
+    return ret;
+}
+
+CBigNum CBigNum::mul_mod(const CBigNum& b, const CBigNum& m) const
+{
+    CBigNum ret;
+    if (!BN_mod_mul(ret.bn, bn, b.bn, m.bn, GetCtx()))
+        throw bignum_error("CBigNum::mul_mod : BN_mod_mul failed");
+
+    return ret;
+}
+
+/** a^p mod m, reusing the cached Montgomery context when m is odd */
+static bool ModExp(BIGNUM* r, const BIGNUM* a, const BIGNUM* p, const BIGNUM* m)
+{
+    CBigNumScratch& s = GetScratch();
+    if (!BN_is_odd(m))
+        return BN_mod_exp(r, a, p, m, s.ctx);
+    return BN_mod_exp_mont(r, a, p, m, s.ctx, s.GetMont(m));
+}
+
+CBigNum CBigNum::pow_mod(const CBigNum& e, const CBigNum& m) const
+{
+    CBigNum ret;
+    if (BN_is_negative(e.bn)) {
+        // g^-x = (g^-1)^x
+        CBigNum inv = this->inverse(m);
+        CBigNum posE = -e;
+        if (!ModExp(ret.bn, inv.bn, posE.bn, m.bn))
+            throw bignum_error("CBigNum::pow_mod: BN_mod_exp failed on negative exponent");
+    } else if (!ModExp(ret.bn, bn, e.bn, m.bn))
+        throw bignum_error("CBigNum::pow_mod : BN_mod_exp failed");
+
+    return ret;
+}
+
+CBigNum CBigNum::inverse(const CBigNum& m) const
+{
+    CBigNum ret;
+    if (!BN_mod_inverse(ret.bn, bn, m.bn, GetCtx()))
+        throw bignum_error("CBigNum::inverse*= :BN_mod_inverse");
+    return ret;
+}
+
+CBigNum CBigNum::generatePrime(const unsigned int numBits, bool safe)
+{
+    CBigNum ret;
+    if(!BN_generate_prime_ex(ret.bn, numBits, (safe == true), NULL, NULL, NULL))
+        throw bignum_error("CBigNum::generatePrime*= :BN_generate_prime_ex");
+    return ret;
+}
+
+CBigNum CBigNum::gcd(const CBigNum& b) const
+{
+    CBigNum ret;
+    if (!BN_gcd(ret.bn, bn, b.bn, GetCtx()))
+        throw bignum_error("CBigNum::gcd*= :BN_gcd");
+    return ret;
+}
+
+bool CBigNum::isPrime(const int checks) const
+{
+    int ret = BN_is_prime_ex(bn, checks > 0 ? checks : BN_prime_checks, GetCtx(), NULL);
+    if(ret < 0){
+        throw bignum_error("CBigNum::isPrime :BN_is_prime");
+    }
+    return ret;
+}
+
+bool CBigNum::isOne() const
+{
+    return BN_is_one(bn);
+}
+
+bool CBigNum::operator!() const
+{
+    return BN_is_zero(bn);
+}
+
+CBigNum& CBigNum::operator+=(const CBigNum& b)
+{
+    if (!BN_add(bn, bn, b.bn))
+        throw bignum_error("CBigNum::operator+= : BN_add failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator-=(const CBigNum& b)
+{
+    if (!BN_sub(bn, bn, b.bn))
+        throw bignum_error("CBigNum::operator-= : BN_sub failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator*=(const CBigNum& b)
+{
+    if (!BN_mul(bn, bn, b.bn, GetCtx()))
+        throw bignum_error("CBigNum::operator*= : BN_mul failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator<<=(unsigned int shift)
+{
+    if (!BN_lshift(bn, bn, shift))
+        throw bignum_error("CBigNum:operator<<= : BN_lshift failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator>>=(unsigned int shift)
+{
+    // Note: BN_rshift segfaults on 64-bit if 2^shift is greater than the number
+    //   if built on ubuntu 9.04 or 9.10, probably depends on version of OpenSSL
+    CBigNum a = 1;
+    a <<= shift;
+    if (BN_cmp(a.bn, bn) > 0)
+    {
+        BN_zero(bn);
+        return *this;
+    }
+
+    if (!BN_rshift(bn, bn, shift))
+        throw bignum_error("CBigNum:operator>>= : BN_rshift failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator++()
+{
+    // prefix operator
+    if (!BN_add(bn, bn, BN_value_one()))
+        throw bignum_error("CBigNum::operator++ : BN_add failed");
+    return *this;
+}
+
+CBigNum& CBigNum::operator--()
+{
+    // prefix operator
+    if (!BN_sub(bn, bn, BN_value_one()))
+        throw bignum_error("CBigNum::operator-- : BN_sub failed");
+    return *this;
+}
+
+const CBigNum operator+(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_add(r.bn, a.bn, b.bn))
+        throw bignum_error("CBigNum::operator+ : BN_add failed");
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_sub(r.bn, a.bn, b.bn))
+        throw bignum_error("CBigNum::operator- : BN_sub failed");
+    return r;
+}
+
+const CBigNum operator-(const CBigNum& a)
+{
+    CBigNum r(a);
+    BN_set_negative(r.bn, !BN_is_negative(r.bn));
+    return r;
+}
+
+const CBigNum operator*(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_mul(r.bn, a.bn, b.bn, GetCtx()))
+        throw bignum_error("CBigNum::operator* : BN_mul failed");
+    return r;
+}
+
+const CBigNum operator/(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_div(r.bn, NULL, a.bn, b.bn, GetCtx()))
+        throw bignum_error("CBigNum::operator/ : BN_div failed");
+    return r;
+}
+
+const CBigNum operator%(const CBigNum& a, const CBigNum& b)
+{
+    CBigNum r;
+    if (!BN_nnmod(r.bn, a.bn, b.bn, GetCtx()))
+        throw bignum_error("CBigNum::operator% : BN_div failed");
+    return r;
+}
+
+const CBigNum operator<<(const CBigNum& a, unsigned int shift)
+{
+    CBigNum r;
+    if (!BN_lshift(r.bn, a.bn, shift))
+        throw bignum_error("CBigNum:operator<< : BN_lshift failed");
+    return r;
+}
+
+bool operator==(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) == 0); }
+bool operator!=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) != 0); }
+bool operator<=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) <= 0); }
+bool operator>=(const CBigNum& a, const CBigNum& b) { return (BN_cmp(a.bn, b.bn) >= 0); }
+bool operator<(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(a.bn, b.bn) < 0); }
+bool operator>(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(a.bn, b.bn) > 0); }
+
+#endif // USE_NUM_OPENSSL
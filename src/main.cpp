@@ -30,6 +30,7 @@
 #include "pow.h"
 #include "spork.h"
 #include "sporkdb.h"
+#include "stakespent.h"
 #include "swifttx.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -45,9 +46,11 @@
 #include "activemasternode.h"
 
 #include "primitives/zerocoin.h"
+#include "libzerocoin/BatchVerifier.h"
 #include "libzerocoin/Denominations.h"
 #include "invalid.h"
 
+#include <atomic>
 #include <sstream>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -81,7 +84,7 @@ set<pair<COutPoint, unsigned int> > setStakeSeen;
 // active chain, or the staking input was spent in the past 100 blocks after the height
 // of the incoming block.
 // Sourced from Phore.io pull req #133 & #134  (added by LOMA OOPALOOPA)
-map<COutPoint, int> mapStakeSpent;
+CStakeSpentMap mapStakeSpent;
 
 map<unsigned int, unsigned int> mapHashedBlocks;
 CChain chainActive;
@@ -206,6 +209,35 @@ set<CBlockIndex*> setDirtyBlockIndex;
 set<int> setDirtyFileInfo;
 } // anon namespace
 
+/** A downloaded block waiting for its parent, with the peer that sent it and when. */
+struct CBlockAwaitingParent {
+    CBlock block;
+    uint256 hashBlock;
+    NodeId nodeFrom;
+    int64_t nTimeReceived;
+};
+
+/**
+ * Downloaded blocks whose parent has no data yet, by parent hash, and the set of their own hashes.
+ * They are processed once the parent is, and dropped when their sender disconnects. Protected by cs_main.
+ */
+multimap<uint256, CBlockAwaitingParent> mapBlocksAwaitingParent;
+set<uint256> setBlocksAwaitingParent;
+
+/** Drop the blocks awaiting their parent that nodeFrom sent, or that arrived before nTimeBefore. Requires cs_main. */
+void static EraseBlocksAwaitingParent(NodeId nodeFrom, int64_t nTimeBefore)
+{
+    multimap<uint256, CBlockAwaitingParent>::iterator it = mapBlocksAwaitingParent.begin();
+    while (it != mapBlocksAwaitingParent.end()) {
+        if (it->second.nodeFrom == nodeFrom || it->second.nTimeReceived < nTimeBefore) {
+            setBlocksAwaitingParent.erase(it->second.hashBlock);
+            mapBlocksAwaitingParent.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Registration of network node signals.
@@ -325,6 +357,7 @@ void FinalizeNode(NodeId nodeid)
     BOOST_FOREACH (const QueuedBlock& entry, state->vBlocksInFlight)
         mapBlocksInFlight.erase(entry.hash);
     EraseOrphansFor(nodeid);
+    EraseBlocksAwaitingParent(nodeid, 0);
     nPreferredDownload -= state->fPreferredDownload;
 
     mapNodeState.erase(nodeid);
@@ -344,6 +377,8 @@ void MarkBlockAsReceived(const uint256& hash)
     }
 }
 
+} // anon namespace
+
 // Requires cs_main.
 void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, CBlockIndex* pindex = NULL)
 {
@@ -477,6 +512,9 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
             if (pindex->nStatus & BLOCK_HAVE_DATA) {
                 if (pindex->nChainTx)
                     state->pindexLastCommonBlock = pindex;
+            } else if (setBlocksAwaitingParent.count(pindex->GetBlockHash())) {
+                // Already downloaded, waiting for its parent.
+                continue;
             } else if (mapBlocksInFlight.count(pindex->GetBlockHash()) == 0) {
                 // The block is not already downloaded, and not yet in flight.
                 if (pindex->nHeight > nWindowEnd) {
@@ -499,7 +537,69 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
     }
 }
 
-} // anon namespace
+/** Whether a peer answers getheaders with headers, rather than with block inventory. */
+bool CanSyncHeaders(const CNode* pnode)
+{
+    return Params().HeadersFirstSyncingActive() && pnode->nVersion >= HEADERS_FIRST_VERSION;
+}
+
+/**
+ * Keep a block nodeFrom sent until its parent has been processed, if it was requested from a peer.
+ * The block is no longer in flight either way. Requires cs_main.
+ */
+bool AddBlockAwaitingParent(const CBlock& block, NodeId nodeFrom)
+{
+    uint256 hashBlock = block.GetHash();
+    bool fRequested = mapBlocksInFlight.count(hashBlock);
+    MarkBlockAsReceived(hashBlock);
+    if (!fRequested)
+        return false;
+    int64_t nNow = GetTime();
+    if (setBlocksAwaitingParent.size() >= BLOCK_DOWNLOAD_WINDOW)
+        EraseBlocksAwaitingParent(-1, nNow - BLOCK_AWAITING_PARENT_TIMEOUT);
+    if (setBlocksAwaitingParent.size() >= BLOCK_DOWNLOAD_WINDOW)
+        return false;
+    if (setBlocksAwaitingParent.insert(hashBlock).second) {
+        CBlockAwaitingParent entry;
+        entry.block = block;
+        entry.hashBlock = hashBlock;
+        entry.nodeFrom = nodeFrom;
+        entry.nTimeReceived = nNow;
+        mapBlocksAwaitingParent.insert(make_pair(block.hashPrevBlock, entry));
+    }
+    return true;
+}
+
+/** Process the blocks that were waiting for hashParent, and then those waiting for them. */
+void ProcessBlocksAwaitingParent(const uint256& hashParent)
+{
+    deque<uint256> queue(1, hashParent);
+    while (!queue.empty()) {
+        vector<CBlockAwaitingParent> vBlocks;
+        {
+            LOCK(cs_main);
+            pair<multimap<uint256, CBlockAwaitingParent>::iterator, multimap<uint256, CBlockAwaitingParent>::iterator> range = mapBlocksAwaitingParent.equal_range(queue.front());
+            for (multimap<uint256, CBlockAwaitingParent>::iterator it = range.first; it != range.second; ++it) {
+                setBlocksAwaitingParent.erase(it->second.hashBlock);
+                vBlocks.push_back(it->second);
+            }
+            mapBlocksAwaitingParent.erase(range.first, range.second);
+        }
+        queue.pop_front();
+
+        BOOST_FOREACH (CBlockAwaitingParent& entry, vBlocks) {
+            // Invalid blocks are followed too, so that their descendants get dropped
+            CValidationState state;
+            ProcessNewBlock(state, NULL, &entry.block);
+            int nDoS;
+            if (state.IsInvalid(nDoS) && nDoS > 0) {
+                LOCK(cs_main);
+                Misbehaving(entry.nodeFrom, nDoS);
+            }
+            queue.push_back(entry.hashBlock);
+        }
+    }
+}
 
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats)
 {
@@ -980,7 +1080,7 @@ bool ContextualCheckZerocoinSpend(const CTransaction& tx, const CoinSpend& spend
     return true;
 }
 
-bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state)
+bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvChecks)
 {
     //max needed non-mint outputs should be 2 - one for redemption address and a possible 2nd for change
     if (tx.vout.size() > 2) {
@@ -1035,12 +1135,15 @@ bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidati
                 return state.DoS(100, error("%s: Zerocoinspend could not find accumulator associated with checksum %s", __func__, HexStr(BEGIN(nChecksum), END(nChecksum))));
             }
 
-            Accumulator accumulator(Params().Zerocoin_Params(chainActive.Height() < Params().Zerocoin_Block_V2_Start()),
-                                    newSpend.getDenomination(), bnAccumulatorValue);
+            CZerocoinSpendCheck check(newSpend, Params().Zerocoin_Params(chainActive.Height() < Params().Zerocoin_Block_V2_Start()),
+                                      bnAccumulatorValue, tx.GetHash());
 
             //Check that the coin has been accumulated
-            if(!newSpend.Verify(accumulator))
-                    return state.DoS(100, error("CheckZerocoinSpend(): zerocoin spend did not verify"));
+            if (pvChecks) {
+                pvChecks->push_back(CZerocoinSpendCheck());
+                check.swap(pvChecks->back());
+            } else if (!check())
+                return state.DoS(100, error("CheckZerocoinSpend(): zerocoin spend did not verify"));
         }
 
         if (serials.count(newSpend.getCoinSerialNumber()))
@@ -1060,7 +1163,7 @@ bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidati
     return fValidated;
 }
 
-bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state)
+bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvZerocoinChecks)
 {
     // Basic checks that don't depend on any context
     if (tx.vin.empty())
@@ -1116,7 +1219,7 @@ bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fReject
 
             // Do not require signature verification if this is initial sync and a block over 24 hours old
             bool fVerifySignature = !IsInitialBlockDownload() && (GetTime() - chainActive.Tip()->GetBlockTime() < (60*60*24));
-            if (!CheckZerocoinSpend(tx, fVerifySignature, state))
+            if (!CheckZerocoinSpend(tx, fVerifySignature, state, pvZerocoinChecks))
                 return state.DoS(100, error("CheckTransaction() : invalid zerocoin spend"));
         }
     }
@@ -1210,7 +1313,28 @@ CAmount GetMinRelayFee(const CTransaction& tx, unsigned int nBytes, bool fAllowF
 }
 
 
-bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee, bool ignoreFees)
+/** Drop expired transactions, then evict by fee rate until the pool fits in limit bytes */
+static void LimitMempoolSize(CTxMemPool& pool, size_t limit, int64_t age, std::list<CTransaction>& removed)
+{
+    int expired = pool.Expire(GetTime() - age, removed);
+    if (expired != 0)
+        LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
+
+    pool.TrimToSize(limit, removed);
+}
+
+/** Script flags a transaction has to pass to enter the mempool */
+static unsigned int GetMempoolScriptFlags()
+{
+    unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (CBlockIndex::IsSuperMajority(6, chainActive.Tip(), Params().EnforceBlockUpgradeMajority()))
+        flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    return flags;
+}
+
+/** Transactions loaded from mempool.dat keep the time they first entered the mempool, nAcceptTime */
+static bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee, bool ignoreFees,
+                                     int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
     if (pfMissingInputs)
@@ -1220,8 +1344,17 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
     if (GetAdjustedTime() > GetSporkValue(SPORK_20_ZEROCOIN_MAINTENANCE_MODE) && tx.ContainsZerocoins())
         return state.DoS(10, error("AcceptToMemoryPool : Zerocoin transactions are temporarily disabled for maintenance"), REJECT_INVALID, "bad-tx");
 
-    if (!CheckTransaction(tx, chainActive.Height() >= Params().Zerocoin_StartHeight(), true, state))
+    int flags = GetMempoolScriptFlags();
+
+    // Spend proofs are queued and then verified together
+    std::vector<CZerocoinSpendCheck> vZerocoinChecks;
+    if (!CheckTransaction(tx, chainActive.Height() >= Params().Zerocoin_StartHeight(), true, state, &vZerocoinChecks))
         return state.DoS(100, error("AcceptToMemoryPool: : CheckTransaction failed"), REJECT_INVALID, "bad-tx");
+    BatchZerocoinSpendChecks(vZerocoinChecks, 1);
+    for (CZerocoinSpendCheck& check : vZerocoinChecks) {
+        if (!check())
+            return state.DoS(100, error("AcceptToMemoryPool: : zerocoin spend did not verify"), REJECT_INVALID, "bad-tx");
+    }
 
     // Coinbase is only valid in a block, not as a loose transaction
     if (tx.IsCoinBase())
@@ -1271,7 +1404,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
         }
     }
 
-
+    std::list<CTransaction> evicted;
     {
         CCoinsView dummy;
         CCoinsViewCache view(&dummy);
@@ -1379,9 +1512,9 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 
         double dPriority = 0;
         if (!hasZcSpendInputs)
-            view.GetPriority(tx, chainActive.Height());
+            dPriority = view.GetPriority(tx, chainActive.Height());
 
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height());
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime, dPriority, chainActive.Height());
         unsigned int nSize = entry.GetTxSize();
 
         // Don't accept it if it can't get into a block
@@ -1394,6 +1527,15 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
                 return state.DoS(0, error("%s : not enough fees %s, %d < %d",
                         __func__, hash.ToString(), nFees, txMinFee), REJECT_INSUFFICIENTFEE, "insufficient fee");
 
+            // After evicting transactions to stay below -maxmempool the pool asks for a higher fee rate
+            double dPriorityDelta = 0;
+            CAmount nModifiedFees = nFees;
+            pool.ApplyDeltas(hash, dPriorityDelta, nModifiedFees);
+            CAmount mempoolRejectFee = pool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+            if (mempoolRejectFee > 0 && nModifiedFees < mempoolRejectFee && !hasZcSpendInputs)
+                return state.DoS(0, error("%s : mempool min fee not met %s, %d < %d",
+                        __func__, hash.ToString(), nModifiedFees, mempoolRejectFee), REJECT_INSUFFICIENTFEE, "mempool min fee not met");
+
             // Require that free transactions have sufficient priority to be mined in the next block.
             if (tx.IsZerocoinMint()) {
                 if(nFees < Params().Zerocoin_MintFee() * tx.GetZerocoinMintCount())
@@ -1440,15 +1582,13 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
                     __func__, hash.ToString(), nFees, ::minRelayTxFee.GetFee(nSize) * 10000);
         }
 
-        bool fCLTVHasMajority = CBlockIndex::IsSuperMajority(6, chainActive.Tip(), Params().EnforceBlockUpgradeMajority());
+        // Long unconfirmed chains make every addition to and removal from the pool walk all of them
+        std::string errString;
+        if (!pool.CheckChainLimits(tx, GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT), GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT), errString))
+            return state.DoS(0, error("%s : %s %s", __func__, hash.ToString(), errString), REJECT_NONSTANDARD, "too-long-mempool-chain");
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
-
-        if (fCLTVHasMajority) {
-            flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
-        }
         if (!CheckInputs(tx, state, view, true, flags, true)) {
             return error("AcceptToMemoryPool: : ConnectInputs failed %s", hash.ToString());
         }
@@ -1462,19 +1602,21 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
         // There is a similar check in CreateNewBlock() to prevent creating
         // invalid blocks, however allowing such transactions into the mempool
         // can be exploited as a DoS attack.
-        flags = STANDARD_SCRIPT_VERIFY_FLAGS;
-
-        if (fCLTVHasMajority) {
-            flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
-        }
         if (!CheckInputs(tx, state, view, true, flags, true)) {
             return error("AcceptToMemoryPool: : BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s", hash.ToString());
         }
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry);
+        LimitMempoolSize(pool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60, evicted);
     }
 
+    // Tell the wallet about evicted transactions the way it is told about conflicts
+    BOOST_FOREACH (const CTransaction& txEvicted, evicted)
+        SyncWithWallets(txEvicted, NULL);
+    if (!pool.exists(hash))
+        return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
+
     SyncWithWallets(tx, nullptr);
 
     //Track zerocoinspends and ensure that they are given priority to make it into the blockchain
@@ -1484,6 +1626,11 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
     return true;
 }
 
+bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee, bool ignoreFees)
+{
+    return AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, fRejectInsaneFee, ignoreFees, GetTime());
+}
+
 bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool fRejectInsaneFee, bool isDSTX)
 {
     AssertLockHeld(cs_main);
@@ -2289,16 +2436,19 @@ CAmount GetMasternodePayment(int nHeight, int64_t blockValue, int nMasternodeCou
 
 bool IsInitialBlockDownload()
 {
-    LOCK(cs_main);
-    if (fImporting || fReindex || fVerifyingBlocks || chainActive.Height() < Checkpoints::GetTotalBlocksEstimate())
+    if (fImporting || fReindex || fVerifyingBlocks)
         return true;
-    static bool lockIBDState = false;
-    if (lockIBDState)
+    // Once caught up this stays false, so the message handlers can ask without waiting for cs_main
+    static std::atomic<bool> lockIBDState(false);
+    if (lockIBDState.load(std::memory_order_relaxed))
         return false;
+    LOCK(cs_main);
+    if (chainActive.Height() < Checkpoints::GetTotalBlocksEstimate())
+        return true;
     bool state = (chainActive.Height() < pindexBestHeader->nHeight - 24 * 6 ||
                   pindexBestHeader->GetBlockTime() < GetTime() - 6 * 60 * 60); // ~144 blocks behind -> 2 x fork detection time
     if (!state)
-        lockIBDState = true;
+        lockIBDState.store(true, std::memory_order_relaxed);
     return state;
 }
 
@@ -2454,6 +2604,63 @@ bool CScriptCheck::operator()()
     return true;
 }
 
+bool CZerocoinSpendCheck::operator()()
+{
+    libzerocoin::BatchVerifier batch(params);
+    for (const auto& spend : vSpends)
+        batch.Add(*spend.first, Accumulator(params, spend.first->getDenomination(), bnAccumulatorValue));
+    if (batch.Verify())
+        return true;
+
+    for (size_t i = 0; i < vSpends.size(); i++) {
+        if (!batch.GetResults()[i])
+            return ::error("CZerocoinSpendCheck(): %s zerocoin spend with serial %s did not verify", vSpends[i].second.ToString(), vSpends[i].first->getCoinSerialNumber().GetHex());
+    }
+    return false;
+}
+
+void BatchZerocoinSpendChecks(std::vector<CZerocoinSpendCheck>& vChecks, unsigned int nBatches)
+{
+    nBatches = std::max(nBatches, 1U);
+
+    // Group the checks by accumulator, and count the spends of each
+    std::vector<size_t> vGroupOf(vChecks.size());
+    std::vector<size_t> vGroupFirst;
+    std::vector<size_t> vGroupSpends;
+    for (size_t i = 0; i < vChecks.size(); i++) {
+        size_t nGroup = 0;
+        while (nGroup < vGroupFirst.size() && !vChecks[vGroupFirst[nGroup]].IsSameAccumulator(vChecks[i]))
+            nGroup++;
+        if (nGroup == vGroupFirst.size()) {
+            vGroupFirst.push_back(i);
+            vGroupSpends.push_back(0);
+        }
+        vGroupOf[i] = nGroup;
+        vGroupSpends[nGroup] += vChecks[i].size();
+    }
+
+    // Then merge the checks of each group into nBatches batches of about the same size
+    std::vector<CZerocoinSpendCheck> vBatches;
+    std::map<std::pair<size_t, size_t>, size_t> mapBatches;
+    std::vector<size_t> vGroupBatched(vGroupFirst.size(), 0);
+    for (size_t i = 0; i < vChecks.size(); i++) {
+        size_t nGroup = vGroupOf[i];
+        size_t nBatchSize = (vGroupSpends[nGroup] + nBatches - 1) / nBatches;
+        std::pair<size_t, size_t> key(nGroup, vGroupBatched[nGroup] / nBatchSize);
+        vGroupBatched[nGroup] += vChecks[i].size();
+
+        std::map<std::pair<size_t, size_t>, size_t>::iterator it = mapBatches.find(key);
+        if (it != mapBatches.end()) {
+            vBatches[it->second].Merge(vChecks[i]);
+            continue;
+        }
+        mapBatches[key] = vBatches.size();
+        vBatches.push_back(CZerocoinSpendCheck());
+        vBatches.back().swap(vChecks[i]);
+    }
+    vChecks.swap(vBatches);
+}
+
 std::map<COutPoint, COutPoint> mapInvalidOutPoints;
 std::map<CBigNum, CAmount> mapInvalidSerials;
 void AddInvalidSpendsToMap(const CBlock& block)
@@ -2745,7 +2952,7 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                 coins->vout[out.n] = undo.txout;
 
                 // erase the spent input
-                mapStakeSpent.erase(out);
+                mapStakeSpent.Erase(out);
             }
         }
     }
@@ -2803,6 +3010,20 @@ void ThreadScriptCheck()
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Zerocoin spend proofs are checked in CheckBlock, which may run outside of cs_main
+ * (ProcessNewBlock), so the queue is guarded separately. A caller that cannot take
+ * the queue verifies its spends inline instead.
+ */
+static CCriticalSection cs_zerocoinspendcheckqueue;
+static CCheckQueue<CZerocoinSpendCheck> zerocoinspendcheckqueue(8);
+
+void ThreadZerocoinSpendCheck()
+{
+    RenameThread("vitae-zcspendch");
+    zerocoinspendcheckqueue.Thread();
+}
+
 void RecalculateZVITMinted()
 {
     CBlockIndex *pindex = chainActive[Params().Zerocoin_StartHeight()];
@@ -2818,10 +3039,9 @@ void RecalculateZVITMinted()
         std::list<CZerocoinMint> listMints;
         BlockToZerocoinMintList(block, listMints, true);
 
-        vector<libzerocoin::CoinDenomination> vDenomsBefore = pindex->vMintDenominationsInBlock;
-        pindex->vMintDenominationsInBlock.clear();
+        pindex->vMintsInBlock.SetNull();
         for (auto mint : listMints)
-            pindex->vMintDenominationsInBlock.emplace_back(mint.GetDenomination());
+            pindex->vMintsInBlock.at(mint.GetDenomination())++;
 
         if (pindex->nHeight < nHeightEnd)
             pindex = chainActive.Next(pindex);
@@ -2844,17 +3064,15 @@ void RecalculateZVITSpent()
         list<libzerocoin::CoinDenomination> listDenomsSpent = ZerocoinSpendListFromBlock(block, true);
 
         //Reset the supply to previous block
-        pindex->mapZerocoinSupply = pindex->pprev->mapZerocoinSupply;
+        pindex->vZerocoinSupply = pindex->pprev->vZerocoinSupply;
 
         //Add mints to zVITAE supply
-        for (auto denom : libzerocoin::zerocoinDenomList) {
-            long nDenomAdded = count(pindex->vMintDenominationsInBlock.begin(), pindex->vMintDenominationsInBlock.end(), denom);
-            pindex->mapZerocoinSupply.at(denom) += nDenomAdded;
-        }
+        for (auto denom : libzerocoin::zerocoinDenomList)
+            pindex->vZerocoinSupply.at(denom) += pindex->vMintsInBlock.at(denom);
 
         //Remove spends from zVITAE supply
         for (auto denom : listDenomsSpent)
-            pindex->mapZerocoinSupply.at(denom)--;
+            pindex->vZerocoinSupply.at(denom)--;
 
         //Rewrite money supply
         assert(pblocktree->WriteBlockIndex(CDiskBlockIndex(pindex)));
@@ -2996,19 +3214,19 @@ bool UpdateZVITAESupply(const CBlock& block, CBlockIndex* pindex)
     // Initialize zerocoin supply to the supply from previous block
     if (pindex->pprev && pindex->pprev->GetBlockHeader().nVersion > 3) {
         for (auto& denom : zerocoinDenomList) {
-            pindex->mapZerocoinSupply.at(denom) = pindex->pprev->mapZerocoinSupply.at(denom);
+            pindex->vZerocoinSupply.at(denom) = pindex->pprev->vZerocoinSupply.at(denom);
         }
     }
 
     // Track zerocoin money supply
     CAmount nAmountZerocoinSpent = 0;
-    pindex->vMintDenominationsInBlock.clear();
+    pindex->vMintsInBlock.SetNull();
     if (pindex->pprev) {
         std::set<uint256> setAddedToWallet;
         for (auto& m : listMints) {
             libzerocoin::CoinDenomination denom = m.GetDenomination();
-            pindex->vMintDenominationsInBlock.push_back(m.GetDenomination());
-            pindex->mapZerocoinSupply.at(denom)++;
+            pindex->vMintsInBlock.at(denom)++;
+            pindex->vZerocoinSupply.at(denom)++;
 
             //Remove any of our own mints from the mintpool
             if (pwalletMain) {
@@ -3033,17 +3251,17 @@ bool UpdateZVITAESupply(const CBlock& block, CBlockIndex* pindex)
         }
 
         for (auto& denom : listSpends) {
-            pindex->mapZerocoinSupply.at(denom)--;
+            pindex->vZerocoinSupply.at(denom)--;
             nAmountZerocoinSpent += libzerocoin::ZerocoinDenominationToAmount(denom);
 
             // zerocoin failsafe
-            if (pindex->mapZerocoinSupply.at(denom) < 0)
+            if (pindex->vZerocoinSupply.at(denom) < 0)
                 return error("Block contains zerocoins that spend more than are in the available supply to spend");
         }
     }
 
     for (auto& denom : zerocoinDenomList)
-        LogPrint("zero", "%s coins for denomination %d pubcoin %s\n", __func__, denom, pindex->mapZerocoinSupply.at(denom));
+        LogPrint("zero", "%s coins for denomination %d pubcoin %s\n", __func__, denom, pindex->vZerocoinSupply.at(denom));
 
     return true;
 }
@@ -3347,6 +3565,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (!vMints.empty() && !zerocoinDB->WriteCoinMintBatch(vMints))
         return state.Abort(("Failed to record new mints to database"));
 
+    //Index the block's pubcoins so accumulator checkpoints and witnesses never need to read it back from disk
+    if (pindex->nHeight >= Params().Zerocoin_StartHeight()) {
+        std::vector<CBlockPubcoin> vBlockPubcoins;
+        if (!BlockToPubcoinIndex(block, vBlockPubcoins) || !zerocoinDB->WriteBlockPubcoins(pindex->GetBlockHash(), vBlockPubcoins))
+            return state.Abort(("Failed to record block pubcoins to database"));
+    }
+
     //Record accumulator checksums
     DatabaseChecksums(mapAccumulators);
 
@@ -3360,20 +3585,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             continue;
         for (const CTxIn in: tx.vin) {
             LogPrint("map", "mapStakeSpent: Insert %s | %u\n", in.prevout.ToString(), pindex->nHeight);
-            mapStakeSpent.insert(std::make_pair(in.prevout, pindex->nHeight));
+            mapStakeSpent.Insert(in.prevout, pindex->nHeight);
         }
     }
 
     // delete old entries
-    for (auto it = mapStakeSpent.begin(); it != mapStakeSpent.end();) {
-        if (it->second < pindex->nHeight - Params().MaxReorganizationDepth()) {
-            LogPrint("map", "mapStakeSpent: Erase %s | %u\n", it->first.ToString(), it->second);
-            it = mapStakeSpent.erase(it);
-        }
-        else {
-            it++;
-        }
-    }
+    mapStakeSpent.Expire(pindex->nHeight - Params().MaxReorganizationDepth());
 
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -4003,6 +4220,53 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex* pindex)
     return true;
 }
 
+/**
+ * Fill in the proof-of-stake data of a block index entry. It depends on the
+ * block's transactions, so entries added from a header alone get it once the
+ * block itself arrives, in chain order.
+ */
+void SetBlockIndexStakeData(CBlockIndex* pindexNew, const CBlock& block)
+{
+    if (block.IsProofOfStake() && !pindexNew->IsProofOfStake()) {
+        pindexNew->SetProofOfStake();
+        CBlockIndexStake& stake = pindexNew->GetStakeDataForUpdate();
+        stake.prevoutStake = block.vtx[1].vin[0].prevout;
+        stake.nStakeTime = block.nTime;
+        setStakeSeen.insert(make_pair(stake.prevoutStake, stake.nStakeTime));
+    }
+
+    if (!pindexNew->pprev)
+        return;
+
+    const uint256 hash = pindexNew->GetBlockHash();
+
+    // ppcoin: compute stake entropy bit for stake modifier
+    if (!pindexNew->SetStakeEntropyBit(pindexNew->GetStakeEntropyBit()))
+        LogPrintf("AddToBlockIndex() : SetStakeEntropyBit() failed \n");
+
+    // ppcoin: record proof-of-stake hash value
+    if (pindexNew->IsProofOfStake()) {
+        if (!mapProofOfStake.count(hash))
+            LogPrintf("AddToBlockIndex() : hashProofOfStake not found in map \n");
+        pindexNew->GetStakeDataForUpdate().hashProofOfStake = mapProofOfStake[hash];
+    }
+
+    if (!Params().IsStakeModifierV2(pindexNew->nHeight, getStakeModifierV2SporkValue())) {
+        uint64_t nStakeModifier = 0;
+        bool fGeneratedStakeModifier = false;
+        if (!ComputeNextStakeModifier(pindexNew->pprev, nStakeModifier, fGeneratedStakeModifier))
+            LogPrintf("AddToBlockIndex() : ComputeNextStakeModifier() failed \n");
+        pindexNew->SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
+        pindexNew->nStakeModifierChecksum = GetStakeModifierChecksum(pindexNew);
+        if (!CheckStakeModifierCheckpoints(pindexNew->nHeight, pindexNew->nStakeModifierChecksum))
+            LogPrintf("AddToBlockIndex() : Rejected by stake modifier checkpoint height=%d, modifier=%s \n", pindexNew->nHeight, std::to_string(nStakeModifier));
+    } else {
+        // compute v2 stake modifier
+        pindexNew->nStakeModifierV2 = ComputeStakeModifier(pindexNew->pprev, block.vtx[1].vin[0].prevout.hash);
+    }
+    setDirtyBlockIndex.insert(pindexNew);
+}
+
 CBlockIndex* AddToBlockIndex(const CBlock& block)
 {
     // Check for duplicate
@@ -4022,7 +4286,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
 
     //mark as PoS seen
     if (pindexNew->IsProofOfStake())
-        setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+        setStakeSeen.insert(make_pair(pindexNew->GetStakeData().prevoutStake, pindexNew->GetStakeData().nStakeTime));
 
     pindexNew->phashBlock = &((*mi).first);
     BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
@@ -4034,33 +4298,9 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         //update previous block pointer
         pindexNew->pprev->pnext = pindexNew;
 
-        // ppcoin: compute chain trust score
-        pindexNew->bnChainTrust = (pindexNew->pprev ? pindexNew->pprev->bnChainTrust : 0) + pindexNew->GetBlockTrust();
-
-        // ppcoin: compute stake entropy bit for stake modifier
-        if (!pindexNew->SetStakeEntropyBit(pindexNew->GetStakeEntropyBit()))
-            LogPrintf("AddToBlockIndex() : SetStakeEntropyBit() failed \n");
-
-        // ppcoin: record proof-of-stake hash value
-        if (pindexNew->IsProofOfStake()) {
-            if (!mapProofOfStake.count(hash))
-                LogPrintf("AddToBlockIndex() : hashProofOfStake not found in map \n");
-            pindexNew->hashProofOfStake = mapProofOfStake[hash];
-        }
-
-        if (!Params().IsStakeModifierV2(pindexNew->nHeight, getStakeModifierV2SporkValue())) {
-            uint64_t nStakeModifier = 0;
-            bool fGeneratedStakeModifier = false;
-            if (!ComputeNextStakeModifier(pindexNew->pprev, nStakeModifier, fGeneratedStakeModifier))
-                LogPrintf("AddToBlockIndex() : ComputeNextStakeModifier() failed \n");
-            pindexNew->SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
-            pindexNew->nStakeModifierChecksum = GetStakeModifierChecksum(pindexNew);
-            if (!CheckStakeModifierCheckpoints(pindexNew->nHeight, pindexNew->nStakeModifierChecksum))
-                LogPrintf("AddToBlockIndex() : Rejected by stake modifier checkpoint height=%d, modifier=%s \n", pindexNew->nHeight, std::to_string(nStakeModifier));
-        } else {
-            // compute v2 stake modifier
-            pindexNew->nStakeModifierV2 = ComputeStakeModifier(pindexNew->pprev, block.vtx[1].vin[0].prevout.hash);
-        }
+        // headers received ahead of their block get the stake data later
+        if (!block.vtx.empty())
+            SetBlockIndexStakeData(pindexNew, block);
     }
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
@@ -4350,12 +4590,17 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     bool fZerocoinActive = block.GetBlockTime() > Params().Zerocoin_StartTime();
     vector<CBigNum> vBlockSerials;
     int blockHeight = chainActive.Height() + 1;
+    TRY_LOCK(cs_zerocoinspendcheckqueue, lockZerocoinQueue);
+    bool fParallelZerocoinChecks = lockZerocoinQueue && nScriptCheckThreads;
+    CCheckQueueControl<CZerocoinSpendCheck> zerocoinControl(fParallelZerocoinChecks ? &zerocoinspendcheckqueue : nullptr);
+    std::vector<CZerocoinSpendCheck> vZerocoinChecks;
     for (const CTransaction& tx : block.vtx) {
         if (!CheckTransaction(
                 tx,
                 fZerocoinActive,
                 blockHeight >= Params().Zerocoin_Block_EnforceSerialRange(),
-                state
+                state,
+                &vZerocoinChecks
         ))
             return error("%s : CheckTransaction failed", __func__);
 
@@ -4374,6 +4619,18 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
     }
 
 
+    // Spends of the block proving membership in the same accumulator are verified together
+    BatchZerocoinSpendChecks(vZerocoinChecks, fParallelZerocoinChecks ? nScriptCheckThreads : 1);
+    if (fParallelZerocoinChecks) {
+        zerocoinControl.Add(vZerocoinChecks);
+    } else {
+        for (CZerocoinSpendCheck& check : vZerocoinChecks) {
+            if (!check())
+                return state.DoS(100, error("%s : zerocoin spend did not verify", __func__),
+                    REJECT_INVALID, "bad-txns-zerocoinspend");
+        }
+    }
+
     unsigned int nSigOps = 0;
     BOOST_FOREACH (const CTransaction& tx, block.vtx) {
         nSigOps += GetLegacySigOpCount(tx);
@@ -4383,17 +4640,22 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
             REJECT_INVALID, "bad-blk-sigops", true);
 
+    if (!zerocoinControl.Wait())
+        return state.DoS(100, error("%s : zerocoin spend did not verify", __func__),
+            REJECT_INVALID, "bad-txns-zerocoinspend");
+
     return true;
 }
 
-bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev)
+bool CheckWork(const CBlockHeader& block, CBlockIndex* const pindexPrev)
 {
     if (pindexPrev == NULL)
         return error("%s : null pindexPrev for block %s", __func__, block.GetHash().GetHex());
 
     unsigned int nBitsRequired = GetNextWorkRequired(pindexPrev, &block);
 
-    if (block.IsProofOfWork() && (pindexPrev->nHeight + 1 <= 68589)) {
+    // Only proof-of-work blocks are valid up to LAST_POW_BLOCK, which a bare header can't tell otherwise
+    if (pindexPrev->nHeight + 1 <= Params().LAST_POW_BLOCK() && (pindexPrev->nHeight + 1 <= 68589)) {
         double n1 = ConvertBitsToDouble(block.nBits);
         double n2 = ConvertBitsToDouble(nBitsRequired);
 
@@ -4449,6 +4711,11 @@ bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& sta
         return state.DoS(100, error("%s : incorrect proof of work", __func__),
                 REJECT_INVALID, "bad-diffbits");
 
+    // Headers are accepted ahead of their blocks, so their target has to follow the retargeting already
+    if (!CheckWork(block, pindexPrev))
+        return state.DoS(100, error("%s : incorrect difficulty target", __func__),
+                REJECT_INVALID, "bad-diffbits");
+
 
     //If this is a reorg, check that it is not too deep
     int nMaxReorgDepth = GetArg("-maxreorg", Params().MaxReorganizationDepth());
@@ -4545,6 +4812,9 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
             *ppindex = pindex;
         if (pindex->nStatus & BLOCK_FAILED_MASK)
             return state.Invalid(error("%s : block is marked invalid", __func__), 0, "duplicate");
+        // The entry was added from the header, now that the block is here complete it
+        if (!block.vtx.empty() && !(pindex->nStatus & BLOCK_HAVE_DATA))
+            SetBlockIndexStakeData(pindex, block);
         return true;
     }
 
@@ -4576,6 +4846,9 @@ bool AcceptBlockHeader(const CBlock& block, CValidationState& state, CBlockIndex
                              REJECT_INVALID, "bad-prevblk");
         }
 
+        // Headers can arrive well ahead of their blocks, check the work of the proof-of-work era already
+        if (pindexPrev->nHeight + 1 <= Params().LAST_POW_BLOCK() && !CheckProofOfWork(hash, block.nBits))
+            return state.DoS(50, error("%s : proof of work failed", __func__), REJECT_INVALID, "high-hash");
     }
 
     if (!ContextualCheckBlockHeader(block, state, pindexPrev))
@@ -4619,9 +4892,6 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
         }
     }
 
-    if (block.GetHash() != Params().HashGenesisBlock() && !CheckWork(block, pindexPrev))
-        return false;
-
     if (block.IsProofOfStake()) {
         uint256 hashProofOfStake = 0;
         unique_ptr<CStakeInput> stake;
@@ -4665,11 +4935,11 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
             // the inputs are spent at the chain tip so we should look at the recently spent outputs
 
             for (CTxIn in : block.vtx[1].vin) {
-                auto it = mapStakeSpent.find(in.prevout);
-                if (it == mapStakeSpent.end()) {
+                int nSpentHeight;
+                if (!mapStakeSpent.Find(in.prevout, nSpentHeight)) {
                     return false;
                 }
-                if (it->second < pindexPrev->nHeight) {
+                if (nSpentHeight < pindexPrev->nHeight) {
                     return false;
                 }
             }
@@ -4965,7 +5235,7 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
 
     //mark as PoS seen
     if (pindexNew->IsProofOfStake())
-        setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+        setStakeSeen.insert(make_pair(pindexNew->GetStakeData().prevoutStake, pindexNew->GetStakeData().nStakeTime));
 
     pindexNew->phashBlock = &((*mi).first);
 
@@ -5322,6 +5592,159 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
     return nLoaded > 0;
 }
 
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+
+//! Set once mempool.dat was read, so an early periodic dump does not replace it with a partial pool
+static std::atomic<bool> fMempoolLoaded(false);
+
+bool LoadMempool()
+{
+    int64_t nStart = GetTimeMillis();
+    boost::filesystem::path pathMempool = GetDataDir() / "mempool.dat";
+    CAutoFile filein(fopen(pathMempool.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        LogPrintf("%s : No mempool file %s, starting with an empty mempool\n", __func__, pathMempool.string());
+        fMempoolLoaded = true;
+        return false;
+    }
+
+    uint64_t fileSize = boost::filesystem::file_size(pathMempool);
+    if (fileSize < sizeof(uint256)) {
+        fMempoolLoaded = true;
+        return error("%s : Mempool file %s is truncated", __func__, pathMempool.string());
+    }
+    std::vector<unsigned char> vchData(fileSize - sizeof(uint256));
+    uint256 hashIn;
+
+    std::vector<std::pair<CTransaction, int64_t> > vEntries;
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    std::map<uint256, int64_t> mapZerocoinTimes;
+    try {
+        if (!vchData.empty())
+            filein.read((char*)&vchData[0], vchData.size());
+        filein >> hashIn;
+        filein.fclose();
+
+        CDataStream ssMempool(vchData, SER_DISK, CLIENT_VERSION);
+        if (hashIn != Hash(ssMempool.begin(), ssMempool.end())) {
+            fMempoolLoaded = true;
+            return error("%s : Checksum mismatch, mempool file corrupted", __func__);
+        }
+
+        uint64_t nVersion;
+        ssMempool >> nVersion;
+        if (nVersion != MEMPOOL_DUMP_VERSION) {
+            fMempoolLoaded = true;
+            return error("%s : Unknown mempool file version %d", __func__, nVersion);
+        }
+        ssMempool >> vEntries >> mapDeltas >> mapZerocoinTimes;
+    } catch (const std::exception& e) {
+        fMempoolLoaded = true;
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    // Deltas go in first so the fee checks below see the prioritised fees
+    for (std::map<uint256, std::pair<double, CAmount> >::const_iterator it = mapDeltas.begin(); it != mapDeltas.end(); ++it)
+        mempool.PrioritiseTransaction(it->first, it->first.ToString(), it->second.first, it->second.second);
+
+    // Entries are stored oldest first, which puts most parents before their children.
+    // The rest are retried for as long as a pass still accepts something.
+    int64_t nExpiryTime = GetTime() - GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    int nAccepted = 0, nFailed = 0, nExpired = 0;
+    bool fProgress = true;
+    while (!vEntries.empty() && fProgress) {
+        fProgress = false;
+        std::vector<std::pair<CTransaction, int64_t> > vMissingInputs;
+        for (std::vector<std::pair<CTransaction, int64_t> >::const_iterator it = vEntries.begin(); it != vEntries.end(); ++it) {
+            if (ShutdownRequested())
+                return false;
+            if (it->second < nExpiryTime) {
+                nExpired++;
+                continue;
+            }
+
+            const uint256& hash = it->first.GetHash();
+            CValidationState state;
+            bool fMissingInputs = false;
+            LOCK(cs_main);
+            if (AcceptToMemoryPoolWorker(mempool, state, it->first, false, &fMissingInputs, false, false, it->second)) {
+                std::map<uint256, int64_t>::const_iterator itZc = mapZerocoinTimes.find(hash);
+                if (itZc != mapZerocoinTimes.end())
+                    mapZerocoinspends[hash] = itZc->second;
+                nAccepted++;
+                fProgress = true;
+            } else if (fMissingInputs) {
+                vMissingInputs.push_back(*it);
+            } else {
+                nFailed++;
+            }
+        }
+        vEntries.swap(vMissingInputs);
+    }
+    nFailed += vEntries.size();
+
+    fMempoolLoaded = true;
+    LogPrintf("%s : Imported mempool transactions from disk: %i successes, %i failed, %i expired in %dms\n",
+        __func__, nAccepted, nFailed, nExpired, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool DumpMempool()
+{
+    if (!fMempoolLoaded)
+        return false;
+
+    static CCriticalSection cs_dumpMempool;
+    LOCK(cs_dumpMempool);
+
+    int64_t nStart = GetTimeMillis();
+    std::vector<std::pair<CTransaction, int64_t> > vEntries;
+    std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    std::map<uint256, int64_t> mapZerocoinTimes;
+    {
+        LOCK2(cs_main, mempool.cs);
+        if (chainActive.Tip() == NULL)
+            return false;
+
+        mapDeltas = mempool.mapDeltas;
+        const indexed_transaction_set::index<entry_time>::type& index = mempool.mapTx.get<entry_time>();
+        vEntries.reserve(index.size());
+        for (indexed_transaction_set::index<entry_time>::type::const_iterator it = index.begin(); it != index.end(); ++it) {
+            const uint256& hash = it->GetTx().GetHash();
+            vEntries.push_back(std::make_pair(it->GetTx(), it->GetTime()));
+            std::map<uint256, int64_t>::const_iterator itZc = mapZerocoinspends.find(hash);
+            if (itZc != mapZerocoinspends.end())
+                mapZerocoinTimes.insert(*itZc);
+        }
+    }
+    int64_t nMid = GetTimeMillis();
+
+    CDataStream ssMempool(SER_DISK, CLIENT_VERSION);
+    ssMempool << MEMPOOL_DUMP_VERSION;
+    ssMempool << vEntries << mapDeltas << mapZerocoinTimes;
+    uint256 hash = Hash(ssMempool.begin(), ssMempool.end());
+    ssMempool << hash;
+
+    boost::filesystem::path pathMempool = GetDataDir() / "mempool.dat";
+    boost::filesystem::path pathTmp = GetDataDir() / "mempool.dat.new";
+    CAutoFile fileout(fopen(pathTmp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathTmp.string());
+    try {
+        fileout << ssMempool;
+    } catch (const std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    if (!RenameOver(pathTmp, pathMempool))
+        return error("%s : Failed to rename %s", __func__, pathTmp.string());
+
+    LogPrint("mempool", "Dumped %u mempool transactions: %dms to copy, %dms to write\n",
+        vEntries.size(), nMid - nStart, GetTimeMillis() - nMid);
+    return true;
+}
+
 void static CheckBlockIndex()
 {
     if (!fCheckBlockIndex) {
@@ -5544,7 +5967,7 @@ bool static AlreadyHave(const CInv& inv)
     case MSG_SPORK:
         return mapSporks.count(inv.hash);
     case MSG_FUNDAMENTALNODE_WINNER:
-        if (fundamentalnodePayments.mapFundamentalnodePayeeVotes.count(inv.hash)) {
+        if (fundamentalnodePayments.HasVote(inv.hash)) {
             fundamentalnodeSync.AddedFundamentalnodeWinner(inv.hash);
             return true;
         }
@@ -5719,10 +6142,11 @@ void static ProcessGetData(CNode* pfrom)
                     }
                 }
                 if (!pushed && inv.type == MSG_FUNDAMENTALNODE_WINNER) {
-                    if (fundamentalnodePayments.mapFundamentalnodePayeeVotes.count(inv.hash)) {
+                    CFundamentalnodePaymentWinner winner;
+                    if (fundamentalnodePayments.GetVote(inv.hash, winner)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << fundamentalnodePayments.mapFundamentalnodePayeeVotes[inv.hash];
+                        ss << winner;
                         pfrom->PushMessage("fnw", ss);
                         pushed = true;
                     }
@@ -6104,9 +6528,20 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             if (inv.type == MSG_BLOCK) {
                 UpdateBlockAvailability(pfrom->GetId(), inv.hash);
                 if (!fAlreadyHave && !fImporting && !fReindex && !mapBlocksInFlight.count(inv.hash)) {
-                    // Add this to the list of blocks to request
-                    vToFetch.push_back(inv);
-                    LogPrint("net", "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                    if (CanSyncHeaders(pfrom)) {
+                        // Get the headers up to the announced block, the download logic fetches the blocks in
+                        // parallel from there. Near the tip, ask for the announced block right away as well.
+                        pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), inv.hash);
+                        LogPrint("net", "getheaders (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                        if (chainActive.Tip()->GetBlockTime() > GetAdjustedTime() - Params().TargetSpacing() * 20) {
+                            vToFetch.push_back(inv);
+                            MarkBlockAsInFlight(pfrom->GetId(), inv.hash);
+                        }
+                    } else {
+                        // Add this to the list of blocks to request
+                        vToFetch.push_back(inv);
+                        LogPrint("net", "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, inv.hash.ToString(), pfrom->id);
+                    }
                 }
             }
 
@@ -6144,7 +6579,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
-    else if (strCommand == "getblocks" || strCommand == "getheaders") {
+    else if (strCommand == "getblocks" || (strCommand == "getheaders" && !CanSyncHeaders(pfrom))) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
@@ -6176,7 +6611,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     }
 
 
-    else if (strCommand == "headers" && Params().HeadersFirstSyncingActive()) {
+    else if (strCommand == "getheaders" && CanSyncHeaders(pfrom)) {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
@@ -6409,6 +6844,9 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             if (!AcceptBlockHeader((CBlock)header, state, &pindexLast)) {
                 int nDoS;
                 if (state.IsInvalid(nDoS)) {
+                    // Headers come without their stake to check, so peers sending ones from the future are scored too
+                    if (nDoS == 0 && state.GetRejectReason() == "time-too-new")
+                        nDoS = 10;
                     if (nDoS > 0)
                         Misbehaving(pfrom->GetId(), nDoS);
                     std::string strError = "invalid header received " + header.GetHash().ToString();
@@ -6440,7 +6878,13 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         LogPrint("net", "received block %s peer=%d\n", inv.hash.ToString(), pfrom->id);
 
         //sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
-        if (!mapBlockIndex.count(block.hashPrevBlock)) {
+        if (!mapBlockIndex.count(block.hashPrevBlock) && CanSyncHeaders(pfrom)) {
+            // Fill in the headers in between, the missing blocks are then downloaded in parallel
+            LOCK(cs_main);
+            if (!AddBlockAwaitingParent(block, pfrom->GetId()))
+                LogPrint("net", "%s : parent of block %s unknown, dropping it\n", __func__, hashBlock.GetHex());
+            pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), hashBlock);
+        } else if (!mapBlockIndex.count(block.hashPrevBlock)) {
             if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
                 //we already asked for this block, so lets work backwards and ask for the previous block
                 pfrom->PushMessage("getblocks", chainActive.GetLocator(), block.hashPrevBlock);
@@ -6453,9 +6897,25 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         } else {
             pfrom->AddInventoryKnown(inv);
 
+            // Blocks downloaded ahead of their parent wait for it, the stake checks need the parent's data
+            bool fAwaitParent = false;
+            {
+                LOCK(cs_main);
+                CBlockIndex* pindexPrev = mapBlockIndex[block.hashPrevBlock];
+                if (!(pindexPrev->nStatus & BLOCK_HAVE_DATA)) {
+                    fAwaitParent = true;
+                    if (!AddBlockAwaitingParent(block, pfrom->GetId()))
+                        LogPrint("net", "%s : parent of block %s not processed yet, dropping it\n", __func__, hashBlock.GetHex());
+                }
+            }
+            if (fAwaitParent)
+                return true;
+
             CValidationState state;
-            if (!mapBlockIndex.count(block.GetHash())) {
+            BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+            if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA)) {
                 ProcessNewBlock(state, pfrom, &block);
+                ProcessBlocksAwaitingParent(hashBlock);
                 int nDoS;
                 if(state.IsInvalid(nDoS)) {
                     pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
@@ -6692,6 +7152,14 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 LogPrint("net", "Unparseable reject message received\n");
             }
         }
+    }
+
+
+    // node pings go straight to their list, they may be handled on a message worker
+    else if (strCommand == "fnp" || strCommand == "obseep") {
+        mnodeman.ProcessMessage(pfrom, strCommand, vRecv);
+    } else if (strCommand == "dseep") {
+        m_nodeman.ProcessMessage(pfrom, strCommand, vRecv);
     } else {
         //probably one the extensions
         obfuScationPool.ProcessMessageObfuscation(pfrom, strCommand, vRecv);
@@ -6738,8 +7206,19 @@ int ActiveProtocol()
     return MIN_PEER_PROTO_VERSION_BEFORE_ENFORCEMENT;
 }
 
+/**
+ * Messages that may be handled on a message worker while another thread
+ * holds cs_main. Their handlers only touch the sending peer and state that
+ * is guarded by its own lock. Node pings look up their block in
+ * mapBlockIndex and score peers, both of which need cs_main.
+ */
+static bool IsConcurrentMessage(const std::string& strCommand)
+{
+    return strCommand == "ping" || strCommand == "pong";
+}
+
 // requires LOCK(cs_vRecvMsg)
-bool ProcessMessages(CNode* pfrom)
+bool ProcessMessages(CNode* pfrom, bool fConcurrentOnly)
 {
     //if (fDebug)
     //    LogPrintf("ProcessMessages(%u messages)\n", pfrom->vRecvMsg.size());
@@ -6754,6 +7233,10 @@ bool ProcessMessages(CNode* pfrom)
     //
     bool fOk = true;
 
+    // getdata replies go out before anything else and need cs_main
+    if (fConcurrentOnly && !pfrom->vRecvGetData.empty())
+        return fOk;
+
     if (!pfrom->vRecvGetData.empty())
         ProcessGetData(pfrom);
 
@@ -6778,6 +7261,10 @@ bool ProcessMessages(CNode* pfrom)
         if (!msg.complete())
             break;
 
+        // leave the message and the ones after it to the validation thread
+        if (fConcurrentOnly && !IsConcurrentMessage(msg.hdr.GetCommand()))
+            break;
+
         // at this point, any failure means we can delete the current message
         it++;
 
@@ -6812,6 +7299,7 @@ bool ProcessMessages(CNode* pfrom)
 
         // Process message
         bool fRet = false;
+        int64_t nTimeStart = GetTimeMicros();
         try {
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
             boost::this_thread::interruption_point();
@@ -6833,6 +7321,7 @@ bool ProcessMessages(CNode* pfrom)
         } catch (...) {
             PrintExceptionContinue(NULL, "ProcessMessages()");
         }
+        RecordMessageStats(strCommand, nTimeStart - msg.nTime, GetTimeMicros() - nTimeStart);
 
         if (!fRet)
             LogPrintf("ProcessMessage(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -6954,10 +7443,13 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             if (nSyncStarted == 0 || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
                 state.fSyncStarted = true;
                 nSyncStarted++;
-                //CBlockIndex *pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
-                //LogPrint("net", "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
-                //pto->PushMessage("getheaders", chainActive.GetLocator(pindexStart), uint256(0));
-                pto->PushMessage("getblocks", chainActive.GetLocator(chainActive.Tip()), uint256(0));
+                if (CanSyncHeaders(pto)) {
+                    CBlockIndex* pindexStart = pindexBestHeader->pprev ? pindexBestHeader->pprev : pindexBestHeader;
+                    LogPrint("net", "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->id, pto->nStartingHeight);
+                    pto->PushMessage("getheaders", chainActive.GetLocator(pindexStart), uint256(0));
+                } else {
+                    pto->PushMessage("getblocks", chainActive.GetLocator(chainActive.Tip()), uint256(0));
+                }
             }
         }
 
@@ -45,6 +45,7 @@
 
 #include "libzerocoin/CoinSpend.h"
 
+#include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
 
 class CBlockIndex;
@@ -54,6 +55,7 @@ class CSporkDB;
 class CBloomFilter;
 class CInv;
 class CScriptCheck;
+class CZerocoinSpendCheck;
 class CValidationInterface;
 class CValidationState;
 
@@ -80,6 +82,18 @@ static const unsigned int MAX_TX_SIGOPS_CURRENT = MAX_BLOCK_SIGOPS_CURRENT / 5;
 static const unsigned int MAX_TX_SIGOPS_LEGACY = MAX_BLOCK_SIGOPS_LEGACY / 5;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -maxmempool, maximum megabytes of mempool memory usage */
+static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
+static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
+/** Default for -limitancestorcount, max number of in-mempool ancestors of a transaction, itself included */
+static const unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
+/** Default for -limitdescendantcount, max number of in-mempool descendants of a transaction, itself included */
+static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
+/** Default for -persistmempool, keep the mempool in mempool.dat across restarts */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Seconds between periodic writes of mempool.dat */
+static const int64_t DUMP_MEMPOOL_INTERVAL = 15 * 60;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -102,6 +116,8 @@ static const unsigned int MAX_HEADERS_RESULTS = 2000;
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
  *  harder). We'll probably want to make this a per-peer adaptive value at some point. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+/** Seconds a downloaded block may wait for its parent before it makes room for others. */
+static const unsigned int BLOCK_AWAITING_PARENT_TIMEOUT = 10 * 60;
 /** Time to wait (in seconds) between writing blockchain state to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 3600;
 /** Maximum length of reject messages. */
@@ -131,6 +147,7 @@ typedef boost::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
+extern int64_t nLastBlockTemplateMicros;
 extern const std::string strMessageMagic;
 extern int64_t nTimeBestReceived;
 extern CWaitableCriticalSection csBestBlock;
@@ -201,6 +218,10 @@ FILE* OpenUndoFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 boost::filesystem::path GetBlockPosFilename(const CDiskBlockPos& pos, const char* prefix);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp = NULL);
+/** Load mempool.dat into the mempool, skipping checks it records as passed */
+bool LoadMempool();
+/** Write the mempool, its priorities and validity digests to mempool.dat */
+bool DumpMempool();
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex();
 /** Load the block tree and coins database from disk */
@@ -209,8 +230,13 @@ bool LoadBlockIndex(std::string& strError);
 void UnloadBlockIndex();
 /** See whether the protocol update is enforced for connected nodes */
 int ActiveProtocol();
-/** Process protocol messages received from a given node */
-bool ProcessMessages(CNode* pfrom);
+/**
+ * Process protocol messages received from a given node.
+ *
+ * @param[in]   pfrom           The node whose received messages are processed.
+ * @param[in]   fConcurrentOnly When true only process messages that do not need cs_main, stopping at the first one that does.
+ */
+bool ProcessMessages(CNode* pfrom, bool fConcurrentOnly);
 /**
  * Send queued protocol messages to be sent to a give node.
  *
@@ -220,6 +246,8 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the zerocoin spend checking thread */
+void ThreadZerocoinSpendCheck();
 
 // ***TODO*** probably not the right place for these 2
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
@@ -353,10 +381,13 @@ bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsVi
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CValidationState& state, CCoinsViewCache& inputs, CTxUndo& txundo, int nHeight);
 
-/** Context-independent validity checks */
-bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state);
+/**
+ * Context-independent validity checks. If pvZerocoinChecks is not NULL, zerocoin spend proof
+ * verifications are pushed onto it instead of being performed inline.
+ */
+bool CheckTransaction(const CTransaction& tx, bool fZerocoinActive, bool fRejectBadUTXO, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvZerocoinChecks = NULL);
 bool CheckZerocoinMint(const uint256& txHash, const CTxOut& txout, CValidationState& state, bool fCheckOnly = false);
-bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state);
+bool CheckZerocoinSpend(const CTransaction& tx, bool fVerifySignature, CValidationState& state, std::vector<CZerocoinSpendCheck>* pvChecks = NULL);
 bool ContextualCheckZerocoinSpend(const CTransaction& tx, const libzerocoin::CoinSpend& spend, CBlockIndex* pindex);
 bool IsTransactionInChain(const uint256& txId, int& nHeightTx, CTransaction& tx);
 bool IsTransactionInChain(const uint256& txId, int& nHeightTx);
@@ -437,6 +468,45 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the verification of zerocoin spend proofs of membership in one accumulator.
+ * The accumulator value is looked up by the caller, so the check itself does not touch any database.
+ */
+class CZerocoinSpendCheck
+{
+private:
+    //! Spends and the transactions they are in
+    std::vector<std::pair<boost::shared_ptr<libzerocoin::CoinSpend>, uint256> > vSpends;
+    const libzerocoin::ZerocoinParams* params;
+    CBigNum bnAccumulatorValue;
+
+public:
+    CZerocoinSpendCheck() : params(NULL) {}
+    CZerocoinSpendCheck(const libzerocoin::CoinSpend& spendIn, const libzerocoin::ZerocoinParams* paramsIn, const CBigNum& bnAccumulatorValueIn, const uint256& txidIn)
+        : vSpends(1, std::make_pair(boost::shared_ptr<libzerocoin::CoinSpend>(new libzerocoin::CoinSpend(spendIn)), txidIn)), params(paramsIn), bnAccumulatorValue(bnAccumulatorValueIn) {}
+
+    bool operator()();
+
+    //! Whether check proves membership in the same accumulator, so that Merge() may take its spends
+    bool IsSameAccumulator(const CZerocoinSpendCheck& check) const { return params == check.params && bnAccumulatorValue == check.bnAccumulatorValue; }
+    void Merge(const CZerocoinSpendCheck& check) { vSpends.insert(vSpends.end(), check.vSpends.begin(), check.vSpends.end()); }
+    size_t size() const { return vSpends.size(); }
+
+    void swap(CZerocoinSpendCheck& check)
+    {
+        vSpends.swap(check.vSpends);
+        std::swap(params, check.params);
+        std::swap(bnAccumulatorValue, check.bnAccumulatorValue);
+    }
+};
+
+/**
+ * Merge the checks of spends proving membership in the same accumulator, so that each accumulator's
+ * spends are verified as one batch. Accumulators with many spends are split into up to nBatches
+ * batches, to keep the check queue threads busy.
+ */
+void BatchZerocoinSpendChecks(std::vector<CZerocoinSpendCheck>& vChecks, unsigned int nBatches);
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos);
@@ -461,7 +531,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
-bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev);
+bool CheckWork(const CBlockHeader& block, CBlockIndex* const pindexPrev);
 
 /** Context-dependent validity checks */
 bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex* pindexPrev);
@@ -476,8 +476,7 @@ bool CMasternodePayments::ProcessBlock(int nBlockHeight)
             CMasternode* pmn = m_nodeman.Find(vinLP);
             if(pmn != NULL)
             {
-                pmn->Check();
-                if(!pmn->IsEnabled()) continue;
+                if(!m_nodeman.CheckEntry(*pmn)) continue;
 
                 newWinner.score = 0;
                 newWinner.nBlockHeight = nBlockHeight;
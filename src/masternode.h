@@ -36,6 +36,7 @@
 #define MASTERNODE_PING_SECONDS                (5*60)   // bitsenddev 12-05 OLD 1*60
 #define MASTERNODE_EXPIRATION_SECONDS          (65*60)
 #define MASTERNODE_REMOVAL_SECONDS             (70*60)
+#define MASTERNODE_CHECK_SECONDS               5
 
 #define START_MASTERNODE_PAYMENTS_TESTNET 1511347576
 #define START_MASTERNODE_PAYMENTS 1511347576
@@ -207,12 +207,11 @@ bool CMasternodeMan::Add(CMasternode &mn)
     if (!mn.IsEnabled())
         return false;
 
-    CMasternode *pmn = Find(mn.vin);
-
-    if (pmn == NULL)
+    if (listMasternodes.Find(mn.vin.prevout) == NULL)
     {
         if(fDebug) LogPrintf("CMasternodeMan: Adding new Masternode %s - %i now\n", mn.addr.ToString().c_str(), size() + 1);
-        vMasternodes.push_back(mn);
+        listMasternodes.Add(mn);
+        rankCache.Clear();
         return true;
     }
 
@@ -223,8 +222,30 @@ void CMasternodeMan::Check()
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-        mn.Check();
+    BOOST_FOREACH(CMasternode& mn, listMasternodes)
+        CheckEntry(mn);
+}
+
+bool CMasternodeMan::CheckEntry(CMasternode& mn)
+{
+    LOCK(cs);
+
+    mn.Check();
+
+    // the counters and rankings only count enabled Masternodes
+    if (listMasternodes.Refresh(mn)) rankCache.Clear();
+
+    return mn.IsEnabled();
+}
+
+void CMasternodeMan::ForEachMasternode(boost::function<void(CMasternode&)> fn)
+{
+    LOCK(cs);
+
+    BOOST_FOREACH(CMasternode& mn, listMasternodes) {
+        CheckEntry(mn);
+        fn(mn);
+    }
 }
 
 void CMasternodeMan::CheckAndRemove()
@@ -234,11 +255,12 @@ void CMasternodeMan::CheckAndRemove()
     Check();
 
     //remove inactive
-    vector<CMasternode>::iterator it = vMasternodes.begin();
-    while(it != vMasternodes.end()){
+    CNodeList<CMasternode, &CMasternode::pubkey2>::iterator it = listMasternodes.begin();
+    while(it != listMasternodes.end()){
         if((*it).activeState == CMasternode::MASTERNODE_REMOVE || (*it).activeState == CMasternode::MASTERNODE_VIN_SPENT){
             if(fDebug) LogPrintf("CMasternodeMan: Removing inactive Masternode %s - %i now\n", (*it).addr.ToString().c_str(), size() - 1);
-            it = vMasternodes.erase(it);
+            it = listMasternodes.Erase(it);
+            rankCache.Clear();
         } else {
             ++it;
         }
@@ -279,7 +301,8 @@ void CMasternodeMan::CheckAndRemove()
 void CMasternodeMan::Clear()
 {
     LOCK(cs);
-    vMasternodes.clear();
+    listMasternodes.Clear();
+    rankCache.Clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -288,22 +311,19 @@ void CMasternodeMan::Clear()
 
 int CMasternodeMan::CountEnabled()
 {
-    int i = 0;
-
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-        mn.Check();
-        if(mn.IsEnabled()) i++;
-    }
+    LOCK(cs);
 
-    return i;
+    // as of the last check of each Masternode
+    return listMasternodes.CountEnabled();
 }
 
 void CMasternodeMan::CountNetworks(int protocolVersion, int& ipv4, int& ipv6, int& onion)
 {
     protocolVersion = protocolVersion == -1 ? GetMinMasternodePaymentsProto() : protocolVersion;
 
-    BOOST_FOREACH (CMasternode& mn, vMasternodes) {
-        mn.Check();
+    LOCK(cs);
+
+    BOOST_FOREACH (CMasternode& mn, listMasternodes) {
         std::string strHost;
         int port;
         SplitHostPort(mn.addr.ToString(), port, strHost);
@@ -325,15 +345,10 @@ void CMasternodeMan::CountNetworks(int protocolVersion, int& ipv4, int& ipv6, in
 
 int CMasternodeMan::CountMasternodesAboveProtocol(int protocolVersion)
 {
-    int i = 0;
-
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-        mn.Check();
-        if(mn.protocolVersion < protocolVersion || !mn.IsEnabled()) continue;
-        i++;
-    }
+    LOCK(cs);
 
-    return i;
+    // as of the last check of each Masternode
+    return listMasternodes.CountEnabled(protocolVersion);
 }
 
 int CMasternodeMan::stable_size ()
@@ -343,7 +358,9 @@ int CMasternodeMan::stable_size ()
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
 
-    BOOST_FOREACH (CMasternode& mn, vMasternodes) {
+    LOCK(cs);
+
+    BOOST_FOREACH (CMasternode& mn, listMasternodes) {
         if (mn.protocolVersion < nMinProtocol) {
             continue; // Skip obsolete versions
         }
@@ -352,8 +369,7 @@ int CMasternodeMan::stable_size ()
         if ((nMasternode_Age) < nMasternode_Min_Age) {
             continue; // Skip masternodes younger than (default) 8000 sec (MUST be > MASTERNODE_REMOVAL_SECONDS)
         }
-        mn.Check ();
-        if (!mn.IsEnabled ())
+        if (!CheckEntry(mn))
             continue; // Skip not-enabled masternodes
 
         nStable_size++;
@@ -383,24 +399,14 @@ CMasternode *CMasternodeMan::Find(const CTxIn &vin)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CMasternode& mn, vMasternodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    return listMasternodes.Find(vin.prevout);
 }
 
 CMasternode *CMasternodeMan::Find(const CPubKey &pubKeyMasternode)
 {
-LOCK(cs);
+    LOCK(cs);
 
-BOOST_FOREACH(CMasternode& mn, vMasternodes)
-{
-if(mn.pubkey2 == pubKeyMasternode)
-return &mn;
-}
-return NULL;
+    return listMasternodes.Find(pubKeyMasternode);
 }
 
 CMasternode* CMasternodeMan::FindOldestNotInVec(const std::vector<CTxIn> &vVins, int nMinimumAge, int nMinimumActiveSeconds)
@@ -409,24 +415,19 @@ CMasternode* CMasternodeMan::FindOldestNotInVec(const std::vector<CTxIn> &vVins,
 
     CMasternode *pOldestMasternode = NULL;
 
-    BOOST_FOREACH(CMasternode &mn, vMasternodes)
+    std::set<COutPoint> setExcluded;
+    BOOST_FOREACH(const CTxIn& vin, vVins)
+        setExcluded.insert(vin.prevout);
+
+    BOOST_FOREACH(CMasternode &mn, listMasternodes)
     {
-        mn.Check();
-        if(!mn.IsEnabled()) continue;
+        if(!CheckEntry(mn)) continue;
 
         //if(!RegTest()){
             if(mn.GetMasternodeInputAge() < nMinimumAge || mn.lastTimeSeen - mn.sigTime < nMinimumActiveSeconds) continue;
         //}
 
-        bool found = false;
-        BOOST_FOREACH(const CTxIn& vin, vVins)
-            if(mn.vin.prevout == vin.prevout)
-            {
-                found = true;
-                break;
-            }
-
-        if(found) continue;
+        if(setExcluded.count(mn.vin.prevout)) continue;
 
         if(pOldestMasternode == NULL || pOldestMasternode->GetMasternodeInputAge() < mn.GetMasternodeInputAge()){
             pOldestMasternode = &mn;
@@ -442,50 +443,28 @@ CMasternode *CMasternodeMan::FindRandom()
 
     if(size() == 0) return NULL;
 
-    return &vMasternodes[GetRandInt(vMasternodes.size())];
+    CNodeList<CMasternode, &CMasternode::pubkey2>::iterator it = listMasternodes.begin();
+    std::advance(it, GetRandInt(listMasternodes.size()));
+    return &*it;
 }
 
-CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol)
-{
-    unsigned int score = 0;
-    CMasternode* winner = NULL;
-
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
-        mn.Check();
-        if(mn.protocolVersion < minProtocol || !mn.IsEnabled()) continue;
-
-        // calculate the score for each Masternode
-        uint256 n = mn.CalculateScore(mod, nBlockHeight);
-        unsigned int n2 = 0;
-        memcpy(&n2, &n, sizeof(n2));
-
-        // determine the winner
-        if(n2 > score){
-            score = n2;
-            winner = &mn;
-        }
-    }
-
-    return winner;
-}
-
-int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+const CNodeRanking* CMasternodeMan::GetRanking(int64_t nBlockHeight, int minProtocol, int nFilter)
 {
-    std::vector<pair<unsigned int, CTxIn> > vecMasternodeScores;
+    LOCK(cs);
 
     //make sure we know about this block
     uint256 hash = 0;
-    if(!GetBlockHashMN(hash, nBlockHeight)) return -1;
+    if(!GetBlockHashMN(hash, nBlockHeight)) return NULL;
+
+    int64_t nNow = GetTime();
+    const CNodeRanking* pranking = rankCache.Get(nBlockHeight, minProtocol, nFilter, hash, nNow);
+    if(pranking) return pranking;
 
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+    std::vector<pair<int64_t, CTxIn> > vecMasternodeScores;
+    BOOST_FOREACH(CMasternode& mn, listMasternodes) {
 
         if(mn.protocolVersion < minProtocol) continue;
-        if(fOnlyActive) {
-            mn.Check();
-            if(!mn.IsEnabled()) continue;
-        }
+        if((nFilter & RANK_ONLY_ACTIVE) && !CheckEntry(mn)) continue;
 
         uint256 n = mn.CalculateScore(1, nBlockHeight);
         unsigned int n2 = 0;
@@ -494,87 +473,68 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
         vecMasternodeScores.push_back(make_pair(n2, mn.vin));
     }
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareValueOnly());
-
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(unsigned int, CTxIn)& s, vecMasternodeScores){
-        rank++;
-        if(s.second == vin) {
-            return rank;
-        }
-    }
-
-    return -1;
+    // Masternodes are only checked again once the ranking expires
+    return &rankCache.Set(nBlockHeight, minProtocol, nFilter, CNodeRanking(hash, nNow + MASTERNODE_CHECK_SECONDS, vecMasternodeScores));
 }
 
-std::vector<pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight, int minProtocol)
+CMasternode* CMasternodeMan::GetCurrentMasterNode(int64_t nBlockHeight, int minProtocol)
 {
-    std::vector<pair<unsigned int, CMasternode> > vecMasternodeScores;
-    std::vector<pair<int, CMasternode> > vecMasternodeRanks;
+    LOCK(cs);
 
-    //make sure we know about this block
-    uint256 hash = 0;
-    if(!GetBlockHashMN(hash, nBlockHeight)) return vecMasternodeRanks;
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, minProtocol, RANK_ONLY_ACTIVE);
+    if(!pranking) return NULL;
 
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+    // the winner is the Masternode with the highest score
+    const pair<int64_t, CTxIn>* pwinner = pranking->GetByRank(1);
+    if(!pwinner || pwinner->first == 0) return NULL;
 
-        mn.Check();
+    return Find(pwinner->second);
+}
 
-        if(mn.protocolVersion < minProtocol) continue;
-        if(!mn.IsEnabled()) {
-            continue;
-        }
+int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
+{
+    LOCK(cs);
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        unsigned int n2 = 0;
-        memcpy(&n2, &n, sizeof(n2));
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, minProtocol, fOnlyActive ? RANK_ONLY_ACTIVE : RANK_ALL);
+    if(!pranking) return -1;
 
-        vecMasternodeScores.push_back(make_pair(n2, mn));
-    }
+    return pranking->GetRank(vin.prevout);
+}
+
+void CMasternodeMan::ForEachRankedMasternode(int64_t nBlockHeight, boost::function<void(int, CMasternode&)> fn)
+{
+    LOCK(cs);
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareValueOnlyMN());
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, 0, RANK_ONLY_ACTIVE);
+    if(!pranking) return;
 
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(unsigned int, CMasternode)& s, vecMasternodeScores){
-        rank++;
-        vecMasternodeRanks.push_back(make_pair(rank, s.second));
+    for(unsigned int rank = 1; rank <= pranking->size(); rank++) {
+        CMasternode* pmn = Find(pranking->GetByRank(rank)->second);
+        if(pmn) fn(rank, *pmn);
     }
-
-    return vecMasternodeRanks;
 }
 
 CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<pair<unsigned int, CTxIn> > vecMasternodeScores;
-
-    // scan for winner
-    BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+    LOCK(cs);
 
-        if(mn.protocolVersion < minProtocol) continue;
-        if(fOnlyActive) {
-            mn.Check();
-            if(!mn.IsEnabled()) continue;
-        }
+    const CNodeRanking* pranking = GetRanking(nBlockHeight, minProtocol, fOnlyActive ? RANK_ONLY_ACTIVE : RANK_ALL);
+    if(!pranking) return NULL;
 
-        uint256 n = mn.CalculateScore(1, nBlockHeight);
-        unsigned int n2 = 0;
-        memcpy(&n2, &n, sizeof(n2));
+    const pair<int64_t, CTxIn>* pscore = pranking->GetByRank(nRank);
+    if(!pscore) return NULL;
 
-        vecMasternodeScores.push_back(make_pair(n2, mn.vin));
-    }
+    return Find(pscore->second);
+}
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareValueOnly());
+void CMasternodeMan::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    LOCK(cs);
 
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(unsigned int, CTxIn)& s, vecMasternodeScores){
-        rank++;
-        if(rank == nRank) {
-            return Find(s.second);
-        }
-    }
+    rankCache.Prune(pindex->nHeight - NODE_RANK_CACHE_DEPTH);
 
-    return NULL;
+    // payment votes for the next blocks are checked against this ranking
+    GetRanking(pindex->nHeight + 10 - 100, ActiveProtocol(), RANK_ONLY_ACTIVE);
 }
 
 void CMasternodeMan::ProcessMasternodeConnections()
@@ -607,6 +567,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
     if (strCommand == "dsee") { //DarkSend Election Entry
 
+        CDataStream vRecvCopy(vRecv);
         CTxIn vin;
         CService addr;
         CPubKey pubkey;
@@ -671,6 +632,11 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             return;
         }
 
+        // check the signature on a worker thread, which then processes the entry
+        std::vector<CObfuScationSigCheck> vChecks(1, CObfuScationSigCheck(pubkey, vchSig, strMessage));
+        if(obfuScationVerifyPool.Defer(pfrom, Hash(vchSig.begin(), vchSig.end()), vin.prevout, vChecks, boost::bind(&CMasternodeMan::ProcessMessage, this, pfrom, strCommand, vRecvCopy)))
+            return;
+
         std::string errorMessage = "";
         if(!obfuScationSigner.VerifyMessage(pubkey, vchSig, strMessage, errorMessage)){
             LogPrintf("dsee - Got bad Masternode address signature\n");
@@ -703,7 +669,8 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
                     pmn->addr = addr;
                     pmn->donationAddress = donationAddress;
                     pmn->donationPercentage = donationPercentage;
-                    pmn->Check();
+                    CheckEntry(*pmn);
+                    rankCache.Clear();
                     if(pmn->IsEnabled())
                         m_nodeman.RelayMasternodeEntry(vin, addr, vchSig, sigTime, pubkey, pubkey2, count, current, lastUpdated, protocolVersion, donationAddress, donationPercentage);
                 }
@@ -797,6 +764,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
     else if (strCommand == "dseep") { //DarkSend Election Entry Ping
 
+        CDataStream vRecvCopy(vRecv);
         CTxIn vin;
         vector<unsigned char> vchSig;
         int64_t sigTime;
@@ -825,6 +793,11 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             {
                 std::string strMessage = pmn->addr.ToString() + boost::lexical_cast<std::string>(sigTime) + boost::lexical_cast<std::string>(stop);
 
+                // check the signature on a worker thread, which then processes the ping
+                std::vector<CObfuScationSigCheck> vChecks(1, CObfuScationSigCheck(pmn->pubkey2, vchSig, strMessage));
+                if(obfuScationVerifyPool.Defer(pfrom, Hash(vchSig.begin(), vchSig.end()), vin.prevout, vChecks, boost::bind(&CMasternodeMan::ProcessMessage, this, pfrom, strCommand, vRecvCopy)))
+                    return;
+
                 std::string errorMessage = "";
                 if(!obfuScationSigner.VerifyMessage(pmn->pubkey2, vchSig, strMessage, errorMessage))
                 {
@@ -837,12 +810,12 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
                 if(!pmn->UpdatedWithin(MASTERNODE_MIN_DSEEP_SECONDS))
                 {
+                    rankCache.Clear();
                     if(stop) pmn->Disable();
                     else
                     {
                         pmn->UpdateLastSeen();
-                        pmn->Check();
-                        if(!pmn->IsEnabled()) return;
+                        if(!CheckEntry(*pmn)) return;
                     }
                     m_nodeman.RelayMasternodeEntryPing(vin, vchSig, sigTime, stop);
                 }
@@ -850,6 +823,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
             return;
         }
 
+        // an entry for it may be queued for a worker, process the ping after it
+        if(obfuScationVerifyPool.Defer(pfrom, Hash(vchSig.begin(), vchSig.end()), vin.prevout, std::vector<CObfuScationSigCheck>(), boost::bind(&CMasternodeMan::ProcessMessage, this, pfrom, strCommand, vRecvCopy)))
+            return;
+
         if(fDebug) LogPrintf("dseep - Couldn't find Masternode entry %s\n", vin.ToString().c_str());
 
         std::map<COutPoint, int64_t>::iterator i = mWeAskedForMasternodeListEntry.find(vin.prevout);
@@ -927,7 +904,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         int count = this->size();
         int i = 0;
 
-        BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+        BOOST_FOREACH(CMasternode& mn, listMasternodes) {
 
             if(mn.addr.IsRFC1918()) continue; //local network
 
@@ -967,13 +944,11 @@ void CMasternodeMan::Remove(CTxIn vin)
 {
     LOCK(cs);
 
-    vector<CMasternode>::iterator it = vMasternodes.begin();
-    while(it != vMasternodes.end()){
-        if((*it).vin == vin){
-            if(fDebug) LogPrintf("CMasternodeMan: Removing Masternode %s - %i now\n", (*it).addr.ToString().c_str(), size() - 1);
-            vMasternodes.erase(it);
-            break;
-        }
+    CMasternode* pmn = listMasternodes.Find(vin.prevout);
+    if(pmn && pmn->vin == vin){
+        if(fDebug) LogPrintf("CMasternodeMan: Removing Masternode %s - %i now\n", pmn->addr.ToString().c_str(), size() - 1);
+        listMasternodes.Erase(vin.prevout);
+        rankCache.Clear();
     }
 }
 
@@ -981,7 +956,7 @@ std::string CMasternodeMan::ToString() const
 {
     std::ostringstream info;
 
-    info << "Masternodes: " << (int)vMasternodes.size() <<
+    info << "Masternodes: " << (int)listMasternodes.size() <<
             ", peers who asked us for Masternode list: " << (int)mAskedUsForMasternodeList.size() <<
             ", peers we asked for Masternode list: " << (int)mWeAskedForMasternodeList.size() <<
             ", entries in Masternode list we asked for: " << (int)mWeAskedForMasternodeListEntry.size() <<
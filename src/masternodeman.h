@@ -18,6 +18,11 @@
 #include "base58.h"
 #include "main.h"
 #include "masternode.h"
+#include "nodelist.h"
+#include "noderank.h"
+#include "validationinterface.h"
+
+#include <boost/function.hpp>
 
 #define MASTERNODES_DUMP_SECONDS               (15*60)
 #define MASTERNODES_DSEG_SECONDS               (3*60*60)
@@ -52,20 +57,25 @@ public:
     ReadResult Read(CMasternodeMan& m_nodemanToLoad);
 };
 
-class CMasternodeMan
+class CMasternodeMan : public CValidationInterface
 {
 private:
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
 
-    // map to hold all MNs
-    std::vector<CMasternode> vMasternodes;
+    // all MNs, indexed by collateral and by pubkey2
+    CNodeList<CMasternode, &CMasternode::pubkey2> listMasternodes;
     // who's asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
     std::map<CNetAddr, int64_t> mWeAskedForMasternodeList;
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
+    // rankings already computed for recent blocks
+    CNodeRankCache rankCache;
+
+    /// Rank the Masternodes for a block, reusing the ranking computed for it before if it is still valid
+    const CNodeRanking* GetRanking(int64_t nBlockHeight, int minProtocol, int nFilter);
 
 public:
     // keep track of dsq count to prevent masternodes from gaming darksend queue
@@ -83,7 +93,7 @@ public:
                 LOCK(cs);
                 unsigned char nVersion = 0;
                 READWRITE(nVersion);
-                READWRITE(vMasternodes);
+                READWRITE(listMasternodes);
                 READWRITE(mAskedUsForMasternodeList);
                 READWRITE(mWeAskedForMasternodeList);
                 READWRITE(mWeAskedForMasternodeListEntry);
@@ -100,6 +110,9 @@ public:
     /// Check all Masternodes
     void Check();
 
+    /// Check an entry and update the list indexes, counters and rankings if it changed
+    bool CheckEntry(CMasternode& mn);
+
     /// Check all Masternodes and remove inactive
     void CheckAndRemove();
 
@@ -125,11 +138,20 @@ public:
     CMasternode* FindRandom();
 
     /// Get the current winner for this block
-    CMasternode* GetCurrentMasterNode(int mod=1, int64_t nBlockHeight=0, int minProtocol=0);
+    CMasternode* GetCurrentMasterNode(int64_t nBlockHeight=0, int minProtocol=0);
 
-    std::vector<CMasternode> GetFullMasternodeVector() { Check(); return vMasternodes; }
+    std::vector<CMasternode> GetFullMasternodeVector()
+    {
+        Check();
+        LOCK(cs);
+        return std::vector<CMasternode>(listMasternodes.begin(), listMasternodes.end());
+    }
+
+    /// Check all Masternodes and call fn on each of them under the list lock, without copying the list
+    void ForEachMasternode(boost::function<void(CMasternode&)> fn);
 
-    std::vector<pair<int, CMasternode> > GetMasternodeRanks(int64_t nBlockHeight, int minProtocol=0);
+    /// Call fn on each enabled Masternode with its rank for the block, best first, under the list lock
+    void ForEachRankedMasternode(int64_t nBlockHeight, boost::function<void(int, CMasternode&)> fn);
     int GetMasternodeRank(const CTxIn &vin, int64_t nBlockHeight, int minProtocol=0, bool fOnlyActive=true);
     CMasternode* GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol=0, bool fOnlyActive=true);
 
@@ -138,7 +160,7 @@ public:
     void ProcessMessage(CNode* pfrom, std::string& strCommand, CDataStream& vRecv);
 
     /// Return the number of (unique) Masternodes
-    int size() { return vMasternodes.size(); }
+    int size() { return listMasternodes.size(); }
 
     /// Return the number of masternodes older than (default) 8000 seconds
     int stable_size ();
@@ -154,6 +176,9 @@ public:
 
     void Remove(CTxIn vin);
 
+    /// Drop the rankings of old blocks and rank the Masternodes for the next payment vote
+    void UpdatedBlockTip(const CBlockIndex* pindex);
+
 	// Get Masternode Protocol Version
 	int GetMinMasternodePaymentsProto();
 };
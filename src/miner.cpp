@@ -36,6 +36,8 @@
 
 #include "masternodeman.h"
 
+#include <queue>
+
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 
@@ -46,33 +48,16 @@ using namespace std;
 // VITAEMiner
 //
 
-//
-// Unconfirmed transactions in the memory pool often depend on other
-// transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
-// The COrphan class keeps track of these 'temporary orphans' while
-// CreateBlock is figuring out which transactions to include.
-//
-class COrphan
-{
-public:
-    const CTransaction* ptx;
-    set<uint256> setDependsOn;
-    CFeeRate feeRate;
-    double dPriority;
-
-    COrphan(const CTransaction* ptxIn) : ptx(ptxIn), feeRate(0), dPriority(0)
-    {
-    }
-};
+// Transactions that may be tried in a row without one fitting into a block that is almost full
+static const int MAX_CONSECUTIVE_FAILURES = 1000;
 
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
+int64_t nLastBlockTemplateMicros = 0;
 int64_t nLastCoinStakeSearchInterval = 0;
 
 // We want to sort transactions by priority and fee rate, so:
-typedef boost::tuple<double, CFeeRate, const CTransaction*> TxPriority;
+typedef boost::tuple<double, CFeeRate, CTxMemPool::txiter> TxPriority;
 class TxPriorityCompare
 {
     bool byFee;
@@ -94,6 +79,44 @@ public:
     }
 };
 
+class TxIterCompareByModFeeRate
+{
+public:
+    bool operator()(CTxMemPool::txiter a, CTxMemPool::txiter b) const
+    {
+        return CompareTxMemPoolEntryByModFeeRate()(*a, *b);
+    }
+};
+
+// Zerocoin spends have no coin age. Their priority grows with the time they
+// have waited in the mempool and with their value, so that they get into the
+// next blocks.
+static double ZerocoinSpendPriority(const CTransaction& tx, unsigned int nTxSize)
+{
+    uint256 txid = tx.GetHash();
+    int64_t nTimeSeen = GetAdjustedTime();
+    auto it = mapZerocoinspends.find(txid);
+    if (it != mapZerocoinspends.end()) {
+        nTimeSeen = it->second;
+    } else {
+        //for some reason not in map, add it
+        mapZerocoinspends[txid] = nTimeSeen;
+    }
+
+    //Priority = (age^6+100000)*amount - gives higher priority to zvits that have been in mempool long
+    //and higher priority to zvits that are large in value
+    double nConfs = 100000;
+    double nTimePriority = std::pow(GetAdjustedTime() - nTimeSeen, 6);
+    CAmount nTotalIn = tx.GetZerocoinSpent();
+    double dPriority = 0;
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        // zVITAE spends can have very large priority, use non-overflowing safe functions
+        dPriority = double_safe_addition(dPriority, (nTimePriority * nConfs));
+        dPriority = double_safe_multiplication(dPriority, nTotalIn);
+    }
+    return tx.ComputePriority(dPriority, nTxSize);
+}
+
 void UpdateTime(CBlockHeader* pblock, const CBlockIndex* pindexPrev)
 {
     if (Params().IsTimeProtocolV2(pindexPrev->nHeight+1, getTimeProtocolV2SporkValue())) {
@@ -219,181 +242,81 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
 
     {
         LOCK2(cs_main, mempool.cs);
+        int64_t nTimeStart = GetTimeMicros();
 
         CBlockIndex* pindexPrev = chainActive.Tip();
         const int nHeight = pindexPrev->nHeight + 1;
         CCoinsViewCache view(pcoinsTip);
 
-        // Priority order to process transactions
-        list<COrphan> vOrphan; // list memory doesn't move
-        map<uint256, vector<COrphan*> > mapDependers;
-        bool fPrintPriority = GetBoolArg("-printpriority", false);
-
-        // This vector will be sorted into a priority queue:
-        vector<TxPriority> vecPriority;
-        vecPriority.reserve(mempool.mapTx.size());
-        for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.mapTx.begin();
-             mi != mempool.mapTx.end(); ++mi) {
-            const CTransaction& tx = mi->second.GetTx();
-            if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, nHeight)){
-                continue;
-            }
-            if(GetAdjustedTime() > GetSporkValue(SPORK_20_ZEROCOIN_MAINTENANCE_MODE) && tx.ContainsZerocoins()){
-                continue;
-            }
-
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            CAmount nTotalIn = 0;
-            bool fMissingInputs = false;
-            uint256 txid = tx.GetHash();
-            for (const CTxIn& txin : tx.vin) {
-                //zerocoinspend has special vin
-                if (tx.IsZerocoinSpend()) {
-                    nTotalIn = tx.GetZerocoinSpent();
-
-                    //Give a high priority to zerocoinspends to get into the next block
-                    //Priority = (age^6+100000)*amount - gives higher priority to zvits that have been in mempool long
-                    //and higher priority to zvits that are large in value
-                    int64_t nTimeSeen = GetAdjustedTime();
-                    double nConfs = 100000;
-
-                    auto it = mapZerocoinspends.find(txid);
-                    if (it != mapZerocoinspends.end()) {
-                        nTimeSeen = it->second;
-                    } else {
-                        //for some reason not in map, add it
-                        mapZerocoinspends[txid] = nTimeSeen;
-                    }
-
-                    double nTimePriority = std::pow(GetAdjustedTime() - nTimeSeen, 6);
-
-                    // zVITAE spends can have very large priority, use non-overflowing safe functions
-                    dPriority = double_safe_addition(dPriority, (nTimePriority * nConfs));
-                    dPriority = double_safe_multiplication(dPriority, nTotalIn);
-
-                    continue;
-                }
+        // Normally done when the tip's block left its transactions in the pool
+        mempool.UpdatePriorities(nHeight);
 
-                // Read prev transaction
-                if (!view.HaveCoins(txin.prevout.hash)) {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    if (!mempool.mapTx.count(txin.prevout.hash)) {
-                        LogPrintf("ERROR: mempool transaction missing input\n");
-                        if (fDebug) assert("mempool transaction missing input" == 0);
-                        fMissingInputs = true;
-                        if (porphan)
-                            vOrphan.pop_back();
-                        break;
-                    }
-
-                    // Has to wait for dependencies
-                    if (!porphan) {
-                        // Use list for automatic deletion
-                        vOrphan.push_back(COrphan(&tx));
-                        porphan = &vOrphan.back();
-                    }
-                    mapDependers[txin.prevout.hash].push_back(porphan);
-                    porphan->setDependsOn.insert(txin.prevout.hash);
-                    nTotalIn += mempool.mapTx[txin.prevout.hash].GetTx().vout[txin.prevout.n].nValue;
-                    continue;
-                }
-
-                //Check for invalid/fraudulent inputs. They shouldn't make it through mempool, but check anyways.
-                if (invalid_out::ContainsOutPoint(txin.prevout)) {
-                    LogPrintf("%s : found invalid input %s in tx %s", __func__, txin.prevout.ToString(), tx.GetHash().ToString());
-                    fMissingInputs = true;
-                    break;
-                }
-
-                const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-                assert(coins);
-
-                CAmount nValueIn = coins->vout[txin.prevout.n].nValue;
-                nTotalIn += nValueIn;
-
-                int nConf = nHeight - coins->nHeight;
-
-                // zVITAE spends can have very large priority, use non-overflowing safe functions
-                dPriority = double_safe_addition(dPriority, ((double)nValueIn * nConf));
-
-            }
-            if (fMissingInputs) continue;
-
-            // Priority is sum(valuein * age) / modified_txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            dPriority = tx.ComputePriority(dPriority, nTxSize);
-
-            uint256 hash = tx.GetHash();
-            mempool.ApplyDeltas(hash, dPriority, nTotalIn);
-
-            CFeeRate feeRate(nTotalIn - tx.GetValueOut(), nTxSize);
-
-            if (porphan) {
-                porphan->dPriority = dPriority;
-                porphan->feeRate = feeRate;
-            } else
-                vecPriority.push_back(TxPriority(dPriority, feeRate, &mi->second.GetTx()));
-        }
+        bool fPrintPriority = GetBoolArg("-printpriority", false);
 
         // Collect transactions into block
         uint64_t nBlockSize = 1000;
         uint64_t nBlockTx = 0;
         int nBlockSigOps = 100;
-        bool fSortedByFee = (nBlockPrioritySize <= 0);
-
-        TxPriorityCompare comparer(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-
+        unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
         vector<CBigNum> vBlockSerials;
-        vector<CBigNum> vTxSerials;
-        while (!vecPriority.empty()) {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            CFeeRate feeRate = vecPriority.front().get<1>();
-            const CTransaction& tx = *(vecPriority.front().get<2>());
 
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
+        // Unconfirmed transactions in the memory pool often depend on other
+        // transactions in the memory pool. A transaction whose parent is not
+        // in the block yet waits in mapDependers until the parent gets in.
+        set<uint256> setInBlock;
+        map<uint256, vector<CTxMemPool::txiter> > mapDependers;
+
+        auto fIsCandidate = [&](const CTransaction& tx) {
+            if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, nHeight))
+                return false;
+            if (GetAdjustedTime() > GetSporkValue(SPORK_20_ZEROCOIN_MAINTENANCE_MODE) && tx.ContainsZerocoins())
+                return false;
+            return !setInBlock.count(tx.GetHash());
+        };
+
+        auto fWaitsForParent = [&](CTxMemPool::txiter iter) {
+            const CTransaction& tx = iter->GetTx();
+            if (tx.IsZerocoinSpend())
+                return false;
+            for (const CTxIn& txin : tx.vin) {
+                if (mempool.mapTx.count(txin.prevout.hash) && !setInBlock.count(txin.prevout.hash)) {
+                    mapDependers[txin.prevout.hash].push_back(iter);
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        auto addTx = [&](CTxMemPool::txiter iter, double dPriority, const CFeeRate& feeRate) {
+            const CTransaction& tx = iter->GetTx();
 
             // Size limits
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            unsigned int nTxSize = iter->GetTxSize();
             if (nBlockSize + nTxSize >= nBlockMaxSize)
-                continue;
+                return false;
 
             // Legacy limits on sigOps:
-            unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
             unsigned int nTxSigOps = GetLegacySigOpCount(tx);
             if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps)
-                continue;
+                return false;
 
-            // Skip free transactions if we're past the minimum block size:
-            const uint256& hash = tx.GetHash();
-            double dPriorityDelta = 0;
-            CAmount nFeeDelta = 0;
-            mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
-            if (!tx.IsZerocoinSpend() && fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
-                continue;
+            if (!view.HaveInputs(tx))
+                return false;
 
-            // Prioritise by fee once past the priority size or we run out of high-priority
-            // transactions:
-            if (!fSortedByFee &&
-                ((nBlockSize + nTxSize >= nBlockPrioritySize) || !AllowFree(dPriority))) {
-                fSortedByFee = true;
-                comparer = TxPriorityCompare(fSortedByFee);
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+            //Check for invalid/fraudulent inputs. They shouldn't make it through mempool, but check anyways.
+            for (const CTxIn& txin : tx.vin) {
+                if (!tx.IsZerocoinSpend() && invalid_out::ContainsOutPoint(txin.prevout)) {
+                    LogPrintf("%s : found invalid input %s in tx %s", __func__, txin.prevout.ToString(), tx.GetHash().ToString());
+                    return false;
+                }
             }
 
-            if (!view.HaveInputs(tx))
-                continue;
-
             // double check that there are no double spent zVITAE spends in this block or tx
+            vector<CBigNum> vTxSerials;
             if (tx.IsZerocoinSpend()) {
                 int nHeightTx = 0;
                 if (IsTransactionInChain(tx.GetHash(), nHeightTx))
-                    continue;
+                    return false;
 
                 bool fDoubleSerial = false;
                 for (const CTxIn txIn : tx.vin) {
@@ -413,24 +336,23 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
                 }
                 //This zVITAE serial has already been included in the block, do not add this tx.
                 if (fDoubleSerial)
-                    continue;
+                    return false;
             }
 
             CAmount nTxFees = view.GetValueIn(tx) - tx.GetValueOut();
-
             if(nTxFees > FUNDAMENTALNODE_AMOUNT)
                 nTxFees = nTxFees - FUNDAMENTALNODE_AMOUNT;
 
             nTxSigOps += GetP2SHSigOpCount(tx, view);
             if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps)
-                continue;
+                return false;
 
-            // Note that flags: we don't want to set mempool/IsStandard()
-            // policy here, but we still have to ensure that the block we
-            // create only contains transactions that are valid in new blocks.
+            // Scripts are checked here as well, an entry that fails them is skipped rather than failing
+            // the whole block in TestBlockValidity. Every entry, mempool.dat ones included, was checked
+            // on the way into the mempool by this process, so the signature cache makes this cheap.
             CValidationState state;
             if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
-                continue;
+                return false;
 
             CTxUndo txundo;
             UpdateCoins(tx, state, view, txundo, nHeight);
@@ -443,6 +365,7 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
             ++nBlockTx;
             nBlockSigOps += nTxSigOps;
             nFees += nTxFees;
+            setInBlock.insert(tx.GetHash());
 
             for (const CBigNum bnSerial : vTxSerials)
                 vBlockSerials.emplace_back(bnSerial);
@@ -451,19 +374,142 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
                 LogPrintf("priority %.1f fee %s txid %s\n",
                     dPriority, feeRate.ToString(), tx.GetHash().ToString());
             }
+            return true;
+        };
+
+        // The transactions that were waiting for hash and have no other parent to wait for
+        auto releaseDependers = [&](const uint256& hash, vector<CTxMemPool::txiter>& vReady) {
+            map<uint256, vector<CTxMemPool::txiter> >::iterator it = mapDependers.find(hash);
+            if (it == mapDependers.end())
+                return;
+            vector<CTxMemPool::txiter> vWaiting;
+            vWaiting.swap(it->second);
+            mapDependers.erase(it);
+            for (CTxMemPool::txiter iter : vWaiting) {
+                if (!setInBlock.count(iter->GetTx().GetHash()) && !fWaitsForParent(iter))
+                    vReady.push_back(iter);
+            }
+        };
 
-            // Add transactions that depend on this one to the priority queue
-            if (mapDependers.count(hash)) {
-                BOOST_FOREACH (COrphan* porphan, mapDependers[hash]) {
-                    if (!porphan->setDependsOn.empty()) {
-                        porphan->setDependsOn.erase(hash);
-                        if (porphan->setDependsOn.empty()) {
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                        }
+        auto getPriority = [&](CTxMemPool::txiter iter) {
+            const CTransaction& tx = iter->GetTx();
+            double dPriority = tx.IsZerocoinSpend() ? ZerocoinSpendPriority(tx, iter->GetTxSize()) : iter->GetPriority(nHeight);
+            double dPriorityDelta = 0;
+            CAmount nFeeDelta = 0;
+            mempool.ApplyDeltas(tx.GetHash(), dPriorityDelta, nFeeDelta);
+            return TxPriority(dPriority + dPriorityDelta, CFeeRate(iter->GetModifiedFee(), iter->GetTxSize()), iter);
+        };
+
+        // Fill the space for high-priority transactions, which are included
+        // regardless of the fees they pay, walking the mempool priority index
+        // from the top. Transactions whose parents got into the block
+        // meanwhile are merged in by the same order.
+        if (nBlockPrioritySize > 0) {
+            typedef indexed_transaction_set::index<mining_priority>::type::reverse_iterator priority_iter;
+            priority_iter itPriority = mempool.mapTx.get<mining_priority>().rbegin();
+            const priority_iter itPriorityEnd = mempool.mapTx.get<mining_priority>().rend();
+            TxPriorityCompare comparer(false);
+            vector<TxPriority> vecReleased;
+            TxPriority nextFromIndex;
+            bool fHaveNextFromIndex = false;
+            while (true) {
+                if (!fHaveNextFromIndex && itPriority != itPriorityEnd) {
+                    nextFromIndex = getPriority(mempool.mapTx.project<0>(std::prev(itPriority.base())));
+                    ++itPriority;
+                    fHaveNextFromIndex = true;
+                }
+
+                // Take the highest priority transaction of the two
+                TxPriority next;
+                if (fHaveNextFromIndex && (vecReleased.empty() || !comparer(nextFromIndex, vecReleased.front()))) {
+                    next = nextFromIndex;
+                    fHaveNextFromIndex = false;
+                } else if (!vecReleased.empty()) {
+                    next = vecReleased.front();
+                    std::pop_heap(vecReleased.begin(), vecReleased.end(), comparer);
+                    vecReleased.pop_back();
+                } else {
+                    break;
+                }
+                double dPriority = next.get<0>();
+                CFeeRate feeRate = next.get<1>();
+                CTxMemPool::txiter iter = next.get<2>();
+
+                // Prioritise by fee once past the priority size or we run out of high-priority
+                // transactions
+                if ((nBlockSize + iter->GetTxSize() >= nBlockPrioritySize) || !AllowFree(dPriority))
+                    break;
+
+                if (!fIsCandidate(iter->GetTx()) || fWaitsForParent(iter) || !addTx(iter, dPriority, feeRate))
+                    continue;
+
+                vector<CTxMemPool::txiter> vReady;
+                releaseDependers(iter->GetTx().GetHash(), vReady);
+                for (CTxMemPool::txiter iterReady : vReady) {
+                    vecReleased.push_back(getPriority(iterReady));
+                    std::push_heap(vecReleased.begin(), vecReleased.end(), comparer);
+                }
+            }
+        }
+
+        // Fill the rest of the block by modified fee rate, walking the mempool
+        // index from the top. Transactions whose parents got into the block
+        // meanwhile are merged in by the same order.
+        typedef indexed_transaction_set::index<modified_feerate>::type::reverse_iterator feerate_iter;
+        feerate_iter itFee = mempool.mapTx.get<modified_feerate>().rbegin();
+        const feerate_iter itFeeEnd = mempool.mapTx.get<modified_feerate>().rend();
+        std::priority_queue<CTxMemPool::txiter, vector<CTxMemPool::txiter>, TxIterCompareByModFeeRate> clearedTxs;
+        int nConsecutiveFailed = 0;
+        while (itFee != itFeeEnd || !clearedTxs.empty()) {
+            CTxMemPool::txiter iter;
+            bool fFromIndex = itFee != itFeeEnd && (clearedTxs.empty() || CompareTxMemPoolEntryByModFeeRate()(*clearedTxs.top(), *itFee));
+            if (fFromIndex) {
+                iter = mempool.mapTx.project<0>(std::prev(itFee.base()));
+                ++itFee;
+                if (!fIsCandidate(iter->GetTx()) || fWaitsForParent(iter))
+                    continue;
+            } else {
+                iter = clearedTxs.top();
+                clearedTxs.pop();
+                if (!fIsCandidate(iter->GetTx()))
+                    continue;
+            }
+
+            const CTransaction& tx = iter->GetTx();
+            unsigned int nTxSize = iter->GetTxSize();
+            CFeeRate feeRate(iter->GetModifiedFee(), nTxSize);
+
+            // Skip free transactions if we're past the minimum block size:
+            double dPriorityDelta = 0;
+            CAmount nFeeDelta = 0;
+            mempool.ApplyDeltas(tx.GetHash(), dPriorityDelta, nFeeDelta);
+            if (!tx.IsZerocoinSpend() && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize)) {
+                // Everything further down the index pays less still, so stop walking
+                // it and only take the transactions exempt from the relay fee
+                if (fFromIndex) {
+                    itFee = itFeeEnd;
+                    vector<CTxMemPool::txiter> vExempt;
+                    mempool.GetMinFeeExempt(::minRelayTxFee, vExempt);
+                    for (CTxMemPool::txiter iterExempt : vExempt) {
+                        if (CompareTxMemPoolEntryByModFeeRate()(*iterExempt, *iter) && fIsCandidate(iterExempt->GetTx()) && !fWaitsForParent(iterExempt))
+                            clearedTxs.push(iterExempt);
                     }
                 }
+                continue;
             }
+
+            if (!addTx(iter, iter->GetPriority(nHeight), feeRate)) {
+                // Stop looking once the block is close to full and nothing fits any more
+                if (nBlockSize + 4000 > nBlockMaxSize && ++nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES)
+                    break;
+                continue;
+            }
+            nConsecutiveFailed = 0;
+
+            vector<CTxMemPool::txiter> vReady;
+            releaseDependers(tx.GetHash(), vReady);
+            for (CTxMemPool::txiter iterReady : vReady)
+                clearedTxs.push(iterReady);
         }
 
         if (!fProofOfStake) {
@@ -530,6 +576,8 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
             mempool.clear();
             return NULL;
         }
+        nLastBlockTemplateMicros = GetTimeMicros() - nTimeStart;
+        LogPrint("bench", "CreateNewBlock(): %u transactions in %.2fms\n", nBlockTx, nLastBlockTemplateMicros * 0.001);
 
 //        if (pblock->IsZerocoinStake()) {
 //            CWalletTx wtx(pwalletMain, pblock->vtx[1]);
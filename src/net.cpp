@@ -28,6 +28,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -76,6 +80,7 @@ struct ListenSocket {
 //
 bool fDiscover = true;
 bool fListen = true;
+bool fSocketEventsEpoll = false;
 uint64_t nLocalServices = NODE_NETWORK;
 CCriticalSection cs_mapLocalHost;
 map<CNetAddr, LocalServiceInfo> mapLocalHost;
@@ -83,6 +88,11 @@ static bool vfLimited[NET_MAX] = {};
 static CNode* pnodeLocalHost = NULL;
 uint64_t nLocalHostNonce = 0;
 static std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+// epoll instance of the socket handler, -1 while sockets are select()ed
+static int hEpoll = -1;
+#endif
+static void RegisterSocketEvents(CNode* pnode);
 CAddrMan addrman;
 int nMaxConnections = 125;
 bool fAddressesInitialized = false;
@@ -108,6 +118,11 @@ CCriticalSection cs_nLastNodeId;
 
 static CSemaphore* semOutbound = NULL;
 boost::condition_variable messageHandlerCondition;
+// Shared by the threads waiting on messageHandlerCondition, only held while waiting
+static boost::mutex messageHandlerMutex;
+
+static map<string, CMessageStats> mapMessageStats;
+static CCriticalSection cs_mapMessageStats;
 
 // Signals for message handling
 static CNodeSignals g_signals;
@@ -429,6 +444,7 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest, bool obfuScationMa
         {
             LOCK(cs_vNodes);
             vNodes.push_back(pnode);
+            RegisterSocketEvents(pnode);
         }
 
         pnode->nTimeConnected = GetTime();
@@ -705,6 +721,34 @@ void CNode::copyStats(CNodeStats& stats)
 }
 #undef X
 
+/** Commands that have message stats of their own, anything else a peer sends is counted as "other" */
+static const char* ppszMessageStatsCommands[] = {
+    "version", "verack", "addr", "inv", "getdata", "getblocks", "getheaders", "headers", "tx", "block",
+    "getaddr", "mempool", "ping", "pong", "alert", "filterload", "filteradd", "filterclear", "reject", "notfound",
+    "spork", "getsporks", "ix", "txlvote", "ssc", "dstx",
+    "dsa", "dsc", "dsf", "dsi", "dsq", "dss", "dssu",
+    "dsee", "dseep", "dseg", "mnget", "mnw", "mnse", "mnvs", "mprop", "mvote", "fbs", "fbvote",
+    "fnb", "fnp", "obsee", "obseep", "obseg", "fnget", "fnw", "fnvs", "fprop", "fvote"};
+
+void RecordMessageStats(const string& strCommand, int64_t nWaitTime, int64_t nProcessTime)
+{
+    static const set<string> setCommands(ppszMessageStatsCommands, ppszMessageStatsCommands + ARRAYLEN(ppszMessageStatsCommands));
+    const string& strKey = setCommands.count(strCommand) ? strCommand : "other";
+
+    LOCK(cs_mapMessageStats);
+    CMessageStats& stats = mapMessageStats[strKey];
+    stats.nCount++;
+    stats.nWaitTime += nWaitTime;
+    stats.nProcessTime += nProcessTime;
+    stats.nMaxProcessTime = max(stats.nMaxProcessTime, nProcessTime);
+}
+
+map<string, CMessageStats> GetMessageStats()
+{
+    LOCK(cs_mapMessageStats);
+    return mapMessageStats;
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes)
 {
@@ -736,7 +780,7 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes)
 
         if (msg.complete()) {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            messageHandlerCondition.notify_all();
         }
     }
 
@@ -835,9 +879,387 @@ void SocketSendData(CNode* pnode)
 
 static list<CNode*> vNodesDisconnected;
 
+/** Watch the socket of pnode for events, if they are waited for with epoll. Requires cs_vNodes. */
+static void RegisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (hEpoll == -1)
+        return;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, pnode->hSocket, &event) == SOCKET_ERROR) {
+        LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+        pnode->CloseSocketDisconnect();
+    }
+#endif
+}
+
+static void AcceptConnection(const ListenSocket& hListenSocket)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
+    CAddress addr;
+    int nInbound = 0;
+
+    if (hSocket != INVALID_SOCKET)
+        if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+            LogPrintf("Warning: Unknown socket family\n");
+
+    bool whitelisted = hListenSocket.whitelisted || CNode::IsWhitelistedRange(addr);
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodes)
+            if (pnode->fInbound)
+                nInbound++;
+    }
+
+    if (hSocket == INVALID_SOCKET) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK)
+            LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
+    } else if (!fSocketEventsEpoll && !IsSelectableSocket(hSocket)) {
+        LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
+        CloseSocket(hSocket);
+    } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
+        LogPrint("net", "connection from %s dropped (full)\n", addr.ToString());
+        CloseSocket(hSocket);
+    } else if (CNode::IsBanned(addr) && !whitelisted) {
+        LogPrintf("connection from %s dropped (banned)\n", addr.ToString());
+        CloseSocket(hSocket);
+    } else {
+        CNode* pnode = new CNode(hSocket, addr, "", true);
+        pnode->AddRef();
+        pnode->fWhitelisted = whitelisted;
+
+        {
+            LOCK(cs_vNodes);
+            vNodes.push_back(pnode);
+            RegisterSocketEvents(pnode);
+        }
+    }
+}
+
+// requires LOCK(cs_vRecvMsg)
+static bool CanReceiveData(CNode* pnode)
+{
+    return pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
+           pnode->GetTotalRecvSize() <= ReceiveFloodSize();
+}
+
+/**
+ * Read once from the socket of pnode into its receive buffer, disconnecting
+ * it on errors. Returns what recv() did.
+ */
+// requires LOCK(cs_vRecvMsg)
+static int SocketRecvData(CNode* pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0) {
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+            pnode->CloseSocketDisconnect();
+        pnode->nLastRecv = GetTime();
+        pnode->nRecvBytes += nBytes;
+        pnode->RecordBytesRecv(nBytes);
+    } else if (nBytes == 0) {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    } else if (nBytes < 0) {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return nBytes;
+}
+
+static void InactivityCheck(CNode* pnode)
+{
+    int64_t nTime = GetTime();
+    if (nTime - pnode->nTimeConnected > 60) {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        } else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90 * 60)) {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        } else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros()) {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+/** Wait for socket events with select() and service every socket that has one */
+static void SocketHandlerSelect()
+{
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = max(hSocketMax, hListenSocket.socket);
+        have_fds = true;
+    }
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodes) {
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = max(hSocketMax, pnode->hSocket);
+            have_fds = true;
+
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is no (complete) message in the receive buffer,
+            //   or there is space left in the buffer, select() for receiving data.
+            // * (if neither of the above applies, there is certainly one message
+            //   in the receiver buffer ready to be processed).
+            // Together, that means that at least one of the following is always possible,
+            // so we don't deadlock:
+            // * We send some data.
+            // * We wait for data to be received (and disconnect after timeout).
+            // * We process a message in the buffer (message handler thread).
+            {
+                TRY_LOCK(pnode->cs_vSend, lockSend);
+                if (lockSend && !pnode->vSendMsg.empty()) {
+                    FD_SET(pnode->hSocket, &fdsetSend);
+                    continue;
+                }
+            }
+            {
+                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                if (lockRecv && CanReceiveData(pnode))
+                    FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+        &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    boost::this_thread::interruption_point();
+
+    if (nSelect == SOCKET_ERROR) {
+        if (have_fds) {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        MilliSleep(timeout.tv_usec / 1000);
+    }
+
+    //
+    // Accept new connections
+    //
+    BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
+        if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            AcceptConnection(hListenSocket);
+    }
+
+    //
+    // Service each socket
+    //
+    vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        vNodesCopy = vNodes;
+        BOOST_FOREACH (CNode* pnode, vNodesCopy)
+            pnode->AddRef();
+    }
+    BOOST_FOREACH (CNode* pnode, vNodesCopy) {
+        boost::this_thread::interruption_point();
+
+        //
+        // Receive
+        //
+        if (pnode->hSocket == INVALID_SOCKET)
+            continue;
+        if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError)) {
+            TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+            if (lockRecv)
+                SocketRecvData(pnode);
+        }
+
+        //
+        // Send
+        //
+        if (pnode->hSocket == INVALID_SOCKET)
+            continue;
+        if (FD_ISSET(pnode->hSocket, &fdsetSend)) {
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (lockSend)
+                SocketSendData(pnode);
+        }
+
+        //
+        // Inactivity checking
+        //
+        InactivityCheck(pnode);
+    }
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodesCopy)
+            pnode->Release();
+    }
+}
+
+#ifdef USE_EPOLL
+/**
+ * Wait for socket events with epoll and service the sockets that became
+ * ready. Events are edge-triggered: a node stays in setReady until its
+ * socket has been read until it would block and, if it became writable,
+ * its send buffer has been flushed, so only sockets with something to do
+ * are looked at. A node that is locked by a message handler, which can
+ * take as long as validating a block, stays in setReady and is looked at
+ * again after the next wait rather than polled for.
+ */
+static void SocketHandlerEpoll(std::set<CNode*>& setReady, int64_t& nLastInactivityCheck)
+{
+    struct epoll_event events[1024];
+
+    // frequency to look at disconnected nodes and full receive buffers
+    int nEvents = epoll_wait(hEpoll, events, ARRAYLEN(events), 50);
+    boost::this_thread::interruption_point();
+
+    if (nEvents == SOCKET_ERROR) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            MilliSleep(50);
+        }
+        nEvents = 0;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const ListenSocket* pListenSocket = NULL;
+        BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket)
+            if (events[i].data.ptr == &hListenSocket)
+                pListenSocket = &hListenSocket;
+
+        //
+        // Accept new connections
+        //
+        if (pListenSocket != NULL) {
+            AcceptConnection(*pListenSocket);
+            continue;
+        }
+
+        CNode* pnode = (CNode*)events[i].data.ptr;
+        if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+            pnode->fSocketRecvReady = true;
+        if (events[i].events & EPOLLOUT)
+            pnode->fSocketSendReady = true;
+        setReady.insert(pnode);
+    }
+
+    //
+    // Service each socket with an event
+    //
+    vector<CNode*> vNodesReady(setReady.begin(), setReady.end());
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodesReady)
+            pnode->AddRef();
+    }
+    BOOST_FOREACH (CNode* pnode, vNodesReady) {
+        boost::this_thread::interruption_point();
+
+        if (pnode->hSocket == INVALID_SOCKET) {
+            setReady.erase(pnode);
+            continue;
+        }
+
+        //
+        // Send
+        //
+        if (pnode->fSocketSendReady) {
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (lockSend) {
+                if (!pnode->vSendMsg.empty())
+                    SocketSendData(pnode);
+                pnode->fSocketSendReady = false;
+            }
+        }
+
+        //
+        // Receive, until the socket would block. As with select(), data
+        // waiting to be sent is flushed before receiving more.
+        //
+        if (pnode->fSocketRecvReady) {
+            TRY_LOCK(pnode->cs_vSend, lockSend);
+            if (lockSend && pnode->vSendMsg.empty()) {
+                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                while (lockRecv && CanReceiveData(pnode)) {
+                    if (SocketRecvData(pnode) <= 0) {
+                        pnode->fSocketRecvReady = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (!pnode->fSocketRecvReady && !pnode->fSocketSendReady)
+            setReady.erase(pnode);
+    }
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodesReady)
+            pnode->Release();
+    }
+
+    //
+    // Inactivity checking
+    //
+    int64_t nTime = GetTime();
+    if (nTime != nLastInactivityCheck) {
+        nLastInactivityCheck = nTime;
+        LOCK(cs_vNodes);
+        BOOST_FOREACH (CNode* pnode, vNodes)
+            InactivityCheck(pnode);
+    }
+}
+#endif
+
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    // nodes with socket events not acted on yet, for epoll
+    std::set<CNode*> setReady;
+    int64_t nLastInactivityCheck = 0;
     while (true) {
         //
         // Disconnect nodes
@@ -885,6 +1307,7 @@ void ThreadSocketHandler()
                     }
                     if (fDelete) {
                         vNodesDisconnected.remove(pnode);
+                        setReady.erase(pnode);
                         delete pnode;
                     }
                 }
@@ -900,218 +1323,13 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH (CNode* pnode, vNodes) {
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
-                {
-                    TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
-                                        pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-            &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        boost::this_thread::interruption_point();
-
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
-        }
-
-        //
-        // Accept new connections
-        //
-        BOOST_FOREACH (const ListenSocket& hListenSocket, vhListenSocket) {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv)) {
-                struct sockaddr_storage sockaddr;
-                socklen_t len = sizeof(sockaddr);
-                SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
-                CAddress addr;
-                int nInbound = 0;
-
-                if (hSocket != INVALID_SOCKET)
-                    if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
-                        LogPrintf("Warning: Unknown socket family\n");
-
-                bool whitelisted = hListenSocket.whitelisted || CNode::IsWhitelistedRange(addr);
-                {
-                    LOCK(cs_vNodes);
-                    BOOST_FOREACH (CNode* pnode, vNodes)
-                        if (pnode->fInbound)
-                            nInbound++;
-                }
-
-                if (hSocket == INVALID_SOCKET) {
-                    int nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK)
-                        LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
-                } else if (!IsSelectableSocket(hSocket)) {
-                    LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
-                    CloseSocket(hSocket);
-                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
-                    LogPrint("net", "connection from %s dropped (full)\n", addr.ToString());
-                    CloseSocket(hSocket);
-                } else if (CNode::IsBanned(addr) && !whitelisted) {
-                    LogPrintf("connection from %s dropped (banned)\n", addr.ToString());
-                    CloseSocket(hSocket);
-                } else {
-                    CNode* pnode = new CNode(hSocket, addr, "", true);
-                    pnode->AddRef();
-                    pnode->fWhitelisted = whitelisted;
-
-                    {
-                        LOCK(cs_vNodes);
-                        vNodes.push_back(pnode);
-                    }
-                }
-            }
-        }
-
-        //
-        // Service each socket
-        //
-        vector<CNode*> vNodesCopy;
-        {
-            LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            BOOST_FOREACH (CNode* pnode, vNodesCopy)
-                pnode->AddRef();
-        }
-        BOOST_FOREACH (CNode* pnode, vNodesCopy) {
-            boost::this_thread::interruption_point();
-
-            //
-            // Receive
-            //
-            if (pnode->hSocket == INVALID_SOCKET)
-                continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError)) {
-                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0) {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pnode->CloseSocketDisconnect();
-                            pnode->nLastRecv = GetTime();
-                            pnode->nRecvBytes += nBytes;
-                            pnode->RecordBytesRecv(nBytes);
-                        } else if (nBytes == 0) {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        } else if (nBytes < 0) {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
-
-            //
-            // Send
-            //
-            if (pnode->hSocket == INVALID_SOCKET)
-                continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend)) {
-                TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
-                    SocketSendData(pnode);
-            }
-
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetTime();
-            if (nTime - pnode->nTimeConnected > 60) {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0) {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                } else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL) {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                } else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90 * 60)) {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                } else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros()) {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-            }
-        }
-        {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH (CNode* pnode, vNodesCopy)
-                pnode->Release();
+#ifdef USE_EPOLL
+        if (hEpoll != -1) {
+            SocketHandlerEpoll(setReady, nLastInactivityCheck);
+            continue;
         }
+#endif
+        SocketHandlerSelect();
     }
 }
 
@@ -1494,9 +1712,6 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant* grantOu
 
 void ThreadMessageHandler()
 {
-    boost::mutex condition_mutex;
-    boost::unique_lock<boost::mutex> lock(condition_mutex);
-
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         vector<CNode*> vNodesCopy;
@@ -1522,37 +1737,99 @@ void ThreadMessageHandler()
             // Receive messages
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    if (!g_signals.ProcessMessages(pnode))
-                        pnode->CloseSocketDisconnect();
+                if (!lockRecv)
+                    continue;
 
-                    if (pnode->nSendSize < SendBufferSize()) {
-                        if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete())) {
-                            fSleep = false;
-                        }
+                if (!g_signals.ProcessMessages(pnode, false))
+                    pnode->CloseSocketDisconnect();
+
+                if (pnode->nSendSize < SendBufferSize()) {
+                    if (!pnode->vRecvGetData.empty() || (!pnode->vRecvMsg.empty() && pnode->vRecvMsg[0].complete())) {
+                        fSleep = false;
                     }
                 }
+                boost::this_thread::interruption_point();
+
+                // Send messages, still holding cs_vRecvMsg so the message workers
+                // don't change the ping state of this node underneath
+                {
+                    TRY_LOCK(pnode->cs_vSend, lockSend);
+                    if (lockSend)
+                        g_signals.SendMessages(pnode, pnode == pnodeTrickle || pnode->fWhitelisted);
+                }
             }
             boost::this_thread::interruption_point();
+        }
+
+
+        {
+            LOCK(cs_vNodes);
+            BOOST_FOREACH (CNode* pnode, vNodesCopy)
+                pnode->Release();
+        }
+
+        if (fSleep) {
+            boost::unique_lock<boost::mutex> lock(messageHandlerMutex);
+            messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+        }
+    }
+}
+
+/**
+ * Message worker: handles the messages that don't need cs_main for the
+ * nodes assigned to it, while ThreadMessageHandler may be busy validating.
+ * Both take messages off the front of a node's queue under cs_vRecvMsg, so
+ * every node's messages are still processed in the order they arrived.
+ */
+void ThreadMessageWorker(int nWorker, int nWorkers)
+{
+    while (true) {
+        vector<CNode*> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            BOOST_FOREACH (CNode* pnode, vNodes) {
+                if (pnode->id % nWorkers == nWorker) {
+                    pnode->AddRef();
+                    vNodesCopy.push_back(pnode);
+                }
+            }
+        }
+
+        bool fSleep = true;
+
+        BOOST_FOREACH (CNode* pnode, vNodesCopy) {
+            if (pnode->fDisconnect)
+                continue;
 
-            // Send messages
             {
-                TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
-                    g_signals.SendMessages(pnode, pnode == pnodeTrickle || pnode->fWhitelisted);
+                TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
+                if (!lockRecv)
+                    continue;
+
+                size_t nQueued = pnode->vRecvMsg.size();
+                if (!g_signals.ProcessMessages(pnode, true))
+                    pnode->CloseSocketDisconnect();
+
+                if (pnode->vRecvMsg.size() < nQueued) {
+                    fSleep = false;
+                    // the next message may be one for the validation thread
+                    if (!pnode->vRecvMsg.empty())
+                        messageHandlerCondition.notify_all();
+                }
             }
             boost::this_thread::interruption_point();
         }
 
-
         {
             LOCK(cs_vNodes);
             BOOST_FOREACH (CNode* pnode, vNodesCopy)
                 pnode->Release();
         }
 
-        if (fSleep)
+        if (fSleep) {
+            boost::unique_lock<boost::mutex> lock(messageHandlerMutex);
             messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+        }
     }
 }
 
@@ -1756,6 +2033,26 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Map ports with UPnP
     MapPort(GetBoolArg("-upnp", DEFAULT_UPNP));
 
+#ifdef USE_EPOLL
+    if (fSocketEventsEpoll && hEpoll == -1) {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (hEpoll == -1) {
+            LogPrintf("socket epoll_create error %s, using select\n", NetworkErrorString(WSAGetLastError()));
+            fSocketEventsEpoll = false;
+        }
+        BOOST_FOREACH (ListenSocket& hListenSocket, vhListenSocket) {
+            if (hEpoll == -1)
+                break;
+            // level-triggered, connections are accepted one at a time
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hListenSocket.socket, &event) == SOCKET_ERROR)
+                LogPrintf("socket epoll_ctl error %s\n", NetworkErrorString(WSAGetLastError()));
+        }
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
@@ -1768,6 +2065,12 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Process messages
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
 
+    int nMessageWorkers = std::max(0, std::min((int)GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS), MAX_MSGHANDLER_THREADS));
+    LogPrintf("Using %d message worker threads\n", nMessageWorkers);
+    for (int i = 0; i < nMessageWorkers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "msgwork",
+            CScheduler::Function(boost::bind(&ThreadMessageWorker, i, nMessageWorkers))));
+
     // Dump network addresses
     scheduler.scheduleEvery(&DumpData, DUMP_ADDRESSES_INTERVAL);
 
@@ -1807,6 +2110,12 @@ public:
             if (hListenSocket.socket != INVALID_SOCKET)
                 if (!CloseSocket(hListenSocket.socket))
                     LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+        if (hEpoll != -1) {
+            close(hEpoll);
+            hEpoll = -1;
+        }
+#endif
 
         // clean up some globals (to help leak detection)
         BOOST_FOREACH (CNode* pnode, vNodes)
@@ -2073,6 +2382,8 @@ CNode::CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn, bool fIn
     fNetworkNode = false;
     fSuccessfullyConnected = false;
     fDisconnect = false;
+    fSocketRecvReady = false;
+    fSocketSendReady = false;
     nRefCount = 0;
     nSendSize = 0;
     nSendOffset = 0;
@@ -61,6 +61,16 @@ static const bool DEFAULT_UPNP = USE_UPNP;
 #else
 static const bool DEFAULT_UPNP = false;
 #endif
+/** -socketevents default */
+#ifdef USE_EPOLL
+static const char* const DEFAULT_SOCKETEVENTS = "epoll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
+/** -msghandlerthreads default, the message workers that run next to the validation thread */
+static const int DEFAULT_MSGHANDLER_THREADS = 2;
+/** Maximum number of message workers */
+static const int MAX_MSGHANDLER_THREADS = 16;
 /** The maximum number of entries in mapAskFor */
 static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 
@@ -88,7 +98,7 @@ typedef int NodeId;
 // Signals for message handling
 struct CNodeSignals {
     boost::signals2::signal<int()> GetHeight;
-    boost::signals2::signal<bool(CNode*)> ProcessMessages;
+    boost::signals2::signal<bool(CNode*, bool)> ProcessMessages;
     boost::signals2::signal<bool(CNode*, bool)> SendMessages;
     boost::signals2::signal<void(NodeId, const CNode*)> InitializeNode;
     boost::signals2::signal<void(NodeId)> FinalizeNode;
@@ -126,6 +136,7 @@ CAddress GetLocalAddress(const CNetAddr* paddrPeer = NULL);
 
 extern bool fDiscover;
 extern bool fListen;
+extern bool fSocketEventsEpoll;
 extern uint64_t nLocalServices;
 extern uint64_t nLocalHostNonce;
 extern CAddrMan addrman;
@@ -174,6 +185,19 @@ public:
     std::string addrLocal;
 };
 
+/** Processing times of the messages received with one command, in microseconds */
+struct CMessageStats {
+    uint64_t nCount;
+    int64_t nWaitTime;    // total time between receipt and processing
+    int64_t nProcessTime; // total time spent in the handlers
+    int64_t nMaxProcessTime;
+
+    CMessageStats() : nCount(0), nWaitTime(0), nProcessTime(0), nMaxProcessTime(0) {}
+};
+
+void RecordMessageStats(const std::string& strCommand, int64_t nWaitTime, int64_t nProcessTime);
+std::map<std::string, CMessageStats> GetMessageStats();
+
 
 class CNetMessage
 {
@@ -318,6 +342,10 @@ public:
     bool fNetworkNode;
     bool fSuccessfullyConnected;
     bool fDisconnect;
+    // Readiness reported by edge-triggered socket events and not used up
+    // yet. Only touched by the socket handler thread.
+    bool fSocketRecvReady;
+    bool fSocketSendReady;
     // We use fRelayTxes for two purposes -
     // a) it allows us to not relay tx invs before receiving the peer's version message
     // b) the peer may tell us in their version message that we should not relay tx invs
@@ -0,0 +1,189 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VITAE_NODELIST_H
+#define VITAE_NODELIST_H
+
+#include "coins.h"
+#include "primitives/transaction.h"
+#include "pubkey.h"
+#include "serialize.h"
+
+#include <list>
+#include <map>
+
+#include <boost/unordered_map.hpp>
+
+/**
+ * Storage for the masternode and fundamentalnode lists. Nodes keep their
+ * address while they are listed, so pointers handed out by Find stay valid
+ * until the node is removed. Nodes are indexed by collateral outpoint and
+ * by the key their messages are signed with (the member PubKey), and the
+ * list counts its enabled nodes per protocol version.
+ *
+ * The indexes and counters follow changes made to a listed node once
+ * Refresh is called for it. Serialized like a vector of nodes.
+ */
+template <typename Node, CPubKey Node::*PubKey>
+class CNodeList
+{
+public:
+    typedef typename std::list<Node>::iterator iterator;
+    typedef typename std::list<Node>::const_iterator const_iterator;
+
+private:
+    struct CEntry {
+        iterator it;
+        // State of the node as last seen by the indexes and counters
+        CPubKey pubkey;
+        bool fEnabled;
+        int nProtocolVersion;
+    };
+
+    std::list<Node> lNodes;
+    boost::unordered_map<COutPoint, CEntry, COutPointHasher> mapNodes;
+    std::multimap<CPubKey, COutPoint> mapPubKeys;
+    std::map<int, int> mapEnabled;
+
+    void Count(const CEntry& entry, int nDelta)
+    {
+        if (!entry.fEnabled)
+            return;
+        if ((mapEnabled[entry.nProtocolVersion] += nDelta) == 0)
+            mapEnabled.erase(entry.nProtocolVersion);
+    }
+
+    void UnindexPubKey(const CPubKey& pubkey, const COutPoint& out)
+    {
+        std::pair<std::multimap<CPubKey, COutPoint>::iterator, std::multimap<CPubKey, COutPoint>::iterator> range = mapPubKeys.equal_range(pubkey);
+        for (std::multimap<CPubKey, COutPoint>::iterator it = range.first; it != range.second; ++it) {
+            if (it->second == out) {
+                mapPubKeys.erase(it);
+                return;
+            }
+        }
+    }
+
+public:
+    iterator begin() { return lNodes.begin(); }
+    iterator end() { return lNodes.end(); }
+    const_iterator begin() const { return lNodes.begin(); }
+    const_iterator end() const { return lNodes.end(); }
+    size_t size() const { return lNodes.size(); }
+    bool empty() const { return lNodes.empty(); }
+
+    Node* Find(const COutPoint& out)
+    {
+        typename boost::unordered_map<COutPoint, CEntry, COutPointHasher>::iterator it = mapNodes.find(out);
+        return it == mapNodes.end() ? NULL : &*it->second.it;
+    }
+
+    /** A listed node signing with pubkey, the one indexed first if there are several */
+    Node* Find(const CPubKey& pubkey)
+    {
+        std::multimap<CPubKey, COutPoint>::iterator it = mapPubKeys.find(pubkey);
+        return it == mapPubKeys.end() ? NULL : Find(it->second);
+    }
+
+    /** Append a node, unless its collateral is already listed */
+    Node* Add(const Node& node)
+    {
+        if (mapNodes.count(node.vin.prevout))
+            return NULL;
+        CEntry& entry = mapNodes[node.vin.prevout];
+        entry.it = lNodes.insert(lNodes.end(), node);
+        entry.pubkey = (*entry.it).*PubKey;
+        entry.fEnabled = entry.it->IsEnabled();
+        entry.nProtocolVersion = entry.it->protocolVersion;
+        mapPubKeys.insert(std::make_pair(entry.pubkey, node.vin.prevout));
+        Count(entry, 1);
+        return &*entry.it;
+    }
+
+    iterator Erase(iterator it)
+    {
+        typename boost::unordered_map<COutPoint, CEntry, COutPointHasher>::iterator itEntry = mapNodes.find(it->vin.prevout);
+        Count(itEntry->second, -1);
+        UnindexPubKey(itEntry->second.pubkey, itEntry->first);
+        mapNodes.erase(itEntry);
+        return lNodes.erase(it);
+    }
+
+    bool Erase(const COutPoint& out)
+    {
+        typename boost::unordered_map<COutPoint, CEntry, COutPointHasher>::iterator it = mapNodes.find(out);
+        if (it == mapNodes.end())
+            return false;
+        Erase(it->second.it);
+        return true;
+    }
+
+    void Clear()
+    {
+        lNodes.clear();
+        mapNodes.clear();
+        mapPubKeys.clear();
+        mapEnabled.clear();
+    }
+
+    /** Update the indexes and counters after node changed. Returns whether its enabled state did. */
+    bool Refresh(Node& node)
+    {
+        typename boost::unordered_map<COutPoint, CEntry, COutPointHasher>::iterator it = mapNodes.find(node.vin.prevout);
+        if (it == mapNodes.end())
+            return false;
+        CEntry& entry = it->second;
+        if (entry.pubkey != node.*PubKey) {
+            UnindexPubKey(entry.pubkey, it->first);
+            entry.pubkey = node.*PubKey;
+            mapPubKeys.insert(std::make_pair(entry.pubkey, it->first));
+        }
+        bool fEnabled = node.IsEnabled();
+        bool fChanged = fEnabled != entry.fEnabled;
+        if (fChanged || node.protocolVersion != entry.nProtocolVersion) {
+            Count(entry, -1);
+            entry.fEnabled = fEnabled;
+            entry.nProtocolVersion = node.protocolVersion;
+            Count(entry, 1);
+        }
+        return fChanged;
+    }
+
+    /** Number of enabled nodes running at least protocol version nMinProtocol */
+    int CountEnabled(int nMinProtocol = 0) const
+    {
+        int nCount = 0;
+        for (std::map<int, int>::const_iterator it = mapEnabled.lower_bound(nMinProtocol); it != mapEnabled.end(); ++it)
+            nCount += it->second;
+        return nCount;
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        unsigned int nSize = GetSizeOfCompactSize(lNodes.size());
+        for (const_iterator it = lNodes.begin(); it != lNodes.end(); ++it)
+            nSize += ::GetSerializeSize(*it, nType, nVersion);
+        return nSize;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        WriteCompactSize(s, lNodes.size());
+        for (const_iterator it = lNodes.begin(); it != lNodes.end(); ++it)
+            ::Serialize(s, *it, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        std::vector<Node> vNodes;
+        ::Unserialize(s, vNodes, nType, nVersion);
+        Clear();
+        for (unsigned int i = 0; i < vNodes.size(); i++)
+            Add(vNodes[i]);
+    }
+};
+
+#endif // VITAE_NODELIST_H
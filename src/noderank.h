@@ -0,0 +1,125 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VITAE_NODERANK_H
+#define VITAE_NODERANK_H
+
+#include "primitives/transaction.h"
+#include "uint256.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+/** Which nodes of the list a ranking considers */
+enum NodeRankFilter {
+    RANK_ALL = 0,
+    // Only nodes that are enabled
+    RANK_ONLY_ACTIVE = (1 << 0),
+    // Only nodes that have been announced for the minimum age
+    RANK_MIN_AGE = (1 << 1),
+};
+
+/** Rankings are kept for blocks up to this far below the tip */
+static const int NODE_RANK_CACHE_DEPTH = 200;
+
+/**
+ * The nodes of a masternode or fundamentalnode list ordered by their score
+ * for one block, best first, with the rank of each node indexed by its
+ * collateral outpoint.
+ */
+class CNodeRanking
+{
+private:
+    std::vector<std::pair<int64_t, CTxIn> > vRanked;
+    std::map<COutPoint, int> mapRank;
+
+    struct CompareScoreDesc {
+        bool operator()(const std::pair<int64_t, CTxIn>& t1,
+            const std::pair<int64_t, CTxIn>& t2) const
+        {
+            return t1.first > t2.first;
+        }
+    };
+
+public:
+    // Block the scores were calculated from
+    uint256 hashBlock;
+    // Time from which the ranking may be out of date, e.g. because a node
+    // it skipped for being too young has come of age since
+    int64_t nExpireTime;
+
+    CNodeRanking() : nExpireTime(0) {}
+
+    /** Rank the scored nodes. Nodes with equal scores keep their list order. */
+    CNodeRanking(const uint256& hashBlockIn, int64_t nExpireTimeIn, const std::vector<std::pair<int64_t, CTxIn> >& vScores)
+        : vRanked(vScores), hashBlock(hashBlockIn), nExpireTime(nExpireTimeIn)
+    {
+        std::stable_sort(vRanked.begin(), vRanked.end(), CompareScoreDesc());
+        for (unsigned int i = 0; i < vRanked.size(); i++)
+            mapRank.insert(std::make_pair(vRanked[i].second.prevout, i + 1));
+    }
+
+    size_t size() const { return vRanked.size(); }
+
+    /** The 1-based rank of the node with this collateral, or -1 if it is not ranked. */
+    int GetRank(const COutPoint& out) const
+    {
+        std::map<COutPoint, int>::const_iterator it = mapRank.find(out);
+        return it == mapRank.end() ? -1 : it->second;
+    }
+
+    /** The node at a 1-based rank, or NULL if there are fewer nodes. */
+    const std::pair<int64_t, CTxIn>* GetByRank(int nRank) const
+    {
+        if (nRank < 1 || nRank > (int)vRanked.size())
+            return NULL;
+        return &vRanked[nRank - 1];
+    }
+};
+
+/**
+ * Rankings already computed, per block height and filter. A ranking is only
+ * handed out again while its block is still the one at that height and it
+ * has not expired; the owning list clears the cache whenever it changes.
+ */
+class CNodeRankCache
+{
+private:
+    // Block height, minimum protocol version, NodeRankFilter
+    typedef boost::tuple<int64_t, int, int> RankKey;
+    std::map<RankKey, CNodeRanking> mapRankings;
+
+public:
+    const CNodeRanking* Get(int64_t nBlockHeight, int minProtocol, int nFilter, const uint256& hashBlock, int64_t nNow) const
+    {
+        std::map<RankKey, CNodeRanking>::const_iterator it = mapRankings.find(RankKey(nBlockHeight, minProtocol, nFilter));
+        if (it == mapRankings.end() || it->second.hashBlock != hashBlock || nNow >= it->second.nExpireTime)
+            return NULL;
+        return &it->second;
+    }
+
+    const CNodeRanking& Set(int64_t nBlockHeight, int minProtocol, int nFilter, const CNodeRanking& ranking)
+    {
+        return mapRankings[RankKey(nBlockHeight, minProtocol, nFilter)] = ranking;
+    }
+
+    /** Forget the rankings of blocks below nMinHeight. */
+    void Prune(int64_t nMinHeight)
+    {
+        std::map<RankKey, CNodeRanking>::iterator it = mapRankings.begin();
+        while (it != mapRankings.end() && boost::get<0>(it->first) < nMinHeight)
+            mapRankings.erase(it++);
+    }
+
+    void Clear() { mapRankings.clear(); }
+
+    size_t size() const { return mapRankings.size(); }
+};
+
+#endif // VITAE_NODERANK_H
@@ -7,9 +7,12 @@
 
 #include "obfuscation.h"
 #include "coincontrol.h"
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
 #include "init.h"
 #include "main.h"
 #include "fundamentalnodeman.h"
+#include "script/sigcache.h"
 #include "script/sign.h"
 #include "swifttx.h"
 #include "ui_interface.h"
@@ -30,6 +33,8 @@ using namespace boost;
 CObfuscationPool obfuScationPool;
 // A helper object for signing messages from Fundamentalnodes
 CObfuScationSigner obfuScationSigner;
+// Checks the signatures of node announcements and pings off the message handler thread
+CObfuScationVerifyPool obfuScationVerifyPool;
 // The current Obfuscations in progress on the network
 std::vector<CObfuscationQueue> vecObfuscationQueue;
 // Keep track of the used Fundamentalnodes
@@ -2161,14 +2166,82 @@ bool CObfuScationSigner::SignMessage(std::string strMessage, std::string& errorM
     return true;
 }
 
+namespace
+{
+/**
+ * Outcomes of recent message signature checks. The same announcements and pings
+ * reach us from many peers, this saves recovering their keys every time.
+ */
+class CMessageSigCache
+{
+private:
+    //! Entries are SHA256(nonce || public key || signature || message || outcome)
+    CSHA256 salted_hasher;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setEntries;
+    boost::shared_mutex cs_cache;
+
+    uint256 ComputeEntry(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, bool fValid)
+    {
+        uint256 entry;
+        const unsigned char chValid = fValid;
+        CSHA256(salted_hasher).Write(pubkey.begin(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Write((const unsigned char*)strMessage.data(), strMessage.size()).Write(&chValid, 1).Finalize(entry.begin());
+        return entry;
+    }
+
+public:
+    CMessageSigCache()
+    {
+        uint256 nonce = GetRandHash();
+        salted_hasher.Write(nonce.begin(), 32);
+        salted_hasher.Write(nonce.begin(), 32);
+        // Room for some 130000 outcomes, many times the announcements and pings of a full node list
+        setEntries.setup_bytes(4 << 20);
+    }
+
+    bool Get(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, bool& fValid)
+    {
+        const uint256 entryValid = ComputeEntry(pubkey, vchSig, strMessage, true);
+        const uint256 entryInvalid = ComputeEntry(pubkey, vchSig, strMessage, false);
+        boost::shared_lock<boost::shared_mutex> lock(cs_cache);
+        if (setEntries.contains(entryValid, false)) {
+            fValid = true;
+            return true;
+        }
+        if (setEntries.contains(entryInvalid, false)) {
+            fValid = false;
+            return true;
+        }
+        return false;
+    }
+
+    void Set(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, bool fValid)
+    {
+        const uint256 entry = ComputeEntry(pubkey, vchSig, strMessage, fValid);
+        boost::unique_lock<boost::shared_mutex> lock(cs_cache);
+        setEntries.insert(entry);
+    }
+};
+
+CMessageSigCache& GetMessageSigCache()
+{
+    static CMessageSigCache cache;
+    return cache;
+}
+}
+
 bool CObfuScationSigner::VerifyMessage(CPubKey pubkey, vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage)
 {
+    bool fValid;
+    if (GetMessageSigCache().Get(pubkey, vchSig, strMessage, fValid))
+        return fValid;
+
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
 
     CPubKey pubkey2;
     if (!pubkey2.RecoverCompact(ss.GetHash(), vchSig)) {
+        GetMessageSigCache().Set(pubkey, vchSig, strMessage, false);
         errorMessage = _("Error recovering public key.");
         return false;
     }
@@ -2176,7 +2249,102 @@ bool CObfuScationSigner::VerifyMessage(CPubKey pubkey, vector<unsigned char>& vc
     if (fDebug && pubkey2.GetID() != pubkey.GetID())
         LogPrintf("CObfuScationSigner::VerifyMessage -- keys don't match: %s %s\n", pubkey2.GetID().ToString(), pubkey.GetID().ToString());
 
-    return (pubkey2.GetID() == pubkey.GetID());
+    fValid = pubkey2.GetID() == pubkey.GetID();
+    GetMessageSigCache().Set(pubkey, vchSig, strMessage, fValid);
+    return fValid;
+}
+
+bool CObfuScationSigner::IsVerificationCached(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, bool& fValid)
+{
+    return GetMessageSigCache().Get(pubkey, vchSig, strMessage, fValid);
+}
+
+void CObfuScationVerifyPool::Start(boost::thread_group& threadGroup, int nThreads)
+{
+    LOCK(cs);
+    for (int i = 0; i < nThreads; i++) {
+        boost::thread* pthread = threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "obfverify",
+            CScheduler::Function(boost::bind(&CScheduler::serviceQueue, &scheduler))));
+        vWorkers.push_back(pthread->get_id());
+    }
+}
+
+bool CObfuScationVerifyPool::Defer(CNode* pfrom, const uint256& hash, const COutPoint& outpoint, const std::vector<CObfuScationSigCheck>& vChecks, const boost::function<void()>& fProcess)
+{
+    bool fCached = true;
+    BOOST_FOREACH (const CObfuScationSigCheck& check, vChecks) {
+        // Mirrors the handlers' checks, which stop at the first message the signature is valid for
+        bool fValid = false;
+        BOOST_FOREACH (const std::string& strMessage, check.vMessages) {
+            if (!obfuScationSigner.IsVerificationCached(check.pubkey, check.vchSig, strMessage, fValid)) {
+                fCached = false;
+                break;
+            }
+            if (fValid)
+                break;
+        }
+        if (!fCached)
+            break;
+    }
+
+    LOCK(cs);
+    if (vWorkers.empty() || std::count(vWorkers.begin(), vWorkers.end(), boost::this_thread::get_id()))
+        return false;
+    std::map<COutPoint, std::deque<CQueuedMessage> >::iterator it = mapQueued.find(outpoint);
+    if (fCached && it == mapQueued.end())
+        return false;
+    if (setQueued.count(hash))
+        return true;
+    if (setQueued.size() >= MAX_VERIFY_QUEUE) {
+        // processing it now would put it ahead of the messages queued for the node
+        if (it != mapQueued.end()) {
+            LogPrint("obfuscation", "CObfuScationVerifyPool::Defer - queue full, dropping %s from peer=%d\n", hash.ToString(), pfrom->GetId());
+            return true;
+        }
+        return false;
+    }
+
+    setQueued.insert(hash);
+    pfrom->AddRef();
+    CQueuedMessage message = {pfrom, hash, vChecks, fProcess};
+    if (it != mapQueued.end()) {
+        it->second.push_back(message);
+        return true;
+    }
+    mapQueued[outpoint].push_back(message);
+    scheduler.schedule(boost::bind(&CObfuScationVerifyPool::ProcessQueue, this, outpoint), boost::chrono::system_clock::now());
+    return true;
+}
+
+void CObfuScationVerifyPool::ProcessQueue(const COutPoint& outpoint)
+{
+    while (true) {
+        CQueuedMessage message;
+        {
+            LOCK(cs);
+            message = mapQueued[outpoint].front();
+        }
+
+        BOOST_FOREACH (CObfuScationSigCheck check, message.vChecks) {
+            std::string errorMessage;
+            BOOST_FOREACH (const std::string& strMessage, check.vMessages) {
+                if (obfuScationSigner.VerifyMessage(check.pubkey, check.vchSig, strMessage, errorMessage))
+                    break;
+            }
+        }
+        message.fProcess();
+        message.pfrom->Release();
+
+        // the message stays queued until processed, so that later ones for the node wait for it
+        LOCK(cs);
+        setQueued.erase(message.hash);
+        std::deque<CQueuedMessage>& queue = mapQueued[outpoint];
+        queue.pop_front();
+        if (queue.empty()) {
+            mapQueued.erase(outpoint);
+            return;
+        }
+    }
 }
 
 bool CObfuscationQueue::Sign()
@@ -2311,6 +2479,7 @@ void ThreadCheckObfuScationPool()
             }
 
             //if(c % FUNDAMENTALNODES_DUMP_SECONDS == 0) DumpFundamentalnodes();
+            if (c % FUNDAMENTALNODES_DUMP_SECONDS == 0) DumpFundamentalnodePayments();
 
             obfuScationPool.CheckTimeout();
             obfuScationPool.CheckForCompleteQueue();
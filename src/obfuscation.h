@@ -13,12 +13,18 @@
 #include "fundamentalnode-sync.h"
 #include "fundamentalnodeman.h"
 #include "obfuscation-relay.h"
+#include "scheduler.h"
 #include "sync.h"
 
+#include <deque>
+
+#include <boost/function.hpp>
+
 //#include "activemasternode.h"
 
 class CTxIn;
 class CObfuscationPool;
+class CObfuScationVerifyPool;
 class CObfuScationSigner;
 class CFundamentalNodeVote;
 class CBitcoinAddress;
@@ -55,6 +61,7 @@ static const CAmount OBFUSCATION_POOL_MAX = (99999.99 * COIN);
 
 extern CObfuscationPool obfuScationPool;
 extern CObfuScationSigner obfuScationSigner;
+extern CObfuScationVerifyPool obfuScationVerifyPool;
 extern std::vector<CObfuscationQueue> vecObfuscationQueue;
 extern std::string strFundamentalNodePrivKey;
 extern map<uint256, CObfuscationBroadcastTx> mapObfuscationBroadcastTxes;
@@ -264,6 +271,62 @@ public:
     bool SignMessage(std::string strMessage, std::string& errorMessage, std::vector<unsigned char>& vchSig, CKey key);
     /// Verify the message, returns true if succcessful
     bool VerifyMessage(CPubKey pubkey, std::vector<unsigned char>& vchSig, std::string strMessage, std::string& errorMessage);
+    /// Was the message verified recently? Sets fValid to the outcome if so
+    bool IsVerificationCached(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, bool& fValid);
+};
+
+/** A signature a message handler checks, valid if it signs any of vMessages. */
+struct CObfuScationSigCheck
+{
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+    std::vector<std::string> vMessages;
+
+    CObfuScationSigCheck(const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn, const std::string& strMessage)
+        : pubkey(pubkeyIn), vchSig(vchSigIn), vMessages(1, strMessage) {}
+};
+
+/** Maximum number of messages queued for the verify pool, further ones are processed by the caller */
+static const unsigned int MAX_VERIFY_QUEUE = 1000;
+
+/**
+ * Checks the signatures of fundamentalnode and masternode announcements and pings on
+ * worker threads, so that bursts of them (list sync replies, network wide ping waves)
+ * don't hold up the message handler. A worker verifies the signatures of a message,
+ * leaving the outcomes in the signer's cache, and then processes the message itself,
+ * finding them already checked. Messages for the same node are processed in the order
+ * they arrived, so a ping never overtakes the announcement it follows.
+ */
+class CObfuScationVerifyPool
+{
+private:
+    struct CQueuedMessage {
+        CNode* pfrom;
+        uint256 hash;
+        std::vector<CObfuScationSigCheck> vChecks;
+        boost::function<void()> fProcess;
+    };
+
+    CCriticalSection cs;
+    CScheduler scheduler;
+    std::vector<boost::thread::id> vWorkers;
+    //! Messages queued for the workers, further copies of them are dropped
+    std::set<uint256> setQueued;
+    //! Queued messages by the collateral outpoint of their node, in arrival order
+    std::map<COutPoint, std::deque<CQueuedMessage> > mapQueued;
+
+    void ProcessQueue(const COutPoint& outpoint);
+
+public:
+    void Start(boost::thread_group& threadGroup, int nThreads);
+
+    /**
+     * Hand the message with the given hash, about the node with the given collateral outpoint,
+     * over to a worker, which checks vChecks and then calls fProcess. Returns false when the
+     * caller should process the message itself: the pool isn't running or is full, the caller
+     * is a worker, or all the outcomes are cached and no message for the node is queued.
+     */
+    bool Defer(CNode* pfrom, const uint256& hash, const COutPoint& outpoint, const std::vector<CObfuScationSigCheck>& vChecks, const boost::function<void()>& fProcess);
 };
 
 /** Used to keep track of current status of Obfuscation pool
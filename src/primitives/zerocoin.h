@@ -229,6 +229,48 @@ public:
     };
 };
 
+//A pubcoin minted in a block, as stored in the per-block pubcoin index of the zerocoinDB
+class CBlockPubcoin
+{
+private:
+    CBigNum value;
+    libzerocoin::CoinDenomination denomination;
+    bool fValidOutPoint; //false if the mint would be filtered out for using an invalid outpoint
+
+public:
+    CBlockPubcoin()
+    {
+        SetNull();
+    }
+
+    CBlockPubcoin(const CBigNum& value, libzerocoin::CoinDenomination denomination, bool fValidOutPoint)
+    {
+        this->value = value;
+        this->denomination = denomination;
+        this->fValidOutPoint = fValidOutPoint;
+    }
+
+    void SetNull()
+    {
+        value = 0;
+        denomination = libzerocoin::ZQ_ERROR;
+        fValidOutPoint = true;
+    }
+
+    CBigNum GetValue() const { return value; }
+    libzerocoin::CoinDenomination GetDenomination() const { return denomination; }
+    bool IsValidOutPoint() const { return fValidOutPoint; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(value);
+        READWRITE(denomination);
+        READWRITE(fValidOutPoint);
+    };
+};
+
 class CZerocoinSpendReceipt
 {
 private:
@@ -712,7 +712,7 @@ void PrivacyDialog::setBalance(const CAmount& balance, const CAmount& unconfirme
     // Display global supply
     ui->labelZsupplyAmount->setText(QString::number(chainActive.Tip()->GetZerocoinSupply()/COIN) + QString(" <b>zVITAE </b> "));
     for (auto denom : libzerocoin::zerocoinDenomList) {
-        int64_t nSupply = chainActive.Tip()->mapZerocoinSupply.at(denom);
+        int64_t nSupply = chainActive.Tip()->vZerocoinSupply.at(denom);
         QString strSupply = QString::number(nSupply) + " x " + QString::number(denom) + " = <b>" +
                             QString::number(nSupply*denom) + " zVITAE </b> ";
         switch (denom) {
@@ -104,10 +104,6 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
             "\nAs a JSON-RPC call\n" +
             HelpExampleRpc("importprivkey", "\"mykey\", \"testing\", false"));
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-
-    EnsureWalletIsUnlocked();
-
     string strSecret = params[0].get_str();
     string strLabel = "";
     if (params.size() > 1)
@@ -129,7 +125,12 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
     CPubKey pubkey = key.GetPubKey();
     assert(key.VerifyPubKey(pubkey));
     CKeyID vchAddress = pubkey.GetID();
+    CBlockIndex* pindexRescan = NULL;
     {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
+        EnsureWalletIsUnlocked();
+
         pwalletMain->MarkDirty();
         pwalletMain->SetAddressBook(vchAddress, strLabel, "receive");
 
@@ -144,12 +145,13 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
 
         // whenever a key is imported, we need to scan the whole chain
         pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
-
-        if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
-        }
+        pindexRescan = chainActive.Genesis();
     }
 
+    // The rescan takes cs_main and cs_wallet itself, a chunk of blocks at a time
+    if (fRescan)
+        pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+
     return NullUniValue;
 }
 
@@ -175,8 +177,6 @@ UniValue importaddress(const UniValue& params, bool fHelp)
             "\nAs a JSON-RPC call\n" +
             HelpExampleRpc("importaddress", "\"myaddress\", \"testing\", false"));
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-
     CScript script;
 
     CBitcoinAddress address(params[0].get_str());
@@ -198,7 +198,10 @@ UniValue importaddress(const UniValue& params, bool fHelp)
     if (params.size() > 2)
         fRescan = params[2].get_bool();
 
+    CBlockIndex* pindexRescan = NULL;
     {
+        LOCK2(cs_main, pwalletMain->cs_wallet);
+
         if (::IsMine(*pwalletMain, script) == ISMINE_SPENDABLE)
             throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this address or script");
 
@@ -214,11 +217,12 @@ UniValue importaddress(const UniValue& params, bool fHelp)
 
         if (!pwalletMain->AddWatchOnly(script))
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding address to wallet");
+        pindexRescan = chainActive.Genesis();
+    }
 
-        if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
-            pwalletMain->ReacceptWalletTransactions();
-        }
+    if (fRescan) {
+        pwalletMain->ScanForWalletTransactions(pindexRescan, true);
+        pwalletMain->ReacceptWalletTransactions();
     }
 
     return NullUniValue;
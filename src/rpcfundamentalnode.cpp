@@ -688,7 +688,7 @@ UniValue masternode(const UniValue& params, bool fHelp)
 
     if (strCommand == "current")
     {
-        CMasternode* winner = m_nodeman.GetCurrentMasterNode(1);
+        CMasternode* winner = m_nodeman.GetCurrentMasterNode();
         if(winner) {
             //Object obj;
             UniValue obj(UniValue::VOBJ);
@@ -920,18 +920,16 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
     //Object obj;
         UniValue obj(UniValue::VOBJ);
     if (strMode == "rank") {
-        std::vector<pair<int, CMasternode> > vMasternodeRanks = m_nodeman.GetMasternodeRanks(chainActive.Tip()->nHeight);
-        BOOST_FOREACH(PAIRTYPE(int, CMasternode)& s, vMasternodeRanks) {
-            std::string strAddr = s.second.addr.ToString();
-            if(strFilter !="" && strAddr.find(strFilter) == string::npos) continue;
-            obj.push_back(Pair(strAddr,       s.first));
-        }
+        m_nodeman.ForEachRankedMasternode(chainActive.Tip()->nHeight, [&](int nRank, CMasternode& mn) {
+            std::string strAddr = mn.addr.ToString();
+            if(strFilter !="" && strAddr.find(strFilter) == string::npos) return;
+            obj.push_back(Pair(strAddr,       nRank));
+        });
     } else {
-        std::vector<CMasternode> vMasternodes = m_nodeman.GetFullMasternodeVector();
-        BOOST_FOREACH(CMasternode& mn, vMasternodes) {
+        m_nodeman.ForEachMasternode([&](CMasternode& mn) {
             std::string strAddr = mn.addr.ToString();
             if (strMode == "activeseconds") {
-                if(strFilter !="" && strAddr.find(strFilter) == string::npos) continue;
+                if(strFilter !="" && strAddr.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(strAddr,       (int64_t)(mn.lastTimeSeen - mn.sigTime)));
             } else if (strMode == "donation") {
                 CTxDestination address1;
@@ -939,7 +937,7 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
                 CBitcoinAddress address2(address1);
 
                 if(strFilter !="" && address2.ToString().find(strFilter) == string::npos &&
-                    strAddr.find(strFilter) == string::npos) continue;
+                    strAddr.find(strFilter) == string::npos) return;
 
                 std::string strOut = "";
 
@@ -970,14 +968,14 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
                 std::string output = stringStream.str();
                 stringStream << " " << strAddr;
                 if(strFilter !="" && stringStream.str().find(strFilter) == string::npos &&
-                        strAddr.find(strFilter) == string::npos) continue;
+                        strAddr.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(mn.vin.prevout.hash.ToString(), output));
             } else if (strMode == "lastseen") {
-                if(strFilter !="" && strAddr.find(strFilter) == string::npos) continue;
+                if(strFilter !="" && strAddr.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(strAddr,       (int64_t)mn.lastTimeSeen));
             } else if (strMode == "protocol") {
                 if(strFilter !="" && strFilter != boost::lexical_cast<std::string>(mn.protocolVersion) &&
-                    strAddr.find(strFilter) == string::npos) continue;
+                    strAddr.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(strAddr,       (int64_t)mn.protocolVersion));
             } else if (strMode == "pubkey") {
                 CScript pubkey;
@@ -987,19 +985,19 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
                 CBitcoinAddress address2(address1);
 
                 if(strFilter !="" && address2.ToString().find(strFilter) == string::npos &&
-                    strAddr.find(strFilter) == string::npos) continue;
+                    strAddr.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(strAddr,       address2.ToString().c_str()));
             } else if (strMode == "pose") {
-                if(strFilter !="" && strAddr.find(strFilter) == string::npos) continue;
+                if(strFilter !="" && strAddr.find(strFilter) == string::npos) return;
                 std::string strOut = boost::lexical_cast<std::string>(mn.nScanningErrorCount);
                 obj.push_back(Pair(strAddr,       strOut.c_str()));
             } else if(strMode == "status") {
                 std::string strStatus = mn.Status();
-                if(strFilter !="" && strAddr.find(strFilter) == string::npos && strStatus.find(strFilter) == string::npos) continue;
+                if(strFilter !="" && strAddr.find(strFilter) == string::npos && strStatus.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(strAddr,       strStatus.c_str()));
             } else if (strMode == "vin") {
                 if(strFilter !="" && mn.vin.prevout.hash.ToString().find(strFilter) == string::npos &&
-                    strAddr.find(strFilter) == string::npos) continue;
+                    strAddr.find(strFilter) == string::npos) return;
                 obj.push_back(Pair(strAddr,       mn.vin.prevout.hash.ToString().c_str()));
             } else if(strMode == "votes"){
                 std::string strStatus = "ABSTAIN";
@@ -1011,10 +1009,10 @@ UniValue masternodelist(const UniValue& params, bool fHelp)
                     if(mn.nVote == 1) strStatus = "YEA";
                 }
 
-                if(strFilter !="" && (strAddr.find(strFilter) == string::npos && strStatus.find(strFilter) == string::npos)) continue;
+                if(strFilter !="" && (strAddr.find(strFilter) == string::npos && strStatus.find(strFilter) == string::npos)) return;
                 obj.push_back(Pair(strAddr,       strStatus.c_str()));
             }
-        }
+        });
     }
     return obj;
 }
@@ -1098,41 +1096,35 @@ UniValue listfundamentalnodes(const UniValue& params, bool fHelp)
         if(!pindex) return 0;
         nHeight = pindex->nHeight;
     }
-    std::vector<pair<int, CFundamentalnode> > vFundamentalnodeRanks = mnodeman.GetFundamentalnodeRanks(nHeight);
-    BOOST_FOREACH (PAIRTYPE(int, CFundamentalnode) & s, vFundamentalnodeRanks) {
+    mnodeman.ForEachRankedFundamentalnode(nHeight, [&](int nRank, CFundamentalnode& mn) {
+        std::string strTxHash = mn.vin.prevout.hash.ToString();
+        uint32_t oIdx = mn.vin.prevout.n;
+
+        if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
+            mn.Status().find(strFilter) == string::npos &&
+            CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString().find(strFilter) == string::npos) return;
+
+        std::string strStatus = mn.Status();
+        std::string strHost;
+        int port;
+        SplitHostPort(mn.addr.ToString(), port, strHost);
+        CNetAddr node = CNetAddr(strHost, false);
+        std::string strNetwork = GetNetworkName(node.GetNetwork());
+
         UniValue obj(UniValue::VOBJ);
-        std::string strVin = s.second.vin.prevout.ToStringShort();
-        std::string strTxHash = s.second.vin.prevout.hash.ToString();
-        uint32_t oIdx = s.second.vin.prevout.n;
-
-        CFundamentalnode* mn = mnodeman.Find(s.second.vin);
-
-        if (mn != NULL) {
-            if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
-                mn->Status().find(strFilter) == string::npos &&
-                CBitcoinAddress(mn->pubKeyCollateralAddress.GetID()).ToString().find(strFilter) == string::npos) continue;
-
-            std::string strStatus = mn->Status();
-            std::string strHost;
-            int port;
-            SplitHostPort(mn->addr.ToString(), port, strHost);
-            CNetAddr node = CNetAddr(strHost, false);
-            std::string strNetwork = GetNetworkName(node.GetNetwork());
-
-            obj.push_back(Pair("rank", (strStatus == "ENABLED" ? s.first : 0)));
-            obj.push_back(Pair("network", strNetwork));
-            obj.push_back(Pair("txhash", strTxHash));
-            obj.push_back(Pair("outidx", (uint64_t)oIdx));
-            obj.push_back(Pair("status", strStatus));
-            obj.push_back(Pair("addr", CBitcoinAddress(mn->pubKeyCollateralAddress.GetID()).ToString()));
-            obj.push_back(Pair("version", mn->protocolVersion));
-            obj.push_back(Pair("lastseen", (int64_t)mn->lastPing.sigTime));
-            obj.push_back(Pair("activetime", (int64_t)(mn->lastPing.sigTime - mn->sigTime)));
-            obj.push_back(Pair("lastpaid", (int64_t)mn->GetLastPaid()));
+        obj.push_back(Pair("rank", (strStatus == "ENABLED" ? nRank : 0)));
+        obj.push_back(Pair("network", strNetwork));
+        obj.push_back(Pair("txhash", strTxHash));
+        obj.push_back(Pair("outidx", (uint64_t)oIdx));
+        obj.push_back(Pair("status", strStatus));
+        obj.push_back(Pair("addr", CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString()));
+        obj.push_back(Pair("version", mn.protocolVersion));
+        obj.push_back(Pair("lastseen", (int64_t)mn.lastPing.sigTime));
+        obj.push_back(Pair("activetime", (int64_t)(mn.lastPing.sigTime - mn.sigTime)));
+        obj.push_back(Pair("lastpaid", (int64_t)mn.GetLastPaid()));
 
-            ret.push_back(obj);
-        }
-    }
+        ret.push_back(obj);
+    });
 
     return ret;
 }
@@ -1220,7 +1212,7 @@ UniValue fundamentalnodecurrent (const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("fundamentalnodecurrent", "") + HelpExampleRpc("fundamentalnodecurrent", ""));
 
-    CFundamentalnode* winner = mnodeman.GetCurrentFundamentalNode(1);
+    CFundamentalnode* winner = mnodeman.GetCurrentFundamentalNode();
     if (winner) {
         UniValue obj(UniValue::VOBJ);
 
@@ -1717,19 +1709,19 @@ UniValue getfundamentalnodescores (const UniValue& params, bool fHelp)
     }
     UniValue obj(UniValue::VOBJ);
 
-    std::vector<CFundamentalnode> vFundamentalnodes = mnodeman.GetFullFundamentalnodeVector();
-    for (int nHeight = chainActive.Tip()->nHeight - nLast; nHeight < chainActive.Tip()->nHeight + 20; nHeight++) {
-        uint256 nHigh = 0;
-        CFundamentalnode* pBestFundamentalnode = NULL;
-        BOOST_FOREACH (CFundamentalnode& mn, vFundamentalnodes) {
-            uint256 n = mn.CalculateScore(1, nHeight - 100);
-            if (n > nHigh) {
-                nHigh = n;
-                pBestFundamentalnode = &mn;
-            }
+    // best score and its Fundamentalnode for each height, filled in a single pass over the list
+    int nFirst = chainActive.Tip()->nHeight - nLast;
+    std::vector<pair<uint256, CTxIn> > vBest(std::max(0, nLast + 20), make_pair(uint256(0), CTxIn()));
+    mnodeman.ForEachFundamentalnode([&](CFundamentalnode& mn) {
+        for (unsigned int i = 0; i < vBest.size(); i++) {
+            uint256 n = mn.CalculateScore(1, nFirst + i - 100);
+            if (n > vBest[i].first)
+                vBest[i] = make_pair(n, mn.vin);
         }
-        if (pBestFundamentalnode)
-            obj.push_back(Pair(strprintf("%d", nHeight), pBestFundamentalnode->vin.prevout.hash.ToString().c_str()));
+    });
+    for (unsigned int i = 0; i < vBest.size(); i++) {
+        if (vBest[i].first > 0)
+            obj.push_back(Pair(strprintf("%d", nFirst + i), vBest[i].second.prevout.hash.ToString().c_str()));
     }
 
     return obj;
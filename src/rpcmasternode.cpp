@@ -313,41 +313,35 @@ UniValue listmasternodes(const UniValue& params, bool fHelp)
         if(!pindex) return 0;
         nHeight = pindex->nHeight;
     }
-    std::vector<pair<int, CMasternode> > vMasternodeRanks = mnodeman.GetMasternodeRanks(nHeight);
-    BOOST_FOREACH (PAIRTYPE(int, CMasternode) & s, vMasternodeRanks) {
+    mnodeman.ForEachRankedMasternode(nHeight, [&](int nRank, CMasternode& mn) {
+        std::string strTxHash = mn.vin.prevout.hash.ToString();
+        uint32_t oIdx = mn.vin.prevout.n;
+
+        if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
+            mn.Status().find(strFilter) == string::npos &&
+            CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString().find(strFilter) == string::npos) return;
+
+        std::string strStatus = mn.Status();
+        std::string strHost;
+        int port;
+        SplitHostPort(mn.addr.ToString(), port, strHost);
+        CNetAddr node = CNetAddr(strHost, false);
+        std::string strNetwork = GetNetworkName(node.GetNetwork());
+
         UniValue obj(UniValue::VOBJ);
-        std::string strVin = s.second.vin.prevout.ToStringShort();
-        std::string strTxHash = s.second.vin.prevout.hash.ToString();
-        uint32_t oIdx = s.second.vin.prevout.n;
-
-        CMasternode* mn = mnodeman.Find(s.second.vin);
-
-        if (mn != NULL) {
-            if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
-                mn->Status().find(strFilter) == string::npos &&
-                CBitcoinAddress(mn->pubKeyCollateralAddress.GetID()).ToString().find(strFilter) == string::npos) continue;
-
-            std::string strStatus = mn->Status();
-            std::string strHost;
-            int port;
-            SplitHostPort(mn->addr.ToString(), port, strHost);
-            CNetAddr node = CNetAddr(strHost, false);
-            std::string strNetwork = GetNetworkName(node.GetNetwork());
-
-            obj.push_back(Pair("rank", (strStatus == "ENABLED" ? s.first : 0)));
-            obj.push_back(Pair("network", strNetwork));
-            obj.push_back(Pair("txhash", strTxHash));
-            obj.push_back(Pair("outidx", (uint64_t)oIdx));
-            obj.push_back(Pair("status", strStatus));
-            obj.push_back(Pair("addr", CBitcoinAddress(mn->pubKeyCollateralAddress.GetID()).ToString()));
-            obj.push_back(Pair("version", mn->protocolVersion));
-            obj.push_back(Pair("lastseen", (int64_t)mn->lastPing.sigTime));
-            obj.push_back(Pair("activetime", (int64_t)(mn->lastPing.sigTime - mn->sigTime)));
-            obj.push_back(Pair("lastpaid", (int64_t)mn->GetLastPaid()));
+        obj.push_back(Pair("rank", (strStatus == "ENABLED" ? nRank : 0)));
+        obj.push_back(Pair("network", strNetwork));
+        obj.push_back(Pair("txhash", strTxHash));
+        obj.push_back(Pair("outidx", (uint64_t)oIdx));
+        obj.push_back(Pair("status", strStatus));
+        obj.push_back(Pair("addr", CBitcoinAddress(mn.pubKeyCollateralAddress.GetID()).ToString()));
+        obj.push_back(Pair("version", mn.protocolVersion));
+        obj.push_back(Pair("lastseen", (int64_t)mn.lastPing.sigTime));
+        obj.push_back(Pair("activetime", (int64_t)(mn.lastPing.sigTime - mn.sigTime)));
+        obj.push_back(Pair("lastpaid", (int64_t)mn.GetLastPaid()));
 
-            ret.push_back(obj);
-        }
-    }
+        ret.push_back(obj);
+    });
 
     return ret;
 }
@@ -437,7 +431,7 @@ UniValue masternodecurrent (const UniValue& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("masternodecurrent", "") + HelpExampleRpc("masternodecurrent", ""));
 
-    CMasternode* winner = mnodeman.GetCurrentMasterNode(1);
+    CMasternode* winner = mnodeman.GetCurrentMasterNode();
     if (winner) {
         UniValue obj(UniValue::VOBJ);
 
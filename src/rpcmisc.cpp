@@ -9,6 +9,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "kernel.h"
 #include "main.h"
 #include "fundamentalnode-sync.h"
 #include "net.h"
@@ -126,7 +127,7 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("moneysupply",ValueFromAmount(chainActive.Tip()->nMoneySupply)));
     UniValue zVitObj(UniValue::VOBJ);
     for (auto denom : libzerocoin::zerocoinDenomList) {
-        zVitObj.push_back(Pair(to_string(denom), ValueFromAmount(chainActive.Tip()->mapZerocoinSupply.at(denom) * (denom*COIN))));
+        zVitObj.push_back(Pair(to_string(denom), ValueFromAmount(chainActive.Tip()->vZerocoinSupply.at(denom) * (denom*COIN))));
     }
     zVitObj.push_back(Pair("total", ValueFromAmount(chainActive.Tip()->GetZerocoinSupply())));
     obj.push_back(Pair("zVITAEsupply", zVitObj));
@@ -621,6 +622,8 @@ UniValue getstakingstatus(const UniValue& params, bool fHelp)
             "  \"enoughcoins\": true|false,        (boolean) if available coins are greater than reserve balance\n"
             "  \"fnsync\": true|false,             (boolean) if fundamentalnode data is synced\n"
             "  \"staking status\": true|false,     (boolean) if the wallet is staking or not\n"
+            "  \"stakethreads\": n,                (numeric) number of threads searching for stake kernels\n"
+            "  \"hashespersec\": n.nnn,            (numeric) stake kernel hashes per second\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -648,6 +651,8 @@ UniValue getstakingstatus(const UniValue& params, bool fHelp)
     else if (mapHashedBlocks.count(chainActive.Tip()->nHeight - 1) && nLastCoinStakeSearchInterval)
         nStaking = true;
     obj.push_back(Pair("staking status", nStaking));
+    obj.push_back(Pair("stakethreads", GetStakeSearchThreads()));
+    obj.push_back(Pair("hashespersec", GetStakeSearchHashRate()));
 
     return obj;
 }
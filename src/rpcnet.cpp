@@ -420,7 +420,16 @@ UniValue getnetworkinfo(const UniValue& params, bool fHelp)
             "    \"score\": xxx                         (numeric) relative score\n"
             "  }\n"
             "  ,...\n"
-            "  ]\n"
+            "  ],\n"
+            "  \"messages\": {                          (json object) processing times per message command, in microseconds\n"
+            "    \"command\": {                         (json object) a command, or \"other\" for the ones not listed\n"
+            "      \"count\": n,                        (numeric) messages processed\n"
+            "      \"avgwait\": n,                      (numeric) average time between receipt and processing\n"
+            "      \"avgprocess\": n,                   (numeric) average processing time\n"
+            "      \"maxprocess\": n                    (numeric) longest processing time\n"
+            "    }\n"
+            "    ,...\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -450,6 +459,18 @@ UniValue getnetworkinfo(const UniValue& params, bool fHelp)
         }
     }
     obj.push_back(Pair("localaddresses", localAddresses));
+    UniValue messages(UniValue::VOBJ);
+    std::map<std::string, CMessageStats> mapStats = GetMessageStats();
+    for (std::map<std::string, CMessageStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        const CMessageStats& stats = it->second;
+        UniValue rec(UniValue::VOBJ);
+        rec.push_back(Pair("count", stats.nCount));
+        rec.push_back(Pair("avgwait", stats.nWaitTime / (int64_t)stats.nCount));
+        rec.push_back(Pair("avgprocess", stats.nProcessTime / (int64_t)stats.nCount));
+        rec.push_back(Pair("maxprocess", stats.nMaxProcessTime));
+        messages.push_back(Pair(SanitizeString(it->first), rec));
+    }
+    obj.push_back(Pair("messages", messages));
     return obj;
 }
 
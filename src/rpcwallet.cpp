@@ -2121,6 +2121,10 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp)
             "  \"keypoololdest\": xxxxxx,    (numeric) the timestamp (seconds since GMT epoch) of the oldest pre-generated key in the key pool\n"
             "  \"keypoolsize\": xxxx,        (numeric) how many new keys are pre-generated\n"
             "  \"unlocked_until\": ttt,      (numeric) the timestamp in seconds since epoch (midnight Jan 1 1970 GMT) that the wallet is unlocked for transfers, or 0 if the wallet is locked\n"
+            "  \"rescanning\": {             (json object, only while a rescan is running)\n"
+            "    \"height\": xxxxx,          (numeric) the block height the rescan has reached\n"
+            "    \"progress\": xx            (numeric) the rescan progress in percent\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -2136,6 +2140,13 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp)
     obj.push_back(Pair("keypoolsize", (int)pwalletMain->GetKeyPoolSize()));
     if (pwalletMain->IsCrypted())
         obj.push_back(Pair("unlocked_until", nWalletUnlockTime));
+    int nRescanHeight = pwalletMain->nRescanHeight;
+    if (nRescanHeight >= 0) {
+        UniValue rescan(UniValue::VOBJ);
+        rescan.push_back(Pair("height", nRescanHeight));
+        rescan.push_back(Pair("progress", (int)pwalletMain->nRescanProgress));
+        obj.push_back(Pair("rescanning", rescan));
+    }
     return obj;
 }
 
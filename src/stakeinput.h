@@ -82,6 +82,8 @@ public:
     CVitStake(){}
 
     bool SetInput(CTransaction txPrev, unsigned int n);
+    // Set the block the input was confirmed in when the caller already knows it
+    void SetIndexFrom(CBlockIndex* pindex) { pindexFrom = pindex; }
 
     CBlockIndex* GetIndexFrom() override;
     bool GetTxFrom(CTransaction& tx) override;
@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VITAE_STAKESPENT_H
+#define VITAE_STAKESPENT_H
+
+#include "coins.h"
+#include "primitives/transaction.h"
+
+#include <deque>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+/**
+ * Outputs spent in the recent blocks of the active chain, with the height
+ * they were spent at. Lookups go through a hashed index, while expiry walks
+ * a ring of per-height buckets, so both insertion and expiry cost the number
+ * of outputs involved instead of the size of the whole set.
+ */
+class CStakeSpentMap
+{
+private:
+    boost::unordered_map<COutPoint, int, COutPointHasher> mapSpent;
+    // vBuckets[i] holds the outputs inserted at height nBaseHeight + i. Erased
+    // outputs are left in their bucket and skipped when it expires.
+    std::deque<std::vector<COutPoint> > vBuckets;
+    int nBaseHeight;
+
+public:
+    CStakeSpentMap() : nBaseHeight(0) {}
+
+    size_t size() const { return mapSpent.size(); }
+
+    /** Record out as spent at nHeight, keeping the existing height if it is already known. */
+    void Insert(const COutPoint& out, int nHeight)
+    {
+        if (!mapSpent.insert(std::make_pair(out, nHeight)).second)
+            return;
+        if (vBuckets.empty())
+            nBaseHeight = nHeight;
+        while (nHeight < nBaseHeight) {
+            vBuckets.push_front(std::vector<COutPoint>());
+            nBaseHeight--;
+        }
+        if (nHeight - nBaseHeight >= (int)vBuckets.size())
+            vBuckets.resize(nHeight - nBaseHeight + 1);
+        vBuckets[nHeight - nBaseHeight].push_back(out);
+    }
+
+    /** Look up the height out was spent at. */
+    bool Find(const COutPoint& out, int& nHeight) const
+    {
+        boost::unordered_map<COutPoint, int, COutPointHasher>::const_iterator it = mapSpent.find(out);
+        if (it == mapSpent.end())
+            return false;
+        nHeight = it->second;
+        return true;
+    }
+
+    void Erase(const COutPoint& out)
+    {
+        mapSpent.erase(out);
+    }
+
+    /** Forget every output spent below nHeight. */
+    void Expire(int nHeight)
+    {
+        while (!vBuckets.empty() && nBaseHeight < nHeight) {
+            for (const COutPoint& out : vBuckets.front()) {
+                boost::unordered_map<COutPoint, int, COutPointHasher>::iterator it = mapSpent.find(out);
+                // Skip outputs erased and then spent again at another height
+                if (it != mapSpent.end() && it->second == nBaseHeight)
+                    mapSpent.erase(it);
+            }
+            vBuckets.pop_front();
+            nBaseHeight++;
+        }
+    }
+
+    void Clear()
+    {
+        mapSpent.clear();
+        vBuckets.clear();
+        nBaseHeight = 0;
+    }
+};
+
+#endif // VITAE_STAKESPENT_H
@@ -0,0 +1,175 @@
+// Copyright (c) 2018 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "libzerocoin/Accumulator.h"
+#include "libzerocoin/Coin.h"
+#include "libzerocoin/CoinSpend.h"
+#include "utiltime.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <openssl/bn.h>
+
+using namespace libzerocoin;
+
+#if defined(USE_NUM_GMP)
+static const char* BIGNUM_BACKEND = "gmp";
+#else
+static const char* BIGNUM_BACKEND = "openssl";
+#endif
+
+static void PrintTiming(const std::string& strName, int64_t nStart, int nCount)
+{
+    int64_t nElapsed = GetTimeMicros() - nStart;
+    std::cout << "\t" << strName << ": " << nElapsed / 1000 << " ms total, "
+              << nElapsed / nCount << " us per op" << std::endl;
+}
+
+static BIGNUM* ToOpenSSL(const CBigNum& bn)
+{
+    BIGNUM* ret = NULL;
+    BN_hex2bn(&ret, bn.GetHex().c_str());
+    return ret;
+}
+
+// The same modular arithmetic straight on OpenSSL, the reference the backend is compared with
+static void BenchmarkOpenSSL(const CBigNum& g, const CBigNum& h, const CBigNum& modulus, const std::vector<CBigNum>& vExp, const std::string& strGroup)
+{
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* bnG = ToOpenSSL(g);
+    BIGNUM* bnH = ToOpenSSL(h);
+    BIGNUM* bnModulus = ToOpenSSL(modulus);
+    BIGNUM* bnAcc = BN_dup(bnG);
+    std::vector<BIGNUM*> vBnExp;
+    for (size_t i = 0; i < vExp.size(); i++)
+        vBnExp.push_back(ToOpenSSL(vExp[i]));
+
+    int64_t nStart = GetTimeMicros();
+    for (size_t i = 0; i < vExp.size(); i++)
+        BN_mod_mul(bnAcc, bnAcc, bnH, bnModulus, ctx);
+    PrintTiming("openssl mul_mod (" + strGroup + ")", nStart, vExp.size());
+
+    nStart = GetTimeMicros();
+    for (size_t i = 0; i < vExp.size(); i++)
+        BN_mod_exp(bnAcc, bnG, vBnExp[i], bnModulus, ctx);
+    PrintTiming("openssl pow_mod (" + strGroup + ")", nStart, vExp.size());
+
+    for (size_t i = 0; i < vBnExp.size(); i++)
+        BN_free(vBnExp[i]);
+    BN_free(bnAcc);
+    BN_free(bnModulus);
+    BN_free(bnH);
+    BN_free(bnG);
+    BN_CTX_free(ctx);
+}
+
+BOOST_AUTO_TEST_SUITE(benchmark_bignum)
+
+BOOST_AUTO_TEST_CASE(bignum_backend_compat)
+{
+    // Both backends must produce the MPI based serialization of the
+    // original OpenSSL wrapper, since it is part of the zerocoin consensus
+    BOOST_CHECK(CBigNum(0).getvch().empty());
+    BOOST_CHECK(CBigNum(1).getvch() == std::vector<unsigned char>(1, 0x01));
+    BOOST_CHECK(CBigNum(-1).getvch() == std::vector<unsigned char>(1, 0x81));
+
+    std::vector<unsigned char> vch128;
+    vch128.push_back(0x80);
+    vch128.push_back(0x00);
+    BOOST_CHECK(CBigNum(128).getvch() == vch128);
+    vch128[1] = 0x80;
+    BOOST_CHECK(CBigNum(-128).getvch() == vch128);
+    BOOST_CHECK(CBigNum(vch128) == CBigNum(-128));
+
+    CBigNum bn;
+    bn.SetHex("-0x1234abcd5678ef90aa");
+    BOOST_CHECK_EQUAL(bn.GetHex(), "-1234abcd5678ef90aa");
+    BOOST_CHECK_EQUAL(bn.bitSize(), 69);
+    BOOST_CHECK(CBigNum(bn.getvch()) == bn);
+
+    // Division truncates, modulo is never negative
+    BOOST_CHECK(CBigNum(-7) / CBigNum(2) == CBigNum(-3));
+    BOOST_CHECK(CBigNum(-7) % CBigNum(3) == CBigNum(2));
+    BOOST_CHECK((CBigNum(-7) >> 1) == CBigNum(0));
+    BOOST_CHECK((CBigNum(7) >> 3) == CBigNum(0));
+    BOOST_CHECK((CBigNum(1024) >> 3) == CBigNum(128));
+
+    CBigNum bnDec = 0;
+    --bnDec;
+    BOOST_CHECK(bnDec == CBigNum(-1));
+
+    BOOST_CHECK(CBigNum(3).pow_mod(CBigNum(-1), CBigNum(7)) == CBigNum(5));
+    BOOST_CHECK(CBigNum(3).inverse(CBigNum(7)) == CBigNum(5));
+    BOOST_CHECK_EQUAL(CBigNum(0x1d00ffff).GetCompact(), 0x041d00ffU);
+    BOOST_CHECK(CBigNum().SetCompact(0x041d00ff) == CBigNum(0x1d00ff00));
+
+    uint256 n = uint256("0x8000000000000000000000000000000000000000000000000000000000000001");
+    BOOST_CHECK(CBigNum(n).getuint256() == n);
+    BOOST_CHECK_EQUAL(CBigNum(n).bitSize(), 256);
+}
+
+BOOST_AUTO_TEST_CASE(bignum_benchmark)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinParams* params = Params().Zerocoin_Params(false);
+    const IntegerGroupParams& group = params->coinCommitmentGroup;
+    const int nOps = 200;
+
+    std::cout << "CBigNum benchmark, " << BIGNUM_BACKEND << " backend" << std::endl;
+
+    std::vector<CBigNum> vExp;
+    for (int i = 0; i < nOps; i++)
+        vExp.push_back(CBigNum::randBignum(group.groupOrder));
+
+    int64_t nStart = GetTimeMicros();
+    CBigNum bnAcc = group.g;
+    for (int i = 0; i < nOps; i++)
+        bnAcc = bnAcc.mul_mod(group.h, group.modulus);
+    PrintTiming("mul_mod (commitment group)", nStart, nOps);
+
+    nStart = GetTimeMicros();
+    for (int i = 0; i < nOps; i++)
+        bnAcc = group.g.pow_mod(vExp[i], group.modulus);
+    PrintTiming("pow_mod (commitment group)", nStart, nOps);
+
+    nStart = GetTimeMicros();
+    CBigNum bnAccValue = params->accumulatorParams.accumulatorBase;
+    for (int i = 0; i < nOps; i++)
+        bnAccValue = bnAccValue.pow_mod(vExp[i], params->accumulatorParams.accumulatorModulus);
+    PrintTiming("pow_mod (accumulator modulus)", nStart, nOps);
+
+    BenchmarkOpenSSL(group.g, group.h, group.modulus, vExp, "commitment group");
+    BenchmarkOpenSSL(params->accumulatorParams.accumulatorBase, group.h, params->accumulatorParams.accumulatorModulus, vExp, "accumulator modulus");
+
+    // Full mint, spend and verify round
+    const int nCoins = 5;
+    std::vector<PrivateCoin> vCoins;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < nCoins; i++)
+        vCoins.push_back(PrivateCoin(params, CoinDenomination::ZQ_ONE));
+    PrintTiming("mint", nStart, nCoins);
+
+    Accumulator acc(&params->accumulatorParams, CoinDenomination::ZQ_ONE);
+    AccumulatorWitness witness(params, acc, vCoins[0].getPublicCoin());
+    for (int i = 0; i < nCoins; i++) {
+        acc += vCoins[i].getPublicCoin();
+        witness += vCoins[i].getPublicCoin();
+    }
+
+    nStart = GetTimeMicros();
+    CoinSpend spend(params, params, vCoins[0], acc, 0, witness, 0, SpendType::SPEND);
+    PrintTiming("spend", nStart, 1);
+
+    const int nVerify = 5;
+    bool fValid = true;
+    nStart = GetTimeMicros();
+    for (int i = 0; i < nVerify; i++)
+        fValid &= spend.Verify(acc);
+    PrintTiming("spend verify", nStart, nVerify);
+
+    BOOST_CHECK(fValid);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,133 @@
+// Copyright (c) 2018 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "main.h"
+#include "libzerocoin/Accumulator.h"
+#include "libzerocoin/BatchVerifier.h"
+#include "libzerocoin/Coin.h"
+#include "libzerocoin/CoinSpend.h"
+#include "utiltime.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+
+using namespace libzerocoin;
+
+static const int nCoins = 4;
+
+struct ZerocoinBatchSetup {
+    ZerocoinParams* params;
+    Accumulator acc;
+    Accumulator accPartial;
+    std::vector<CoinSpend> vSpends;
+
+    ZerocoinBatchSetup() : params(Params().Zerocoin_Params(false)),
+                           acc(&params->accumulatorParams, CoinDenomination::ZQ_ONE),
+                           accPartial(&params->accumulatorParams, CoinDenomination::ZQ_ONE)
+    {
+        std::vector<PrivateCoin> vCoins;
+        for (int i = 0; i < nCoins; i++) {
+            vCoins.push_back(PrivateCoin(params, CoinDenomination::ZQ_ONE));
+            acc += vCoins[i].getPublicCoin();
+        }
+        accPartial += vCoins[0].getPublicCoin();
+
+        for (int i = 0; i < nCoins; i++) {
+            AccumulatorWitness witness(params, Accumulator(&params->accumulatorParams, CoinDenomination::ZQ_ONE), vCoins[i].getPublicCoin());
+            for (int j = 0; j < nCoins; j++)
+                witness += vCoins[j].getPublicCoin();
+            vSpends.push_back(CoinSpend(params, params, vCoins[i], acc, 0, witness, 0, SpendType::SPEND));
+        }
+    }
+};
+
+BOOST_AUTO_TEST_SUITE(benchmark_zerocoin_batch)
+
+BOOST_AUTO_TEST_CASE(batch_verifier_results)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinBatchSetup setup;
+
+    // Enough spends per accumulator to use a shared accumulator table,
+    // plus spends proving membership in the wrong accumulator
+    BatchVerifier batch(setup.params);
+    for (int i = 0; i < 2 * nCoins; i++)
+        batch.Add(setup.vSpends[i % nCoins], setup.acc);
+    BOOST_CHECK(batch.Verify());
+    BOOST_CHECK(batch.GetResults() == std::vector<bool>(2 * nCoins, true));
+
+    for (int i = 0; i < nCoins; i++)
+        batch.Add(setup.vSpends[i], setup.accPartial);
+    batch.Add(setup.vSpends[1], setup.acc);
+    BOOST_CHECK(!batch.Verify());
+
+    std::vector<bool> vExpected(3 * nCoins + 1, true);
+    for (int i = 2 * nCoins; i < 3 * nCoins; i++)
+        vExpected[i] = false;
+    BOOST_CHECK(batch.GetResults() == vExpected);
+
+    for (int i = 0; i < nCoins; i++)
+        BOOST_CHECK(!setup.vSpends[i].Verify(setup.accPartial));
+
+    batch.clear();
+    BOOST_CHECK(batch.Verify());
+    BOOST_CHECK_EQUAL(batch.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(batch_spend_checks)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinBatchSetup setup;
+
+    // Six spends in one accumulator, and two in the wrong one
+    std::vector<CZerocoinSpendCheck> vChecks;
+    for (int i = 0; i < 6; i++)
+        vChecks.push_back(CZerocoinSpendCheck(setup.vSpends[i % nCoins], setup.params, setup.acc.getValue(), uint256(i)));
+    for (int i = 0; i < 2; i++)
+        vChecks.push_back(CZerocoinSpendCheck(setup.vSpends[i], setup.params, setup.accPartial.getValue(), uint256(6 + i)));
+
+    // Split into up to two batches per accumulator
+    BatchZerocoinSpendChecks(vChecks, 2);
+    BOOST_REQUIRE_EQUAL(vChecks.size(), 4U);
+    BOOST_CHECK_EQUAL(vChecks[0].size(), 3U);
+    BOOST_CHECK_EQUAL(vChecks[1].size(), 3U);
+    BOOST_CHECK_EQUAL(vChecks[2].size(), 1U);
+    BOOST_CHECK_EQUAL(vChecks[3].size(), 1U);
+    BOOST_CHECK(vChecks[0]());
+    BOOST_CHECK(!vChecks[2]());
+
+    BatchZerocoinSpendChecks(vChecks, 1);
+    BOOST_REQUIRE_EQUAL(vChecks.size(), 2U);
+    BOOST_CHECK_EQUAL(vChecks[0].size(), 6U);
+    BOOST_CHECK_EQUAL(vChecks[1].size(), 2U);
+}
+
+// Takes about half a minute, run it with --run_test=benchmark_zerocoin_batch/bench_zerocoin_batch
+#if BOOST_VERSION >= 105900
+BOOST_AUTO_TEST_CASE(bench_zerocoin_batch, *boost::unit_test::disabled())
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinBatchSetup setup;
+
+    // Build the parameter tables outside of the timings
+    BOOST_CHECK(setup.vSpends[0].Verify(setup.acc));
+
+    std::cout << "Zerocoin batch verification" << std::endl;
+    const int vBatchSizes[] = {1, 8, 32, 128};
+    for (int nBatch : vBatchSizes) {
+        BatchVerifier batch(setup.params);
+        for (int i = 0; i < nBatch; i++)
+            batch.Add(setup.vSpends[i % nCoins], setup.acc);
+
+        int64_t nStart = GetTimeMicros();
+        BOOST_CHECK(batch.Verify());
+        int64_t nElapsed = std::max(GetTimeMicros() - nStart, (int64_t)1);
+        std::cout << "\tbatch " << nBatch << ": " << nElapsed / 1000 << " ms, "
+                  << nBatch * 1000000.0 / nElapsed << " spends/s" << std::endl;
+    }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
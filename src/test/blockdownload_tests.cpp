@@ -0,0 +1,213 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "main.h"
+#include "net.h"
+
+#include <boost/test/unit_test.hpp>
+
+// Tests these internal-to-main.cpp methods:
+extern void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, CBlockIndex* pindex);
+extern void UpdateBlockAvailability(NodeId nodeid, const uint256& hash);
+extern void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller);
+extern bool AddBlockAwaitingParent(const CBlock& block, NodeId nodeFrom);
+extern void ProcessBlocksAwaitingParent(const uint256& hashParent);
+extern std::set<uint256> setBlocksAwaitingParent;
+
+BOOST_AUTO_TEST_SUITE(blockdownload_tests)
+
+namespace {
+/** Headers-only successors of the tip, as they are after a peer sent their headers. */
+struct HeaderChain {
+    std::vector<CBlock> vBlocks;
+    std::vector<CBlockIndex*> vIndex;
+
+    HeaderChain(unsigned int nLength)
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindexPrev = chainActive.Tip();
+        for (unsigned int i = 0; i < nLength; i++) {
+            CBlock block;
+            block.nVersion = 1;
+            block.hashPrevBlock = pindexPrev->GetBlockHash();
+            block.nTime = pindexPrev->nTime + 60;
+            block.nNonce = i;
+
+            CBlockIndex* pindex = new CBlockIndex(block);
+            pindex->phashBlock = &mapBlockIndex.insert(std::make_pair(block.GetHash(), pindex)).first->first;
+            pindex->pprev = pindexPrev;
+            pindex->nHeight = pindexPrev->nHeight + 1;
+            pindex->nChainWork = pindexPrev->nChainWork + 1;
+            pindex->RaiseValidity(BLOCK_VALID_TREE);
+            pindex->BuildSkip();
+
+            vBlocks.push_back(block);
+            vIndex.push_back(pindex);
+            pindexPrev = pindex;
+        }
+    }
+
+    ~HeaderChain()
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex : vIndex) {
+            mapBlockIndex.erase(pindex->GetBlockHash());
+            delete pindex;
+        }
+    }
+};
+
+std::vector<CBlockIndex*> NextBlocksToDownload(const CNode& node, unsigned int count)
+{
+    LOCK(cs_main);
+    std::vector<CBlockIndex*> vBlocks;
+    NodeId staller = -1;
+    FindNextBlocksToDownload(node.GetId(), count, vBlocks, staller);
+    return vBlocks;
+}
+
+size_t BlocksInFlight(const CNode& node)
+{
+    CNodeStateStats stats;
+    BOOST_CHECK(GetNodeStateStats(node.GetId(), stats));
+    return stats.vHeightInFlight.size();
+}
+}
+
+BOOST_AUTO_TEST_CASE(blockdownload_window)
+{
+    CAddress addr(CService("1.2.3.4", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    HeaderChain chain(BLOCK_DOWNLOAD_WINDOW + 10);
+    {
+        LOCK(cs_main);
+        UpdateBlockAvailability(node.GetId(), chain.vIndex.back()->GetBlockHash());
+    }
+
+    // Blocks are fetched in chain order, a batch at a time
+    std::vector<CBlockIndex*> vBatch = NextBlocksToDownload(node, MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+    BOOST_REQUIRE_EQUAL(vBatch.size(), (size_t)MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+    for (unsigned int i = 0; i < vBatch.size(); i++)
+        BOOST_CHECK(vBatch[i] == chain.vIndex[i]);
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex : vBatch)
+            MarkBlockAsInFlight(node.GetId(), pindex->GetBlockHash(), pindex);
+    }
+    BOOST_CHECK_EQUAL(BlocksInFlight(node), (size_t)MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+
+    // Blocks in flight are skipped, and nothing beyond the window is fetched
+    std::vector<CBlockIndex*> vRest = NextBlocksToDownload(node, 2 * BLOCK_DOWNLOAD_WINDOW);
+    BOOST_REQUIRE_EQUAL(vRest.size(), BLOCK_DOWNLOAD_WINDOW - MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+    BOOST_CHECK(vRest.front() == chain.vIndex[MAX_BLOCKS_IN_TRANSIT_PER_PEER]);
+    BOOST_CHECK(vRest.back() == chain.vIndex[BLOCK_DOWNLOAD_WINDOW - 1]);
+}
+
+BOOST_AUTO_TEST_CASE(blockdownload_awaiting_parent)
+{
+    CAddress addr(CService("1.2.3.5", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    HeaderChain chain(3);
+    {
+        LOCK(cs_main);
+        UpdateBlockAvailability(node.GetId(), chain.vIndex.back()->GetBlockHash());
+
+        // Only requested blocks are kept
+        BOOST_CHECK(!AddBlockAwaitingParent(chain.vBlocks[1], node.GetId()));
+        BOOST_CHECK(setBlocksAwaitingParent.empty());
+
+        // A kept block is no longer in flight, and not downloaded again
+        MarkBlockAsInFlight(node.GetId(), chain.vBlocks[1].GetHash(), chain.vIndex[1]);
+        MarkBlockAsInFlight(node.GetId(), chain.vBlocks[2].GetHash(), chain.vIndex[2]);
+        BOOST_CHECK(AddBlockAwaitingParent(chain.vBlocks[1], node.GetId()));
+        BOOST_CHECK(AddBlockAwaitingParent(chain.vBlocks[2], node.GetId()));
+        BOOST_CHECK_EQUAL(setBlocksAwaitingParent.size(), 2U);
+    }
+    BOOST_CHECK_EQUAL(BlocksInFlight(node), 0U);
+    std::vector<CBlockIndex*> vBlocks = NextBlocksToDownload(node, MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+    BOOST_REQUIRE_EQUAL(vBlocks.size(), 1U);
+    BOOST_CHECK(vBlocks[0] == chain.vIndex[0]);
+
+    // Processing the parent processes its descendants, these ones are invalid and dropped
+    ProcessBlocksAwaitingParent(chain.vBlocks[0].GetHash());
+    LOCK(cs_main);
+    BOOST_CHECK(setBlocksAwaitingParent.empty());
+
+    // and their sender pays for them
+    CNodeStateStats stats;
+    BOOST_CHECK(GetNodeStateStats(node.GetId(), stats));
+    BOOST_CHECK(stats.nMisbehavior > 0);
+}
+
+BOOST_AUTO_TEST_CASE(blockdownload_awaiting_parent_bounded)
+{
+    CAddress addr(CService("1.2.3.6", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    uint256 hashParent = uint256(1);
+    {
+        LOCK(cs_main);
+        for (unsigned int i = 0; i <= BLOCK_DOWNLOAD_WINDOW; i++) {
+            CBlock block;
+            block.hashPrevBlock = hashParent;
+            block.nNonce = i;
+            MarkBlockAsInFlight(node.GetId(), block.GetHash(), NULL);
+            BOOST_CHECK_EQUAL(AddBlockAwaitingParent(block, node.GetId()), i < BLOCK_DOWNLOAD_WINDOW);
+        }
+        BOOST_CHECK_EQUAL(setBlocksAwaitingParent.size(), BLOCK_DOWNLOAD_WINDOW);
+    }
+
+    ProcessBlocksAwaitingParent(hashParent);
+    LOCK(cs_main);
+    BOOST_CHECK(setBlocksAwaitingParent.empty());
+}
+
+BOOST_AUTO_TEST_CASE(blockdownload_awaiting_parent_expiry)
+{
+    CAddress addr(CService("1.2.3.7", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    uint256 hashParent = uint256(2);
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+    {
+        // Blocks go with the peer that sent them
+        CNode nodeGone(INVALID_SOCKET, CAddress(CService("1.2.3.8", Params().GetDefaultPort())), "", true);
+        LOCK(cs_main);
+        CBlock block;
+        block.hashPrevBlock = hashParent;
+        MarkBlockAsInFlight(nodeGone.GetId(), block.GetHash(), NULL);
+        BOOST_CHECK(AddBlockAwaitingParent(block, nodeGone.GetId()));
+        BOOST_CHECK_EQUAL(setBlocksAwaitingParent.size(), 1U);
+    }
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(setBlocksAwaitingParent.empty());
+
+        for (unsigned int i = 0; i < BLOCK_DOWNLOAD_WINDOW; i++) {
+            CBlock block;
+            block.hashPrevBlock = hashParent;
+            block.nNonce = i;
+            MarkBlockAsInFlight(node.GetId(), block.GetHash(), NULL);
+            BOOST_CHECK(AddBlockAwaitingParent(block, node.GetId()));
+        }
+
+        // A full stash makes room once its blocks waited too long
+        CBlock blockLate;
+        blockLate.hashPrevBlock = hashParent;
+        blockLate.nNonce = BLOCK_DOWNLOAD_WINDOW;
+        MarkBlockAsInFlight(node.GetId(), blockLate.GetHash(), NULL);
+        BOOST_CHECK(!AddBlockAwaitingParent(blockLate, node.GetId()));
+        SetMockTime(nTime + BLOCK_AWAITING_PARENT_TIMEOUT + 1);
+        MarkBlockAsInFlight(node.GetId(), blockLate.GetHash(), NULL);
+        BOOST_CHECK(AddBlockAwaitingParent(blockLate, node.GetId()));
+        BOOST_CHECK_EQUAL(setBlocksAwaitingParent.size(), 1U);
+    }
+    SetMockTime(0);
+
+    ProcessBlocksAwaitingParent(hashParent);
+    LOCK(cs_main);
+    BOOST_CHECK(setBlocksAwaitingParent.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
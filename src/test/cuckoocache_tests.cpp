@@ -0,0 +1,97 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "cuckoocache.h"
+
+#include "random.h"
+#include "uint256.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(cuckoocache_tests)
+
+namespace {
+// Random test elements, so any 32 bits of them make a good hash
+class TestHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+typedef CuckooCache::cache<uint256, TestHasher> TestCache;
+
+std::vector<uint256> RandomElements(size_t n)
+{
+    std::vector<uint256> v(n);
+    for (uint256& e : v)
+        for (unsigned char* p = e.begin(); p != e.end(); p += 4) {
+            uint32_t r = insecure_rand();
+            std::memcpy(p, &r, 4);
+        }
+    return v;
+}
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_no_fakes)
+{
+    TestCache cc;
+    cc.setup_bytes(1 << 20);
+    for (const uint256& e : RandomElements(100000))
+        cc.insert(e);
+    for (const uint256& e : RandomElements(100000))
+        BOOST_CHECK(!cc.contains(e, false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_hit_rate_ok)
+{
+    // Loaded up to its size, the cache keeps almost everything; past that,
+    // it keeps about as many elements as it has room for
+    const size_t nBytes = 1 << 20;
+    for (double load = 0.1; load < 2; load *= 2) {
+        TestCache cc;
+        const size_t nSize = cc.setup_bytes(nBytes);
+        std::vector<uint256> v = RandomElements(load * nSize);
+        for (const uint256& e : v)
+            cc.insert(e);
+
+        size_t nHits = 0;
+        for (const uint256& e : v)
+            nHits += cc.contains(e, false);
+        BOOST_CHECK(nHits * std::max(load, 1.0) > 0.98 * v.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_erase_ok)
+{
+    // Elements erased on lookup make room for new ones before older elements do
+    TestCache cc;
+    const size_t nSize = cc.setup_bytes(1 << 20);
+    std::vector<uint256> v = RandomElements(nSize);
+    for (size_t i = 0; i < nSize / 2; i++)
+        cc.insert(v[i]);
+    for (size_t i = 0; i < nSize / 4; i++)
+        BOOST_CHECK(cc.contains(v[i], true));
+    for (size_t i = nSize / 2; i < nSize; i++)
+        cc.insert(v[i]);
+
+    size_t nErased = 0, nStale = 0, nFresh = 0;
+    for (size_t i = 0; i < nSize / 4; i++)
+        nErased += cc.contains(v[i], false);
+    for (size_t i = nSize / 4; i < nSize / 2; i++)
+        nStale += cc.contains(v[i], false);
+    for (size_t i = nSize / 2; i < nSize; i++)
+        nFresh += cc.contains(v[i], false);
+    BOOST_CHECK_EQUAL(nFresh, nSize - nSize / 2);
+    BOOST_CHECK(nStale > 2 * nErased);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
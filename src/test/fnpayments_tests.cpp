@@ -0,0 +1,128 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "fundamentalnode-payments.h"
+
+#include "random.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(fnpayments_tests)
+
+namespace {
+CScript RandomPayee()
+{
+    return CScript() << OP_DUP << OP_HASH160 << ToByteVector(GetRandHash()) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+CFundamentalnodePaymentWinner RandomVote(int nBlockHeight, const CScript& payee)
+{
+    CFundamentalnodePaymentWinner winner(CTxIn(GetRandHash(), insecure_rand() % 4));
+    winner.nBlockHeight = nBlockHeight;
+    winner.AddPayee(payee);
+    return winner;
+}
+}
+
+BOOST_AUTO_TEST_CASE(fnpayments_votes_by_height)
+{
+    CFundamentalnodePaymentVotes votes(64);
+    CScript payee1 = RandomPayee(), payee2 = RandomPayee();
+
+    std::vector<CFundamentalnodePaymentWinner> vVotes;
+    for (int h = 1000; h < 1040; h++) {
+        for (int i = 0; i < 3; i++) {
+            vVotes.push_back(RandomVote(h, i < 2 ? payee1 : payee2));
+            BOOST_CHECK(votes.Add(vVotes.back()));
+        }
+    }
+    // A vote is only stored once
+    BOOST_CHECK(!votes.Add(vVotes[0]));
+    BOOST_CHECK_EQUAL(votes.size(), 120U);
+    BOOST_CHECK_EQUAL(votes.CountBlocks(), 40);
+    BOOST_CHECK_EQUAL(votes.GetOldestBlock(), 1000);
+    BOOST_CHECK_EQUAL(votes.GetNewestBlock(), 1039);
+
+    for (unsigned int i = 0; i < vVotes.size(); i++) {
+        const CFundamentalnodePaymentWinner* pwinner = votes.Get(vVotes[i].GetHash());
+        BOOST_CHECK(pwinner != NULL && pwinner->nBlockHeight == vVotes[i].nBlockHeight);
+    }
+
+    CScript payee;
+    CFundamentalnodeBlockPayees* pblockPayees = votes.GetPayees(1020);
+    BOOST_CHECK(pblockPayees != NULL && pblockPayees->GetPayee(payee));
+    BOOST_CHECK(payee == payee1);
+    BOOST_CHECK(pblockPayees->HasPayeeWithVotes(payee1, 2));
+    BOOST_CHECK(!pblockPayees->HasPayeeWithVotes(payee2, 2));
+    BOOST_CHECK_EQUAL(votes.GetHashes(1020)->size(), 3U);
+    BOOST_CHECK(votes.GetPayees(1040) == NULL);
+    // 1020 and 1084 share a slot of the ring
+    BOOST_CHECK(votes.GetPayees(1084) == NULL);
+
+    // Old heights are dropped with their votes
+    std::vector<uint256> vErased;
+    votes.Prune(1010, &vErased);
+    BOOST_CHECK_EQUAL(vErased.size(), 30U);
+    BOOST_CHECK_EQUAL(votes.size(), 90U);
+    BOOST_CHECK_EQUAL(votes.GetOldestBlock(), 1010);
+    BOOST_CHECK(!votes.Has(vVotes[0].GetHash()));
+    BOOST_CHECK(votes.Has(vVotes[30].GetHash()));
+    BOOST_CHECK(!votes.Add(RandomVote(1005, payee1)));
+
+    // A newer height takes over the slot of an older one
+    BOOST_CHECK(votes.Add(RandomVote(1074, payee2)));
+    BOOST_CHECK(votes.GetPayees(1010) == NULL);
+    BOOST_CHECK(!votes.Add(RandomVote(1010, payee2)));
+    BOOST_CHECK_EQUAL(votes.size(), 88U);
+
+    // Growing the ring keeps the votes and their counts
+    votes.Reserve(100);
+    BOOST_CHECK_EQUAL(votes.Depth(), 128U);
+    BOOST_CHECK_EQUAL(votes.size(), 88U);
+    BOOST_CHECK_EQUAL(votes.CountBlocks(), 30);
+    BOOST_CHECK(votes.GetPayees(1020)->HasPayeeWithVotes(payee1, 2));
+    BOOST_CHECK(!votes.Add(RandomVote(1005, payee1)));
+
+    votes.Clear();
+    BOOST_CHECK_EQUAL(votes.size(), 0U);
+    BOOST_CHECK_EQUAL(votes.CountBlocks(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(fnpayments_db_append)
+{
+    CFundamentalnodePaymentDB paymentdb;
+    CScript payee = RandomPayee();
+
+    std::vector<CFundamentalnodePaymentWinner> vFirst, vSecond;
+    for (int h = 2000; h < 2010; h++) {
+        vFirst.push_back(RandomVote(h, payee));
+        vSecond.push_back(RandomVote(h, payee));
+    }
+    BOOST_CHECK(paymentdb.Write(vFirst));
+    BOOST_CHECK(paymentdb.Append(vSecond));
+
+    CFundamentalnodePayments payments;
+    BOOST_CHECK(paymentdb.Read(payments) == CFundamentalnodePaymentDB::Ok);
+    for (unsigned int i = 0; i < vFirst.size(); i++) {
+        BOOST_CHECK(payments.HasVote(vFirst[i].GetHash()));
+        BOOST_CHECK(payments.HasVote(vSecond[i].GetHash()));
+    }
+    BOOST_CHECK(payments.HasPayeeWithVotes(2005, payee, 2));
+
+    // A batch cut short is dropped, the ones before it are kept
+    boost::filesystem::path pathDB = GetDataDir() / "fnpayments.dat";
+    BOOST_CHECK(paymentdb.Append(std::vector<CFundamentalnodePaymentWinner>(1, RandomVote(2010, payee))));
+    boost::filesystem::resize_file(pathDB, boost::filesystem::file_size(pathDB) - 10);
+
+    CFundamentalnodePayments paymentsTorn;
+    BOOST_CHECK(paymentdb.Read(paymentsTorn) == CFundamentalnodePaymentDB::Ok);
+    BOOST_CHECK(paymentsTorn.HasVote(vSecond[9].GetHash()));
+    BOOST_CHECK(paymentsTorn.GetNewestBlock() == 2009);
+
+    boost::filesystem::remove(pathDB);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
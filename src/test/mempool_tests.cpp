@@ -3,9 +3,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "main.h"
+#include "random.h"
 #include "txmempool.h"
 #include "util.h"
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 #include <list>
 
@@ -99,4 +101,303 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     removed.clear();
 }
 
+static CMutableTransaction MakeTx(const uint256& hashPrev, int nOutputs)
+{
+    static int nLockTime = 0;
+    CMutableTransaction tx;
+    tx.nLockTime = nLockTime++; // so all transactions get different hashes
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout.hash = hashPrev;
+    tx.vin[0].prevout.n = 0;
+    tx.vout.resize(nOutputs);
+    for (int i = 0; i < nOutputs; i++) {
+        tx.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[i].nValue = 10000LL;
+    }
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(MempoolDescendantStateTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    std::list<CTransaction> removed;
+
+    CMutableTransaction txParent = MakeTx(uint256(1), 2);
+    CMutableTransaction txChild = MakeTx(txParent.GetHash(), 1);
+    CMutableTransaction txGrandChild = MakeTx(txChild.GetHash(), 1);
+    CTxMemPoolEntry entryParent(txParent, 1000, 0, 0.0, 1);
+    CTxMemPoolEntry entryChild(txChild, 2000, 0, 0.0, 1);
+    CTxMemPoolEntry entryGrandChild(txGrandChild, 3000, 0, 0.0, 1);
+    uint64_t nSize = entryParent.GetTxSize() + entryChild.GetTxSize() + entryGrandChild.GetTxSize();
+
+    testPool.addUnchecked(txParent.GetHash(), entryParent);
+    testPool.addUnchecked(txChild.GetHash(), entryChild);
+    testPool.addUnchecked(txGrandChild.GetHash(), entryGrandChild);
+    CTxMemPool::txiter it = testPool.mapTx.find(txParent.GetHash());
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), 3U);
+    BOOST_CHECK_EQUAL(it->GetSizeWithDescendants(), nSize);
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), 6000);
+
+    // Fee deltas count towards the ancestors
+    testPool.PrioritiseTransaction(txGrandChild.GetHash(), txGrandChild.GetHash().ToString(), 0, 500);
+    BOOST_CHECK_EQUAL(testPool.mapTx.find(txGrandChild.GetHash())->GetModifiedFee(), 3500);
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), 6500);
+
+    testPool.remove(txChild, removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), 1U);
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), 1000);
+
+    // A transaction put back by a reorg picks up the descendants already in the pool
+    testPool.remove(txParent, removed, false);
+    testPool.addUnchecked(txChild.GetHash(), entryChild);
+    testPool.addUnchecked(txGrandChild.GetHash(), entryGrandChild);
+    testPool.addUnchecked(txParent.GetHash(), entryParent);
+    it = testPool.mapTx.find(txParent.GetHash());
+    BOOST_CHECK_EQUAL(it->GetCountWithDescendants(), 3U);
+    BOOST_CHECK_EQUAL(it->GetSizeWithDescendants(), nSize);
+    BOOST_CHECK_EQUAL(it->GetModFeesWithDescendants(), 6500);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolChainLimitTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    std::string errString;
+
+    // A chain of five, and a parent with five children
+    std::vector<CMutableTransaction> vChain(1, MakeTx(uint256(1), 1));
+    for (int i = 1; i < 5; i++)
+        vChain.push_back(MakeTx(vChain.back().GetHash(), 1));
+    CMutableTransaction txParent = MakeTx(uint256(2), 6);
+    std::vector<CMutableTransaction> vChildren;
+    for (int i = 0; i < 5; i++) {
+        vChildren.push_back(MakeTx(txParent.GetHash(), 1));
+        vChildren.back().vin[0].prevout.n = i;
+    }
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 0, 0, 0.0, 1));
+    for (const CMutableTransaction& tx : vChain)
+        testPool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 1));
+    for (const CMutableTransaction& tx : vChildren)
+        testPool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 1));
+
+    CMutableTransaction txTip = MakeTx(vChain.back().GetHash(), 1);
+    BOOST_CHECK(testPool.CheckChainLimits(txTip, 6, 6, errString));
+    BOOST_CHECK(!testPool.CheckChainLimits(txTip, 5, 100, errString));
+    BOOST_CHECK(errString.find("ancestors") != std::string::npos);
+
+    CMutableTransaction txSibling = MakeTx(txParent.GetHash(), 1);
+    txSibling.vin[0].prevout.n = 5;
+    BOOST_CHECK(testPool.CheckChainLimits(txSibling, 2, 7, errString));
+    BOOST_CHECK(!testPool.CheckChainLimits(txSibling, 100, 6, errString));
+    BOOST_CHECK(errString.find("descendants") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
+{
+    CTxMemPool testPool(CFeeRate(1000));
+    std::list<CTransaction> removed;
+
+    // A parent paying little with a child paying a lot, and a transaction
+    // paying more than the parent alone
+    CMutableTransaction txParent = MakeTx(uint256(1), 1);
+    CMutableTransaction txChild = MakeTx(txParent.GetHash(), 1);
+    CMutableTransaction txOther = MakeTx(uint256(2), 1);
+    CTxMemPoolEntry entryParent(txParent, 1000, 0, 0.0, 1);
+    CTxMemPoolEntry entryChild(txChild, 50000, 0, 0.0, 1);
+    CTxMemPoolEntry entryOther(txOther, 5000, 0, 0.0, 1);
+    testPool.addUnchecked(txParent.GetHash(), entryParent);
+    testPool.addUnchecked(txChild.GetHash(), entryChild);
+    testPool.addUnchecked(txOther.GetHash(), entryOther);
+    BOOST_CHECK_EQUAL(testPool.GetMinFee(1).GetFeePerK(), 0);
+
+    // The package of parent and child pays the better rate, so the other one goes first
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1, removed);
+    BOOST_CHECK_EQUAL(removed.size(), 1);
+    BOOST_CHECK(removed.front().GetHash() == txOther.GetHash());
+    BOOST_CHECK(testPool.exists(txParent.GetHash()) && testPool.exists(txChild.GetHash()));
+
+    // New transactions have to beat the evicted rate plus the relay fee
+    CAmount nMinFee = CFeeRate(5000, entryOther.GetTxSize()).GetFeePerK() + 1000;
+    BOOST_CHECK_EQUAL(testPool.GetMinFee(1).GetFeePerK(), nMinFee);
+
+    // The parent is evicted with its child
+    testPool.TrimToSize(0, removed);
+    BOOST_CHECK_EQUAL(removed.size(), 3);
+    BOOST_CHECK_EQUAL(testPool.size(), 0);
+    BOOST_CHECK_EQUAL(testPool.DynamicMemoryUsage(), 0);
+    nMinFee = CFeeRate(51000, entryParent.GetTxSize() + entryChild.GetTxSize()).GetFeePerK() + 1000;
+    BOOST_CHECK_EQUAL(testPool.GetMinFee(1).GetFeePerK(), nMinFee);
+
+    // After a block the minimum decays, four times as fast while the pool is nearly empty
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+    std::list<CTransaction> conflicts;
+    testPool.removeForBlock(std::vector<CTransaction>(), 1, conflicts);
+    SetMockTime(nTime + CTxMemPool::ROLLING_FEE_HALFLIFE);
+    BOOST_CHECK_EQUAL(testPool.GetMinFee(1000000).GetFeePerK(), (CAmount)(nMinFee / 16.0));
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSizeLimitZerocoinSpendTest)
+{
+    CTxMemPool testPool(CFeeRate(1000));
+    std::list<CTransaction> removed;
+
+    // Spends enter a full pool without paying, trimming must not take them right back out
+    CMutableTransaction txPaying = MakeTx(uint256(1), 1);
+    CMutableTransaction txSpend = MakeTx(uint256(0), 1);
+    txSpend.vin[0].scriptSig = CScript() << OP_ZEROCOINSPEND;
+    testPool.addUnchecked(txPaying.GetHash(), CTxMemPoolEntry(txPaying, 10000, 0, 0.0, 1));
+    testPool.addUnchecked(txSpend.GetHash(), CTxMemPoolEntry(txSpend, 0, 0, 0.0, 1));
+
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1, removed);
+    BOOST_CHECK_EQUAL(removed.size(), 1);
+    BOOST_CHECK(removed.front().GetHash() == txPaying.GetHash());
+    BOOST_CHECK(testPool.exists(txSpend.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPriorityIndexTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    typedef indexed_transaction_set::index<mining_priority>::type::reverse_iterator priority_iter;
+
+    // The first starts out ahead, the second carries far more value and gains faster
+    CMutableTransaction txOld = MakeTx(uint256(1), 1);
+    CMutableTransaction txRich = MakeTx(uint256(2), 1);
+    testPool.addUnchecked(txOld.GetHash(), CTxMemPoolEntry(txOld, 0, 0, 1000000.0, 1));
+    testPool.addUnchecked(txRich.GetHash(), CTxMemPoolEntry(txRich, 100000000LL, 0, 0.0, 1));
+    priority_iter it = testPool.mapTx.get<mining_priority>().rbegin();
+    BOOST_CHECK(it->GetTx().GetHash() == txOld.GetHash());
+
+    testPool.UpdatePriorities(2);
+    it = testPool.mapTx.get<mining_priority>().rbegin();
+    BOOST_CHECK(it->GetTx().GetHash() == txRich.GetHash());
+    BOOST_CHECK_EQUAL(it->GetCachedPriority(), it->GetPriority(2));
+
+    // Priority deltas move an entry within the index
+    testPool.PrioritiseTransaction(txOld.GetHash(), txOld.GetHash().ToString(), 10000000.0, 0);
+    it = testPool.mapTx.get<mining_priority>().rbegin();
+    BOOST_CHECK(it->GetTx().GetHash() == txOld.GetHash());
+
+    // Zerocoin spends rank above everything else
+    CMutableTransaction txSpend = MakeTx(uint256(0), 1);
+    txSpend.vin[0].scriptSig = CScript() << OP_ZEROCOINSPEND;
+    testPool.addUnchecked(txSpend.GetHash(), CTxMemPoolEntry(txSpend, 0, 0, 0.0, 2));
+    it = testPool.mapTx.get<mining_priority>().rbegin();
+    BOOST_CHECK(it->GetTx().GetHash() == txSpend.GetHash());
+    BOOST_CHECK((++it)->GetTx().GetHash() == txOld.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolMinFeeExemptTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    CFeeRate minFeeRate(1000);
+
+    // Pays the relay fee, pays nothing, and is a free zerocoin spend
+    CMutableTransaction txPaying = MakeTx(uint256(1), 1);
+    CMutableTransaction txFree = MakeTx(uint256(2), 1);
+    CMutableTransaction txSpend = MakeTx(uint256(0), 1);
+    txSpend.vin[0].scriptSig = CScript() << OP_ZEROCOINSPEND;
+    testPool.addUnchecked(txPaying.GetHash(), CTxMemPoolEntry(txPaying, 10000, 0, 0.0, 1));
+    testPool.addUnchecked(txFree.GetHash(), CTxMemPoolEntry(txFree, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txSpend.GetHash(), CTxMemPoolEntry(txSpend, 0, 0, 0.0, 1));
+
+    // Only the spend may go below the fee floor
+    std::vector<CTxMemPool::txiter> vExempt;
+    testPool.GetMinFeeExempt(minFeeRate, vExempt);
+    BOOST_REQUIRE_EQUAL(vExempt.size(), 1);
+    BOOST_CHECK(vExempt[0]->GetTx().GetHash() == txSpend.GetHash());
+
+    // A priority delta exempts the free one; so does a fee delta, until it lifts it over the floor
+    CMutableTransaction txBumped = MakeTx(uint256(3), 1);
+    testPool.addUnchecked(txBumped.GetHash(), CTxMemPoolEntry(txBumped, 0, 0, 0.0, 1));
+    testPool.PrioritiseTransaction(txFree.GetHash(), txFree.GetHash().ToString(), 1000000.0, 0);
+    testPool.PrioritiseTransaction(txBumped.GetHash(), txBumped.GetHash().ToString(), 0, 1);
+    vExempt.clear();
+    testPool.GetMinFeeExempt(minFeeRate, vExempt);
+    BOOST_CHECK_EQUAL(vExempt.size(), 3);
+
+    testPool.PrioritiseTransaction(txBumped.GetHash(), txBumped.GetHash().ToString(), 0, 10000);
+    vExempt.clear();
+    testPool.GetMinFeeExempt(minFeeRate, vExempt);
+    BOOST_CHECK_EQUAL(vExempt.size(), 2);
+    BOOST_FOREACH (CTxMemPool::txiter it, vExempt)
+        BOOST_CHECK(it->GetTx().GetHash() != txBumped.GetHash() && it->GetTx().GetHash() != txPaying.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPersistTest)
+{
+    boost::filesystem::path pathMempool = GetDataDir() / "mempool.dat";
+    boost::filesystem::remove(pathMempool);
+    // Nothing to load yet, but dumping is allowed from now on
+    BOOST_CHECK(!LoadMempool());
+
+    CScript scriptPayee = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript scriptTrue = CScript() << OP_TRUE;
+    CMutableTransaction txFunding;
+    txFunding.vin.resize(1);
+    txFunding.vin[0].prevout.hash = GetRandHash();
+    txFunding.vout.resize(2);
+    txFunding.vout[0].scriptPubKey = GetScriptForDestination(CScriptID(scriptTrue));
+    txFunding.vout[0].nValue = COIN;
+    txFunding.vout[1].scriptPubKey = scriptPayee;
+    txFunding.vout[1].nValue = COIN;
+
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(1);
+    txSpend.vin[0].prevout = COutPoint(txFunding.GetHash(), 0);
+    txSpend.vin[0].scriptSig = CScript() << std::vector<unsigned char>(scriptTrue.begin(), scriptTrue.end());
+    txSpend.vout.resize(1);
+    txSpend.vout[0].scriptPubKey = scriptPayee;
+    txSpend.vout[0].nValue = COIN - CENT;
+    uint256 hashSpend = txSpend.GetHash();
+    int64_t nTime = GetTime() - 60;
+
+    // Its signature does not verify, and nothing in mempool.dat lets it skip the checks when loaded
+    CMutableTransaction txBadSig = txSpend;
+    txBadSig.vin[0].prevout = COutPoint(txFunding.GetHash(), 1);
+    txBadSig.vin[0].scriptSig = CScript() << std::vector<unsigned char>(71, 1) << std::vector<unsigned char>(33, 2);
+    uint256 hashBadSig = txBadSig.GetHash();
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(chainActive.Tip() != NULL);
+        pcoinsTip->ModifyCoins(txFunding.GetHash())->FromTx(txFunding, chainActive.Height());
+        CValidationState state;
+        BOOST_CHECK(!AcceptToMemoryPool(mempool, state, txBadSig, false, NULL));
+        mempool.addUnchecked(hashSpend, CTxMemPoolEntry(txSpend, CENT, nTime, 0.0, chainActive.Height()));
+        mempool.addUnchecked(hashBadSig, CTxMemPoolEntry(txBadSig, CENT, nTime, 0.0, chainActive.Height()));
+    }
+    uint256 hashPrioritised = GetRandHash();
+    mempool.PrioritiseTransaction(hashPrioritised, hashPrioritised.ToString(), 1.0, 5000);
+
+    BOOST_CHECK(DumpMempool());
+    mempool.clear();
+    mempool.ClearPrioritisation(hashPrioritised);
+
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK(mempool.exists(hashSpend));
+    BOOST_CHECK(!mempool.exists(hashBadSig));
+    {
+        LOCK(mempool.cs);
+        BOOST_CHECK_EQUAL(mempool.mapTx.find(hashSpend)->GetTime(), nTime);
+    }
+    double dPriorityDelta = 0;
+    CAmount nFeeDelta = 0;
+    mempool.ApplyDeltas(hashPrioritised, dPriorityDelta, nFeeDelta);
+    BOOST_CHECK_EQUAL(nFeeDelta, 5000);
+
+    // A damaged file is rejected as a whole
+    BOOST_CHECK(DumpMempool());
+    mempool.clear();
+    boost::filesystem::resize_file(pathMempool, boost::filesystem::file_size(pathMempool) - 1);
+    BOOST_CHECK(!LoadMempool());
+    BOOST_CHECK(!mempool.exists(hashSpend));
+
+    mempool.ClearPrioritisation(hashPrioritised);
+    boost::filesystem::remove(pathMempool);
+    LOCK(cs_main);
+    pcoinsTip->ModifyCoins(txFunding.GetHash())->Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "net.h"
+#include "streams.h"
+#include "version.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(msghandler_tests)
+
+namespace {
+void ReceiveMessage(CNode& node, const std::string& strCommand)
+{
+    CDataStream ssPayload(SER_NETWORK, PROTOCOL_VERSION);
+    CMessageHeader hdr(strCommand.c_str(), 0);
+    uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+    memcpy(&hdr.nChecksum, &hash, sizeof(hdr.nChecksum));
+
+    CDataStream ssMsg(SER_NETWORK, PROTOCOL_VERSION);
+    ssMsg << hdr;
+    LOCK(node.cs_vRecvMsg);
+    BOOST_CHECK(node.ReceiveMsgBytes(&ssMsg[0], ssMsg.size()));
+}
+}
+
+BOOST_AUTO_TEST_CASE(msghandler_concurrent_only)
+{
+    CAddress addr(CService("1.2.3.4", Params().GetDefaultPort()));
+    CNode node(INVALID_SOCKET, addr, "", true);
+    // old enough not to answer pings, which would try to send on the dummy socket
+    node.nVersion = BIP0031_VERSION;
+
+    ReceiveMessage(node, "pong");
+    ReceiveMessage(node, "verack");
+    ReceiveMessage(node, "pong");
+    uint64_t nPongs = GetMessageStats()["pong"].nCount;
+
+    LOCK(node.cs_vRecvMsg);
+    BOOST_CHECK_EQUAL(node.vRecvMsg.size(), 3U);
+    BOOST_CHECK(ProcessMessages(&node, true));
+    BOOST_CHECK_EQUAL(node.vRecvMsg.size(), 2U);
+
+    // verack has to wait for the validation thread, and so does everything after it
+    BOOST_CHECK(ProcessMessages(&node, true));
+    BOOST_CHECK_EQUAL(node.vRecvMsg.size(), 2U);
+    BOOST_CHECK(ProcessMessages(&node, false));
+    BOOST_CHECK_EQUAL(node.vRecvMsg.size(), 1U);
+    BOOST_CHECK(ProcessMessages(&node, true));
+    BOOST_CHECK(node.vRecvMsg.empty());
+    BOOST_CHECK(!node.fDisconnect);
+
+    BOOST_CHECK_EQUAL(GetMessageStats()["pong"].nCount, nPongs + 2);
+}
+
+BOOST_AUTO_TEST_CASE(msghandler_stats_bounded)
+{
+    uint64_t nOther = GetMessageStats()["other"].nCount;
+    uint64_t nBlocks = GetMessageStats()["block"].nCount;
+    for (unsigned int i = 0; i < 100; i++)
+        RecordMessageStats(strprintf("cmd%u", i), 10, 20);
+    RecordMessageStats("block", 10, 50);
+
+    // Made up commands don't get an entry of their own, and can't crowd out the real ones
+    std::map<std::string, CMessageStats> mapStats = GetMessageStats();
+    BOOST_CHECK(!mapStats.count("cmd0"));
+    BOOST_CHECK_EQUAL(mapStats["other"].nCount, nOther + 100);
+    BOOST_CHECK_EQUAL(mapStats["block"].nCount, nBlocks + 1);
+    BOOST_CHECK(mapStats["block"].nMaxProcessTime >= 50);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "nodelist.h"
+
+#include "clientversion.h"
+#include "key.h"
+#include "random.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(nodelist_tests)
+
+namespace {
+// The parts of a masternode the list relies on
+class CTestNode
+{
+public:
+    CTxIn vin;
+    CPubKey pubkey;
+    int protocolVersion;
+    bool fEnabled;
+
+    CTestNode() : protocolVersion(0), fEnabled(false) {}
+
+    bool IsEnabled() { return fEnabled; }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(vin);
+        READWRITE(pubkey);
+        READWRITE(protocolVersion);
+        READWRITE(fEnabled);
+    }
+};
+
+typedef CNodeList<CTestNode, &CTestNode::pubkey> CTestNodeList;
+
+CPubKey RandomPubKey()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key.GetPubKey();
+}
+
+CTestNode RandomNode()
+{
+    CTestNode node;
+    node.vin = CTxIn(GetRandHash(), insecure_rand() % 4);
+    node.pubkey = RandomPubKey();
+    node.protocolVersion = 70000 + insecure_rand() % 4;
+    node.fEnabled = insecure_rand() % 2;
+    return node;
+}
+
+void CheckIndexes(CTestNodeList& list)
+{
+    std::map<int, int> mapEnabled;
+    for (CTestNodeList::iterator it = list.begin(); it != list.end(); ++it) {
+        BOOST_CHECK(list.Find(it->vin.prevout) == &*it);
+        BOOST_CHECK(list.Find(it->pubkey) == &*it);
+        if (it->fEnabled)
+            mapEnabled[it->protocolVersion]++;
+    }
+    for (int nProtocol = 70000; nProtocol < 70005; nProtocol++) {
+        int nExpected = 0;
+        for (std::map<int, int>::iterator it = mapEnabled.lower_bound(nProtocol); it != mapEnabled.end(); ++it)
+            nExpected += it->second;
+        BOOST_CHECK_EQUAL(list.CountEnabled(nProtocol), nExpected);
+    }
+}
+}
+
+BOOST_AUTO_TEST_CASE(nodelist_index)
+{
+    CTestNodeList list;
+    std::vector<CTestNode*> vNodes;
+    for (unsigned int i = 0; i < 50; i++) {
+        CTestNode node = RandomNode();
+        CTestNode* pnode = list.Add(node);
+        BOOST_CHECK(pnode != NULL);
+        // The same collateral is only listed once
+        BOOST_CHECK(list.Add(node) == NULL);
+        vNodes.push_back(pnode);
+    }
+    BOOST_CHECK_EQUAL(list.size(), 50U);
+    CheckIndexes(list);
+
+    // Nodes changed in place are found again once refreshed
+    for (unsigned int i = 0; i < 20; i++) {
+        CTestNode* pnode = vNodes[i];
+        CPubKey pubkeyOld = pnode->pubkey;
+        bool fEnabled = pnode->fEnabled;
+        pnode->pubkey = RandomPubKey();
+        pnode->protocolVersion = 70000 + insecure_rand() % 4;
+        pnode->fEnabled = !fEnabled;
+        BOOST_CHECK(list.Refresh(*pnode));
+        BOOST_CHECK(list.Find(pubkeyOld) == NULL);
+    }
+    CheckIndexes(list);
+
+    // Pointers to the other nodes stay valid across removals
+    for (unsigned int i = 0; i < 10; i++)
+        BOOST_CHECK(list.Erase(vNodes[i]->vin.prevout));
+    BOOST_CHECK(!list.Erase(COutPoint(GetRandHash(), 0)));
+    BOOST_CHECK_EQUAL(list.size(), 40U);
+    for (unsigned int i = 10; i < vNodes.size(); i++)
+        BOOST_CHECK(list.Find(vNodes[i]->vin.prevout) == vNodes[i]);
+    CheckIndexes(list);
+
+    list.Clear();
+    BOOST_CHECK(list.empty());
+    BOOST_CHECK_EQUAL(list.CountEnabled(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(nodelist_serialize)
+{
+    CTestNodeList list;
+    std::vector<CTestNode> vNodes;
+    for (unsigned int i = 0; i < 20; i++) {
+        vNodes.push_back(RandomNode());
+        list.Add(vNodes.back());
+    }
+
+    // The list is stored like a vector of nodes
+    CDataStream ssList(SER_DISK, CLIENT_VERSION), ssVector(SER_DISK, CLIENT_VERSION);
+    ssList << list;
+    ssVector << vNodes;
+    BOOST_CHECK(ssList.str() == ssVector.str());
+    BOOST_CHECK_EQUAL(::GetSerializeSize(list, SER_DISK, CLIENT_VERSION), ssList.size());
+
+    CTestNodeList listRead;
+    listRead.Add(RandomNode());
+    ssVector >> listRead;
+    BOOST_CHECK_EQUAL(listRead.size(), vNodes.size());
+    CheckIndexes(listRead);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,59 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "noderank.h"
+
+#include "random.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(noderank_tests)
+
+BOOST_AUTO_TEST_CASE(noderank_order)
+{
+    std::vector<std::pair<int64_t, CTxIn> > vScores;
+    for (unsigned int i = 0; i < 100; i++)
+        vScores.push_back(std::make_pair((int64_t)(insecure_rand() % 20), CTxIn(GetRandHash(), i)));
+
+    CNodeRanking ranking(GetRandHash(), 0, vScores);
+    BOOST_CHECK_EQUAL(ranking.size(), vScores.size());
+    BOOST_CHECK(ranking.GetByRank(0) == NULL);
+    BOOST_CHECK(ranking.GetByRank(vScores.size() + 1) == NULL);
+    BOOST_CHECK_EQUAL(ranking.GetRank(COutPoint(GetRandHash(), 0)), -1);
+
+    for (unsigned int i = 0; i < vScores.size(); i++) {
+        // A node ranks after every node with a higher score and every
+        // earlier node with the same score
+        int nRank = 1;
+        for (unsigned int j = 0; j < vScores.size(); j++)
+            if (vScores[j].first > vScores[i].first || (vScores[j].first == vScores[i].first && j < i))
+                nRank++;
+        BOOST_CHECK_EQUAL(ranking.GetRank(vScores[i].second.prevout), nRank);
+        BOOST_CHECK(ranking.GetByRank(nRank)->second == vScores[i].second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(noderank_cache)
+{
+    std::vector<std::pair<int64_t, CTxIn> > vScores(1, std::make_pair(1, CTxIn(GetRandHash(), 0)));
+    uint256 hashA = GetRandHash(), hashB = GetRandHash();
+    CNodeRankCache cache;
+
+    cache.Set(100, 70000, RANK_ONLY_ACTIVE, CNodeRanking(hashA, 1000, vScores));
+    BOOST_CHECK(cache.Get(100, 70000, RANK_ONLY_ACTIVE, hashA, 999) != NULL);
+    // Other filters, a reorganized block or an expired ranking miss
+    BOOST_CHECK(cache.Get(100, 70000, RANK_ALL, hashA, 999) == NULL);
+    BOOST_CHECK(cache.Get(100, 70001, RANK_ONLY_ACTIVE, hashA, 999) == NULL);
+    BOOST_CHECK(cache.Get(100, 70000, RANK_ONLY_ACTIVE, hashB, 999) == NULL);
+    BOOST_CHECK(cache.Get(100, 70000, RANK_ONLY_ACTIVE, hashA, 1000) == NULL);
+
+    cache.Set(101, 70000, RANK_ONLY_ACTIVE, CNodeRanking(hashB, 1000, vScores));
+    cache.Prune(101);
+    BOOST_CHECK_EQUAL(cache.size(), 1U);
+    BOOST_CHECK(cache.Get(101, 70000, RANK_ONLY_ACTIVE, hashB, 0) != NULL);
+    cache.Clear();
+    BOOST_CHECK(cache.Get(101, 70000, RANK_ONLY_ACTIVE, hashB, 0) == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "clientversion.h"
 #include "main.h"
 #include "random.h"
 #include "util.h"
@@ -100,4 +101,96 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+// Reference answers, walking the chains block by block
+static const CBlockIndex* WalkLastStakeModifier(const CBlockIndex* pindex)
+{
+    while (pindex && !pindex->GeneratedStakeModifier())
+        pindex = pindex->pprev;
+    return pindex;
+}
+
+static const CBlockIndex* WalkNextStakeModifier(const CChain& chain, int nHeight, int64_t nTime)
+{
+    for (const CBlockIndex* pindex = chain[nHeight + 1]; pindex; pindex = chain.Next(pindex)) {
+        if (pindex->GeneratedStakeModifier() && pindex->GetBlockTime() >= nTime)
+            return pindex;
+    }
+    return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(stakemodifier_index_test)
+{
+    // A main chain and a branch splitting off at block 1499, with jittery
+    // block times and a modifier generated by roughly one block in eight.
+    std::vector<CBlockIndex> vBlocksMain(3000);
+    std::vector<CBlockIndex> vBlocksSide(2000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].nTime = 1000000 + i * 60 + insecure_rand() % 600;
+        vBlocksMain[i].SetStakeModifier(i, i == 0 || insecure_rand() % 8 == 0);
+        vBlocksMain[i].BuildSkip();
+    }
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 1500;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[1499];
+        vBlocksSide[i].nTime = 1000000 + (i + 1500) * 60 + insecure_rand() % 600;
+        vBlocksSide[i].SetStakeModifier(i, insecure_rand() % 8 == 0);
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    CBlockIndex* vTips[] = {&vBlocksMain[2000], &vBlocksMain.back(), &vBlocksSide.back(), &vBlocksMain[1200], &vBlocksMain.back()};
+    for (CBlockIndex* tip : vTips) {
+        chain.SetTip(tip);
+        for (int n=0; n<500; n++) {
+            int r = insecure_rand() % 5000;
+            const CBlockIndex* pindex = (r < 3000) ? &vBlocksMain[r] : &vBlocksSide[r - 3000];
+            BOOST_CHECK(chain.FindLastStakeModifier(pindex) == WalkLastStakeModifier(pindex));
+
+            int nHeight = insecure_rand() % (chain.Height() + 1);
+            int64_t nTime = chain[nHeight]->GetBlockTime() + insecure_rand() % 4000;
+            BOOST_CHECK(chain.FindNextStakeModifier(nHeight, nTime) == WalkNextStakeModifier(chain, nHeight, nTime));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(diskblockindex_zerocoin_format_test)
+{
+    // The per-denomination arrays keep the on-disk layout of the former map and vector
+    CBlockIndex index;
+    index.nVersion = 4;
+    index.nAccumulatorCheckpoint = GetRandHash();
+    std::map<libzerocoin::CoinDenomination, int64_t> mapSupply;
+    std::vector<libzerocoin::CoinDenomination> vMints;
+    for (auto& denom : libzerocoin::zerocoinDenomList) {
+        index.vZerocoinSupply.at(denom) = insecure_rand() % 1000;
+        mapSupply[denom] = index.vZerocoinSupply.at(denom);
+        for (unsigned int i = insecure_rand() % 3; i > 0; i--) {
+            index.vMintsInBlock.at(denom)++;
+            vMints.push_back(denom);
+        }
+    }
+    index.SetProofOfStake();
+    index.GetStakeDataForUpdate().prevoutStake = COutPoint(GetRandHash(), 1);
+    index.GetStakeDataForUpdate().nStakeTime = 1234;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+    CDataStream ssTail(SER_DISK, CLIENT_VERSION);
+    ssTail << index.nAccumulatorCheckpoint << mapSupply << vMints;
+    BOOST_CHECK(ss.size() > ssTail.size());
+    BOOST_CHECK(std::string(ss.end() - ssTail.size(), ss.end()) == std::string(ssTail.begin(), ssTail.end()));
+
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    for (auto& denom : libzerocoin::zerocoinDenomList) {
+        BOOST_CHECK_EQUAL(diskindex.vZerocoinSupply.at(denom), index.vZerocoinSupply.at(denom));
+        BOOST_CHECK_EQUAL(diskindex.vMintsInBlock.at(denom), index.vMintsInBlock.at(denom));
+        BOOST_CHECK_EQUAL(diskindex.MintedDenomination(denom), index.vMintsInBlock.at(denom) > 0);
+    }
+    BOOST_CHECK(diskindex.GetStakeData().prevoutStake == index.GetStakeData().prevoutStake);
+    BOOST_CHECK_EQUAL(diskindex.GetStakeData().nStakeTime, index.GetStakeData().nStakeTime);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+// Copyright (c) 2019 The VITAE developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stakespent.h"
+
+#include "random.h"
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(stakespent_tests)
+
+static COutPoint RandomOutPoint()
+{
+    // Few distinct outputs, so that spends get erased and repeated
+    return COutPoint(insecure_rand() % 64, insecure_rand() % 4);
+}
+
+BOOST_AUTO_TEST_CASE(stakespent_map)
+{
+    const int nDepth = 10;
+    CStakeSpentMap spent;
+    // Reference: the plain map scanned in full on every block
+    std::map<COutPoint, int> mapRef;
+    std::vector<std::vector<COutPoint> > vBlocks(1);
+
+    for (int n = 0; n < 5000; n++) {
+        int nTip = vBlocks.size() - 1;
+        if (nTip > 1 && insecure_rand() % 3 == 0) {
+            // Disconnect the tip, restoring its spends
+            for (const COutPoint& out : vBlocks.back()) {
+                spent.Erase(out);
+                mapRef.erase(out);
+            }
+            vBlocks.pop_back();
+        } else {
+            // Connect a block at the next height
+            nTip++;
+            vBlocks.push_back(std::vector<COutPoint>());
+            for (unsigned int i = insecure_rand() % 8; i > 0; i--) {
+                COutPoint out = RandomOutPoint();
+                vBlocks.back().push_back(out);
+                spent.Insert(out, nTip);
+                mapRef.insert(std::make_pair(out, nTip));
+            }
+            spent.Expire(nTip - nDepth);
+            for (std::map<COutPoint, int>::iterator it = mapRef.begin(); it != mapRef.end();) {
+                if (it->second < nTip - nDepth)
+                    mapRef.erase(it++);
+                else
+                    it++;
+            }
+        }
+
+        BOOST_CHECK_EQUAL(spent.size(), mapRef.size());
+        for (unsigned int i = 0; i < 8; i++) {
+            COutPoint out = RandomOutPoint();
+            int nHeight = -1;
+            std::map<COutPoint, int>::const_iterator it = mapRef.find(out);
+            BOOST_CHECK_EQUAL(spent.Find(out, nHeight), it != mapRef.end());
+            if (it != mapRef.end())
+                BOOST_CHECK_EQUAL(nHeight, it->second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
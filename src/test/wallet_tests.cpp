@@ -4,6 +4,9 @@
 
 #include "wallet.h"
 
+#include "main.h"
+#include "random.h"
+
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -305,4 +308,134 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+static CWalletTx confirmed_tx(CWallet& w, const CMutableTransaction& tx)
+{
+    CWalletTx wtx(&w, tx);
+    wtx.hashBlock = chainActive.Tip()->GetBlockHash();
+    wtx.nIndex = 0;
+    wtx.fMerkleVerified = true;
+    return wtx;
+}
+
+BOOST_AUTO_TEST_CASE(wallet_unspent_index)
+{
+    CWallet w;
+    LOCK2(cs_main, w.cs_wallet);
+
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+    BOOST_CHECK(w.AddKey(key));
+
+    CMutableTransaction tx1;
+    tx1.vin.push_back(CTxIn(GetRandHash(), 0));
+    tx1.vout.push_back(CTxOut(1 * COIN, GetScriptForDestination(key.GetPubKey().GetID())));
+    tx1.vout.push_back(CTxOut(2 * COIN, GetScriptForDestination(keyOther.GetPubKey().GetID())));
+    w.AddToWallet(confirmed_tx(w, tx1), true);
+
+    std::vector<const CWalletTx*> vWtx;
+    w.GetUnspentWalletTx(vWtx);
+    BOOST_CHECK_EQUAL(vWtx.size(), 1U);
+    BOOST_CHECK(vWtx[0]->GetHash() == tx1.GetHash());
+    BOOST_CHECK_EQUAL(w.GetBalance(), 1 * COIN);
+
+    // A spend that is neither in the chain nor in the mempool doesn't count
+    CMutableTransaction tx2;
+    tx2.vin.push_back(CTxIn(tx1.GetHash(), 0));
+    tx2.vout.push_back(CTxOut(COIN / 2, GetScriptForDestination(key.GetPubKey().GetID())));
+    w.AddToWallet(CWalletTx(&w, tx2), true);
+    w.GetUnspentWalletTx(vWtx);
+    BOOST_CHECK_EQUAL(vWtx.size(), 2U);
+    BOOST_CHECK_EQUAL(w.GetBalance(), 1 * COIN);
+
+    // Once the spend is in the chain the spent transaction leaves the index
+    w.AddToWallet(confirmed_tx(w, tx2), true);
+    w.GetUnspentWalletTx(vWtx);
+    BOOST_CHECK_EQUAL(vWtx.size(), 1U);
+    BOOST_CHECK(vWtx[0]->GetHash() == tx2.GetHash());
+    BOOST_CHECK_EQUAL(w.GetBalance(), COIN / 2);
+
+    std::vector<COutput> vAvailable;
+    w.AvailableCoins(vAvailable);
+    BOOST_CHECK_EQUAL(vAvailable.size(), 1U);
+    BOOST_CHECK(vAvailable[0].tx->GetHash() == tx2.GetHash());
+
+    // A full rebuild ends up with the same index
+    w.MarkDirty();
+    w.GetUnspentWalletTx(vWtx);
+    BOOST_CHECK_EQUAL(vWtx.size(), 1U);
+    BOOST_CHECK_EQUAL(w.GetBalance(), COIN / 2);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_rescan)
+{
+    CWallet w;
+    CBlockIndex* pindexGenesis;
+    CBlock genesis;
+    {
+        LOCK(cs_main);
+        pindexGenesis = chainActive.Genesis();
+    }
+    BOOST_CHECK(ReadBlockFromDisk(genesis, pindexGenesis));
+    BOOST_CHECK(w.AddWatchOnly(genesis.vtx[0].vout[0].scriptPubKey));
+
+    // The rescan takes the locks itself and reports no progress once done. The
+    // wallet has no file to write to, so the count of added transactions stays 0.
+    w.ScanForWalletTransactions(pindexGenesis, true);
+    BOOST_CHECK_EQUAL(w.nRescanHeight, -1);
+    LOCK(w.cs_wallet);
+    BOOST_CHECK(w.mapWallet.count(genesis.vtx[0].GetHash()));
+}
+
+/** A stake input whose first nTxInFailures CreateTxIn calls fail */
+class CFailingStakeInput : public CStakeInput
+{
+public:
+    int nTxInFailures;
+    CFailingStakeInput(int nTxInFailuresIn) : nTxInFailures(nTxInFailuresIn) {}
+
+    CBlockIndex* GetIndexFrom() override { return NULL; }
+    bool CreateTxIn(CWallet* pwallet, CTxIn& txIn, uint256 hashTxOut = 0) override
+    {
+        if (nTxInFailures-- > 0)
+            return false;
+        txIn = CTxIn(COutPoint(uint256(1), 0));
+        return true;
+    }
+    bool GetTxFrom(CTransaction& tx) override { return false; }
+    CAmount GetValue() override { return COIN; }
+    bool CreateTxOuts(CWallet* pwallet, vector<CTxOut>& vout, CAmount nTotal) override
+    {
+        vout.push_back(CTxOut(0, CScript() << OP_TRUE));
+        return true;
+    }
+    bool GetModifier(uint64_t& nStakeModifier) override { return false; }
+    bool IsZVIT() override { return false; }
+    CDataStream GetUniqueness() override { return CDataStream(SER_GETHASH, 0); }
+    uint256 GetSerialHash() const override { return 0; }
+};
+
+BOOST_AUTO_TEST_CASE(wallet_coinstake_retry)
+{
+    CWallet w;
+    CMutableTransaction txNew;
+    txNew.vout.push_back(CTxOut(0, CScript()));
+
+    // A failed input leaves just the coin stake marker
+    CFailingStakeInput stakeFailing(1);
+    BOOST_CHECK(!w.FillCoinStake(&stakeFailing, 2 * COIN, false, txNew));
+    BOOST_REQUIRE_EQUAL(txNew.vout.size(), 1U);
+    BOOST_CHECK(txNew.vout[0].IsEmpty());
+    BOOST_CHECK(txNew.vin.empty());
+
+    // so the next one builds a well formed coin stake
+    CFailingStakeInput stake(0);
+    BOOST_CHECK(w.FillCoinStake(&stake, 2 * COIN, false, txNew));
+    BOOST_REQUIRE(txNew.vout.size() >= 2U);
+    BOOST_CHECK(txNew.vout[0].IsEmpty());
+    BOOST_CHECK(!txNew.vout[1].IsEmpty());
+    BOOST_CHECK_EQUAL(txNew.vin.size(), 1U);
+    BOOST_CHECK(CTransaction(txNew).IsCoinStake());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
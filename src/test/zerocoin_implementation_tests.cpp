@@ -11,6 +11,7 @@
 #include "key.h"
 #include "accumulatorcheckpoints.h"
 #include "libzerocoin/bignum.h"
+#include "libzerocoin/MultiExp.h"
 #include <boost/test/unit_test.hpp>
 #include <iostream>
 #include <accumulators.h>
@@ -465,6 +466,32 @@ BOOST_AUTO_TEST_CASE(bignum_setdecimal)
     BOOST_CHECK_MESSAGE(bnDec == bnHex, "CBigNum.SetDec() does not work correctly");
 }
 
+BOOST_AUTO_TEST_CASE(fixed_base_exp)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    ZerocoinParams* params = Params().Zerocoin_Params(false);
+    const IntegerGroupParams& group = params->serialNumberSoKCommitmentGroup;
+    std::shared_ptr<const SerialNumberSoKTables> tables = params->GetSoKTables();
+
+    // The tables must give exactly what pow_mod gives, for exponents that
+    // are negative or larger than the group order as well
+    for (int i = 0; i < 20; i++) {
+        CBigNum e1 = CBigNum::randBignum(group.groupOrder);
+        CBigNum e2 = CBigNum::RandKBitBigum(1200) - CBigNum::RandKBitBigum(1200);
+        BOOST_CHECK(tables->g.pow_mod(e1) == group.g.pow_mod(e1, group.modulus));
+        BOOST_CHECK(tables->h.pow_mod(e2) == group.h.pow_mod(e2, group.modulus));
+        BOOST_CHECK(MultiExp(tables->g, e1, tables->h, e2) ==
+                    group.g.pow_mod(e1, group.modulus).mul_mod(group.h.pow_mod(e2, group.modulus), group.modulus));
+        BOOST_CHECK(tables->b.pow_mod(-e1) == params->coinCommitmentGroup.h.pow_mod(-e1, group.groupOrder));
+    }
+    BOOST_CHECK(tables->a.pow_mod(0) == CBigNum(1));
+
+    // A base of unknown order falls back to pow_mod for negative exponents
+    FixedBaseTable table(CBigNum(3), group.modulus, 0);
+    BOOST_CHECK(table.pow_mod(-12345) == CBigNum(3).pow_mod(-12345, group.modulus));
+    BOOST_CHECK(table.pow_mod(group.modulus + 7) == CBigNum(3).pow_mod(group.modulus + 7, group.modulus));
+}
+
 BOOST_AUTO_TEST_CASE(test_checkpoints)
 {
     BOOST_CHECK_MESSAGE(AccumulatorCheckpoints::LoadCheckpoints("main"), "failed to load checkpoints");
@@ -15,6 +15,7 @@
 
 #include <stdint.h>
 
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -210,6 +211,39 @@ bool CBlockTreeDB::ReadInt(const std::string& name, int& nValue)
     return Read(std::make_pair('I', name), nValue);
 }
 
+/** Block index records are read in batches of this many, each deserialized in parallel. */
+static const size_t BLOCK_INDEX_LOAD_BATCH = 16384;
+
+/**
+ * Deserialize the block index records [nBegin, nEnd). The block hash is the
+ * record's key, it is only recomputed (along with the proof of work) when
+ * -checkblockindex is set.
+ */
+static void ParseBlockIndexRecords(const std::vector<std::pair<uint256, std::string> >& vRecords, std::vector<CDiskBlockIndex>& vIndex,
+    size_t nBegin, size_t nEnd, std::string& strError)
+{
+    for (size_t i = nBegin; i < nEnd; i++) {
+        const uint256& hash = vRecords[i].first;
+        try {
+            CDataStream ssValue(vRecords[i].second.data(), vRecords[i].second.data() + vRecords[i].second.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> vIndex[i];
+        } catch (const std::exception& e) {
+            strError = strprintf("Deserialize or I/O error - %s", e.what());
+            return;
+        }
+        if (!fCheckBlockIndex)
+            continue;
+        if (vIndex[i].GetBlockHash() != hash) {
+            strError = strprintf("block hash mismatch: %s", hash.GetHex());
+            return;
+        }
+        if (vIndex[i].nHeight <= Params().LAST_POW_BLOCK() && !CheckProofOfWork(hash, vIndex[i].nBits)) {
+            strError = strprintf("CheckProofOfWork failed: %s", hash.GetHex());
+            return;
+        }
+    }
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
     boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
@@ -218,78 +252,106 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
     ssKeySet << make_pair('b', uint256(0));
     pcursor->Seek(ssKeySet.str());
 
+    const int nThreads = std::max(1, (int)boost::thread::hardware_concurrency());
+    std::vector<std::pair<uint256, std::string> > vRecords;
+    std::vector<CDiskBlockIndex> vIndex;
+
     // Load mapBlockIndex
     uint256 nPreviousCheckpoint;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == 'b') {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskindex;
-                ssValue >> diskindex;
-
-                // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
-                pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
-                pindexNew->nHeight = diskindex.nHeight;
-                pindexNew->nFile = diskindex.nFile;
-                pindexNew->nDataPos = diskindex.nDataPos;
-                pindexNew->nUndoPos = diskindex.nUndoPos;
-                pindexNew->nVersion = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime = diskindex.nTime;
-                pindexNew->nBits = diskindex.nBits;
-                pindexNew->nNonce = diskindex.nNonce;
-                pindexNew->nStatus = diskindex.nStatus;
-                pindexNew->nTx = diskindex.nTx;
-
-                //zerocoin
-                pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
-                pindexNew->mapZerocoinSupply = diskindex.mapZerocoinSupply;
-                pindexNew->vMintDenominationsInBlock = diskindex.vMintDenominationsInBlock;
-
-                //Proof Of Stake
-                pindexNew->nMint = diskindex.nMint;
-                pindexNew->nMoneySupply = diskindex.nMoneySupply;
-                pindexNew->nFlags = diskindex.nFlags;
-                if (!Params().IsStakeModifierV2(pindexNew->nHeight, getStakeModifierV2SporkValue())) {
-                    pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                } else {
-                    pindexNew->nStakeModifierV2 = diskindex.nStakeModifierV2;
+    bool fDone = false;
+    while (!fDone) {
+        // Read a batch of raw records
+        vRecords.clear();
+        while (vRecords.size() < BLOCK_INDEX_LOAD_BATCH) {
+            boost::this_thread::interruption_point();
+            if (!pcursor->Valid()) {
+                fDone = true;
+                break;
+            }
+            try {
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chType;
+                ssKey >> chType;
+                if (chType != 'b') {
+                    fDone = true; // finished loading block index
+                    break;
                 }
-                pindexNew->prevoutStake = diskindex.prevoutStake;
-                pindexNew->nStakeTime = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
+                uint256 hash;
+                ssKey >> hash;
+                vRecords.push_back(make_pair(hash, pcursor->value().ToString()));
+                pcursor->Next();
+            } catch (const std::exception& e) {
+                return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+            }
+        }
+        if (vRecords.empty())
+            break;
+
+        // Deserialize it across threads
+        vIndex.clear();
+        vIndex.resize(vRecords.size());
+        const int nParts = std::min<int>(nThreads, (vRecords.size() + 1023) / 1024);
+        std::vector<std::string> vError(nParts);
+        boost::thread_group threadGroup;
+        for (int n = 1; n < nParts; n++)
+            threadGroup.create_thread(boost::bind(&ParseBlockIndexRecords, boost::cref(vRecords), boost::ref(vIndex),
+                vRecords.size() * n / nParts, vRecords.size() * (n + 1) / nParts, boost::ref(vError[n])));
+        ParseBlockIndexRecords(vRecords, vIndex, 0, vRecords.size() / nParts, vError[0]);
+        threadGroup.join_all();
+        for (const std::string& strError : vError) {
+            if (!strError.empty())
+                return error("%s : %s", __func__, strError);
+        }
 
-                if (pindexNew->nHeight <= Params().LAST_POW_BLOCK()) {
-                    if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits))
-                        return error("LoadBlockIndex() : CheckProofOfWork failed: %s", pindexNew->ToString());
-                }
-                // ppcoin: build setStakeSeen
-                if (pindexNew->IsProofOfStake())
-                    setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+        // Link it into mapBlockIndex
+        for (size_t i = 0; i < vRecords.size(); i++) {
+            const CDiskBlockIndex& diskindex = vIndex[i];
+
+            // Construct block index object
+            CBlockIndex* pindexNew = InsertBlockIndex(vRecords[i].first);
+            pindexNew->pprev = InsertBlockIndex(diskindex.hashPrev);
+            pindexNew->pnext = InsertBlockIndex(diskindex.hashNext);
+            pindexNew->nHeight = diskindex.nHeight;
+            pindexNew->nFile = diskindex.nFile;
+            pindexNew->nDataPos = diskindex.nDataPos;
+            pindexNew->nUndoPos = diskindex.nUndoPos;
+            pindexNew->nVersion = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime = diskindex.nTime;
+            pindexNew->nBits = diskindex.nBits;
+            pindexNew->nNonce = diskindex.nNonce;
+            pindexNew->nStatus = diskindex.nStatus;
+            pindexNew->nTx = diskindex.nTx;
+
+            //zerocoin
+            pindexNew->nAccumulatorCheckpoint = diskindex.nAccumulatorCheckpoint;
+            pindexNew->vZerocoinSupply = diskindex.vZerocoinSupply;
+            pindexNew->vMintsInBlock = diskindex.vMintsInBlock;
+
+            //Proof Of Stake
+            pindexNew->nMint = diskindex.nMint;
+            pindexNew->nMoneySupply = diskindex.nMoneySupply;
+            pindexNew->nFlags = diskindex.nFlags;
+            if (!Params().IsStakeModifierV2(pindexNew->nHeight, getStakeModifierV2SporkValue())) {
+                pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            } else {
+                pindexNew->nStakeModifierV2 = diskindex.nStakeModifierV2;
+            }
+            pindexNew->pstake = diskindex.pstake;
 
-                //populate accumulator checksum map in memory
-                if(pindexNew->nAccumulatorCheckpoint != 0 && pindexNew->nAccumulatorCheckpoint != nPreviousCheckpoint) {
-                    //Don't load any checkpoints that exist before v2 zvit. The accumulator is invalid for v1 and not used.
-                    if (pindexNew->nHeight >= Params().Zerocoin_Block_V2_Start())
-                        LoadAccumulatorValuesFromDB(pindexNew->nAccumulatorCheckpoint);
+            // ppcoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(make_pair(pindexNew->GetStakeData().prevoutStake, pindexNew->GetStakeData().nStakeTime));
 
-                    nPreviousCheckpoint = pindexNew->nAccumulatorCheckpoint;
-                }
+            //populate accumulator checksum map in memory
+            if(pindexNew->nAccumulatorCheckpoint != 0 && pindexNew->nAccumulatorCheckpoint != nPreviousCheckpoint) {
+                //Don't load any checkpoints that exist before v2 zvit. The accumulator is invalid for v1 and not used.
+                if (pindexNew->nHeight >= Params().Zerocoin_Block_V2_Start())
+                    LoadAccumulatorValuesFromDB(pindexNew->nAccumulatorCheckpoint);
 
-                pcursor->Next();
-            } else {
-                break; // if shutdown requested or finished loading block index
+                nPreviousCheckpoint = pindexNew->nAccumulatorCheckpoint;
             }
-        } catch (const std::exception& e) {
-            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
     }
 
@@ -430,3 +492,13 @@ bool CZerocoinDB::EraseAccumulatorValue(const uint32_t& nChecksum)
     LogPrint("zero", "%s : checksum:%d\n", __func__, nChecksum);
     return Erase(make_pair('2', nChecksum));
 }
+
+bool CZerocoinDB::WriteBlockPubcoins(const uint256& hashBlock, const std::vector<CBlockPubcoin>& vPubcoins)
+{
+    return Write(make_pair('b', hashBlock), vPubcoins);
+}
+
+bool CZerocoinDB::ReadBlockPubcoins(const uint256& hashBlock, std::vector<CBlockPubcoin>& vPubcoins)
+{
+    return Read(make_pair('b', hashBlock), vPubcoins);
+}
@@ -96,6 +96,9 @@ public:
     bool WriteAccumulatorValue(const uint32_t& nChecksum, const CBigNum& bnValue);
     bool ReadAccumulatorValue(const uint32_t& nChecksum, CBigNum& bnValue);
     bool EraseAccumulatorValue(const uint32_t& nChecksum);
+    /** Per-block list of minted pubcoins, so that accumulators can be computed without reading the block */
+    bool WriteBlockPubcoins(const uint256& hashBlock, const std::vector<CBlockPubcoin>& vPubcoins);
+    bool ReadBlockPubcoins(const uint256& hashBlock, std::vector<CBlockPubcoin>& vPubcoins);
 };
 
 #endif // BITCOIN_TXDB_H
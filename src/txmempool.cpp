@@ -19,16 +19,43 @@
 
 using namespace std;
 
-CTxMemPoolEntry::CTxMemPoolEntry() : nFee(0), nTxSize(0), nModSize(0), nTime(0), dPriority(0.0)
+/**
+ * Rough heap usage of a pool entry: the entry in its index nodes, the inputs,
+ * outputs and scripts of its transaction, and its mapNextTx nodes.
+ */
+static size_t EstimateMemoryUsage(const CTransaction& tx)
+{
+    // A red-black tree node holds three pointers and a colour next to its value
+    const size_t nNodeOverhead = 4 * sizeof(void*);
+    size_t nUsage = sizeof(CTxMemPoolEntry) + 4 * nNodeOverhead;
+    nUsage += tx.vin.capacity() * sizeof(CTxIn) + tx.vout.capacity() * sizeof(CTxOut);
+    BOOST_FOREACH (const CTxIn& txin, tx.vin)
+        nUsage += txin.scriptSig.capacity() + sizeof(std::pair<const COutPoint, CInPoint>) + nNodeOverhead;
+    BOOST_FOREACH (const CTxOut& txout, tx.vout)
+        nUsage += txout.scriptPubKey.capacity();
+    return nUsage;
+}
+
+CTxMemPoolEntry::CTxMemPoolEntry() : nFee(0), nTxSize(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0), feeDelta(0), fZerocoinSpend(false), dCachedPriority(0.0)
 {
     nHeight = MEMPOOL_HEIGHT;
+    nCountWithDescendants = 0;
+    nSizeWithDescendants = 0;
+    nModFeesWithDescendants = 0;
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) : tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight)
+CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight) : tx(_tx), nFee(_nFee), nTime(_nTime), dPriority(_dPriority), nHeight(_nHeight), feeDelta(0)
 {
     nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
 
     nModSize = tx.CalculateModifiedSize(nTxSize);
+    nUsageSize = EstimateMemoryUsage(tx);
+    fZerocoinSpend = tx.IsZerocoinSpend();
+    dCachedPriority = dPriority;
+
+    nCountWithDescendants = 1;
+    nSizeWithDescendants = nTxSize;
+    nModFeesWithDescendants = nFee;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -45,6 +72,21 @@ CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
     return dResult;
 }
 
+void CTxMemPoolEntry::UpdateFeeDelta(CAmount newFeeDelta)
+{
+    nModFeesWithDescendants += newFeeDelta - feeDelta;
+    feeDelta = newFeeDelta;
+}
+
+void CTxMemPoolEntry::UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount)
+{
+    nSizeWithDescendants += modifySize;
+    assert(int64_t(nSizeWithDescendants) > 0);
+    nModFeesWithDescendants += modifyFee;
+    nCountWithDescendants += modifyCount;
+    assert(int64_t(nCountWithDescendants) > 0);
+}
+
 /**
  * Keep track of fee/priority for transactions confirmed within N blocks
  */
@@ -358,7 +400,13 @@ public:
 
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) : nTransactionsUpdated(0),
-                                                       minRelayFee(_minRelayFee)
+                                                       minRelayFee(_minRelayFee),
+                                                       totalTxSize(0),
+                                                       cachedInnerUsage(0),
+                                                       lastRollingFeeUpdate(GetTime()),
+                                                       blockSinceLastRollingFeeBump(false),
+                                                       rollingMinimumFeeRate(0),
+                                                       nPriorityHeight(0)
 {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
@@ -404,6 +452,68 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
 }
 
 
+void CTxMemPool::CalculateAncestors(const CTransaction& tx, std::set<uint256>& setAncestors) const
+{
+    std::vector<const CTransaction*> vToVisit(1, &tx);
+    while (!vToVisit.empty()) {
+        const CTransaction& txVisit = *vToVisit.back();
+        vToVisit.pop_back();
+        if (txVisit.IsZerocoinSpend())
+            continue;
+        BOOST_FOREACH (const CTxIn& txin, txVisit.vin) {
+            indexed_transaction_set::const_iterator it = mapTx.find(txin.prevout.hash);
+            if (it != mapTx.end() && setAncestors.insert(txin.prevout.hash).second)
+                vToVisit.push_back(&it->GetTx());
+        }
+    }
+}
+
+bool CTxMemPool::CheckChainLimits(const CTransaction& tx, uint64_t limitAncestorCount, uint64_t limitDescendantCount, std::string& errString) const
+{
+    LOCK(cs);
+    if (tx.IsZerocoinSpend())
+        return true;
+
+    std::set<uint256> setAncestors;
+    std::vector<const CTransaction*> vToVisit(1, &tx);
+    while (!vToVisit.empty()) {
+        const CTransaction& txVisit = *vToVisit.back();
+        vToVisit.pop_back();
+        if (txVisit.IsZerocoinSpend())
+            continue;
+        BOOST_FOREACH (const CTxIn& txin, txVisit.vin) {
+            indexed_transaction_set::const_iterator it = mapTx.find(txin.prevout.hash);
+            if (it == mapTx.end() || !setAncestors.insert(txin.prevout.hash).second)
+                continue;
+            if (setAncestors.size() + 1 > limitAncestorCount) {
+                errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
+                return false;
+            }
+            if (it->GetCountWithDescendants() + 1 > limitDescendantCount) {
+                errString = strprintf("too many descendants for tx %s [limit: %u]", txin.prevout.hash.ToString(), limitDescendantCount);
+                return false;
+            }
+            vToVisit.push_back(&it->GetTx());
+        }
+    }
+    return true;
+}
+
+void CTxMemPool::CalculateDescendants(const uint256& hash, std::set<uint256>& setDescendants) const
+{
+    std::vector<uint256> vToVisit(1, hash);
+    while (!vToVisit.empty()) {
+        uint256 hashVisit = vToVisit.back();
+        vToVisit.pop_back();
+        std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.lower_bound(COutPoint(hashVisit, 0));
+        for (; it != mapNextTx.end() && it->first.hash == hashVisit; ++it) {
+            const uint256& hashChild = it->second.ptx->GetHash();
+            if (setDescendants.insert(hashChild).second)
+                vToVisit.push_back(hashChild);
+        }
+    }
+}
+
 bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry)
 {
     // Add to memory pool without checking anything.
@@ -411,18 +521,82 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry)
     // all the appropriate checks.
     LOCK(cs);
     {
-        mapTx[hash] = entry;
-        const CTransaction& tx = mapTx[hash].GetTx();
+        // Transactions put back into the pool by a reorg can have descendants
+        // in it already. Note their other ancestors before the links through
+        // the new transaction show up.
+        std::set<uint256> setDescendants;
+        CalculateDescendants(hash, setDescendants);
+        std::map<uint256, std::set<uint256> > mapDescendantAncestors;
+        BOOST_FOREACH (const uint256& hashDescendant, setDescendants)
+            CalculateAncestors(mapTx.find(hashDescendant)->GetTx(), mapDescendantAncestors[hashDescendant]);
+
+        txiter it = mapTx.insert(entry).first;
+        std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.find(hash);
+        if (pos != mapDeltas.end() && pos->second.second)
+            mapTx.modify(it, update_fee_delta(pos->second.second));
+        mapTx.modify(it, update_priority(CalculatePriority(*it)));
+
+        const CTransaction& tx = it->GetTx();
         if(!tx.IsZerocoinSpend()) {
             for (unsigned int i = 0; i < tx.vin.size(); i++)
                 mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
         }
+
+        // The new transaction and its descendants count towards the
+        // descendant state of each of its ancestors
+        std::set<uint256> setAncestors;
+        CalculateAncestors(tx, setAncestors);
+        BOOST_FOREACH (const uint256& hashAncestor, setAncestors)
+            mapTx.modify(mapTx.find(hashAncestor), update_descendant_state(it->GetTxSize(), it->GetModifiedFee(), 1));
+        BOOST_FOREACH (const uint256& hashDescendant, setDescendants) {
+            txiter itDescendant = mapTx.find(hashDescendant);
+            update_descendant_state addDescendant(itDescendant->GetTxSize(), itDescendant->GetModifiedFee(), 1);
+            mapTx.modify(it, addDescendant);
+            const std::set<uint256>& setCounted = mapDescendantAncestors[hashDescendant];
+            BOOST_FOREACH (const uint256& hashAncestor, setAncestors) {
+                if (!setCounted.count(hashAncestor))
+                    mapTx.modify(mapTx.find(hashAncestor), addDescendant);
+            }
+        }
+
         nTransactionsUpdated++;
-        totalTxSize += entry.GetTxSize();
+        totalTxSize += it->GetTxSize();
+        cachedInnerUsage += it->DynamicMemoryUsage();
     }
     return true;
 }
 
+void CTxMemPool::RemoveStaged(const std::vector<uint256>& vRemove, std::list<CTransaction>& removed)
+{
+    AssertLockHeld(cs);
+    const std::set<uint256> setRemove(vRemove.begin(), vRemove.end());
+
+    // Take the transactions out of the descendant state of the ancestors
+    // that stay, while the links to those are still in place
+    BOOST_FOREACH (const uint256& hash, vRemove) {
+        txiter it = mapTx.find(hash);
+        std::set<uint256> setAncestors;
+        CalculateAncestors(it->GetTx(), setAncestors);
+        update_descendant_state removeDescendant(-(int64_t)it->GetTxSize(), -it->GetModifiedFee(), -1);
+        BOOST_FOREACH (const uint256& hashAncestor, setAncestors) {
+            if (!setRemove.count(hashAncestor))
+                mapTx.modify(mapTx.find(hashAncestor), removeDescendant);
+        }
+    }
+
+    BOOST_FOREACH (const uint256& hash, vRemove) {
+        txiter it = mapTx.find(hash);
+        const CTransaction& tx = it->GetTx();
+        BOOST_FOREACH (const CTxIn& txin, tx.vin)
+            mapNextTx.erase(txin.prevout);
+
+        removed.push_back(tx);
+        totalTxSize -= it->GetTxSize();
+        cachedInnerUsage -= it->DynamicMemoryUsage();
+        mapTx.erase(it);
+        nTransactionsUpdated++;
+    }
+}
 
 void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& removed, bool fRecursive)
 {
@@ -443,13 +617,16 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
                 txToRemove.push_back(it->second.ptx->GetHash());
             }
         }
+        std::vector<uint256> vRemove;
+        std::set<uint256> setRemove;
         while (!txToRemove.empty()) {
             uint256 hash = txToRemove.front();
             txToRemove.pop_front();
-            if (!mapTx.count(hash))
+            if (!mapTx.count(hash) || !setRemove.insert(hash).second)
                 continue;
-            const CTransaction& tx = mapTx[hash].GetTx();
+            vRemove.push_back(hash);
             if (fRecursive) {
+                const CTransaction& tx = mapTx.find(hash)->GetTx();
                 for (unsigned int i = 0; i < tx.vout.size(); i++) {
                     std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(hash, i));
                     if (it == mapNextTx.end())
@@ -457,14 +634,8 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
                     txToRemove.push_back(it->second.ptx->GetHash());
                 }
             }
-            BOOST_FOREACH (const CTxIn& txin, tx.vin)
-                mapNextTx.erase(txin.prevout);
-
-            removed.push_back(tx);
-            totalTxSize -= mapTx[hash].GetTxSize();
-            mapTx.erase(hash);
-            nTransactionsUpdated++;
         }
+        RemoveStaged(vRemove, removed);
     }
 }
 
@@ -473,10 +644,10 @@ void CTxMemPool::removeCoinbaseSpends(const CCoinsViewCache* pcoins, unsigned in
     // Remove transactions spending a coinbase which are now immature
     LOCK(cs);
     list<CTransaction> transactionsToRemove;
-    for (std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
-        const CTransaction& tx = it->second.GetTx();
+    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
+        const CTransaction& tx = it->GetTx();
         BOOST_FOREACH (const CTxIn& txin, tx.vin) {
-            std::map<uint256, CTxMemPoolEntry>::const_iterator it2 = mapTx.find(txin.prevout.hash);
+            indexed_transaction_set::const_iterator it2 = mapTx.find(txin.prevout.hash);
             if (it2 != mapTx.end())
                 continue;
             const CCoins* coins = pcoins->AccessCoins(txin.prevout.hash);
@@ -517,9 +688,9 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
     LOCK(cs);
     std::vector<CTxMemPoolEntry> entries;
     BOOST_FOREACH (const CTransaction& tx, vtx) {
-        uint256 hash = tx.GetHash();
-        if (mapTx.count(hash))
-            entries.push_back(mapTx[hash]);
+        txiter it = mapTx.find(tx.GetHash());
+        if (it != mapTx.end())
+            entries.push_back(*it);
     }
     minerPolicyEstimator->seenBlock(entries, nBlockHeight, minRelayFee);
     BOOST_FOREACH (const CTransaction& tx, vtx) {
@@ -528,8 +699,122 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
         removeConflicts(tx, conflicts);
         ClearPrioritisation(tx.GetHash());
     }
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = true;
+    UpdatePriorities(nBlockHeight + 1);
+}
+
+double CTxMemPool::CalculatePriority(const CTxMemPoolEntry& entry) const
+{
+    AssertLockHeld(cs);
+    double dResult = entry.GetPriority(std::max(nPriorityHeight, entry.GetHeight()));
+    std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.find(entry.GetTx().GetHash());
+    if (pos != mapDeltas.end())
+        dResult += pos->second.first;
+    return dResult;
 }
 
+void CTxMemPool::UpdatePriorities(unsigned int nHeight)
+{
+    LOCK(cs);
+    if (nHeight == nPriorityHeight)
+        return;
+    nPriorityHeight = nHeight;
+    for (txiter it = mapTx.begin(); it != mapTx.end(); ++it)
+        mapTx.modify(it, update_priority(CalculatePriority(*it)));
+}
+
+void CTxMemPool::GetMinFeeExempt(const CFeeRate& minFeeRate, std::vector<txiter>& vExempt) const
+{
+    LOCK(cs);
+    // Zerocoin spends rank on top of the priority index
+    typedef indexed_transaction_set::index<mining_priority>::type::const_reverse_iterator priority_iter;
+    for (priority_iter it = mapTx.get<mining_priority>().rbegin(); it != mapTx.get<mining_priority>().rend() && it->IsZerocoinSpend(); ++it) {
+        if (CFeeRate(it->GetModifiedFee(), it->GetTxSize()) < minFeeRate)
+            vExempt.push_back(mapTx.project<0>(std::prev(it.base())));
+    }
+    for (std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.begin(); pos != mapDeltas.end(); ++pos) {
+        if (pos->second.first <= 0 && pos->second.second <= 0)
+            continue;
+        txiter it = mapTx.find(pos->first);
+        if (it == mapTx.end() || it->IsZerocoinSpend())
+            continue;
+        if (CFeeRate(it->GetModifiedFee(), it->GetTxSize()) < minFeeRate)
+            vExempt.push_back(it);
+    }
+}
+
+int CTxMemPool::Expire(int64_t time, std::list<CTransaction>& removed)
+{
+    LOCK(cs);
+    std::vector<CTransaction> vExpired;
+    indexed_transaction_set::index<entry_time>::type::iterator it = mapTx.get<entry_time>().begin();
+    while (it != mapTx.get<entry_time>().end() && it->GetTime() < time) {
+        vExpired.push_back(it->GetTx());
+        it++;
+    }
+    size_t nRemovedBefore = removed.size();
+    BOOST_FOREACH (const CTransaction& tx, vExpired)
+        remove(tx, removed, true);
+    return removed.size() - nRemovedBefore;
+}
+
+void CTxMemPool::trackPackageRemoved(const CFeeRate& rate)
+{
+    AssertLockHeld(cs);
+    if (rate.GetFeePerK() > rollingMinimumFeeRate) {
+        rollingMinimumFeeRate = rate.GetFeePerK();
+        blockSinceLastRollingFeeBump = false;
+    }
+}
+
+void CTxMemPool::TrimToSize(size_t sizelimit, std::list<CTransaction>& removed)
+{
+    LOCK(cs);
+    size_t nRemovedBefore = removed.size();
+    CFeeRate maxFeeRateRemoved(0);
+    while (!mapTx.empty() && cachedInnerUsage > sizelimit) {
+        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+
+        // A transaction replacing the evicted ones has to pay for its own
+        // relay on top of their fee rate
+        CFeeRate removedRate(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+        removedRate = CFeeRate(removedRate.GetFeePerK() + minRelayFee.GetFeePerK());
+        trackPackageRemoved(removedRate);
+        maxFeeRateRemoved = std::max(maxFeeRateRemoved, removedRate);
+
+        CTransaction tx = it->GetTx();
+        remove(tx, removed, true);
+    }
+    if (maxFeeRateRemoved > CFeeRate(0))
+        LogPrint("mempool", "Removed %u txn, rolling minimum fee bumped to %s\n", removed.size() - nRemovedBefore, maxFeeRateRemoved.ToString());
+}
+
+CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const
+{
+    LOCK(cs);
+    if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
+        return CFeeRate((CAmount)rollingMinimumFeeRate);
+
+    int64_t time = GetTime();
+    if (time > lastRollingFeeUpdate + 10) {
+        // Decay faster while the pool is well below its limit
+        double halflife = ROLLING_FEE_HALFLIFE;
+        if (cachedInnerUsage < sizelimit / 4)
+            halflife /= 4;
+        else if (cachedInnerUsage < sizelimit / 2)
+            halflife /= 2;
+
+        rollingMinimumFeeRate = rollingMinimumFeeRate / pow(2.0, (time - lastRollingFeeUpdate) / halflife);
+        lastRollingFeeUpdate = time;
+
+        if (rollingMinimumFeeRate < minRelayFee.GetFeePerK() / 2) {
+            rollingMinimumFeeRate = 0;
+            return CFeeRate(0);
+        }
+    }
+    return std::max(CFeeRate((CAmount)rollingMinimumFeeRate), minRelayFee);
+}
 
 void CTxMemPool::clear()
 {
@@ -537,6 +822,10 @@ void CTxMemPool::clear()
     mapTx.clear();
     mapNextTx.clear();
     totalTxSize = 0;
+    cachedInnerUsage = 0;
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = false;
+    rollingMinimumFeeRate = 0;
     ++nTransactionsUpdated;
 }
 
@@ -548,21 +837,41 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
     LogPrint("mempool", "Checking mempool with %u transactions and %u inputs\n", (unsigned int)mapTx.size(), (unsigned int)mapNextTx.size());
 
     uint64_t checkTotal = 0;
+    uint64_t innerUsage = 0;
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(pcoins));
 
     LOCK(cs);
     list<const CTxMemPoolEntry*> waitingOnDependants;
-    for (std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
+    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
         unsigned int i = 0;
-        checkTotal += it->second.GetTxSize();
-        const CTransaction& tx = it->second.GetTx();
+        checkTotal += it->GetTxSize();
+        innerUsage += it->DynamicMemoryUsage();
+        const CTransaction& tx = it->GetTx();
         bool fDependsWait = false;
+
+        // Check the descendant state against the descendants linked through mapNextTx
+        std::set<uint256> setDescendants;
+        CalculateDescendants(tx.GetHash(), setDescendants);
+        uint64_t nCountCheck = 1;
+        uint64_t nSizeCheck = it->GetTxSize();
+        CAmount nFeesCheck = it->GetModifiedFee();
+        BOOST_FOREACH (const uint256& hashDescendant, setDescendants) {
+            indexed_transaction_set::const_iterator itDescendant = mapTx.find(hashDescendant);
+            nCountCheck++;
+            nSizeCheck += itDescendant->GetTxSize();
+            nFeesCheck += itDescendant->GetModifiedFee();
+        }
+        assert(it->GetCountWithDescendants() == nCountCheck);
+        assert(it->GetSizeWithDescendants() == nSizeCheck);
+        assert(it->GetModFeesWithDescendants() == nFeesCheck);
+        assert(it->GetCachedPriority() == CalculatePriority(*it));
+
         BOOST_FOREACH (const CTxIn& txin, tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
-            std::map<uint256, CTxMemPoolEntry>::const_iterator it2 = mapTx.find(txin.prevout.hash);
+            indexed_transaction_set::const_iterator it2 = mapTx.find(txin.prevout.hash);
             if (it2 != mapTx.end()) {
-                const CTransaction& tx2 = it2->second.GetTx();
+                const CTransaction& tx2 = it2->GetTx();
                 assert(tx2.vout.size() > txin.prevout.n && !tx2.vout[txin.prevout.n].IsNull());
                 fDependsWait = true;
             } else {
@@ -577,7 +886,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
             i++;
         }
         if (fDependsWait)
-            waitingOnDependants.push_back(&it->second);
+            waitingOnDependants.push_back(&(*it));
         else {
             CValidationState state;
             CTxUndo undo;
@@ -603,15 +912,16 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins) const
     }
     for (std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.begin(); it != mapNextTx.end(); it++) {
         uint256 hash = it->second.ptx->GetHash();
-        map<uint256, CTxMemPoolEntry>::const_iterator it2 = mapTx.find(hash);
-        const CTransaction& tx = it2->second.GetTx();
+        indexed_transaction_set::const_iterator it2 = mapTx.find(hash);
         assert(it2 != mapTx.end());
+        const CTransaction& tx = it2->GetTx();
         assert(&tx == it->second.ptx);
         assert(tx.vin.size() > it->second.n);
         assert(it->first == it->second.ptx->vin[it->second.n].prevout);
     }
 
     assert(totalTxSize == checkTotal);
+    assert(cachedInnerUsage == innerUsage);
 }
 
 void CTxMemPool::queryHashes(vector<uint256>& vtxid)
@@ -620,8 +930,8 @@ void CTxMemPool::queryHashes(vector<uint256>& vtxid)
 
     LOCK(cs);
     vtxid.reserve(mapTx.size());
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
-        vtxid.push_back((*mi).first);
+    for (indexed_transaction_set::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
+        vtxid.push_back(mi->GetTx().GetHash());
 }
 
 void CTxMemPool::getTransactions(std::set<uint256>& setTxid)
@@ -629,16 +939,16 @@ void CTxMemPool::getTransactions(std::set<uint256>& setTxid)
     setTxid.clear();
 
     LOCK(cs);
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
-        setTxid.insert((*mi).first);
+    for (indexed_transaction_set::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
+        setTxid.insert(mi->GetTx().GetHash());
 }
 
 bool CTxMemPool::lookup(uint256 hash, CTransaction& result) const
 {
     LOCK(cs);
-    map<uint256, CTxMemPoolEntry>::const_iterator i = mapTx.find(hash);
+    indexed_transaction_set::const_iterator i = mapTx.find(hash);
     if (i == mapTx.end()) return false;
-    result = i->second.GetTx();
+    result = i->GetTx();
     return true;
 }
 
@@ -691,6 +1001,15 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const string strHash,
         std::pair<double, CAmount>& deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end()) {
+            mapTx.modify(it, update_priority(CalculatePriority(*it)));
+            mapTx.modify(it, update_fee_delta(deltas.second));
+            std::set<uint256> setAncestors;
+            CalculateAncestors(it->GetTx(), setAncestors);
+            BOOST_FOREACH (const uint256& hashAncestor, setAncestors)
+                mapTx.modify(mapTx.find(hashAncestor), update_descendant_state(0, nFeeDelta, 0));
+        }
     }
     LogPrintf("PrioritiseTransaction: %s priority += %f, fee += %d\n", strHash, dPriorityDelta, FormatMoney(nFeeDelta));
 }
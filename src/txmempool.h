@@ -10,12 +10,17 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <list>
+#include <set>
 
 #include "amount.h"
 #include "coins.h"
 #include "primitives/transaction.h"
 #include "sync.h"
 
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
+
 class CAutoFile;
 
 inline double AllowFreeThreshold()
@@ -44,9 +49,19 @@ private:
     CAmount nFee;         //! Cached to avoid expensive parent-transaction lookups
     size_t nTxSize;       //! ... and avoid recomputing tx size
     size_t nModSize;      //! ... and modified size for priority
+    size_t nUsageSize;    //! ... and estimated memory usage
     int64_t nTime;        //! Local time when entering the mempool
     double dPriority;     //! Priority when entering the mempool
     unsigned int nHeight; //! Chain height when entering the mempool
+    CAmount feeDelta;     //! Fee delta set by PrioritiseTransaction
+    bool fZerocoinSpend;  //! Cached to avoid scanning the inputs when sorting
+    double dCachedPriority; //! Priority at CTxMemPool::nPriorityHeight, with its priority delta
+
+    // Totals for this transaction and all its descendants in the mempool,
+    // kept up to date by CTxMemPool as transactions enter and leave it
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
 
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
@@ -56,11 +71,177 @@ public:
     const CTransaction& GetTx() const { return this->tx; }
     double GetPriority(unsigned int currentHeight) const;
     CAmount GetFee() const { return nFee; }
+    CAmount GetModifiedFee() const { return nFee + feeDelta; }
     size_t GetTxSize() const { return nTxSize; }
+    size_t DynamicMemoryUsage() const { return nUsageSize; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return nHeight; }
+    bool IsZerocoinSpend() const { return fZerocoinSpend; }
+    double GetCachedPriority() const { return dCachedPriority; }
+
+    uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
+    uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
+    CAmount GetModFeesWithDescendants() const { return nModFeesWithDescendants; }
+
+    void UpdateFeeDelta(CAmount newFeeDelta);
+
+    friend struct update_priority;
+    void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
+};
+
+// Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
+struct update_descendant_state {
+    update_descendant_state(int64_t _modifySize, CAmount _modifyFee, int64_t _modifyCount) : modifySize(_modifySize), modifyFee(_modifyFee), modifyCount(_modifyCount) {}
+
+    void operator()(CTxMemPoolEntry& e) { e.UpdateDescendantState(modifySize, modifyFee, modifyCount); }
+
+private:
+    int64_t modifySize;
+    CAmount modifyFee;
+    int64_t modifyCount;
+};
+
+struct update_priority {
+    update_priority(double _dPriority) : dPriority(_dPriority) {}
+
+    void operator()(CTxMemPoolEntry& e) { e.dCachedPriority = dPriority; }
+
+private:
+    double dPriority;
+};
+
+struct update_fee_delta {
+    update_fee_delta(CAmount _feeDelta) : feeDelta(_feeDelta) {}
+
+    void operator()(CTxMemPoolEntry& e) { e.UpdateFeeDelta(feeDelta); }
+
+private:
+    CAmount feeDelta;
+};
+
+// extracts a transaction hash from CTxMemPoolEntry
+struct mempoolentry_txid {
+    typedef uint256 result_type;
+    result_type operator()(const CTxMemPoolEntry& entry) const
+    {
+        return entry.GetTx().GetHash();
+    }
+};
+
+/** Sort by modified fee rate, lowest first. Ties go to the older transaction. */
+class CompareTxMemPoolEntryByModFeeRate
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        // a.fee / a.size < b.fee / b.size without the divisions
+        double f1 = (double)a.GetModifiedFee() * b.GetTxSize();
+        double f2 = (double)b.GetModifiedFee() * a.GetTxSize();
+        if (f1 == f2)
+            return a.GetTime() > b.GetTime();
+        return f1 < f2;
+    }
+};
+
+/**
+ * Sort by the higher of the fee rate of a transaction alone and the fee rate
+ * of it together with its descendants, lowest first. Evicting the lowest
+ * entry and its descendants frees space at the least cost in fees.
+ * Zerocoin spends pay no fee and enter the pool without one, so they rank
+ * above everything else, the longest waiting last.
+ */
+class CompareTxMemPoolEntryByDescendantScore
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        if (a.IsZerocoinSpend() != b.IsZerocoinSpend())
+            return b.IsZerocoinSpend();
+
+        bool fUseADescendants = UseDescendantScore(a);
+        bool fUseBDescendants = UseDescendantScore(b);
+
+        double aModFee = fUseADescendants ? a.GetModFeesWithDescendants() : a.GetModifiedFee();
+        double aSize = fUseADescendants ? a.GetSizeWithDescendants() : a.GetTxSize();
+        double bModFee = fUseBDescendants ? b.GetModFeesWithDescendants() : b.GetModifiedFee();
+        double bSize = fUseBDescendants ? b.GetSizeWithDescendants() : b.GetTxSize();
+
+        // Avoid division by rewriting (a/b > c/d) as (a*d > c*b).
+        double f1 = aModFee * bSize;
+        double f2 = aSize * bModFee;
+        if (f1 == f2)
+            return a.GetTime() > b.GetTime();
+        return f1 < f2;
+    }
+
+    // Whether the descendant fee rate of a is higher than its own
+    bool UseDescendantScore(const CTxMemPoolEntry& a) const
+    {
+        double f1 = (double)a.GetModifiedFee() * a.GetSizeWithDescendants();
+        double f2 = (double)a.GetModFeesWithDescendants() * a.GetTxSize();
+        return f2 > f1;
+    }
+};
+
+/**
+ * Sort by cached coin age priority, lowest first. Zerocoin spends have no
+ * coin age; they rank above everything else, the longest waiting first.
+ */
+class CompareTxMemPoolEntryByPriority
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        if (a.IsZerocoinSpend() != b.IsZerocoinSpend())
+            return b.IsZerocoinSpend();
+        if (a.IsZerocoinSpend() || a.GetCachedPriority() == b.GetCachedPriority())
+            return a.GetTime() > b.GetTime();
+        return a.GetCachedPriority() < b.GetCachedPriority();
+    }
+};
+
+class CompareTxMemPoolEntryByEntryTime
+{
+public:
+    bool operator()(const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) const
+    {
+        return a.GetTime() < b.GetTime();
+    }
 };
 
+// Multi_index tag names
+struct modified_feerate {};
+struct entry_time {};
+struct descendant_score {};
+struct mining_priority {};
+
+typedef boost::multi_index_container<
+    CTxMemPoolEntry,
+    boost::multi_index::indexed_by<
+        // sorted by txid
+        boost::multi_index::ordered_unique<mempoolentry_txid>,
+        // sorted by modified fee rate
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<modified_feerate>,
+            boost::multi_index::identity<CTxMemPoolEntry>,
+            CompareTxMemPoolEntryByModFeeRate>,
+        // sorted by entry time
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<entry_time>,
+            boost::multi_index::identity<CTxMemPoolEntry>,
+            CompareTxMemPoolEntryByEntryTime>,
+        // sorted by score (for eviction)
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<descendant_score>,
+            boost::multi_index::identity<CTxMemPoolEntry>,
+            CompareTxMemPoolEntryByDescendantScore>,
+        // sorted by cached priority, for block assembly
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<mining_priority>,
+            boost::multi_index::identity<CTxMemPoolEntry>,
+            CompareTxMemPoolEntryByPriority> > >
+    indexed_transaction_set;
+
 class CMinerPolicyEstimator;
 
 /** An inpoint - a combination of a transaction and an index n into its vin */
@@ -93,6 +274,16 @@ public:
  * are added to the pool: if a new transaction double-spends
  * an input of a transaction in the pool, it is dropped,
  * as are non-standard transactions.
+ *
+ * mapTx is indexed by txid, by modified fee rate and by priority for block
+ * assembly, by entry time for expiry and by descendant score for eviction.
+ * Priorities grow with the chain, so the priority index holds them as of
+ * nPriorityHeight and UpdatePriorities moves them along with the tip. When the pool
+ * outgrows its size limit, TrimToSize evicts the transactions with the
+ * lowest descendant score together with their descendants, and raises a
+ * rolling minimum fee rate for new transactions above that of the evicted
+ * ones. The minimum decays back to zero with a half-life of
+ * ROLLING_FEE_HALFLIFE once blocks come in.
  */
 class CTxMemPool
 {
@@ -103,10 +294,26 @@ private:
 
     CFeeRate minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
+    uint64_t cachedInnerUsage; //! sum of the estimated memory usage of all entries
+
+    mutable int64_t lastRollingFeeUpdate;
+    mutable bool blockSinceLastRollingFeeBump;
+    mutable double rollingMinimumFeeRate; //! minimum fee rate in satoshis per 1000 bytes to get into the pool
+    unsigned int nPriorityHeight; //! height the cached priorities of the entries are computed for
+
+    void trackPackageRemoved(const CFeeRate& rate);
+    void CalculateAncestors(const CTransaction& tx, std::set<uint256>& setAncestors) const;
+    void CalculateDescendants(const uint256& hash, std::set<uint256>& setDescendants) const;
+    void RemoveStaged(const std::vector<uint256>& vRemove, std::list<CTransaction>& removed);
+    double CalculatePriority(const CTxMemPoolEntry& entry) const;
 
 public:
+    static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12;
+
+    typedef indexed_transaction_set::nth_index<0>::type::iterator txiter;
+
     mutable CCriticalSection cs;
-    std::map<uint256, CTxMemPoolEntry> mapTx;
+    indexed_transaction_set mapTx;
     std::map<COutPoint, CInPoint> mapNextTx;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
 
@@ -123,10 +330,31 @@ public:
     void setSanityCheck(bool _fSanityCheck) { fSanityCheck = _fSanityCheck; }
 
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry);
+    /**
+     * Whether tx stays within the chain limits: at most limitAncestorCount transactions
+     * in the pool with its ancestors, and at most limitDescendantCount with the
+     * descendants of each ancestor, tx included in both. errString says which one it
+     * exceeds. The walk stops there, so a long chain costs no more than the limits.
+     */
+    bool CheckChainLimits(const CTransaction& tx, uint64_t limitAncestorCount, uint64_t limitDescendantCount, std::string& errString) const;
     void remove(const CTransaction& tx, std::list<CTransaction>& removed, bool fRecursive = false);
     void removeCoinbaseSpends(const CCoinsViewCache* pcoins, unsigned int nMemPoolHeight);
     void removeConflicts(const CTransaction& tx, std::list<CTransaction>& removed);
     void removeForBlock(const std::vector<CTransaction>& vtx, unsigned int nBlockHeight, std::list<CTransaction>& conflicts);
+    /** Remove transactions that entered the pool before time, with their descendants. Returns the number removed. */
+    int Expire(int64_t time, std::list<CTransaction>& removed);
+    /** Evict the lowest descendant score transactions and their descendants until the pool uses at most sizelimit bytes */
+    void TrimToSize(size_t sizelimit, std::list<CTransaction>& removed);
+    /** The fee rate a transaction needs to enter a pool limited to sizelimit bytes */
+    CFeeRate GetMinFee(size_t sizelimit) const;
+    /** Recompute the cached priorities for a block at nHeight; does nothing if they already are */
+    void UpdatePriorities(unsigned int nHeight);
+    /**
+     * The zerocoin spends and the transactions with a positive priority or fee delta
+     * whose modified fee rate is below minFeeRate. Block assembly takes these even
+     * though they pay less than the relay fee, without walking the cheap rest of the pool.
+     */
+    void GetMinFeeExempt(const CFeeRate& minFeeRate, std::vector<txiter>& vExempt) const;
     void clear();
     void queryHashes(std::vector<uint256>& vtxid);
     void getTransactions(std::set<uint256>& setTxid);
@@ -149,6 +377,11 @@ public:
         LOCK(cs);
         return totalTxSize;
     }
+    size_t DynamicMemoryUsage() const
+    {
+        LOCK(cs);
+        return cachedInnerUsage;
+    }
 
     bool exists(uint256 hash)
     {
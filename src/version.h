@@ -11,7 +11,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 71026;
+static const int PROTOCOL_VERSION = 71027;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -19,6 +19,9 @@ static const int INIT_PROTO_VERSION = 209;
 //! In this version, 'getheaders' was introduced.
 static const int GETHEADERS_VERSION = 70077;
 
+//! In this version, 'getheaders' is answered with 'headers' and blocks are downloaded headers first.
+static const int HEADERS_FIRST_VERSION = 71027;
+
 //! disconnect from peers older than this proto version
 static const int MIN_PEER_PROTO_VERSION_BEFORE_ENFORCEMENT = 71010;
 static const int MIN_PEER_PROTO_VERSION_AFTER_ENFORCEMENT = 71026;
@@ -34,6 +34,7 @@
 #include "zvitwallet.h"
 #include "primitives/deterministicmint.h"
 #include <assert.h>
+#include <limits>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -467,6 +468,67 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::QueueWalletUTXO(const CTransaction& tx)
+{
+    AssertLockHeld(cs_wallet);
+    setWalletUTXOQueue.insert(tx.GetHash());
+    if (tx.IsCoinBase() || tx.IsZerocoinSpend())
+        return;
+    // Whether the outputs it spends are spent in the chain depends on this transaction
+    BOOST_FOREACH (const CTxIn& txin, tx.vin)
+        setWalletUTXOQueue.insert(txin.prevout.hash);
+}
+
+void CWallet::UpdateWalletUTXO(const uint256& hash) const
+{
+    setWalletUTXO.erase(setWalletUTXO.lower_bound(COutPoint(hash, 0)),
+        setWalletUTXO.upper_bound(COutPoint(hash, std::numeric_limits<uint32_t>::max())));
+
+    std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hash);
+    if (mi == mapWallet.end())
+        return;
+
+    const CWalletTx& wtx = mi->second;
+    for (unsigned int i = 0; i < wtx.vout.size(); i++) {
+        if (IsMine(wtx.vout[i]) == ISMINE_NO)
+            continue;
+
+        // Spends that are only in the mempool may still go away, IsSpent checks those
+        bool fSpentInChain = false;
+        std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range = mapTxSpends.equal_range(COutPoint(hash, i));
+        for (TxSpends::const_iterator it = range.first; it != range.second && !fSpentInChain; ++it) {
+            std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+            fSpentInChain = mit != mapWallet.end() && mit->second.GetDepthInMainChain(false) > 0;
+        }
+        if (!fSpentInChain)
+            setWalletUTXO.insert(COutPoint(hash, i));
+    }
+}
+
+void CWallet::GetUnspentWalletTx(std::vector<const CWalletTx*>& vWtx) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (fWalletUTXODirty) {
+        setWalletUTXO.clear();
+        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+            UpdateWalletUTXO(it->first);
+        fWalletUTXODirty = false;
+    } else {
+        BOOST_FOREACH (const uint256& hash, setWalletUTXOQueue)
+            UpdateWalletUTXO(hash);
+    }
+    setWalletUTXOQueue.clear();
+
+    vWtx.clear();
+    for (std::set<COutPoint>::const_iterator it = setWalletUTXO.begin(); it != setWalletUTXO.end(); ++it) {
+        if (!vWtx.empty() && vWtx.back()->GetHash() == it->hash)
+            continue;
+        vWtx.push_back(&mapWallet.find(it->hash)->second);
+    }
+}
+
 bool CWallet::GetFundamentalnodeVinAndKeys(CTxIn& txinRet, CPubKey& pubKeyRet, CKey& keyRet, std::string strTxHash, std::string strOutputIndex)
 {
     // wait for reindex and/or import to finish
@@ -638,6 +700,8 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         BOOST_FOREACH (PAIRTYPE(const uint256, CWalletTx) & item, mapWallet)
             item.second.MarkDirty();
+        fStakeCandidatesDirty = true;
+        fWalletUTXODirty = true;
     }
 }
 
@@ -646,13 +710,17 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
     uint256 hash = wtxIn.GetHash();
 
     if (fFromLoadWallet) {
+        AssertLockHeld(cs_wallet); // CWalletDB::LoadWallet
+        fStakeCandidatesDirty = true;
         mapWallet[hash] = wtxIn;
         CWalletTx& wtx = mapWallet[hash];
         wtx.BindWallet(this);
         wtxOrdered.insert(make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         AddToSpends(hash);
+        QueueWalletUTXO(wtx);
     } else {
         LOCK(cs_wallet);
+        fStakeCandidatesDirty = true;
         // Inserts only if not already there, returns tx inserted or tx found
         pair<map<uint256, CWalletTx>::iterator, bool> ret = mapWallet.insert(make_pair(hash, wtxIn));
         CWalletTx& wtx = (*ret.first).second;
@@ -695,6 +763,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet)
 
         // Break debit/credit balance caches:
         wtx.MarkDirty();
+        QueueWalletUTXO(wtx);
 
         // Notify UI of new or updated transaction
         NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -747,14 +816,30 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
     }
 }
 
+void CWallet::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    // Keep cached zVITAE witnesses just behind the oldest checkpoint a stake can use, so that they stay
+    // valid for both spends and stakes
+    int nHeightTarget = pindex->nHeight - Params().Zerocoin_RequiredStakeDepth() - 20;
+    if (!zvitTracker || pindex->nHeight < Params().Zerocoin_Block_V2_Start() || nHeightTarget <= 0)
+        return;
+
+    zvitTracker->AdvanceWitnesses(nHeightTarget - (nHeightTarget % 10));
+}
+
 void CWallet::EraseFromWallet(const uint256& hash)
 {
     if (!fFileBacked)
         return;
     {
         LOCK(cs_wallet);
-        if (mapWallet.erase(hash))
+        std::map<uint256, CWalletTx>::iterator it = mapWallet.find(hash);
+        if (it != mapWallet.end()) {
+            QueueWalletUTXO(it->second);
+            mapWallet.erase(it);
             CWalletDB(strWalletFile).EraseTx(hash);
+        }
+        fStakeCandidatesDirty = true;
     }
     return;
 }
@@ -1432,10 +1517,46 @@ bool CWalletTx::WriteToDisk()
     return CWalletDB(pwallet->strWalletFile).WriteTx(GetHash(), *this);
 }
 
+namespace {
+//! Number of blocks a rescan reads ahead and adds to the wallet at a time
+const unsigned int RESCAN_CHUNK_BLOCKS = 200;
+
+struct CRescanBlock {
+    CBlockIndex* pindex;
+    CBlock block;
+    //! Whether each transaction of block pays to the wallet keys or scripts
+    std::vector<char> vIsMine;
+};
+
+void GetRescanChunk(CBlockIndex* pindex, std::vector<CRescanBlock>& vChunk)
+{
+    AssertLockHeld(cs_main);
+    vChunk.clear();
+    for (; pindex && vChunk.size() < RESCAN_CHUNK_BLOCKS; pindex = chainActive.Next(pindex)) {
+        vChunk.push_back(CRescanBlock());
+        vChunk.back().pindex = pindex;
+    }
+}
+
+void ReadRescanChunk(std::vector<CRescanBlock>* pvChunk)
+{
+    BOOST_FOREACH (CRescanBlock& item, *pvChunk)
+        ReadBlockFromDisk(item.block, item.pindex);
+}
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * Blocks are handled a chunk at a time: the next chunk is read from disk
+ * while the outputs of the current one are matched against the keystore
+ * on several threads, and the matches are then added to the wallet in
+ * block order under cs_main and cs_wallet. Inputs are matched there, as
+ * they may spend an output found earlier in the same chunk. The locks are
+ * released between chunks, and a chunk that a reorg took out of the
+ * active chain is rescanned from the fork.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
@@ -1446,83 +1567,144 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
         zvitTracker->Init();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart, dProgressTip;
+    std::vector<CRescanBlock> vChunk, vNext;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - 7200)) && pindex->nHeight <= Params().Zerocoin_StartHeight())
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
-        set<uint256> setAddedToWallet;
-        while (pindex) {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-            BOOST_FOREACH (CTransaction& tx, block.vtx) {
-                if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                    ret++;
+        dProgressStart = Checkpoints::GuessVerificationProgress(pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainActive.Tip(), false);
+        GetRescanChunk(pindex, vNext);
+    }
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    nRescanProgress = 0;
+    nRescanHeight = pindex ? pindex->nHeight : -1;
+    ReadRescanChunk(&vNext);
+
+    const int nThreads = std::max(1, (int)boost::thread::hardware_concurrency());
+    set<uint256> setAddedToWallet;
+    while (!vNext.empty()) {
+        vChunk.swap(vNext);
+        {
+            LOCK(cs_main);
+            GetRescanChunk(chainActive.Next(chainActive.FindFork(vChunk.back().pindex)), vNext);
+        }
+        boost::thread threadRead(boost::bind(&ReadRescanChunk, &vNext));
+
+        // Only the keystore is consulted here, which has its own lock
+        std::atomic<size_t> nNextBlock(0);
+        auto matchWork = [&]() {
+            for (size_t i = nNextBlock++; i < vChunk.size(); i = nNextBlock++) {
+                CRescanBlock& item = vChunk[i];
+                item.vIsMine.resize(item.block.vtx.size());
+                for (unsigned int j = 0; j < item.block.vtx.size(); j++)
+                    item.vIsMine[j] = IsMine(item.block.vtx[j]);
             }
+        };
+        boost::thread_group threadGroup;
+        for (int i = 1; i < std::min(nThreads, (int)vChunk.size()); i++)
+            threadGroup.create_thread(matchWork);
+        matchWork();
+        threadGroup.join_all();
+
+        // The block the next chunk has to follow on from
+        CBlockIndex* pindexResume = vChunk.back().pindex;
+        {
+            LOCK2(cs_main, cs_wallet);
+            BOOST_FOREACH (CRescanBlock& item, vChunk) {
+                pindex = item.pindex;
+                if (!chainActive.Contains(pindex)) {
+                    pindexResume = pindex->pprev;
+                    break;
+                }
 
-            //If this is a zapwallettx, need to readd zvit
-            if (fCheckZVIT && pindex->nHeight >= Params().Zerocoin_StartHeight()) {
-                list<CZerocoinMint> listMints;
-                BlockToZerocoinMintList(block, listMints, true);
-
-                for (auto& m : listMints) {
-                    if (IsMyMint(m.GetValue())) {
-                        LogPrint("zero", "%s: found mint\n", __func__);
-                        pwalletMain->UpdateMint(m.GetValue(), pindex->nHeight, m.GetTxHash(), m.GetDenomination());
-
-                        // Add the transaction to the wallet
-                        for (auto& tx : block.vtx) {
-                            uint256 txid = tx.GetHash();
-                            if (setAddedToWallet.count(txid) || mapWallet.count(txid))
-                                continue;
-                            if (txid == m.GetTxHash()) {
-                                CWalletTx wtx(pwalletMain, tx);
-                                wtx.nTimeReceived = block.GetBlockTime();
-                                wtx.SetMerkleBranch(block);
-                                pwalletMain->AddToWallet(wtx);
-                                setAddedToWallet.insert(txid);
+                if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
+                    nRescanProgress = std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100)));
+                    ShowProgress(_("Rescanning..."), nRescanProgress);
+                }
+                nRescanHeight = pindex->nHeight;
+
+                CBlock& block = item.block;
+                for (unsigned int i = 0; i < block.vtx.size(); i++) {
+                    const CTransaction& tx = block.vtx[i];
+                    if (!item.vIsMine[i] && !mapWallet.count(tx.GetHash()) && !IsFromMe(tx))
+                        continue;
+                    if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
+                        ret++;
+                }
+
+                //If this is a zapwallettx, need to readd zvit
+                if (fCheckZVIT && pindex->nHeight >= Params().Zerocoin_StartHeight()) {
+                    list<CZerocoinMint> listMints;
+                    BlockToZerocoinMintList(block, listMints, true);
+
+                    for (auto& m : listMints) {
+                        if (IsMyMint(m.GetValue())) {
+                            LogPrint("zero", "%s: found mint\n", __func__);
+                            pwalletMain->UpdateMint(m.GetValue(), pindex->nHeight, m.GetTxHash(), m.GetDenomination());
+
+                            // Add the transaction to the wallet
+                            for (auto& tx : block.vtx) {
+                                uint256 txid = tx.GetHash();
+                                if (setAddedToWallet.count(txid) || mapWallet.count(txid))
+                                    continue;
+                                if (txid == m.GetTxHash()) {
+                                    CWalletTx wtx(pwalletMain, tx);
+                                    wtx.nTimeReceived = block.GetBlockTime();
+                                    wtx.SetMerkleBranch(block);
+                                    pwalletMain->AddToWallet(wtx);
+                                    setAddedToWallet.insert(txid);
+                                }
                             }
-                        }
 
-                        //Check if the mint was ever spent
-                        int nHeightSpend = 0;
-                        uint256 txidSpend;
-                        CTransaction txSpend;
-                        if (IsSerialInBlockchain(GetSerialHash(m.GetSerialNumber()), nHeightSpend, txidSpend, txSpend)) {
-                            if (setAddedToWallet.count(txidSpend) || mapWallet.count(txidSpend))
-                                continue;
-
-                            CWalletTx wtx(pwalletMain, txSpend);
-                            CBlockIndex* pindexSpend = chainActive[nHeightSpend];
-                            CBlock blockSpend;
-                            if (ReadBlockFromDisk(blockSpend, pindexSpend))
-                                wtx.SetMerkleBranch(blockSpend);
-
-                            wtx.nTimeReceived = pindexSpend->nTime;
-                            pwalletMain->AddToWallet(wtx);
-                            setAddedToWallet.emplace(txidSpend);
+                            //Check if the mint was ever spent
+                            int nHeightSpend = 0;
+                            uint256 txidSpend;
+                            CTransaction txSpend;
+                            if (IsSerialInBlockchain(GetSerialHash(m.GetSerialNumber()), nHeightSpend, txidSpend, txSpend)) {
+                                if (setAddedToWallet.count(txidSpend) || mapWallet.count(txidSpend))
+                                    continue;
+
+                                CWalletTx wtx(pwalletMain, txSpend);
+                                CBlockIndex* pindexSpend = chainActive[nHeightSpend];
+                                CBlock blockSpend;
+                                if (ReadBlockFromDisk(blockSpend, pindexSpend))
+                                    wtx.SetMerkleBranch(blockSpend);
+
+                                wtx.nTimeReceived = pindexSpend->nTime;
+                                pwalletMain->AddToWallet(wtx);
+                                setAddedToWallet.emplace(txidSpend);
+                            }
                         }
                     }
                 }
+
+                if (GetTime() >= nNow + 60) {
+                    nNow = GetTime();
+                    LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(pindex));
+                }
             }
+        }
+        threadRead.join();
 
-            pindex = chainActive.Next(pindex);
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(pindex));
+        // A reorg since the next chunk was picked means it does not follow on
+        // from what was just scanned: pick it again from the active chain
+        if (pindexResume && (vNext.empty() ? pindexResume != vChunk.back().pindex : vNext.front().pindex->pprev != pindexResume)) {
+            {
+                LOCK(cs_main);
+                GetRescanChunk(chainActive.Next(chainActive.FindFork(pindexResume)), vNext);
             }
+            ReadRescanChunk(&vNext);
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
+    nRescanHeight = -1;
+    nRescanProgress = 0;
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -1632,9 +1814,9 @@ CAmount CWallet::GetBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -1682,9 +1864,9 @@ CAmount CWallet::GetUnlockedCoins() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
                 nTotal += pcoin->GetUnlockedCredit();
         }
@@ -1700,9 +1882,9 @@ CAmount CWallet::GetLockedCoins() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
                 nTotal += pcoin->GetLockedCredit();
         }
@@ -1734,9 +1916,9 @@ CAmount CWallet::GetAnonymizableBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAnonymizableCredit();
         }
@@ -1752,9 +1934,9 @@ CAmount CWallet::GetAnonymizedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAnonymizedCredit();
         }
@@ -1774,10 +1956,10 @@ double CWallet::GetAverageAnonymizedRounds() const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
-            uint256 hash = (*it).first;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
+            const uint256& hash = pcoin->GetHash();
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
                 CTxIn vin = CTxIn(hash, i);
@@ -1806,10 +1988,10 @@ CAmount CWallet::GetNormalizedAnonymizedBalance() const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
-            uint256 hash = (*it).first;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
+            const uint256& hash = pcoin->GetHash();
 
             for (unsigned int i = 0; i < pcoin->vout.size(); i++) {
                 CTxIn vin = CTxIn(hash, i);
@@ -1833,9 +2015,9 @@ CAmount CWallet::GetDenominatedBalance(bool unconfirmed) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             nTotal += pcoin->GetDenominatedCredit(unconfirmed);
         }
     }
@@ -1848,8 +2030,9 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -1862,8 +2045,9 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -1875,8 +2059,9 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -1890,8 +2075,9 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (!IsFinalTx(*pcoin) || (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0))
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -1904,8 +2090,9 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -1917,8 +2104,9 @@ CAmount CWallet::GetLockedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
             if (pcoin->IsTrusted() && pcoin->GetDepthInMainChain() > 0)
                 nTotal += pcoin->GetLockedWatchOnlyCredit();
         }
@@ -1935,10 +2123,10 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
-
+        std::vector<const CWalletTx*> vWtx;
+        GetUnspentWalletTx(vWtx);
+        BOOST_FOREACH (const CWalletTx* pcoin, vWtx) {
+            const uint256& wtxid = pcoin->GetHash();
             if (!CheckFinalTx(*pcoin))
                 continue;
 
@@ -1992,11 +2180,11 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
                 if (mine == ISMINE_WATCH_ONLY && nWatchonlyConfig == 1)
                     continue;
 
-                if (IsLockedCoin((*it).first, i) && nCoinType != ONLY_10000)
+                if (IsLockedCoin(wtxid, i) && nCoinType != ONLY_10000)
                     continue;
                 if (pcoin->vout[i].nValue <= 0 && !fIncludeZeroValue)
                     continue;
-                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected((*it).first, i))
+                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(wtxid, i))
                     continue;
 
                 bool fIsSpendable = false;
@@ -2088,37 +2276,77 @@ bool less_then_denom(const COutput& out1, const COutput& out2)
     return (!found1 && found2);
 }
 
+void CWallet::UpdateStakeCandidates()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    if (!fStakeCandidatesDirty && pindexStakeCandidates == pindexTip)
+        return;
+
+    // Stake modifiers are derived from the blocks following the input, a reorg may change them
+    if (pindexStakeCandidates && pindexTip->GetAncestor(pindexStakeCandidates->nHeight) != pindexStakeCandidates)
+        mapStakeCandidates.clear();
+
+    vector<COutput> vCoins;
+    AvailableCoins(vCoins, true, NULL, false, STAKABLE_COINS);
+
+    std::map<COutPoint, CVitStake> mapCandidates;
+    for (const COutput& out : vCoins) {
+        if (!out.tx->hashBlock)
+            continue;
+
+        BlockMap::iterator mi = mapBlockIndex.find(out.tx->hashBlock);
+        if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second))
+            continue;
+
+        // Keep the kernel data of inputs we already know about
+        const COutPoint outpoint(out.tx->GetHash(), out.i);
+        std::map<COutPoint, CVitStake>::iterator it = mapStakeCandidates.find(outpoint);
+        if (it != mapStakeCandidates.end() && it->second.GetIndexFrom() == mi->second) {
+            mapCandidates.insert(*it);
+            continue;
+        }
+
+        CVitStake& input = mapCandidates[outpoint];
+        input.SetInput((CTransaction) *out.tx, out.i);
+        input.SetIndexFrom(mi->second);
+    }
+
+    mapStakeCandidates.swap(mapCandidates);
+    pindexStakeCandidates = pindexTip;
+    fStakeCandidatesDirty = false;
+}
+
 bool CWallet::SelectStakeCoins(std::list<std::unique_ptr<CStakeInput> >& listInputs, CAmount nTargetAmount,
         int blockHeight, bool fPrecompute)
 {
-    LOCK(cs_main);
+    LOCK2(cs_main, cs_wallet);
     //Add PIV
-    vector<COutput> vCoins;
-    AvailableCoins(vCoins, true, NULL, false, STAKABLE_COINS);
     CAmount nAmountSelected = 0;
     if (GetBoolArg("-vitstake", true)) {
-        for (const COutput &out : vCoins) {
+        UpdateStakeCandidates();
+        const bool fModifierV1 = !Params().IsStakeModifierV2(blockHeight, getStakeModifierV2SporkValue());
+        for (std::pair<const COutPoint, CVitStake>& candidate : mapStakeCandidates) {
+            CVitStake& stake = candidate.second;
             //make sure not to outrun target amount
-            if (nAmountSelected + out.tx->vout[out.i].nValue > nTargetAmount)
+            if (nAmountSelected + stake.GetValue() > nTargetAmount)
                 continue;
 
-            if (out.tx->vin[0].IsZerocoinSpend() && !out.tx->IsInMainChain())
-                continue;
-
-            if (!out.tx->hashBlock)
-                continue;
-
-            CBlockIndex* utxoBlock = mapBlockIndex.at(out.tx->hashBlock);
+            CBlockIndex* utxoBlock = stake.GetIndexFrom();
             //check for maturity (min age/depth)
             if (!Params().HasStakeMinAgeOrDepth(blockHeight, GetAdjustedTime(), utxoBlock->nHeight, utxoBlock->GetBlockTime(), getStakeModifierV2SporkValue()))
                 continue;
 
-            //add to our stake set
-            nAmountSelected += out.tx->vout[out.i].nValue;
+            // Look up the v1 modifier once, the copy below carries it
+            uint64_t nStakeModifier;
+            if (fModifierV1 && !stake.GetModifier(nStakeModifier))
+                continue;
 
-            std::unique_ptr<CVitStake> input(new CVitStake());
-            input->SetInput((CTransaction) *out.tx, out.i);
-            listInputs.emplace_back(std::move(input));
+            //add to our stake set
+            nAmountSelected += stake.GetValue();
+            listInputs.emplace_back(new CVitStake(stake));
         }
     }
 
@@ -3035,15 +3263,21 @@ bool CWallet::CreateCoinStake(
     bool fKernelFound = false;
     int nAttempts = 0;
 
-    for (std::unique_ptr<CStakeInput>& stakeInput : listInputs) {
+    // Drop an input that met the target but could not be used, and search the others again
+    auto dropInput = [&listInputs](CStakeInput* stakeInput) {
+        listInputs.remove_if([stakeInput](const std::unique_ptr<CStakeInput>& input) { return input.get() == stakeInput; });
+    };
+
+    while (!listInputs.empty()) {
         // Make sure the wallet is unlocked and shutdown hasn't been requested
         if (IsLocked() || ShutdownRequested())
             return false;
 
         uint256 hashProofOfStake = 0;
-        nAttempts++;
-        //iterates each utxo inside of CheckStakeKernelHash()
-        if (Stake(pindexPrev, stakeInput.get(), nBits, nTxNewTime, hashProofOfStake)) {
+        CStakeInput* stakeInput = nullptr;
+        nAttempts += listInputs.size();
+        //searches every utxo and time slot on the stake threads
+        if (StakeSearch(pindexPrev, listInputs, nBits, stakeInput, nTxNewTime, hashProofOfStake)) {
 
             // Found a kernel
             LogPrintf("CreateCoinStake : kernel found\n");
@@ -3054,53 +3288,28 @@ bool CWallet::CreateCoinStake(
             nReward = GetBlockValue(chainActive.Height() + 1);
             nCredit += nReward;
 
-            // Create the output transaction(s)
-            vector<CTxOut> vout;
-            if (!stakeInput->CreateTxOuts(this, vout, nCredit)) {
-                LogPrintf("%s : failed to get scriptPubKey\n", __func__);
+            // Create the output transaction(s) and the input
+            if (!FillCoinStake(stakeInput, nCredit, bMasterNodePayment, txNew)) {
+                nCredit = 0;
+                dropInput(stakeInput);
                 continue;
             }
-            txNew.vout.insert(txNew.vout.end(), vout.begin(), vout.end());
-
-            CAmount nMinFee = 0;
-            if (!stakeInput->IsZVIT()) {
-                // Set output amount
-                if (txNew.vout.size() == 3) {
-                    txNew.vout[1].nValue = ((nCredit - nMinFee) / 2 / CENT) * CENT;
-                    txNew.vout[2].nValue = nCredit - nMinFee - txNew.vout[1].nValue;
-                } else
-                    txNew.vout[1].nValue = nCredit - nMinFee;
-            }
 
             // Limit size
             unsigned int nBytes = ::GetSerializeSize(txNew, SER_NETWORK, PROTOCOL_VERSION);
             if (nBytes >= DEFAULT_BLOCK_MAX_SIZE / 5)
                 return error("CreateCoinStake : exceeded coinstake size limit");
 
-            //Masternode payment
-            FillBlockPayee(txNew, nMinFee, true, bMasterNodePayment);
-
-            uint256 hashTxOut = txNew.GetHash();
-            CTxIn in;
-            if (!stakeInput->CreateTxIn(this, in, hashTxOut)) {
-                LogPrintf("%s : failed to create TxIn\n", __func__);
-                txNew.vin.clear();
-                txNew.vout.clear();
-                nCredit = 0;
-                continue;
-            }
-            txNew.vin.emplace_back(in);
-
             //Mark mints as spent
             if (stakeInput->IsZVIT()) {
-                CZVitStake* z = (CZVitStake*)stakeInput.get();
+                CZVitStake* z = (CZVitStake*)stakeInput;
                 if (!z->MarkSpent(this, txNew.GetHash()))
                     return error("%s: failed to mark mint as used\n", __func__);
             }
 
             fKernelFound = true;
-            break;
         }
+        break;
     }
     LogPrint("staking", "%s: attempted staking %d times\n", __func__, nAttempts);
 
@@ -3144,6 +3353,47 @@ bool CWallet::CreateCoinStake(
     return true;
 }
 
+bool CWallet::FillCoinStake(CStakeInput* stakeInput, CAmount nCredit, bool fMasterNodePayment, CMutableTransaction& txNew)
+{
+    // Back to just the coin stake marker on failure, so that another input can be tried
+    auto resetCoinStake = [&txNew]() {
+        txNew.vin.clear();
+        txNew.vout.clear();
+        txNew.vout.push_back(CTxOut(0, CScript()));
+    };
+
+    vector<CTxOut> vout;
+    if (!stakeInput->CreateTxOuts(this, vout, nCredit) || vout.empty()) {
+        LogPrintf("%s : failed to get scriptPubKey\n", __func__);
+        resetCoinStake();
+        return false;
+    }
+    txNew.vout.insert(txNew.vout.end(), vout.begin(), vout.end());
+
+    CAmount nMinFee = 0;
+    if (!stakeInput->IsZVIT()) {
+        // Set output amount
+        if (txNew.vout.size() == 3) {
+            txNew.vout[1].nValue = ((nCredit - nMinFee) / 2 / CENT) * CENT;
+            txNew.vout[2].nValue = nCredit - nMinFee - txNew.vout[1].nValue;
+        } else
+            txNew.vout[1].nValue = nCredit - nMinFee;
+    }
+
+    //Masternode payment
+    FillBlockPayee(txNew, nMinFee, true, fMasterNodePayment);
+
+    uint256 hashTxOut = txNew.GetHash();
+    CTxIn in;
+    if (!stakeInput->CreateTxIn(this, in, hashTxOut)) {
+        LogPrintf("%s : failed to create TxIn\n", __func__);
+        resetCoinStake();
+        return false;
+    }
+    txNew.vin.emplace_back(in);
+    return true;
+}
+
 /**
  * Call after CreateTransaction unless you want to abort
  */
@@ -3819,18 +4069,21 @@ void CWallet::LockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.insert(output);
+    fStakeCandidatesDirty = true;
 }
 
 void CWallet::UnlockCoin(COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    fStakeCandidatesDirty = true;
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.clear();
+    fStakeCandidatesDirty = true;
 }
 
 bool CWallet::IsLockedCoin(uint256 hash, unsigned int n) const
@@ -4540,15 +4793,19 @@ bool CWallet::MintToTxIn(CZerocoinMint zerocoinSelected, int nSecurityLevel, con
         return false;
     }
 
-    // 3. Compute Accumulator and Witness
+    // 3. Compute Accumulator and Witness, resuming from the cached witness of this mint if there is one
     libzerocoin::Accumulator accumulator(paramsAccumulator, pubCoinSelected.getDenomination());
     libzerocoin::AccumulatorWitness witness(paramsAccumulator, accumulator, pubCoinSelected);
     string strFailReason = "";
     int nMintsAdded = 0;
-    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason, pindexCheckpoint)) {
+    uint256 hashPubcoin = GetPubCoinHash(pubCoinSelected.getValue());
+    CoinWitnessData witnessData;
+    zvitTracker->GetWitnessData(hashPubcoin, witnessData);
+    if (!GenerateAccumulatorWitness(pubCoinSelected, accumulator, witness, nSecurityLevel, nMintsAdded, strFailReason, pindexCheckpoint, &witnessData)) {
         receipt.SetStatus(_("Try to spend with a higher security level to include more coins"), ZVIT_FAILED_ACCUMULATOR_INITIALIZATION);
         return error("%s : %s", __func__, receipt.GetStatusMessage());
     }
+    zvitTracker->SetWitnessData(hashPubcoin, witnessData);
 
     // Construct the CoinSpend object. This acts like a signature on the transaction.
     libzerocoin::PrivateCoin privateCoin(paramsCoin, denomination);
@@ -5328,12 +5585,17 @@ void CWallet::SetNull()
     nNextResend = 0;
     nLastResend = 0;
     nTimeFirstKey = 0;
+    nRescanHeight = -1;
+    nRescanProgress = 0;
     fWalletUnlockAnonymizeOnly = false;
     fBackupMints = false;
 
     // Stake Settings
     nStakeSplitThreshold = 2000;
     nStakeSetUpdateTime = 300; // 5 minutes
+    pindexStakeCandidates = NULL;
+    fStakeCandidatesDirty = true;
+    fWalletUTXODirty = true;
 
     //MultiSend
     vMultiSend.clear();
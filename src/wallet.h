@@ -28,6 +28,7 @@
 #include "zvittracker.h"
 
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -192,6 +193,28 @@ private:
 
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>);
 
+    /**
+     * Stakeable outputs with their kernel data (block from, stake modifier),
+     * kept across staking attempts so that every time slot only costs the
+     * kernel hash. Refreshed on wallet changes and new tips.
+     */
+    std::map<COutPoint, CVitStake> mapStakeCandidates;
+    const CBlockIndex* pindexStakeCandidates;
+    bool fStakeCandidatesDirty; // guarded by cs_wallet
+    void UpdateStakeCandidates();
+
+    /**
+     * Our outputs that no transaction in the active chain spends, a superset
+     * of the unspent coins that the balance and coin queries walk instead of
+     * all of mapWallet. Wallet changes queue the transactions they touch, or
+     * a full rebuild, and the queries apply the queue under cs_main.
+     */
+    mutable std::set<COutPoint> setWalletUTXO;
+    mutable std::set<uint256> setWalletUTXOQueue;
+    mutable bool fWalletUTXODirty;
+    void QueueWalletUTXO(const CTransaction& tx);
+    void UpdateWalletUTXO(const uint256& hash) const;
+
 public:
     bool MintableCoins();
     bool SelectStakeCoins(std::list<std::unique_ptr<CStakeInput> >& listInputs, CAmount nTargetAmount, int blockHeight, bool fPrecompute = false);
@@ -299,7 +322,14 @@ public:
 
     int64_t nTimeFirstKey;
 
+    //! Height of the block a running rescan has reached, -1 when no rescan is running
+    std::atomic<int> nRescanHeight;
+    //! Progress of the running rescan in percent, as shown by ShowProgress
+    std::atomic<int> nRescanProgress;
+
     const CWalletTx* GetWalletTx(const uint256& hash) const;
+    //! wallet transactions with outputs of ours that may be unspent, in mapWallet order
+    void GetUnspentWalletTx(std::vector<const CWalletTx*>& vWtx) const;
 
     //! check whether we are allowed to upgrade (or already support) to the named feature
     bool CanSupportFeature(enum WalletFeature wf);
@@ -379,6 +409,7 @@ public:
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFromLoadWallet = false);
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void UpdatedBlockTip(const CBlockIndex* pindex);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate = false);
@@ -422,6 +453,11 @@ public:
     bool CreateCollateralTransaction(CMutableTransaction& txCollateral, std::string& strReason);
     bool ConvertList(std::vector<CTxIn> vCoins, std::vector<int64_t>& vecAmounts);
     bool CreateCoinStake(const CKeyStore& keystore, const CBlockIndex* pindexPrev, unsigned int nBits, int64_t nSearchInterval, CMutableTransaction& txNew, int64_t& nTxNewTime);
+    /**
+     * Add the outputs and the input of stakeInput to the coin stake txNew, which holds just the
+     * coin stake marker output. On failure txNew is reset to just the marker.
+     */
+    bool FillCoinStake(CStakeInput* stakeInput, CAmount nCredit, bool fMasterNodePayment, CMutableTransaction& txNew);
     bool MultiSend();
     void AutoCombineDust();
 
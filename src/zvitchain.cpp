@@ -79,6 +79,69 @@ bool BlockToPubcoinList(const CBlock& block, std::list<libzerocoin::PublicCoin>&
     return true;
 }
 
+//return the pubcoins of a block in the form stored by the zerocoinDB's per-block pubcoin index
+bool BlockToPubcoinIndex(const CBlock& block, std::vector<CBlockPubcoin>& vPubcoins)
+{
+    for (const CTransaction& tx : block.vtx) {
+        if(!tx.IsZerocoinMint())
+            continue;
+
+        // Mints of a tx that spends an invalid outpoint are filtered out as a whole
+        bool fValid = true;
+        for (const CTxIn& in : tx.vin) {
+            if (!ValidOutPoint(in.prevout, INT_MAX)) {
+                fValid = false;
+                break;
+            }
+        }
+
+        uint256 txHash = tx.GetHash();
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            //Same edge case as BlockToPubcoinList: an invalid outpoint filters out the mints that follow it
+            if (!ValidOutPoint(COutPoint(txHash, i), INT_MAX))
+                fValid = false;
+
+            const CTxOut& txOut = tx.vout[i];
+            if(!txOut.scriptPubKey.IsZerocoinMint())
+                continue;
+
+            CValidationState state;
+            libzerocoin::PublicCoin pubCoin(Params().Zerocoin_Params(false));
+            if(!TxOutToPublicCoin(txOut, pubCoin, state))
+                return false;
+
+            vPubcoins.emplace_back(CBlockPubcoin(pubCoin.getValue(), pubCoin.getDenomination(), fValid));
+        }
+    }
+
+    return true;
+}
+
+//return the pubcoins minted in a block, using the zerocoinDB index and only falling back to reading the block from disk
+bool BlockIndexToPubcoinList(const CBlockIndex* pindex, std::list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid)
+{
+    std::vector<CBlockPubcoin> vPubcoins;
+    if (!zerocoinDB->ReadBlockPubcoins(pindex->GetBlockHash(), vPubcoins)) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex))
+            return error("%s: failed to read block from disk", __func__);
+
+        if (!BlockToPubcoinIndex(block, vPubcoins))
+            return error("%s: failed to get zerocoin mintlist from block %d", __func__, pindex->nHeight);
+
+        zerocoinDB->WriteBlockPubcoins(pindex->GetBlockHash(), vPubcoins);
+    }
+
+    for (const CBlockPubcoin& pubcoin : vPubcoins) {
+        if (fFilterInvalid && !pubcoin.IsValidOutPoint())
+            continue;
+
+        listPubcoins.emplace_back(libzerocoin::PublicCoin(Params().Zerocoin_Params(false), pubcoin.GetValue(), pubcoin.GetDenomination()));
+    }
+
+    return true;
+}
+
 //return a list of zerocoin mints contained in a specific block
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints, bool fFilterInvalid)
 {
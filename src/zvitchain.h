@@ -12,6 +12,8 @@
 #include <string>
 
 class CBlock;
+class CBlockIndex;
+class CBlockPubcoin;
 class CBigNum;
 struct CMintMeta;
 class CTransaction;
@@ -23,6 +25,8 @@ class uint256;
 
 bool BlockToMintValueVector(const CBlock& block, const libzerocoin::CoinDenomination denom, std::vector<CBigNum>& vValues);
 bool BlockToPubcoinList(const CBlock& block, std::list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid);
+bool BlockToPubcoinIndex(const CBlock& block, std::vector<CBlockPubcoin>& vPubcoins);
+bool BlockIndexToPubcoinList(const CBlockIndex* pindex, std::list<libzerocoin::PublicCoin>& listPubcoins, bool fFilterInvalid);
 bool BlockToZerocoinMintList(const CBlock& block, std::list<CZerocoinMint>& vMints, bool fFilterInvalid);
 void FindMints(std::vector<CMintMeta> vMintsToFind, std::vector<CMintMeta>& vMintsToUpdate, std::vector<CMintMeta>& vMissingMints);
 int GetZerocoinStartHeight();
@@ -6,6 +6,7 @@
 #include "txdb.h"
 #include "walletdb.h"
 #include "accumulators.h"
+#include "init.h"
 
 using namespace std;
 
@@ -319,6 +320,7 @@ void CzVITAETracker::SetPubcoinUsed(const uint256& hashPubcoin, const uint256& t
     meta.isUsed = true;
     mapPendingSpends.insert(make_pair(meta.hashSerial, txid));
     UpdateState(meta);
+    EraseWitnessData(hashPubcoin);
 }
 
 void CzVITAETracker::SetPubcoinNotUsed(const uint256& hashPubcoin)
@@ -484,7 +486,45 @@ std::set<CMintMeta> CzVITAETracker::ListMints(bool fUnusedOnly, bool fMatureOnly
     return setMints;
 }
 
+bool CzVITAETracker::GetWitnessData(const uint256& hashPubcoin, CoinWitnessData& data)
+{
+    LOCK(cs_witness);
+    if (!mapWitnessData.count(hashPubcoin))
+        return false;
+
+    data = mapWitnessData.at(hashPubcoin);
+    return true;
+}
+
+void CzVITAETracker::SetWitnessData(const uint256& hashPubcoin, const CoinWitnessData& data)
+{
+    LOCK(cs_witness);
+    mapWitnessData[hashPubcoin] = data;
+}
+
+void CzVITAETracker::EraseWitnessData(const uint256& hashPubcoin)
+{
+    LOCK(cs_witness);
+    mapWitnessData.erase(hashPubcoin);
+}
+
+//Move the cached witness of each mint that has been spent or staked before up to the given height,
+//so that the next spend or stake of it only has to add the most recent blocks
+void CzVITAETracker::AdvanceWitnesses(int nHeightTarget)
+{
+    LOCK2(cs_main, cs_witness);
+    for (auto& it : mapWitnessData) {
+        if (ShutdownRequested())
+            return;
+
+        if (!AdvanceAccumulatorWitness(it.second, nHeightTarget))
+            LogPrint("zero", "%s: failed to advance witness of pubcoinhash %s\n", __func__, it.first.GetHex());
+    }
+}
+
 void CzVITAETracker::Clear()
 {
     mapSerialHashes.clear();
+    LOCK(cs_witness);
+    mapWitnessData.clear();
 }
@@ -1,7 +1,9 @@
 #ifndef VITAE_ZVITTRACKER_H
 #define VITAE_ZVITTRACKER_H
 
+#include "accumulators.h"
 #include "primitives/zerocoin.h"
+#include "sync.h"
 #include <list>
 
 class CDeterministicMint;
@@ -13,6 +15,8 @@ private:
     std::string strWalletFile;
     std::map<uint256, CMintMeta> mapSerialHashes;
     std::map<uint256, uint256> mapPendingSpends; //serialhash, txid of spend
+    CCriticalSection cs_witness;
+    std::map<uint256, CoinWitnessData> mapWitnessData; //pubcoinhash, cached witness progress
     bool UpdateStatusInternal(const std::set<uint256>& setMempool, CMintMeta& mint);
 public:
     CzVITAETracker(std::string strWalletFile);
@@ -41,6 +45,10 @@ public:
     bool UnArchive(const uint256& hashPubcoin, bool isDeterministic);
     bool UpdateZerocoinMint(const CZerocoinMint& mint);
     bool UpdateState(const CMintMeta& meta);
+    bool GetWitnessData(const uint256& hashPubcoin, CoinWitnessData& data);
+    void SetWitnessData(const uint256& hashPubcoin, const CoinWitnessData& data);
+    void EraseWitnessData(const uint256& hashPubcoin);
+    void AdvanceWitnesses(int nHeightTarget);
     void Clear();
 };
 